@@ -0,0 +1,298 @@
+/*******************************************************************************
+*	Filename :		virtual_bench.c
+*	Developer :		Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	scheduler benchmark on a virtual clock - the whole
+*					SchedulerRun loop (peek, wait, pop, run, push back) with
+*					no wall-clock wait: n repeated tasks, each with an interval
+*					of its own, are run for a given number of events, by the
+*					binary heap & by the radix heap. the clock jumps from one
+*					run time to the next, so hours of timers take milliseconds.
+*					then the same timers, started at random phases, with a
+*					slack of 0, a quarter & a half of their intervals - the
+*					wakeups (clock jumps) they take.
+*					usage: virtual_bench.out [events]
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* clock_gettime */
+
+#include <stdio.h> 		/* printf */
+#include <stdlib.h>		/* strtoul */
+#include <stdint.h>		/* uint64_t */
+#include <time.h>		/* clock_gettime */
+
+#include "virtual_clock.h"
+
+
+/*** MACROS ***/
+#define UNUSED(x) ((void) x)
+#define DEFAULT_EVENTS (2000000)
+#define NS_IN_SEC (1000000000.0)
+#define SEED (0x2545F4914F6CDD1DULL)
+
+/*** structures ***/
+/*	a workload - count tasks, with intervals of 1 to max_interval seconds */
+typedef struct workload
+{
+	const char *name;
+	size_t count;
+	time_t max_interval;
+} workload_t;
+
+/*	shared by the tasks of a run */
+typedef struct run
+{
+	scheduler_t *scheduler;
+	size_t events;
+	size_t limit;
+} run_t;
+
+/*** benchmark functions ***/
+/*	runs events task runs of workload w on a scheduler with queue. returns the
+	events per second (of wall clock), or a negative value if it failed.
+	*simulated - the virtual seconds which have passed */
+static double RunWorkload(sched_queue_t queue, const workload_t *w,
+						  size_t events, time_t *simulated);
+
+/*	runs events task runs of workload w, each task at a random phase with a
+	slack of its interval / divisor (0 - none). returns the wakeups of the
+	scheduler per simulated hour, or a negative value if it failed */
+static double RunSlack(const workload_t *w, size_t events, time_t divisor);
+
+/*** task functions ***/
+static int TaskCount(void *run);
+
+/*** internal functions ***/
+static uint64_t NextRandom(uint64_t *state);
+static double Now(void);
+
+
+/*****************************************************************************
+*								main
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+	workload_t workloads[] =
+	{
+		{"watchdog",		4,		5},		/* a few tasks, seconds */
+		{"timers",			1000,	60},
+		{"timers",			10000,	3600},
+		{"timers",			100000,	86400},
+		{"shared",			100000,	4}		/* a handful of intervals */
+	};
+	/*	a timer a second wakes the scheduler every second anyway - slack
+		pays off for sparse timers */
+	workload_t sparse[] =
+	{
+		{"sparse",			16,		600},
+		{"sparse",			100,	3600},
+		{"sparse",			1000,	86400}
+	};
+	size_t events = DEFAULT_EVENTS;
+	time_t heap_simulated = 0;
+	time_t radix_simulated = 0;
+	double heap_rate = 0;
+	double radix_rate = 0;
+	size_t i = 0;
+	
+	if (1 < argc)
+	{
+		events = strtoul(argv[1], NULL, 10);
+	}
+	
+	printf("\n***** SCHEDULER BENCHMARK ON A VIRTUAL CLOCK *****\n\n");
+	printf("%lu task runs per run\n\n", (unsigned long)events);
+	printf("%-12s %8s %10s %14s %14s %14s\n", "workload", "tasks",
+		   "max secs", "simulated h", "heap runs/s", "radix runs/s");
+	
+	for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); ++i)
+	{
+		heap_rate = RunWorkload(SCHED_QUEUE_HEAP, &workloads[i], events,
+								&heap_simulated);
+		radix_rate = RunWorkload(SCHED_QUEUE_RADIX, &workloads[i], events,
+								 &radix_simulated);
+		
+		/* both queues must reach the same virtual time */
+		printf("%-12s %8lu %10ld %14.1f %14.0f %14.0f%s\n", workloads[i].name,
+			   (unsigned long)workloads[i].count,
+			   (long)workloads[i].max_interval,
+			   (double)heap_simulated / 3600.0, heap_rate, radix_rate,
+			   (heap_simulated == radix_simulated && 0 < heap_rate &&
+				0 < radix_rate) ? "" : "  FAIL");
+	}
+	
+	/* coalescing - fewer wakeups for the same runs */
+	printf("\n%-12s %8s %10s %14s %14s %14s\n", "workload", "tasks",
+		   "max secs", "wakeups/h", "slack 1/4", "slack 1/2");
+	
+	for (i = 0; i < sizeof(sparse) / sizeof(sparse[0]); ++i)
+	{
+		printf("%-12s %8lu %10ld %14.1f %14.1f %14.1f\n", sparse[i].name,
+			   (unsigned long)sparse[i].count, (long)sparse[i].max_interval,
+			   RunSlack(&sparse[i], events / 10, 0),
+			   RunSlack(&sparse[i], events / 10, 4),
+			   RunSlack(&sparse[i], events / 10, 2));
+	}
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								benchmark
+*******************************************************************************/
+
+/***************************** RunWorkload ************************************/
+static double RunWorkload(sched_queue_t queue, const workload_t *w,
+						  size_t events, time_t *simulated)
+{
+	virtual_clock_t *vclock = NULL;
+	scheduler_options_t options = {0};
+	run_t run = {0};
+	uint64_t state = SEED;
+	double start = 0;
+	double rate = -1;
+	size_t i = 0;
+	
+	vclock = VClockCreate(0);
+	if (NULL == vclock)
+	{
+		return (-1);
+	}
+	
+	options.queue = queue;
+	options.clock = VClockSchedClock(vclock);
+	run.scheduler = SchedulerCreateWithOptions(&options);
+	run.limit = events;
+	if (NULL == run.scheduler)
+	{
+		VClockDestroy(vclock);
+		
+		return (-1);
+	}
+	
+	/* the same random intervals for both queues */
+	for (i = 0; i < w->count; ++i)
+	{
+		if (UIDIsBad(SchedulerAddTask(run.scheduler, TaskCount, &run, 0,
+							1 + (time_t)(NextRandom(&state) % w->max_interval))))
+		{
+			break;
+		}
+	}
+	
+	if (i == w->count)
+	{
+		start = Now();
+		SchedulerRun(run.scheduler);
+		rate = (double)run.events / (Now() - start);
+	}
+	*simulated = VClockNow(vclock);
+	
+	SchedulerDestroy(run.scheduler);
+	VClockDestroy(vclock);
+	
+	return ((run.events == events) ? rate : -1);
+}
+
+
+/***************************** RunSlack ***************************************/
+static double RunSlack(const workload_t *w, size_t events, time_t divisor)
+{
+	virtual_clock_t *vclock = NULL;
+	scheduler_options_t options = {0};
+	run_t run = {0};
+	unique_id_t id = {0};
+	uint64_t state = SEED;
+	time_t interval = 0;
+	double rate = -1;
+	size_t i = 0;
+	
+	vclock = VClockCreate(0);
+	if (NULL == vclock)
+	{
+		return (-1);
+	}
+	
+	options.clock = VClockSchedClock(vclock);
+	run.scheduler = SchedulerCreateWithOptions(&options);
+	run.limit = events;
+	if (NULL == run.scheduler)
+	{
+		VClockDestroy(vclock);
+		
+		return (-1);
+	}
+	
+	/* the same intervals & phases for every slack */
+	for (i = 0; i < w->count; ++i)
+	{
+		interval = 1 + (time_t)(NextRandom(&state) % w->max_interval);
+		id = SchedulerAddTask(run.scheduler, TaskCount, &run,
+							  (time_t)(NextRandom(&state) % interval),
+							  interval);
+		if (UIDIsBad(id) || (0 != divisor &&
+			SUCCESS != SchedulerSetTaskSlack(run.scheduler, id,
+											 interval / divisor)))
+		{
+			break;
+		}
+	}
+	
+	if (i == w->count)
+	{
+		SchedulerRun(run.scheduler);
+		rate = (double)SchedulerWakeups(run.scheduler) * 3600.0 /
+			   (double)VClockNow(vclock);
+	}
+	
+	SchedulerDestroy(run.scheduler);
+	VClockDestroy(vclock);
+	
+	return ((run.events == events) ? rate : -1);
+}
+
+
+/******************************************************************************
+*								Task-functions
+*******************************************************************************/
+
+/****************************** TaskCount *************************************/
+static int TaskCount(void *run)
+{
+	run_t *this_run = (run_t *)run;
+	
+	++this_run->events;
+	if (this_run->limit == this_run->events)
+	{
+		SchedulerStop(this_run->scheduler);
+	}
+	
+	return (REPEAT);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/*************************** NextRandom ***************************************/
+static uint64_t NextRandom(uint64_t *state)
+{
+	/* xorshift64 - the same sequence for both queues */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	
+	return (*state);
+}
+
+
+/*************************** Now **********************************************/
+static double Now(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return ((double)now.tv_sec + (double)now.tv_nsec / NS_IN_SEC);
+}
@@ -0,0 +1,132 @@
+/*******************************************************************************
+*	Filename	:	virtual_clock.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	virtual clock source file
+*******************************************************************************/
+#include <stdlib.h>	/* malloc, free */
+#include <assert.h> /* assert */
+
+#include "virtual_clock.h"
+
+/***************************** structures *************************************/
+struct virtual_clock
+{
+	time_t now;
+	size_t jumps;
+};
+
+/************************* internal functions *********************************/
+/* clock_now_t of the scheduler */
+static time_t Now(void *vclock);
+
+/* clock_sleep_t of the scheduler - jumps to run_time */
+static void SleepUntil(time_t run_time, void *vclock);
+
+
+/******************************************************************************
+*							VClockCreate
+*******************************************************************************/
+virtual_clock_t *VClockCreate(time_t start)
+{
+	virtual_clock_t *new_vclock = NULL;
+	
+	new_vclock = (virtual_clock_t *)malloc(sizeof(virtual_clock_t));
+	if (NULL != new_vclock)
+	{
+		new_vclock->now = start;
+		new_vclock->jumps = 0;
+	}
+	
+	return (new_vclock);
+}
+
+
+/******************************************************************************
+*							VClockDestroy
+*******************************************************************************/
+void VClockDestroy(virtual_clock_t *vclock)
+{
+	assert(vclock);
+	
+	free(vclock);
+}
+
+
+/******************************************************************************
+*							VClockSchedClock
+*******************************************************************************/
+sched_clock_t VClockSchedClock(virtual_clock_t *vclock)
+{
+	sched_clock_t sched_clock = {0};
+	
+	assert(vclock);
+	
+	sched_clock.now_func = Now;
+	sched_clock.sleep_func = SleepUntil;
+	sched_clock.param = vclock;
+	
+	return (sched_clock);
+}
+
+
+/******************************************************************************
+*							VClockNow
+*******************************************************************************/
+time_t VClockNow(const virtual_clock_t *vclock)
+{
+	assert(vclock);
+	
+	return (vclock->now);
+}
+
+
+/******************************************************************************
+*							VClockAdvance
+*******************************************************************************/
+void VClockAdvance(virtual_clock_t *vclock, time_t seconds)
+{
+	assert(vclock);
+	assert(0 <= seconds);
+	
+	vclock->now += seconds;
+}
+
+
+/******************************************************************************
+*							VClockJumps
+*******************************************************************************/
+size_t VClockJumps(const virtual_clock_t *vclock)
+{
+	assert(vclock);
+	
+	return (vclock->jumps);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/********************************* Now ****************************************/
+static time_t Now(void *vclock)
+{
+	assert(vclock);
+	
+	return (((virtual_clock_t *)vclock)->now);
+}
+
+
+/****************************** SleepUntil ************************************/
+static void SleepUntil(time_t run_time, void *vclock)
+{
+	virtual_clock_t *this_vclock = (virtual_clock_t *)vclock;
+	
+	assert(vclock);
+	
+	/* the time never goes back */
+	if (run_time > this_vclock->now)
+	{
+		this_vclock->now = run_time;
+		++this_vclock->jumps;
+	}
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+* File name  : virtual_clock.h
+* Developer  : Eyal Weizman
+* Date		 : 2020-03-08
+* Description: virtual clock - a clock for a scheduler (scheduler_options_t)
+*			   whose time passes only when the scheduler waits: it jumps
+*			   right to the next run time. hours of timers are run at once &
+*			   in the same order every time - for tests & benchmarks.
+*			   used by the thread of the scheduler only.
+*******************************************************************************/
+#ifndef _VIRTUAL_CLOCK_H_
+#define _VIRTUAL_CLOCK_H_
+
+#include <stddef.h> /* size_t */
+#include <time.h>	/* time_t */
+
+#include "../scheduler.h"
+
+
+typedef struct virtual_clock virtual_clock_t;
+
+/***************************** VClockCreate ************************************
+ *	Description: creates a virtual clock.
+ *
+ *	Input:		 start - the time it starts from (e.g. 0, or time(NULL)).
+ *
+ *	Output:		 if success - returns a pointer to the new clock.
+ *				 Otherwise - returns NULL.
+ *
+ *	Complexity:	 O(1)
+ */
+virtual_clock_t *VClockCreate(time_t start);
+
+
+/***************************** VClockDestroy ***********************************
+ *	Description: destroys a virtual clock. the schedulers which use it must
+ *				 be destroyed first.
+ *
+ *	Input:		 vclock - pointer to a virtual clock.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void VClockDestroy(virtual_clock_t *vclock);
+
+
+/*************************** VClockSchedClock **********************************
+ *	Description: the clock to set in scheduler_options_t - the scheduler
+ *				 reads vclock, and its waits move vclock forward.
+ *
+ *	Input:		 vclock - pointer to a virtual clock.
+ *
+ *	Output:		 the scheduler clock.
+ *
+ *	Complexity:	 O(1)
+ */
+sched_clock_t VClockSchedClock(virtual_clock_t *vclock);
+
+
+/****************************** VClockNow **************************************
+ *	Description: the current virtual time.
+ *
+ *	Input:		 vclock - pointer to a virtual clock.
+ *
+ *	Output:		 the current time, in seconds.
+ *
+ *	Complexity:	 O(1)
+ */
+time_t VClockNow(const virtual_clock_t *vclock);
+
+
+/***************************** VClockAdvance ***********************************
+ *	Description: moves the virtual time forward, e.g. by a task which models
+ *				 a long run.
+ *
+ *	Input:		 vclock  - pointer to a virtual clock.
+ *				 seconds - not negative.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void VClockAdvance(virtual_clock_t *vclock, time_t seconds);
+
+
+/****************************** VClockJumps ************************************
+ *	Description: the number of waits which have moved the time forward.
+ *
+ *	Input:		 vclock - pointer to a virtual clock.
+ *
+ *	Output:		 the number of jumps.
+ *
+ *	Complexity:	 O(1)
+ */
+size_t VClockJumps(const virtual_clock_t *vclock);
+
+
+#endif /* _VIRTUAL_CLOCK_H_ */
@@ -0,0 +1,880 @@
+/******************************************************************************
+*	Filename	:	virtual_clock_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	virtual clock test file
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+#include <string.h> 	/* strcmp */
+#include <unistd.h>		/* pipe, read, write, close */
+#include <poll.h>		/* POLLIN */
+
+#include "virtual_clock.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+#define START (1000)
+#define DAY (86400)
+#define MINUTE (60)
+#define HOUR (3600)
+#define TIMERS (10)			/* one per second of the period */
+#define PERIOD (10)
+#define RUNS (100)			/* of each timer */
+#define LOG_SIZE (16)
+#define GROUPED (30)		/* timers of 3 intervals */
+#define REMOVED (5)
+#define END (START + 100)
+#define CHANGED (2)			/* timers whose interval is changed */
+#define TOGETHER (3)		/* tasks due in the same second */
+#define SLOW (2)			/* seconds a slow task runs */
+
+/***************************** structures *************************************/
+typedef struct day_data
+{
+	scheduler_t *scheduler;
+	long ticks;				/* every second */
+	long minutes;			/* every minute */
+	long hours;				/* by a coroutine */
+	int is_on_time;
+} day_data_t;
+
+typedef struct slack_data
+{
+	scheduler_t *scheduler;
+	time_t slack;
+	time_t run_time;		/* of the next run */
+	long runs;
+	int is_in_window;		/* every run within its run time + slack */
+} slack_data_t;
+
+typedef struct class_data
+{
+	scheduler_t *scheduler;
+	virtual_clock_t *vclock;
+	long critical_runs;
+	char log[LOG_SIZE];		/* a letter per run, by class */
+	size_t logged;
+} class_data_t;
+
+typedef struct fd_data
+{
+	virtual_clock_t *vclock;
+	int pipe_fds[2];		/* written by TaskWriteSlow */
+	char log[LOG_SIZE];		/* a letter per run of a task or the fd */
+	size_t logged;
+} fd_data_t;
+
+typedef struct group_timer
+{
+	scheduler_t *scheduler;
+	time_t interval;
+	time_t run_time;		/* of the next run */
+	long runs;
+	int is_on_time;
+} group_timer_t;
+
+typedef struct group_data
+{
+	scheduler_t *scheduler;
+	unique_id_t ids[GROUPED];
+	int is_changed;			/* every change by TaskChangeGroups succeeded */
+} group_data_t;
+
+typedef struct lateness_data
+{
+	virtual_clock_t *vclock;
+	unique_id_t ids[2];		/* two slow tasks, due together */
+	long lateness_ms[2];
+} lateness_data_t;
+
+typedef struct interval_data
+{
+	scheduler_t *scheduler;
+	unique_id_t ids[CHANGED];
+	group_timer_t *timers;
+	int is_changed;
+} interval_data_t;
+
+/************************** unit-test functions *******************************/
+void VClockCreateDestroyTest(void);
+void VClockAdvanceTest(void);
+void VClockSchedulerDayTest(sched_queue_t queue, const char *name);
+void VClockSlackTest(time_t slack, size_t wakeups);
+void VClockClassesTest(void);
+void VClockGroupsTest(sched_queue_t queue, const char *name);
+void VClockIntervalTest(void);
+void VClockBacklogTest(void);
+void VClockLatenessTest(void);
+void VClockFdsTest(void);
+
+/*************************** task functions ***********************************/
+static int TaskTick(void *data);
+static int TaskMinute(void *data);
+static int CoroHours(void *data);
+static int TaskPeriodic(void *data);
+static int TaskCritical(void *data);
+static int TaskSlowNormal(void *data);
+static int TaskBackground(void *data);
+static int TaskGroupTimer(void *data);
+static int TaskChangeGroups(void *data);
+static int TaskChangeIntervals(void *data);
+static int TaskOnce(void *data);
+static int TaskSlow(void *data);
+static int TaskStop(void *data);
+static int TaskWriteSlow(void *data);
+static int TaskLogCritical(void *data);
+static int TaskLogNormal(void *data);
+
+/***************************** fd functions ***********************************/
+static int FdLogRead(int fd, short revents, void *param);
+
+/*************************** helper functions *********************************/
+/* keeps the lateness of the tasks of the lateness_data_t in param */
+static int KeepLateness(unique_id_t id, const task_stats_t *stats,
+						void *param);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR VIRTUAL CLOCK'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	VClockCreateDestroyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockAdvanceTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockSchedulerDayTest(SCHED_QUEUE_HEAP, "heap");
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockSchedulerDayTest(SCHED_QUEUE_RADIX, "radix");
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	/* a wakeup per run on time, one per period when the windows overlap */
+	VClockSlackTest(0, TIMERS * RUNS);
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockSlackTest(PERIOD - 1, RUNS);
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockClassesTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockGroupsTest(SCHED_QUEUE_HEAP, "heap");
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockGroupsTest(SCHED_QUEUE_RADIX, "radix");
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockIntervalTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockBacklogTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockLatenessTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	VClockFdsTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* VClockCreateDestroyTest ****************************/
+void VClockCreateDestroyTest(void)
+{
+	virtual_clock_t *vclock = NULL;
+	sched_clock_t sched_clock = {0};
+	
+	printf("Create + Destroy:\t\t\t");
+	
+	vclock = VClockCreate(START);
+	sched_clock = VClockSchedClock(vclock);
+	
+	(NULL != vclock)							&&
+	(START == VClockNow(vclock))				&&
+	(0 == VClockJumps(vclock))					&&
+	(START == sched_clock.now_func(sched_clock.param))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockAdvanceTest **********************************/
+void VClockAdvanceTest(void)
+{
+	virtual_clock_t *vclock = NULL;
+	sched_clock_t sched_clock = {0};
+	
+	printf("Advance + sleep:\t\t\t");
+	
+	vclock = VClockCreate(START);
+	sched_clock = VClockSchedClock(vclock);
+	
+	/* advancing isn't a jump. a sleep to the past doesn't move the time */
+	VClockAdvance(vclock, 5);
+	sched_clock.sleep_func(START + 20, sched_clock.param);
+	sched_clock.sleep_func(START + 10, sched_clock.param);
+	
+	(START + 20 == VClockNow(vclock))	&&
+	(1 == VClockJumps(vclock))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockSchedulerDayTest *****************************/
+void VClockSchedulerDayTest(sched_queue_t queue, const char *name)
+{
+	virtual_clock_t *vclock = NULL;
+	scheduler_options_t options = {0};
+	day_data_t data = {NULL, 0, 0, 0, 1};
+	int ret_val_1 = STOP;
+	
+	printf("A day of timers (%s):\t\t", name);
+	
+	vclock = VClockCreate(START);
+	options.queue = queue;
+	options.clock = VClockSchedClock(vclock);
+	data.scheduler = SchedulerCreateWithOptions(&options);
+	
+	SchedulerAddTask(data.scheduler, TaskTick, &data,
+					 SchedulerNow(data.scheduler), 1);
+	SchedulerAddTask(data.scheduler, TaskMinute, &data,
+					 SchedulerNow(data.scheduler) + MINUTE, MINUTE);
+	SchedulerAddCoroutine(data.scheduler, CoroHours, &data,
+						  SchedulerNow(data.scheduler));
+	
+	/* no wall-clock wait - the clock jumps from second to second */
+	ret_val_1 = SchedulerRun(data.scheduler);
+	
+	(COMPLETE == ret_val_1)						&&
+	(DAY == data.ticks)							&&
+	(DAY / MINUTE == data.minutes)				&&
+	(DAY / HOUR == data.hours)					&&
+	(1 == data.is_on_time)						&&
+	(START + DAY == VClockNow(vclock))			&&
+	(DAY == VClockJumps(vclock))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(data.scheduler);
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockSlackTest ************************************/
+void VClockSlackTest(time_t slack, size_t wakeups)
+{
+	virtual_clock_t *vclock = NULL;
+	scheduler_options_t options = {0};
+	slack_data_t data[TIMERS] = {{NULL, 0, 0, 0, 1}};
+	unique_id_t id = {0};
+	scheduler_t *scheduler = NULL;
+	int is_set = TRUE;
+	int is_done = TRUE;
+	int i = 0;
+	
+	printf("Timers with slack %ld:\t\t\t", (long)slack);
+	
+	vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(vclock);
+	scheduler = SchedulerCreateWithOptions(&options);
+	
+	/* a timer for each second of the period */
+	for (i = 0; i < TIMERS; ++i)
+	{
+		data[i].scheduler = scheduler;
+		data[i].slack = slack;
+		data[i].run_time = START + 1 + i;
+		data[i].runs = 0;
+		data[i].is_in_window = 1;
+		id = SchedulerAddTask(scheduler, TaskPeriodic, &data[i],
+							  data[i].run_time, PERIOD);
+		is_set &= (SUCCESS == SchedulerSetTaskSlack(scheduler, id, slack));
+	}
+	
+	SchedulerRun(scheduler);
+	
+	for (i = 0; i < TIMERS; ++i)
+	{
+		is_done &= (RUNS == data[i].runs) && (1 == data[i].is_in_window);
+	}
+	
+	(TRUE == is_set)							&&
+	(TRUE == is_done)							&&
+	(wakeups == SchedulerWakeups(scheduler))	&&
+	(wakeups == VClockJumps(vclock))			&&
+	(FAILURE == SchedulerSetTaskSlack(scheduler, id, slack))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(scheduler);
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockClassesTest **********************************/
+void VClockClassesTest(void)
+{
+	scheduler_options_t options = {0};
+	class_data_t data = {0};
+	sched_class_stats_t critical = {0};
+	sched_class_stats_t normal = {0};
+	sched_class_stats_t background = {0};
+	unique_id_t id = {0};
+	int is_set = TRUE;
+	
+	printf("Priority classes:\t\t\t");
+	
+	data.vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(data.vclock);
+	data.scheduler = SchedulerCreateWithOptions(&options);
+	
+	/* all due at the same second - added from the lowest class up */
+	id = SchedulerAddTask(data.scheduler, TaskBackground, &data, START + 1, 5);
+	is_set &= (SUCCESS == SchedulerSetTaskClass(data.scheduler, id,
+												TASK_BACKGROUND));
+	SchedulerAddTask(data.scheduler, TaskSlowNormal, &data, START + 1, 0);
+	id = SchedulerAddTask(data.scheduler, TaskCritical, &data, START + 1, 1);
+	is_set &= (SUCCESS == SchedulerSetTaskClass(data.scheduler, id,
+												TASK_CRITICAL));
+	
+	SchedulerRun(data.scheduler);
+	
+	SchedulerGetClassStats(data.scheduler, TASK_CRITICAL, &critical);
+	SchedulerGetClassStats(data.scheduler, TASK_NORMAL, &normal);
+	SchedulerGetClassStats(data.scheduler, TASK_BACKGROUND, &background);
+	
+	/*	the slow task makes the critical one late - the background one is
+		put off to the next second */
+	(TRUE == is_set)						&&
+	(0 == strcmp("CSCCBC", data.log))		&&
+	(4 == critical.runs)					&&
+	(1 == critical.late_runs)				&&
+	(1 == critical.max_lateness)			&&
+	(1 == normal.runs)						&&
+	(0 == normal.late_runs)					&&
+	(1 == background.runs)					&&
+	(0 == background.late_runs)				&&
+	(1 == background.deferrals)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(data.scheduler);
+	VClockDestroy(data.vclock);
+}
+
+
+/************************* VClockGroupsTest ***********************************/
+void VClockGroupsTest(sched_queue_t queue, const char *name)
+{
+	scheduler_options_t options = {0};
+	virtual_clock_t *vclock = NULL;
+	group_timer_t timers[GROUPED] = {{NULL, 0, 0, 0, 1}};
+	group_data_t data = {0};
+	unique_id_t id = {0};
+	time_t start = 0;
+	time_t last = 0;
+	int is_done = TRUE;
+	int i = 0;
+	
+	printf("Interval groups (%s):\t\t", name);
+	
+	vclock = VClockCreate(START);
+	options.queue = queue;
+	options.clock = VClockSchedClock(vclock);
+	data.scheduler = SchedulerCreateWithOptions(&options);
+	data.is_changed = TRUE;
+	
+	/*	intervals of 1, 2 & 3 seconds at various phases - each re-armed into
+		the group of its interval after its first run */
+	for (i = 0; i < GROUPED; ++i)
+	{
+		timers[i].scheduler = data.scheduler;
+		timers[i].interval = 1 + i % 3;
+		timers[i].run_time = START + 1 + i % 5;
+		timers[i].runs = 0;
+		timers[i].is_on_time = 1;
+		data.ids[i] = SchedulerAddTask(data.scheduler, TaskGroupTimer,
+									   &timers[i], timers[i].run_time,
+									   timers[i].interval);
+	}
+	
+	/* both run first in their seconds */
+	id = SchedulerAddTask(data.scheduler, TaskChangeGroups, &data,
+						  START + 10, 0);
+	SchedulerSetTaskClass(data.scheduler, id, TASK_CRITICAL);
+	id = SchedulerAddTask(data.scheduler, TaskStop, data.scheduler, END, 0);
+	SchedulerSetTaskClass(data.scheduler, id, TASK_CRITICAL);
+	
+	SchedulerRun(data.scheduler);
+	
+	/* the first ones were removed at START + 10 */
+	for (i = 0; i < GROUPED; ++i)
+	{
+		start = START + 1 + i % 5;
+		last = (REMOVED > i) ? START + 9 : END - 1;
+		is_done &= (1 == timers[i].is_on_time) &&
+				   ((last - start) / timers[i].interval + 1 == timers[i].runs);
+	}
+	
+	(TRUE == is_done)										&&
+	(TRUE == data.is_changed)								&&
+	(GROUPED - REMOVED == (int)SchedulerSize(data.scheduler))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(data.scheduler);
+	VClockDestroy(vclock);
+}
+
+/************************* VClockIntervalTest *********************************/
+void VClockIntervalTest(void)
+{
+	scheduler_options_t options = {0};
+	virtual_clock_t *vclock = NULL;
+	group_timer_t timers[CHANGED] = {{NULL, 0, 0, 0, 1}};
+	interval_data_t data = {0};
+	unique_id_t id = {0};
+	int i = 0;
+	
+	printf("Intervals changed:\t\t\t");
+	
+	vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(vclock);
+	data.scheduler = SchedulerCreateWithOptions(&options);
+	data.timers = timers;
+	data.is_changed = TRUE;
+	
+	/* from 10 to 2 seconds, and from 2 to 4 */
+	for (i = 0; i < CHANGED; ++i)
+	{
+		timers[i].scheduler = data.scheduler;
+		timers[i].interval = (0 == i) ? 10 : 2;
+		timers[i].run_time = (0 == i) ? START + 10 : START + 4;
+		timers[i].runs = 0;
+		timers[i].is_on_time = 1;
+		data.ids[i] = SchedulerAddTask(data.scheduler, TaskGroupTimer,
+									   &timers[i], timers[i].run_time,
+									   timers[i].interval);
+	}
+	
+	id = SchedulerAddTask(data.scheduler, TaskChangeIntervals, &data,
+						  START + 3, 0);
+	SchedulerSetTaskClass(data.scheduler, id, TASK_CRITICAL);
+	id = SchedulerAddTask(data.scheduler, TaskStop, data.scheduler,
+						  START + 20, 0);
+	SchedulerSetTaskClass(data.scheduler, id, TASK_CRITICAL);
+	
+	SchedulerRun(data.scheduler);
+	
+	/*	the first is brought forward to START + 5, then 7 ... 19. the second
+		keeps its run at START + 4, then 8, 12, 16 */
+	(TRUE == data.is_changed)										&&
+	(1 == timers[0].is_on_time) && (8 == timers[0].runs)			&&
+	(1 == timers[1].is_on_time) && (4 == timers[1].runs)			&&
+	(FAILURE == SchedulerSetTaskInterval(data.scheduler, id, 1))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(data.scheduler);
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockBacklogTest **********************************/
+void VClockBacklogTest(void)
+{
+	scheduler_options_t options = {0};
+	virtual_clock_t *vclock = NULL;
+	scheduler_t *scheduler = NULL;
+	long runs = 0;
+	size_t size = 0;
+	size_t max_backlog = 0;
+	size_t backlog = 0;
+	int i = 0;
+	
+	printf("Size + Backlog:\t\t\t\t");
+	
+	vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(vclock);
+	scheduler = SchedulerCreateWithOptions(&options);
+	
+	/*	TOGETHER tasks in the first second, then one alone, then the stop */
+	for (i = 0; i < TOGETHER; ++i)
+	{
+		SchedulerAddTask(scheduler, TaskOnce, &runs, START + 1, 0);
+	}
+	SchedulerAddTask(scheduler, TaskOnce, &runs, START + 2, 0);
+	SchedulerAddTask(scheduler, TaskStop, scheduler, START + 3, 0);
+	size = SchedulerSize(scheduler);
+	
+	SchedulerRun(scheduler);
+	backlog = SchedulerBacklog(scheduler, &max_backlog);
+	
+	(TOGETHER + 2 == size)					&&
+	(TOGETHER + 1 == runs)					&&
+	(1 == backlog)							&&
+	(TOGETHER == max_backlog)				&&
+	(0 == SchedulerSize(scheduler))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(scheduler);
+	VClockDestroy(vclock);
+}
+
+
+/************************* VClockLatenessTest *********************************/
+void VClockLatenessTest(void)
+{
+	scheduler_options_t options = {0};
+	lateness_data_t data = {0};
+	scheduler_t *scheduler = NULL;
+	long expected_ms = 0;
+	
+	printf("Lateness (virtual clock):\t\t");
+	
+	data.vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(data.vclock);
+	scheduler = SchedulerCreateWithOptions(&options);
+	
+	/*	both are due at START + 1 - the critical one runs first, and delays
+		the other by SLOW seconds of the virtual clock */
+	data.ids[0] = SchedulerAddTask(scheduler, TaskSlow, data.vclock,
+								   START + 1, DAY);
+	SchedulerSetTaskClass(scheduler, data.ids[0], TASK_CRITICAL);
+	data.ids[1] = SchedulerAddTask(scheduler, TaskSlow, data.vclock,
+								   START + 1, DAY);
+	SchedulerAddTask(scheduler, TaskStop, scheduler, START + 1 + SLOW, 0);
+	
+	SchedulerRun(scheduler);
+	SchedulerForEachTask(scheduler, KeepLateness, &data);
+	
+	/* the stats are collected only with WD_TASK_STATS */
+	#ifdef WD_TASK_STATS
+	expected_ms = SLOW * 1000;
+	#else
+	expected_ms = 0;
+	#endif
+	
+	(0 == data.lateness_ms[0])				&&
+	(expected_ms == data.lateness_ms[1])	&&
+	(START + 1 + 2 * SLOW == VClockNow(data.vclock))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(scheduler);
+	VClockDestroy(data.vclock);
+}
+
+
+/************************* VClockFdsTest **************************************/
+void VClockFdsTest(void)
+{
+	scheduler_options_t options = {0};
+	fd_data_t data = {0};
+	scheduler_t *scheduler = NULL;
+	unique_id_t id = {0};
+	int is_added = TRUE;
+	
+	printf("Fds after the critical tasks:\t\t");
+	
+	data.vclock = VClockCreate(START);
+	options.clock = VClockSchedClock(data.vclock);
+	scheduler = SchedulerCreateWithOptions(&options);
+	is_added &= (0 == pipe(data.pipe_fds));
+	is_added &= (SUCCESS == SchedulerAddFd(scheduler, data.pipe_fds[0],
+										   POLLIN, FdLogRead, &data));
+	
+	/*	the pipe is written by a slow critical task - by then another
+		critical one & a normal one are due. the fd is served between
+		them: after the critical, ahead of the normal */
+	id = SchedulerAddTask(scheduler, TaskWriteSlow, &data, START + 1, 0);
+	SchedulerSetTaskClass(scheduler, id, TASK_CRITICAL);
+	id = SchedulerAddTask(scheduler, TaskLogCritical, &data, START + 2, 0);
+	SchedulerSetTaskClass(scheduler, id, TASK_CRITICAL);
+	SchedulerAddTask(scheduler, TaskLogNormal, &data, START + 2, 0);
+	
+	SchedulerRun(scheduler);
+	
+	(TRUE == is_added)						&&
+	(0 == strcmp("WCFN", data.log))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(scheduler);
+	VClockDestroy(data.vclock);
+	close(data.pipe_fds[0]);
+	close(data.pipe_fds[1]);
+}
+
+
+/******************************************************************************
+*								task functions
+*******************************************************************************/
+
+/******************************** TaskTick ************************************/
+static int TaskTick(void *data)
+{
+	day_data_t *day = (day_data_t *)data;
+	
+	day->is_on_time &= (START + day->ticks == SchedulerNow(day->scheduler));
+	++day->ticks;
+	
+	return ((DAY > day->ticks) ? REPEAT : DONE);
+}
+
+
+/******************************* TaskMinute ***********************************/
+static int TaskMinute(void *data)
+{
+	day_data_t *day = (day_data_t *)data;
+	
+	++day->minutes;
+	day->is_on_time &= (START + day->minutes * MINUTE ==
+						SchedulerNow(day->scheduler));
+	
+	return ((DAY / MINUTE > day->minutes) ? REPEAT : DONE);
+}
+
+
+/******************************* CoroHours ************************************/
+static int CoroHours(void *data)
+{
+	day_data_t *day = (day_data_t *)data;
+	
+	while (DAY / HOUR > day->hours)
+	{
+		SchedulerSleepFor(HOUR);
+		++day->hours;
+	}
+	
+	return (DONE);
+}
+
+
+/****************************** TaskPeriodic **********************************/
+static int TaskPeriodic(void *data)
+{
+	slack_data_t *timer = (slack_data_t *)data;
+	time_t now = SchedulerNow(timer->scheduler);
+	
+	timer->is_in_window &= (timer->run_time <= now) &&
+						   (timer->run_time + timer->slack >= now);
+	timer->run_time = now + PERIOD;
+	++timer->runs;
+	
+	return ((RUNS > timer->runs) ? REPEAT : DONE);
+}
+
+
+/****************************** TaskCritical **********************************/
+static int TaskCritical(void *data)
+{
+	class_data_t *classes = (class_data_t *)data;
+	
+	classes->log[classes->logged++] = 'C';
+	++classes->critical_runs;
+	
+	return ((4 > classes->critical_runs) ? REPEAT : DONE);
+}
+
+
+/***************************** TaskSlowNormal *********************************/
+static int TaskSlowNormal(void *data)
+{
+	class_data_t *classes = (class_data_t *)data;
+	
+	/* runs for 2 seconds */
+	classes->log[classes->logged++] = 'S';
+	VClockAdvance(classes->vclock, 2);
+	
+	return (DONE);
+}
+
+
+/***************************** TaskBackground *********************************/
+static int TaskBackground(void *data)
+{
+	class_data_t *classes = (class_data_t *)data;
+	
+	classes->log[classes->logged++] = 'B';
+	
+	return (DONE);
+}
+
+
+/***************************** TaskGroupTimer *********************************/
+static int TaskGroupTimer(void *data)
+{
+	group_timer_t *timer = (group_timer_t *)data;
+	time_t now = SchedulerNow(timer->scheduler);
+	
+	timer->is_on_time &= (timer->run_time == now);
+	timer->run_time = now + timer->interval;
+	++timer->runs;
+	
+	return (REPEAT);
+}
+
+
+/**************************** TaskChangeGroups ********************************/
+static int TaskChangeGroups(void *data)
+{
+	group_data_t *groups = (group_data_t *)data;
+	int i = 0;
+	
+	/*	removed from their groups, or moved out of them - the others of the
+		groups keep their order */
+	for (i = 0; i < REMOVED; ++i)
+	{
+		groups->is_changed &= (SUCCESS == SchedulerRemoveTask(groups->scheduler,
+															 groups->ids[i]));
+	}
+	groups->is_changed &= (SUCCESS == SchedulerSetTaskClass(groups->scheduler,
+											groups->ids[REMOVED],
+											TASK_BACKGROUND));
+	groups->is_changed &= (SUCCESS == SchedulerSetTaskBudget(groups->scheduler,
+											groups->ids[REMOVED + 1], 0));
+	
+	return (DONE);
+}
+
+
+/************************** TaskChangeIntervals *******************************/
+static int TaskChangeIntervals(void *data)
+{
+	interval_data_t *intervals = (interval_data_t *)data;
+	time_t now = SchedulerNow(intervals->scheduler);
+	
+	/* a shorter interval applies at once, a longer one from the next run */
+	intervals->timers[0].interval = 2;
+	intervals->timers[0].run_time = now + 2;
+	intervals->timers[1].interval = 4;
+	intervals->is_changed &= (SUCCESS == SchedulerSetTaskInterval(
+												intervals->scheduler,
+												intervals->ids[0], 2)) &&
+							 (SUCCESS == SchedulerSetTaskInterval(
+												intervals->scheduler,
+												intervals->ids[1], 4));
+	
+	return (DONE);
+}
+
+
+/******************************** TaskOnce ************************************/
+static int TaskOnce(void *data)
+{
+	++*(long *)data;
+	
+	return (DONE);
+}
+
+
+/******************************** TaskSlow ************************************/
+static int TaskSlow(void *data)
+{
+	VClockAdvance((virtual_clock_t *)data, SLOW);
+	
+	return (REPEAT);
+}
+
+
+/******************************** TaskStop ************************************/
+static int TaskStop(void *data)
+{
+	SchedulerStop((scheduler_t *)data);
+	
+	return (DONE);
+}
+
+
+/****************************** TaskWriteSlow *********************************/
+static int TaskWriteSlow(void *data)
+{
+	fd_data_t *fds = (fd_data_t *)data;
+	
+	/* runs for a second */
+	fds->log[fds->logged++] = (1 == write(fds->pipe_fds[1], "x", 1)) ? 'W' :
+							  '?';
+	VClockAdvance(fds->vclock, 1);
+	
+	return (DONE);
+}
+
+
+/****************************** TaskLogCritical *******************************/
+static int TaskLogCritical(void *data)
+{
+	fd_data_t *fds = (fd_data_t *)data;
+	
+	fds->log[fds->logged++] = 'C';
+	
+	return (DONE);
+}
+
+
+/****************************** TaskLogNormal *********************************/
+static int TaskLogNormal(void *data)
+{
+	fd_data_t *fds = (fd_data_t *)data;
+	
+	fds->log[fds->logged++] = 'N';
+	
+	return (DONE);
+}
+
+
+/******************************************************************************
+*								fd functions
+*******************************************************************************/
+/******************************** FdLogRead ***********************************/
+/* this func is of type fd_func_t */
+static int FdLogRead(int fd, short revents, void *param)
+{
+	fd_data_t *fds = (fd_data_t *)param;
+	char byte = 0;
+	
+	UNUSED(revents);
+	
+	fds->log[fds->logged++] = (1 == read(fd, &byte, 1)) ? 'F' : '?';
+	
+	return (DONE);
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/******************************* KeepLateness *********************************/
+static int KeepLateness(unique_id_t id, const task_stats_t *stats,
+						void *param)
+{
+	lateness_data_t *data = (lateness_data_t *)param;
+	int i = 0;
+	
+	for (i = 0; i < 2; ++i)
+	{
+		if (UIDIsSame(id, data->ids[i]))
+		{
+			data->lateness_ms[i] = stats->last_lateness_ms;
+		}
+	}
+	
+	return (SUCCESS);
+}
@@ -0,0 +1,249 @@
+/*******************************************************************************
+*	Filename	:	coro.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	coroutines source file
+*******************************************************************************/
+#define _GNU_SOURCE			/* ucontext, MAP_ANONYMOUS */
+
+#include <stdlib.h>			/* malloc, free */
+#include <assert.h>			/* assert */
+#include <ucontext.h>		/* ucontext_t, getcontext, makecontext */
+#include <sys/mman.h>		/* mmap, mprotect, munmap */
+#include <unistd.h>			/* sysconf */
+#include <pthread.h>		/* pthread_mutex_t */
+
+#include "coro.h"
+
+/******************************* MACROS ***************************************/
+#define GUARD_SIZE ((size_t)sysconf(_SC_PAGESIZE))
+#define MAP_SIZE (CORO_STACK_SIZE + GUARD_SIZE)
+
+/***************************** structures *************************************/
+struct coro_s
+{
+	ucontext_t context;
+	ucontext_t caller;			/* where CoroYield & the return go back to */
+	coro_t *resumer;			/* the coroutine which has resumed this one */
+	coro_func_t func;
+	void *data;
+	void *map;					/* the guard page, then the stack */
+	int result;
+	int is_finished;
+};
+
+/*	the free stacks. a stack is mapped & protected once, so reusing it saves
+	3 system calls per coroutine */
+typedef struct stack_pool
+{
+	pthread_mutex_t lock;
+	size_t count;
+	void *maps[CORO_POOL_SIZE];
+} stack_pool_t;
+
+/************************* internal functions *********************************/
+/* the entry point of every coroutine - runs the body of the current one */
+static void CoroEntry(void);
+
+/*	makes the context of coro start CoroEntry on its stack. kept apart from
+	CoroCreate, since getcontext may return twice */
+static status_t InitContext(coro_t *coro);
+
+/* takes a stack from the pool, or maps a new one. NULL if it can't */
+static void *StackGet(void);
+
+/* returns a stack to the pool, or unmaps it if the pool is full */
+static void StackPut(void *map);
+
+/******************************* globals **************************************/
+static _Thread_local coro_t *g_current = NULL;
+static stack_pool_t g_pool = {PTHREAD_MUTEX_INITIALIZER, 0, {NULL}};
+
+
+/******************************************************************************
+*							CoroCreate
+*******************************************************************************/
+coro_t *CoroCreate(coro_func_t func, void *data)
+{
+	coro_t *new_coro = NULL;
+	
+	assert(func);
+	
+	new_coro = (coro_t *)malloc(sizeof(coro_t));
+	if (NULL == new_coro)
+	{
+		return (NULL);
+	}
+	
+	new_coro->map = StackGet();
+	if (NULL == new_coro->map || SUCCESS != InitContext(new_coro))
+	{
+		if (NULL != new_coro->map)
+		{
+			StackPut(new_coro->map);
+		}
+		free(new_coro);
+		
+		return (NULL);
+	}
+	
+	new_coro->func = func;
+	new_coro->data = data;
+	new_coro->resumer = NULL;
+	new_coro->result = 0;
+	new_coro->is_finished = FALSE;
+	
+	return (new_coro);
+}
+
+
+/******************************************************************************
+*							CoroDestroy
+*******************************************************************************/
+void CoroDestroy(coro_t *coro)
+{
+	assert(coro);
+	assert(coro != g_current);
+	
+	StackPut(coro->map);
+	free(coro);
+}
+
+
+/******************************************************************************
+*							CoroResume
+*******************************************************************************/
+int CoroResume(coro_t *coro)
+{
+	assert(coro);
+	assert(FALSE == coro->is_finished);
+	
+	coro->resumer = g_current;
+	g_current = coro;
+	swapcontext(&coro->caller, &coro->context);
+	g_current = coro->resumer;
+	
+	return (coro->is_finished);
+}
+
+
+/******************************************************************************
+*							CoroYield
+*******************************************************************************/
+void CoroYield(void)
+{
+	coro_t *self = g_current;
+	
+	assert(self);
+	
+	swapcontext(&self->context, &self->caller);
+}
+
+
+/******************************************************************************
+*							CoroSelf
+*******************************************************************************/
+coro_t *CoroSelf(void)
+{
+	return (g_current);
+}
+
+
+/******************************************************************************
+*							CoroResult
+*******************************************************************************/
+int CoroResult(const coro_t *coro)
+{
+	assert(coro);
+	assert(coro->is_finished);
+	
+	return (coro->result);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/******************************** CoroEntry ***********************************/
+static void CoroEntry(void)
+{
+	coro_t *self = g_current;
+	
+	self->result = self->func(self->data);
+	self->is_finished = TRUE;
+	
+	/* returns into uc_link - the caller of the last CoroResume */
+}
+
+
+/******************************* InitContext **********************************/
+static status_t InitContext(coro_t *coro)
+{
+	if (-1 == getcontext(&coro->context))
+	{
+		return (FAILURE);
+	}
+	
+	coro->context.uc_stack.ss_sp = (char *)coro->map + GUARD_SIZE;
+	coro->context.uc_stack.ss_size = CORO_STACK_SIZE;
+	coro->context.uc_link = &coro->caller;
+	makecontext(&coro->context, CoroEntry, 0);
+	
+	return (SUCCESS);
+}
+
+
+/******************************** StackGet ************************************/
+static void *StackGet(void)
+{
+	void *map = NULL;
+	
+	pthread_mutex_lock(&g_pool.lock);
+	if (0 < g_pool.count)
+	{
+		--g_pool.count;
+		map = g_pool.maps[g_pool.count];
+	}
+	pthread_mutex_unlock(&g_pool.lock);
+	
+	if (NULL != map)
+	{
+		return (map);
+	}
+	
+	map = mmap(NULL, MAP_SIZE, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if (MAP_FAILED == map)
+	{
+		return (NULL);
+	}
+	
+	/* the stack grows down - an overflow hits the guard page & faults */
+	if (-1 == mprotect(map, GUARD_SIZE, PROT_NONE))
+	{
+		munmap(map, MAP_SIZE);
+		
+		return (NULL);
+	}
+	
+	return (map);
+}
+
+
+/******************************** StackPut ************************************/
+static void StackPut(void *map)
+{
+	pthread_mutex_lock(&g_pool.lock);
+	if (CORO_POOL_SIZE > g_pool.count)
+	{
+		g_pool.maps[g_pool.count] = map;
+		++g_pool.count;
+		map = NULL;
+	}
+	pthread_mutex_unlock(&g_pool.lock);
+	
+	if (NULL != map)
+	{
+		munmap(map, MAP_SIZE);
+	}
+}
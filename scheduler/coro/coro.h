@@ -0,0 +1,108 @@
+/*******************************************************************************
+* File name  : coro.h
+* Developer  : Eyal Weizman
+* Date		 : 2020-03-08
+* Description: stackful coroutines - a function which may suspend itself
+*			   (CoroYield) in the middle, and is continued later from the
+*			   same point by CoroResume. each runs on a stack of its own,
+*			   taken from a pool shared by all the threads.
+*******************************************************************************/
+#ifndef _CORO_H_
+#define _CORO_H_
+
+#include <stddef.h> /* size_t */
+
+#include "../../utils/general_types.h"
+
+/*** MACROS ***/
+#define CORO_STACK_SIZE (64 * 1024)	/* bytes, and a guard page below */
+#define CORO_POOL_SIZE (64)			/* free stacks kept for reuse */
+
+
+typedef struct coro_s coro_t;
+
+/* coro_func_t is the body of a coroutine. its return value is kept as the
+*  result of the coroutine (CoroResult).
+*/
+typedef int (*coro_func_t)(void *data);
+
+/***************************** CoroCreate **************************************
+ *	Description: creates a coroutine which hasn't started yet - the first
+ *				 CoroResume calls func(data).
+ *
+ *	Input:		 func - the body of the coroutine.
+ *				 data - passed to func.
+ *
+ *	Output:		 if success - returns a pointer to the new coroutine.
+ *				 Otherwise - returns NULL.
+ *
+ *	Complexity:	 O(1)
+ */
+coro_t *CoroCreate(coro_func_t func, void *data);
+
+
+/***************************** CoroDestroy *************************************
+ *	Description: frees a coroutine, and returns its stack to the pool. a
+ *				 suspended coroutine is discarded as is - whatever it holds
+ *				 isn't released.
+ *
+ *	Input:		 coro - pointer to a coroutine, not running now.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void CoroDestroy(coro_t *coro);
+
+
+/***************************** CoroResume **************************************
+ *	Description: runs coro (from its start, or from where it has yielded)
+ *				 until it yields or returns. a coroutine may resume another.
+ *
+ *	Input:		 coro - pointer to a coroutine which hasn't finished.
+ *
+ *	Output:		 TRUE (1) - the coroutine has finished (see CoroResult).
+ *				 FALSE (0) - it has yielded.
+ *
+ *	Complexity:	 O(1) - a context switch each way.
+ */
+int CoroResume(coro_t *coro);
+
+
+/***************************** CoroYield ***************************************
+ *	Description: suspends the running coroutine back into the one which has
+ *				 resumed it. returns once the coroutine is resumed again.
+ *				 must be called by a coroutine (CoroSelf isn't NULL).
+ *
+ *	Input:		 None.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void CoroYield(void);
+
+
+/***************************** CoroSelf ****************************************
+ *	Description: the coroutine running on the calling thread.
+ *
+ *	Output:		 pointer to the coroutine. NULL if none is running.
+ *
+ *	Complexity:	 O(1)
+ */
+coro_t *CoroSelf(void);
+
+
+/***************************** CoroResult **************************************
+ *	Description: the value returned by the body of a finished coroutine.
+ *
+ *	Input:		 coro - pointer to a finished coroutine.
+ *
+ *	Output:		 the return value of its func.
+ *
+ *	Complexity:	 O(1)
+ */
+int CoroResult(const coro_t *coro);
+
+
+#endif /* _CORO_H_ */
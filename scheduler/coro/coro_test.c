@@ -0,0 +1,223 @@
+/******************************************************************************
+*	Filename	:	coro_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	coroutines test file
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+#include <stdlib.h> 	/* malloc, free */
+
+#include "coro.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+#define STEPS (5)
+#define MANY (1000)
+
+/************************** unit-test functions *******************************/
+void CoroCreateDestroyTest(void);
+void CoroYieldResumeTest(void);
+void CoroNestedTest(void);
+void CoroManyTest(void);
+
+/*************************** coroutine bodies *********************************/
+/* counts *data up to STEPS, yielding after each step. returns STEPS */
+static int CountSteps(void *data);
+
+/* resumes the coroutine in data until it finishes, yielding in between */
+static int ResumeInner(void *data);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR CORO'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	CoroCreateDestroyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	CoroYieldResumeTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	CoroNestedTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	CoroManyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* CoroCreateDestroyTest ******************************/
+void CoroCreateDestroyTest(void)
+{
+	coro_t *coro = NULL;
+	int steps = 0;
+	
+	printf("Create + Destroy:\t\t\t");
+	
+	coro = CoroCreate(CountSteps, &steps);
+	
+	/* never resumed - the body doesn't run */
+	(NULL != coro)			&&
+	(NULL == CoroSelf())	&&
+	(0 == steps)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	CoroDestroy(coro);
+}
+
+
+/************************* CoroYieldResumeTest ********************************/
+void CoroYieldResumeTest(void)
+{
+	coro_t *coro = NULL;
+	int steps = 0;
+	int is_in_order = TRUE;
+	int i = 0;
+	
+	printf("Yield + Resume:\t\t\t\t");
+	
+	coro = CoroCreate(CountSteps, &steps);
+	
+	/* each resume runs one step, the last one returns */
+	for (i = 1; i <= STEPS; ++i)
+	{
+		is_in_order &= (FALSE == CoroResume(coro)) && (i == steps);
+	}
+	
+	(TRUE == is_in_order)			&&
+	(TRUE == CoroResume(coro))		&&
+	(STEPS == CoroResult(coro))		&&
+	(NULL == CoroSelf())
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	CoroDestroy(coro);
+}
+
+
+/************************* CoroNestedTest *************************************/
+void CoroNestedTest(void)
+{
+	coro_t *inner = NULL;
+	coro_t *outer = NULL;
+	int steps = 0;
+	int outer_yields = 0;
+	
+	printf("Coroutine resumes a coroutine:\t\t");
+	
+	inner = CoroCreate(CountSteps, &steps);
+	outer = CoroCreate(ResumeInner, inner);
+	
+	/* the inner yields back into the outer, which yields back to here */
+	while (FALSE == CoroResume(outer))
+	{
+		++outer_yields;
+	}
+	
+	(STEPS == outer_yields)			&&
+	(STEPS == steps)				&&
+	(STEPS == CoroResult(outer))	&&
+	(NULL == CoroSelf())
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	CoroDestroy(outer);
+	CoroDestroy(inner);
+}
+
+
+/************************* CoroManyTest ***************************************/
+void CoroManyTest(void)
+{
+	coro_t **coros = NULL;
+	int *steps = NULL;
+	int is_created = TRUE;
+	int finished = 0;
+	int i = 0;
+	
+	printf("%d interleaved coroutines:\t\t", MANY);
+	
+	coros = (coro_t **)malloc(MANY * sizeof(coro_t *));
+	steps = (int *)calloc(MANY, sizeof(int));
+	
+	for (i = 0; i < MANY; ++i)
+	{
+		coros[i] = CoroCreate(CountSteps, &steps[i]);
+		is_created &= (NULL != coros[i]);
+	}
+	
+	/* round robin - every coroutine keeps its own stack meanwhile */
+	while (TRUE == is_created && MANY > finished)
+	{
+		finished = 0;
+		for (i = 0; i < MANY; ++i)
+		{
+			if (STEPS < steps[i] || TRUE == CoroResume(coros[i]))
+			{
+				steps[i] = STEPS + 1;
+				++finished;
+			}
+		}
+	}
+	
+	(TRUE == is_created)	&&
+	(MANY == finished)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	for (i = 0; i < MANY; ++i)
+	{
+		if (NULL != coros[i])
+		{
+			CoroDestroy(coros[i]);
+		}
+	}
+	free(steps);
+	free(coros);
+}
+
+
+/******************************************************************************
+*							coroutine bodies
+*******************************************************************************/
+
+/****************************** CountSteps ************************************/
+static int CountSteps(void *data)
+{
+	int *steps = (int *)data;
+	
+	while (STEPS > *steps)
+	{
+		++*steps;
+		CoroYield();
+	}
+	
+	return (*steps);
+}
+
+
+/****************************** ResumeInner ***********************************/
+static int ResumeInner(void *data)
+{
+	coro_t *inner = (coro_t *)data;
+	int is_self = TRUE;
+	
+	while (FALSE == CoroResume(inner))
+	{
+		/* back in this coroutine, then out to its own resumer */
+		is_self &= (CoroSelf() != inner);
+		CoroYield();
+	}
+	
+	return (is_self ? CoroResult(inner) : -1);
+}
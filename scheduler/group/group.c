@@ -0,0 +1,274 @@
+/*******************************************************************************
+*	Filename	:	group.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	interval group source file. the tasks are kept in a ring
+*					buffer, which is doubled when it's full - its capacity is
+*					a power of 2, so a position is masked rather than divided.
+*******************************************************************************/
+#include <stdlib.h>			/* malloc, free */
+#include <assert.h>			/* assert */
+
+#include "group.h"
+
+/******************************* MACROS ***************************************/
+#define INITIAL_CAPACITY (8)		/* a power of 2 */
+
+/***************************** structures *************************************/
+struct group
+{
+	time_t interval;
+	time_t slack;
+	task_class_t task_class;
+	task_t **tasks;				/* a ring - the head at tasks[head] */
+	size_t head;
+	size_t size;
+	size_t capacity;
+};
+
+/************************* internal functions *********************************/
+/* the task at position i from the head */
+static task_t **At(const group_t *group, size_t i);
+
+/* doubles the ring, with the head moved to index 0. FAILURE if it can't */
+static status_t Grow(group_t *group);
+
+
+/******************************************************************************
+*							GroupCreate
+*******************************************************************************/
+group_t *GroupCreate(time_t interval, time_t slack, task_class_t task_class)
+{
+	group_t *new_group = NULL;
+	
+	assert(0 < interval);
+	assert(0 <= slack);
+	assert(TASK_CLASSES > task_class);
+	
+	new_group = (group_t *)malloc(sizeof(group_t));
+	if (NULL == new_group)
+	{
+		return (NULL);
+	}
+	
+	new_group->tasks = (task_t **)malloc(INITIAL_CAPACITY * sizeof(task_t *));
+	if (NULL == new_group->tasks)
+	{
+		free(new_group);
+		
+		return (NULL);
+	}
+	
+	new_group->interval = interval;
+	new_group->slack = slack;
+	new_group->task_class = task_class;
+	new_group->head = 0;
+	new_group->size = 0;
+	new_group->capacity = INITIAL_CAPACITY;
+	
+	return (new_group);
+}
+
+
+/******************************************************************************
+*							GroupDestroy
+*******************************************************************************/
+void GroupDestroy(group_t *group)
+{
+	assert(group);
+	
+	free(group->tasks);
+	group->tasks = NULL;
+	free(group);
+}
+
+
+/******************************************************************************
+*							GroupIsMatch
+*******************************************************************************/
+int GroupIsMatch(const group_t *group, task_t *task)
+{
+	assert(group);
+	assert(task);
+	
+	return (group->interval == TaskGetInterval(task) &&
+			group->slack == TaskGetSlack(task) &&
+			group->task_class == TaskGetClass(task));
+}
+
+
+/******************************************************************************
+*							GroupAppend
+*******************************************************************************/
+status_t GroupAppend(group_t *group, task_t *task)
+{
+	assert(group);
+	assert(GroupIsMatch(group, task));
+	assert(0 == group->size ||
+		   TaskGetRunTime(GroupTail(group)) <= TaskGetRunTime(task));
+	
+	if (group->capacity == group->size && SUCCESS != Grow(group))
+	{
+		return (FAILURE);
+	}
+	
+	*At(group, group->size) = task;
+	++group->size;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							GroupPeek
+*******************************************************************************/
+task_t *GroupPeek(const group_t *group)
+{
+	assert(group);
+	assert(0 < group->size);
+	
+	return (*At(group, 0));
+}
+
+
+/******************************************************************************
+*							GroupTail
+*******************************************************************************/
+task_t *GroupTail(const group_t *group)
+{
+	assert(group);
+	assert(0 < group->size);
+	
+	return (*At(group, group->size - 1));
+}
+
+
+/******************************************************************************
+*							GroupPop
+*******************************************************************************/
+task_t *GroupPop(group_t *group)
+{
+	task_t *task = NULL;
+	
+	assert(group);
+	assert(0 < group->size);
+	
+	task = *At(group, 0);
+	group->head = (group->head + 1) & (group->capacity - 1);
+	--group->size;
+	
+	return (task);
+}
+
+
+/******************************************************************************
+*							GroupErase
+*******************************************************************************/
+task_t *GroupErase(group_t *group, pq_is_match_t is_match, void *param)
+{
+	task_t *task = NULL;
+	size_t i = 0;
+	
+	assert(group);
+	assert(is_match);
+	
+	for (i = 0; i < group->size && NULL == task; ++i)
+	{
+		if (is_match(*At(group, i), param))
+		{
+			task = *At(group, i);
+		}
+	}
+	
+	if (NULL == task)
+	{
+		return (NULL);
+	}
+	
+	/* the tasks after it move one place closer to the head */
+	for (; i < group->size; ++i)
+	{
+		*At(group, i - 1) = *At(group, i);
+	}
+	--group->size;
+	
+	return (task);
+}
+
+
+/******************************************************************************
+*							GroupForEach
+*******************************************************************************/
+int GroupForEach(group_t *group, pq_action_t action, void *param)
+{
+	int ret_status = 0;
+	size_t i = 0;
+	
+	assert(group);
+	assert(action);
+	
+	for (i = 0; i < group->size && 0 == ret_status; ++i)
+	{
+		ret_status = action(*At(group, i), param);
+	}
+	
+	return (ret_status);
+}
+
+
+/******************************************************************************
+*							GroupSize
+*******************************************************************************/
+size_t GroupSize(const group_t *group)
+{
+	assert(group);
+	
+	return (group->size);
+}
+
+
+/******************************************************************************
+*							GroupIsEmpty
+*******************************************************************************/
+int GroupIsEmpty(const group_t *group)
+{
+	assert(group);
+	
+	return (0 == group->size);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/************************************ At **************************************/
+static task_t **At(const group_t *group, size_t i)
+{
+	return (&group->tasks[(group->head + i) & (group->capacity - 1)]);
+}
+
+
+/*********************************** Grow *************************************/
+static status_t Grow(group_t *group)
+{
+	task_t **tasks = NULL;
+	size_t i = 0;
+	
+	tasks = (task_t **)malloc(2 * group->capacity * sizeof(task_t *));
+	if (NULL == tasks)
+	{
+		return (FAILURE);
+	}
+	
+	for (i = 0; i < group->size; ++i)
+	{
+		tasks[i] = *At(group, i);
+	}
+	
+	free(group->tasks);
+	group->tasks = tasks;
+	group->head = 0;
+	group->capacity *= 2;
+	
+	return (SUCCESS);
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+* File name  : group.h
+* Developer  : Eyal Weizman
+* Date		 : 2020-03-08
+* Description: interval group - the repeated tasks of one interval, slack &
+*			   class, in the order of their run times. a task re-armed by
+*			   now + interval is never due before the tasks re-armed before
+*			   it, so it's appended at the tail in O(1), and only the head of
+*			   the group has to be ordered against the other groups.
+*******************************************************************************/
+#ifndef _GROUP_H_
+#define _GROUP_H_
+
+#include <stddef.h> /* size_t */
+
+#include "../../utils/general_types.h"
+#include "../task/task.h"
+#include "../pqueue/pqueue.h"
+
+
+typedef struct group group_t;
+
+/***************************** GroupCreate *************************************
+ *	Description: creates an empty group for the tasks of interval, slack &
+ *				 task_class.
+ *
+ *	Input:		 interval   - in seconds. positive.
+ *				 slack		- in seconds (see TaskSetSlack).
+ *				 task_class - the class of the tasks.
+ *
+ *	Output:		 if success - returns a pointer to the new group.
+ *				 Otherwise - returns NULL.
+ *
+ *	Complexity:	 O(1)
+ */
+group_t *GroupCreate(time_t interval, time_t slack, task_class_t task_class);
+
+
+/***************************** GroupDestroy ************************************
+ *	Description: frees a group. the tasks still in it are left as they are -
+ *				 the caller pops them first.
+ *
+ *	Input:		 group - pointer to a group.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void GroupDestroy(group_t *group);
+
+
+/***************************** GroupIsMatch ************************************
+ *	Description: whether task belongs in group - the same interval, slack &
+ *				 class.
+ *
+ *	Input:		 group - pointer to a group.
+ *				 task  - pointer to a task.
+ *
+ *	Output:		 TRUE (1) / FALSE (0).
+ *
+ *	Complexity:	 O(1)
+ */
+int GroupIsMatch(const group_t *group, task_t *task);
+
+
+/***************************** GroupAppend *************************************
+ *	Description: appends task at the tail of group. the run time of task
+ *				 isn't before that of the tail (see GroupTail).
+ *
+ *	Input:		 group - pointer to a group.
+ *				 task  - a matching task (see GroupIsMatch).
+ *
+ *	Output:		 SUCCESS / FAILURE (out of memory - task isn't appended).
+ *
+ *	Complexity:	 O(1) amortized.
+ */
+status_t GroupAppend(group_t *group, task_t *task);
+
+
+/***************************** GroupPeek ***************************************
+ *	Description: the task at the head of group - the earliest to run.
+ *
+ *	Input:		 group - pointer to a group which isn't empty.
+ *
+ *	Output:		 pointer to the task.
+ *
+ *	Complexity:	 O(1)
+ */
+task_t *GroupPeek(const group_t *group);
+
+
+/***************************** GroupTail ***************************************
+ *	Description: the task at the tail of group - the latest to run.
+ *
+ *	Input:		 group - pointer to a group which isn't empty.
+ *
+ *	Output:		 pointer to the task.
+ *
+ *	Complexity:	 O(1)
+ */
+task_t *GroupTail(const group_t *group);
+
+
+/***************************** GroupPop ****************************************
+ *	Description: removes the task at the head of group.
+ *
+ *	Input:		 group - pointer to a group which isn't empty.
+ *
+ *	Output:		 pointer to the task.
+ *
+ *	Complexity:	 O(1)
+ */
+task_t *GroupPop(group_t *group);
+
+
+/***************************** GroupErase **************************************
+ *	Description: removes the first task of group matched by is_match. the
+ *				 order of the others is kept.
+ *
+ *	Input:		 group	  - pointer to a group.
+ *				 is_match - called with each task & param.
+ *				 param	  - passed to is_match.
+ *
+ *	Output:		 pointer to the removed task. NULL if none matches.
+ *
+ *	Complexity:	 O(n)
+ */
+task_t *GroupErase(group_t *group, pq_is_match_t is_match, void *param);
+
+
+/***************************** GroupForEach ************************************
+ *	Description: applies action on every task of group, from the head, until
+ *				 it returns anything but 0.
+ *
+ *	Input:		 group  - pointer to a group.
+ *				 action - called with each task & param.
+ *				 param	- passed to action.
+ *
+ *	Output:		 0 if applied on all - otherwise what action has returned.
+ *
+ *	Complexity:	 O(n)
+ */
+int GroupForEach(group_t *group, pq_action_t action, void *param);
+
+
+/***************************** GroupSize ***************************************
+ *	Description: the number of tasks in group.
+ *
+ *	Complexity:	 O(1)
+ */
+size_t GroupSize(const group_t *group);
+
+
+/***************************** GroupIsEmpty ************************************
+ *	Description: whether group has no tasks.
+ *
+ *	Output:		 TRUE (1) / FALSE (0).
+ *
+ *	Complexity:	 O(1)
+ */
+int GroupIsEmpty(const group_t *group);
+
+
+#endif /* _GROUP_H_ */
@@ -0,0 +1,253 @@
+/******************************************************************************
+*	Filename	:	group_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	interval group test file
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+
+#include "group.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+#define INTERVAL (2)
+#define MANY (100)			/* more than the initial capacity */
+
+/************************** unit-test functions *******************************/
+void GroupCreateDestroyTest(void);
+void GroupAppendPopTest(void);
+void GroupWrapAroundTest(void);
+void GroupEraseTest(void);
+
+/*************************** helper functions *********************************/
+/* does nothing - the tasks are never run */
+static int DoNothing(void *data);
+
+/* matches the task whose data is param */
+static int IsDataMatch(void *task, void *param);
+
+/* counts the tasks in *count */
+static int CountTask(void *task, void *count);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR GROUP'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	GroupCreateDestroyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	GroupAppendPopTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	GroupWrapAroundTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	GroupEraseTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* GroupCreateDestroyTest *****************************/
+void GroupCreateDestroyTest(void)
+{
+	group_t *group = NULL;
+	task_t *task = NULL;
+	int is_match = FALSE;
+	int is_other_match = FALSE;
+	
+	printf("Create + Destroy + IsMatch:\t\t");
+	
+	group = GroupCreate(INTERVAL, 0, TASK_NORMAL);
+	task = TaskCreate(DoNothing, NULL, 0, INTERVAL);
+	
+	is_match = GroupIsMatch(group, task);
+	TaskSetClass(task, TASK_CRITICAL);
+	is_other_match = GroupIsMatch(group, task);
+	
+	(NULL != group)				&&
+	(TRUE == GroupIsEmpty(group))	&&
+	(0 == GroupSize(group))		&&
+	(TRUE == is_match)			&&
+	(FALSE == is_other_match)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	TaskDestroy(task);
+	GroupDestroy(group);
+}
+
+
+/************************* GroupAppendPopTest *********************************/
+void GroupAppendPopTest(void)
+{
+	group_t *group = NULL;
+	task_t *tasks[3] = {NULL};
+	int is_in_order = TRUE;
+	int i = 0;
+	
+	printf("Append + Peek + Pop:\t\t\t");
+	
+	group = GroupCreate(INTERVAL, 0, TASK_NORMAL);
+	
+	/* re-armed one after the other - the same or a later run time */
+	for (i = 0; i < 3; ++i)
+	{
+		tasks[i] = TaskCreate(DoNothing, NULL, 10 + i / 2, INTERVAL);
+		is_in_order &= (SUCCESS == GroupAppend(group, tasks[i]));
+	}
+	
+	is_in_order &= (tasks[0] == GroupPeek(group)) &&
+				   (tasks[2] == GroupTail(group)) &&
+				   (3 == GroupSize(group));
+	for (i = 0; i < 3; ++i)
+	{
+		is_in_order &= (tasks[i] == GroupPop(group));
+	}
+	
+	(TRUE == is_in_order)	&&
+	(TRUE == GroupIsEmpty(group))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	for (i = 0; i < 3; ++i)
+	{
+		TaskDestroy(tasks[i]);
+	}
+	GroupDestroy(group);
+}
+
+
+/************************* GroupWrapAroundTest ********************************/
+void GroupWrapAroundTest(void)
+{
+	group_t *group = NULL;
+	task_t *tasks[MANY] = {NULL};
+	int is_in_order = TRUE;
+	int popped = 0;
+	int i = 0;
+	
+	printf("%d tasks, popped while appended:\t", MANY);
+	
+	group = GroupCreate(INTERVAL, 0, TASK_NORMAL);
+	
+	/* the head moves on as the ring fills up, and grows */
+	for (i = 0; i < MANY; ++i)
+	{
+		tasks[i] = TaskCreate(DoNothing, NULL, i, INTERVAL);
+		is_in_order &= (SUCCESS == GroupAppend(group, tasks[i]));
+		if (0 == i % 3)
+		{
+			is_in_order &= (tasks[popped] == GroupPop(group));
+			++popped;
+		}
+	}
+	
+	is_in_order &= (MANY - popped == (int)GroupSize(group));
+	while (!GroupIsEmpty(group))
+	{
+		is_in_order &= (tasks[popped] == GroupPop(group));
+		++popped;
+	}
+	
+	(TRUE == is_in_order)	&&
+	(MANY == popped)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	for (i = 0; i < MANY; ++i)
+	{
+		TaskDestroy(tasks[i]);
+	}
+	GroupDestroy(group);
+}
+
+
+/************************* GroupEraseTest *************************************/
+void GroupEraseTest(void)
+{
+	group_t *group = NULL;
+	task_t *tasks[MANY] = {NULL};
+	int data[MANY] = {0};
+	int is_in_order = TRUE;
+	size_t count = 0;
+	int i = 0;
+	
+	printf("Erase + ForEach:\t\t\t");
+	
+	group = GroupCreate(INTERVAL, 0, TASK_NORMAL);
+	for (i = 0; i < MANY; ++i)
+	{
+		tasks[i] = TaskCreate(DoNothing, &data[i], i, INTERVAL);
+		GroupAppend(group, tasks[i]);
+	}
+	
+	/* from the middle, the head & the tail - the rest keep their order */
+	is_in_order &= (tasks[MANY / 2] == GroupErase(group, IsDataMatch,
+												  &data[MANY / 2])) &&
+				   (tasks[0] == GroupErase(group, IsDataMatch, &data[0])) &&
+				   (tasks[MANY - 1] == GroupErase(group, IsDataMatch,
+												  &data[MANY - 1])) &&
+				   (NULL == GroupErase(group, IsDataMatch, &data[0]));
+	
+	GroupForEach(group, CountTask, &count);
+	is_in_order &= (MANY - 3 == count) && (MANY - 3 == GroupSize(group));
+	
+	for (i = 1; i < MANY - 1; ++i)
+	{
+		if (MANY / 2 != i)
+		{
+			is_in_order &= (tasks[i] == GroupPop(group));
+		}
+	}
+	
+	(TRUE == is_in_order)	&&
+	(TRUE == GroupIsEmpty(group))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	for (i = 0; i < MANY; ++i)
+	{
+		TaskDestroy(tasks[i]);
+	}
+	GroupDestroy(group);
+}
+
+
+/******************************************************************************
+*							helper functions
+*******************************************************************************/
+
+/******************************* DoNothing ************************************/
+static int DoNothing(void *data)
+{
+	UNUSED(data);
+	
+	return (DONE);
+}
+
+
+/****************************** IsDataMatch ***********************************/
+static int IsDataMatch(void *task, void *param)
+{
+	return (TaskGetData((task_t *)task) == param);
+}
+
+
+/******************************* CountTask ************************************/
+static int CountTask(void *task, void *count)
+{
+	UNUSED(task);
+	++*(size_t *)count;
+	
+	return (0);
+}
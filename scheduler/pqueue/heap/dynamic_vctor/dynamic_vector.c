@@ -18,6 +18,11 @@ enum errors
 	SUCCESS
 };
 
+/*** MACROS ***/
+#define DEFAULT_GROWTH_PERCENT (100)
+#define DEFAULT_SHRINK_DIVISOR (4)
+#define PERCENTS (100)
+
 /*** structs ***/
 struct dynamic_vector
 {
@@ -25,8 +30,14 @@ struct dynamic_vector
 	size_t capacity; /* max size in bytes */
 	size_t size; /* the occupied size in byets */
 	void *vector; /* pointer to the vector's base */
+	dv_policy_t policy; /* when & how much the capacity changes */
 };
 
+/*** internal functions ***/
+/*	reallocs the vector to new_capacity bytes. returns FAIL if realloc failed
+	(the vector is unchanged) */
+static int Resize(dv_t *dv, size_t new_capacity);
+
 /******************************************************************************
 *								DV_Create
 *******************************************************************************/
@@ -51,6 +62,10 @@ dv_t *DVCreate(size_t capacity, size_t element_size)
 	dv->capacity = element_size * capacity;
 	dv->size = 0;
 	
+	dv->policy.growth_percent = DEFAULT_GROWTH_PERCENT;
+	dv->policy.min_capacity = capacity;
+	dv->policy.shrink_divisor = DEFAULT_SHRINK_DIVISOR;
+	
 	return (dv);
 }
 
@@ -79,14 +94,19 @@ void DVDestroy(dv_t *dv)
 *******************************************************************************/
 int DVPushBack(dv_t *dv, const void *element)
 {
+	size_t additional_size = 0;
+	
 	assert(dv);
 	assert(element);
 	
 	/* checks wheather more space is needed */
 	if (dv->size == dv->capacity)
 	{
-		/* duplicates the current capacity via DVReserve function + checks */
-		if (FAIL == DVReserve(dv, (dv->capacity / (dv->element_size))))
+		/* grows by the policy (1 element at least) via DVReserve + checks */
+		additional_size = DVCapacity(dv) * dv->policy.growth_percent / PERCENTS;
+		additional_size = (0 == additional_size) ? 1 : additional_size;
+		
+		if (FAIL == DVReserve(dv, additional_size))
 		{
 			return (FAIL);
 		}
@@ -107,7 +127,7 @@ int DVPushBack(dv_t *dv, const void *element)
 int DVPopBack(dv_t *dv)
 {
 	size_t temp_capacity = 0;
-	void *temp_vector = NULL;
+	size_t min_capacity = 0;
 	
 	assert(dv);
 
@@ -116,21 +136,25 @@ int DVPopBack(dv_t *dv)
 		return (FAIL);
 	}
 	
-	/* case size is now quarter of the capacity - reduce capacity in 1/2 */
-	if (dv->size <= (dv->capacity / 4))
+	/*	case size is now 1/shrink_divisor of the capacity - reduce capacity
+		in 1/2, but not below the min_capacity */
+	if (0 != dv->policy.shrink_divisor &&
+		dv->size <= (dv->capacity / dv->policy.shrink_divisor))
 	{
 		/* prepare a capacity size wich can be devided in element_size */
 		temp_capacity = dv->capacity / 2;
 		temp_capacity -= (temp_capacity % dv->element_size);
 		
-		temp_vector = realloc(dv->vector, temp_capacity);
-		if (NULL == temp_vector)
+		min_capacity = dv->policy.min_capacity * dv->element_size;
+		min_capacity = (0 == min_capacity) ? dv->element_size : min_capacity;
+		temp_capacity = (temp_capacity < min_capacity) ?
+						min_capacity : temp_capacity;
+		
+		if (temp_capacity < dv->capacity &&
+			FAIL == Resize(dv, temp_capacity))
 		{
 			return (FAIL);
 		}
-		
-		dv->vector = temp_vector;
-		dv->capacity = temp_capacity;
 	}
 	
 	dv->size -= dv->element_size;
@@ -201,3 +225,73 @@ int DVReserve(dv_t *dv, size_t additional_size)
 }
 
 
+/******************************************************************************
+*								DVSetPolicy
+*******************************************************************************/
+void DVSetPolicy(dv_t *dv, const dv_policy_t *policy)
+{
+	assert(dv);
+	assert(policy);
+
+	dv->policy = *policy;
+}
+
+
+/******************************************************************************
+*								DVGetPolicy
+*******************************************************************************/
+void DVGetPolicy(const dv_t *dv, dv_policy_t *policy)
+{
+	assert(dv);
+	assert(policy);
+	
+	*policy = dv->policy;
+}
+
+
+/******************************************************************************
+*								DVShrinkToFit
+*******************************************************************************/
+int DVShrinkToFit(dv_t *dv)
+{
+	size_t new_capacity = 0;
+	
+	assert(dv);
+	
+	/* the biggest of: size, min_capacity & 1 element */
+	new_capacity = dv->policy.min_capacity * dv->element_size;
+	new_capacity = (new_capacity < dv->size) ? dv->size : new_capacity;
+	new_capacity = (0 == new_capacity) ? dv->element_size : new_capacity;
+	
+	if (new_capacity < dv->capacity)
+	{
+		return (Resize(dv, new_capacity));
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/******************************** Resize **************************************/
+static int Resize(dv_t *dv, size_t new_capacity)
+{
+	void *temp_vector = NULL;
+	
+	assert(dv);
+	
+	temp_vector = realloc(dv->vector, new_capacity);
+	if (NULL == temp_vector)
+	{
+		return (FAIL);
+	}
+	
+	dv->vector = temp_vector;
+	dv->capacity = new_capacity;
+	
+	return (SUCCESS);
+}
+
+
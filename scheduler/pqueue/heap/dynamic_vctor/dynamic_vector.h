@@ -14,6 +14,26 @@
  */
 typedef struct dynamic_vector dv_t;
 
+/*
+ *  dv_policy_t controls when and how much the vector changes its capacity.
+ *  growth_percent - when a full vector is pushed, its capacity grows in
+ *                   growth_percent percents of the current capacity (100
+ *                   doubles it). it always grows in one element at least.
+ *  min_capacity   - the vector never shrinks below min_capacity elements.
+ *  shrink_divisor - DVPopBack halves the capacity only when the size drops
+ *                   to capacity / shrink_divisor. the gap between that point
+ *                   and the next growth is the hysteresis. 0 disables the
+ *                   automatic shrinking (DVShrinkToFit can still be called).
+ *  DVCreate sets: growth_percent 100, min_capacity as the created capacity,
+ *  shrink_divisor 4.
+ */
+typedef struct dv_policy
+{
+	size_t growth_percent;
+	size_t min_capacity;
+	size_t shrink_divisor;
+} dv_policy_t;
+
 /*
  *  DVCreate creates a Dynamic Vector.
  *  in case of success the create function returns a pointer to the vector.
@@ -65,6 +85,25 @@ void *DVGetItem(const dv_t *dv, size_t index);
  */
 int DVReserve(dv_t *dv, size_t additional_size);
 
+/*
+ *  DVSetPolicy replaces the capacity policy of the vector pointed by dv.
+ *  the current capacity is unchanged.
+ */
+void DVSetPolicy(dv_t *dv, const dv_policy_t *policy);
+
+/*
+ *  DVGetPolicy copies the capacity policy of the vector pointed by dv into
+ *  policy.
+ */
+void DVGetPolicy(const dv_t *dv, dv_policy_t *policy);
+
+/*
+ *  DVShrinkToFit reduces the capacity of the vector pointed by dv to its
+ *  size, but not below the min_capacity of its policy (nor below 1 element).
+ *  the function returns 0 in case of success and -1 in case of failure.
+ */
+int DVShrinkToFit(dv_t *dv);
+
 #endif     /* _DYNAMIC_VECTOR_H_ */
 
 
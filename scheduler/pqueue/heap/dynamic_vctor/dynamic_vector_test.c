@@ -0,0 +1,247 @@
+/******************************************************************************
+*	Filename	:	dynamic_vector_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	dynamic vector test file - capacity policy
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+
+#include "dynamic_vector.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+
+/************************** unit-test functions *******************************/
+void DVDefaultPolicyTest(void);
+void DVGrowthPercentTest(void);
+void DVMinCapacityTest(void);
+void DVHysteresisTest(void);
+void DVShrinkToFitTest(void);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR DYNAMIC VECTOR'S POLICY *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	DVDefaultPolicyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	DVGrowthPercentTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	DVMinCapacityTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	DVHysteresisTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	DVShrinkToFitTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* DVDefaultPolicyTest ********************************/
+void DVDefaultPolicyTest(void)
+{
+	dv_t *dv = NULL;
+	dv_policy_t policy = {0};
+	size_t check_val_1 = 0;
+	int element = 7;
+	
+	printf("Default policy:\t\t\t\t");
+	
+	dv = DVCreate(4, sizeof(int));
+	DVGetPolicy(dv, &policy);
+	
+	DVPushBack(dv, &element);
+	DVPushBack(dv, &element);
+	DVPushBack(dv, &element);
+	DVPushBack(dv, &element);
+	DVPushBack(dv, &element);
+	check_val_1 = DVCapacity(dv);	/* expected: 8 (doubled) */
+	
+	(100	== policy.growth_percent)	&&
+	(4		== policy.min_capacity)		&&
+	(4		== policy.shrink_divisor)	&&
+	(8		== check_val_1)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	DVDestroy(dv);
+	dv = NULL;
+}
+
+
+/************************* DVGrowthPercentTest ********************************/
+void DVGrowthPercentTest(void)
+{
+	dv_t *dv = NULL;
+	dv_policy_t policy = {50, 0, 4};
+	size_t check_val_1 = 0;
+	size_t check_val_2 = 0;
+	int element = 7;
+	size_t i = 0;
+	
+	printf("Growth percent:\t\t\t\t");
+	
+	dv = DVCreate(4, sizeof(int));
+	DVSetPolicy(dv, &policy);
+	
+	for (i = 0; i < 5; ++i)
+	{
+		DVPushBack(dv, &element);
+	}
+	check_val_1 = DVCapacity(dv);	/* expected: 6 (4 + 50%) */
+	
+	/* a growth smaller than 1 element still grows */
+	policy.growth_percent = 0;
+	DVSetPolicy(dv, &policy);
+	for (i = 0; i < 2; ++i)
+	{
+		DVPushBack(dv, &element);
+	}
+	check_val_2 = DVCapacity(dv);	/* expected: 7 */
+	
+	(6	== check_val_1)	&&
+	(7	== check_val_2)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	DVDestroy(dv);
+	dv = NULL;
+}
+
+
+/************************* DVMinCapacityTest **********************************/
+void DVMinCapacityTest(void)
+{
+	dv_t *dv = NULL;
+	size_t check_val_1 = 0;
+	size_t check_val_2 = 0;
+	int element = 7;
+	size_t i = 0;
+	
+	printf("Min capacity:\t\t\t\t");
+	
+	dv = DVCreate(4, sizeof(int));
+	for (i = 0; i < 32; ++i)
+	{
+		DVPushBack(dv, &element);
+	}
+	check_val_1 = DVCapacity(dv);	/* expected: 32 */
+	
+	while (0 < DVSize(dv))
+	{
+		DVPopBack(dv);
+	}
+	check_val_2 = DVCapacity(dv);	/* expected: 4 - the created capacity */
+	
+	(32	== check_val_1)	&&
+	(4	== check_val_2)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	DVDestroy(dv);
+	dv = NULL;
+}
+
+
+/************************* DVHysteresisTest ***********************************/
+void DVHysteresisTest(void)
+{
+	dv_t *dv = NULL;
+	dv_policy_t policy = {100, 1, 0};
+	size_t check_val_1 = 0;
+	size_t check_val_2 = 0;
+	int element = 7;
+	size_t i = 0;
+	
+	printf("Hysteresis:\t\t\t\t");
+	
+	dv = DVCreate(1, sizeof(int));
+	DVSetPolicy(dv, &policy);
+	for (i = 0; i < 16; ++i)
+	{
+		DVPushBack(dv, &element);
+	}
+	
+	/* shrinking disabled - oscillating around a quarter keeps the capacity */
+	for (i = 0; i < 100; ++i)
+	{
+		while (3 < DVSize(dv))
+		{
+			DVPopBack(dv);
+		}
+		DVPushBack(dv, &element);
+		DVPushBack(dv, &element);
+	}
+	check_val_1 = DVCapacity(dv);	/* expected: 16 */
+	
+	/* with a divisor of 8 - a quarter isn't low enough to shrink */
+	policy.shrink_divisor = 8;
+	DVSetPolicy(dv, &policy);
+	while (4 < DVSize(dv))
+	{
+		DVPopBack(dv);
+	}
+	check_val_2 = DVCapacity(dv);	/* expected: 16 */
+	
+	(16	== check_val_1)	&&
+	(16	== check_val_2)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	DVDestroy(dv);
+	dv = NULL;
+}
+
+
+/************************* DVShrinkToFitTest **********************************/
+void DVShrinkToFitTest(void)
+{
+	dv_t *dv = NULL;
+	dv_policy_t policy = {100, 2, 0};
+	size_t check_val_1 = 0;
+	size_t check_val_2 = 0;
+	int check_val_3 = 0;
+	int arr[5] = {1, 2, 3, 4, 5};
+	size_t i = 0;
+	
+	printf("ShrinkToFit:\t\t\t\t");
+	
+	dv = DVCreate(2, sizeof(int));
+	DVSetPolicy(dv, &policy);
+	for (i = 0; i < 5; ++i)
+	{
+		DVPushBack(dv, &arr[i]);
+	}
+	DVShrinkToFit(dv);
+	check_val_1 = DVCapacity(dv);	/* expected: 5 */
+	check_val_3 = *(int *)DVGetItem(dv, 4);	/* expected: 5 */
+	
+	/* not below min_capacity */
+	while (0 < DVSize(dv))
+	{
+		DVPopBack(dv);
+	}
+	DVShrinkToFit(dv);
+	check_val_2 = DVCapacity(dv);	/* expected: 2 */
+	
+	(5	== check_val_1)	&&
+	(2	== check_val_2)	&&
+	(5	== check_val_3)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	DVDestroy(dv);
+	dv = NULL;
+}
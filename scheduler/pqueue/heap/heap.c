@@ -346,6 +346,57 @@ void HeapSetParam(heap_t *heap, const void *param)
 }
 
 
+/******************************************************************************
+*							HeapReserve
+*******************************************************************************/
+status_t HeapReserve(heap_t *heap, size_t capacity)
+{
+	dv_policy_t policy = {0};
+	size_t curr_capacity = 0;
+	
+	assert(heap);
+	
+	curr_capacity = DVCapacity(heap->dv);
+	if (curr_capacity < capacity &&
+		SUCCESS != DVReserve(heap->dv, capacity - curr_capacity))
+	{
+		return (FAILURE);
+	}
+	
+	/* the reserved capacity is retained by the vector's policy */
+	DVGetPolicy(heap->dv, &policy);
+	if (policy.min_capacity < capacity)
+	{
+		policy.min_capacity = capacity;
+		DVSetPolicy(heap->dv, &policy);
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							HeapForEach
+*******************************************************************************/
+int HeapForEach(const heap_t *heap, heap_action_t action, void *param)
+{
+	int status = SUCCESS;
+	size_t i = 0;
+	size_t size = 0;
+	
+	assert(heap);
+	assert(action);
+	
+	size = HeapSize(heap);
+	for (i = 0; i < size && SUCCESS == status; ++i)
+	{
+		status = action(*(void **)DVGetItem(heap->dv, i), param);
+	}
+	
+	return (status);
+}
+
+
 /******************************************************************************
 ************************	internal function	*******************************
 *******************************************************************************/
@@ -38,6 +38,16 @@ typedef int (*heap_is_before_t)(void *heap_data,
 */
 typedef int(*heap_is_match_t)(void *new_data, void *heap_data);
 
+/* heap_action_t is applied on the heap elements by HeapForEach.
+*  Function receives an element's data and a user parameter.
+*
+*  Returns values:
+*  ---------------
+*  SUCCESS (0)  - continue to the next element.
+*  otherwise    - stop the iteration.
+*/
+typedef int(*heap_action_t)(void *heap_data, void *param);
+
 /***************************** HeapCreate **************************************
  *	Description: creates an empty heap.
  *
@@ -158,6 +168,36 @@ size_t HeapSize(const heap_t *heap);
  */
 void HeapSetParam(heap_t *heap, const void *param);
 
+/***************************** HeapReserve *************************************
+ *	Description: makes sure the heap can hold 'capacity' elements without
+ *				 reallocating, and keeps that capacity - the heap won't shrink
+ *				 below it when elements are popped.
+ *
+ *	Input:		 heap - pointer to the heap data structure.
+ *				 capacity - number of elements to hold.
+ *
+ *	Output:		 If succeed - returns SUCCESS (0). Otherwise - FAILURE .
+ *
+ *	Complexity:	 O(n)
+ */
+status_t HeapReserve(heap_t *heap, size_t capacity);
+
+/***************************** HeapForEach *************************************
+ *	Description: applies action on every element of the heap, in the heap's
+ *				 internal order (not sorted). action must not change the
+ *				 order of the elements.
+ *
+ *	Input:		 heap - pointer to the heap data structure.
+ *				 action - function to apply.
+ *				 param - auxilary parameter for action.
+ *
+ *	Output:		 SUCCESS (0) - action was applied on all the elements.
+ *				 otherwise - the status of the action which stopped it.
+ *
+ *	Complexity:	 O(n)
+ */
+int HeapForEach(const heap_t *heap, heap_action_t action, void *param);
+
 
 #endif     /* _heap_H_ */
 
@@ -19,6 +19,7 @@ void HeapIsEmptyTest(void);
 void HeapSizeTest(void);
 void HeapPopTest(void);
 void HeapRemoveTest(void);
+void HeapReserveTest(void);
 
 /************************** internal functions ********************************/
 static int IntIsBefore(void *heap_data, const void *new_data,
@@ -54,6 +55,9 @@ int main(void)
 	HeapRemoveTest();
 	printf("\n\n--------------------------------------------------------\n\n");
 	
+	HeapReserveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
 	return (0);
 }
 
@@ -301,6 +305,51 @@ void HeapRemoveTest(void)
 }
 
 
+/************************* HeapReserveTest ************************************/
+void HeapReserveTest(void)
+{
+	heap_t *heap = NULL;
+	status_t check_val_1 = FAILURE;
+	status_t check_val_2 = FAILURE;
+	void *check_val_3 = NULL;
+	size_t check_val_4 = 0;
+	void *top = NULL;
+	int arr[8] = {100, 80, 40, 60, 70, 30, 20, 50};
+	size_t i = 0;
+	
+	printf("Reserve:\t\t\t\t");
+	
+	heap = HeapCreate(3, IntIsBefore, NULL);
+	
+	check_val_1 = HeapReserve(heap, 64);	/* expected: SUCCESS */
+	check_val_2 = HeapReserve(heap, 8);		/* expected: SUCCESS (no-op) */
+	
+	/* oscillating around a small size keeps the order */
+	for (i = 0; i < 8; ++i)
+	{
+		HeapPush(heap, &arr[i]);
+	}
+	for (i = 0; i < 6; ++i)
+	{
+		top = HeapPeek(heap);
+		HeapPop(heap);
+		HeapPush(heap, top);
+	}
+	check_val_3 = HeapPeek(heap);	/* expected: address of 100 (&arr[0]) */
+	check_val_4 = HeapSize(heap);	/* expected: 8 */
+	
+	(SUCCESS	== check_val_1)	&&
+	(SUCCESS	== check_val_2)	&&
+	(&arr[0]	== check_val_3)	&&
+	(8			== check_val_4)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	HeapDestroy(heap);
+	heap = NULL;
+}
+
+
 /******************************************************************************
 *						internal functions
 *******************************************************************************/
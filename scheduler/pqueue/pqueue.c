@@ -9,6 +9,7 @@
 #include <assert.h> /* assert */
 
 #include "./heap/heap.h"
+#include "./radix/radix_heap.h"
 #include "pqueue.h"
 
 /******************************* MACROS ***************************************/
@@ -22,9 +23,11 @@
 /*};*/
 
 /*** structures ***/
+/*	one of the two is created - the other is NULL */
 struct pqueue
 {
 	heap_t *heap;
+	radix_heap_t *radix;
 };
 
 
@@ -53,6 +56,37 @@ pqueue_t *PQCreate(has_higher_priority_t prior_func)
 	}
 	
 	pq->heap = heap;
+	pq->radix = NULL;
+	return (pq);
+}
+
+
+/******************************************************************************
+*								PQCreateRadix
+*******************************************************************************/
+pqueue_t *PQCreateRadix(pq_key_t key_func)
+{
+	pqueue_t *pq = NULL;
+	radix_heap_t *radix = NULL;
+	
+	assert(key_func);
+	
+	pq = (pqueue_t *) malloc(sizeof(pqueue_t));
+	if (NULL == pq)
+	{
+		return (NULL);
+	}
+	
+	radix = RadixHeapCreate(key_func);
+	if (NULL == radix)
+	{
+		free(pq);
+		pq = NULL;
+		return (NULL);
+	}
+	
+	pq->heap = NULL;
+	pq->radix = radix;
 	return (pq);
 }
 
@@ -64,8 +98,16 @@ void PQDestroy(pqueue_t *pqueue)
 {
 	assert(pqueue);
 	
-	HeapDestroy(pqueue->heap);
-	pqueue->heap = NULL;
+	if (NULL != pqueue->radix)
+	{
+		RadixHeapDestroy(pqueue->radix);
+		pqueue->radix = NULL;
+	}
+	else
+	{
+		HeapDestroy(pqueue->heap);
+		pqueue->heap = NULL;
+	}
 	free(pqueue);
 	pqueue = NULL;
 }
@@ -80,6 +122,11 @@ int PQPush(pqueue_t *pqueue, void *data, void *param)
 	
 	assert(pqueue);
 	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapPush(pqueue->radix, data));
+	}
+	
 	HeapSetParam(pqueue->heap, param);
 	status = HeapPush(pqueue->heap, data);
 	
@@ -96,6 +143,11 @@ void *PQPop(pqueue_t *pqueue)
 	
 	assert(pqueue);
 	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapPop(pqueue->radix));
+	}
+	
 	popped_data = HeapPeek(pqueue->heap);
 	HeapPop(pqueue->heap);
 	
@@ -110,6 +162,11 @@ int PQIsEmpty(const pqueue_t *pqueue)
 {
 	assert(pqueue);
 	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapIsEmpty(pqueue->radix));
+	}
+	
 	return (HeapIsEmpty(pqueue->heap));
 }
 
@@ -121,6 +178,11 @@ void *PQPeek(const pqueue_t *pqueue)
 {
 	assert(pqueue);
 	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapPeek(pqueue->radix));
+	}
+	
 	return (HeapPeek(pqueue->heap));
 }
 
@@ -132,6 +194,11 @@ size_t PQSize(const pqueue_t *pqueue)
 {
 	assert(pqueue);
 	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapSize(pqueue->radix));
+	}
+	
 	return (HeapSize(pqueue->heap));
 }
 
@@ -155,12 +222,49 @@ void PQClear(pqueue_t *pqueue)
 *******************************************************************************/
 void *PQErase(pqueue_t *pqueue, pq_is_match_t func, void *param)
 {
-	assert(pqueue->heap);
+	assert(pqueue);
+	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapRemove(pqueue->radix, param, func));
+	}
 	
 	return (HeapRemove(pqueue->heap, param, func));
 }
 
 
+/******************************************************************************
+*								PQReserve
+*******************************************************************************/
+int PQReserve(pqueue_t *pqueue, size_t capacity)
+{
+	assert(pqueue);
+	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapReserve(pqueue->radix, capacity));
+	}
+	
+	return (HeapReserve(pqueue->heap, capacity));
+}
+
+
+/******************************************************************************
+*								PQForEach
+*******************************************************************************/
+int PQForEach(const pqueue_t *pqueue, pq_action_t func, void *param)
+{
+	assert(pqueue);
+	
+	if (NULL != pqueue->radix)
+	{
+		return (RadixHeapForEach(pqueue->radix, func, param));
+	}
+	
+	return (HeapForEach(pqueue->heap, func, param));
+}
+
+
 
 
 
@@ -8,6 +8,7 @@
 #define _PQUEUE_H_
 
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
 
 
 /*  has_higher_priority_t is a user defined function, that determines the
@@ -35,6 +36,19 @@ typedef int(*has_higher_priority_t)(void *current_data, const void *new_data,
 typedef int(*pq_is_match_t)(void *data, void *param); 
 
 
+/*  pq_key_t returns the integer key of an element, for a queue created by
+ *  PQCreateRadix - the smaller the key, the higher the priority. it's read
+ *  when the element is pushed, and must not change while it's queued.
+ */
+typedef uint64_t(*pq_key_t)(const void *data);
+
+
+/*  pq_action_t is applied on the queue elements by PQForEach.
+ *  returns 0 to continue to the next element - anything else stops.
+ */
+typedef int(*pq_action_t)(void *data, void *param);
+
+
 typedef struct pqueue pqueue_t;
 
 
@@ -47,6 +61,20 @@ typedef struct pqueue pqueue_t;
  */
 pqueue_t *PQCreate(has_higher_priority_t func);
 
+/***************************** PQCreateRadix ***********************************
+ *	Description: creates an empty monotone priority queue over integer keys
+ *				 (a radix heap) - for a user which never pushes an element
+ *				 with a key below the last popped one, like deadlines. such
+ *				 an element is popped next, with the elements of the last
+ *				 popped key. all the other functions behave as with PQCreate.
+ *	Input:		 key function pointer type pq_key_t
+ *	Output:		 if success - returns a pointer to the new queue
+ *				 Otherwise - returns NULL
+ *	Complexity:	 O(1). push - O(1), pop - O(log(C)) amortized, C - the range
+ *				 of the keys.
+ */
+pqueue_t *PQCreateRadix(pq_key_t func);
+
 /***************************** PQDestroy ***************************************
  *	Description: Destroys the priority queue and all of its content
  *	Input:		 Pointer to the priority queue to be destroyed
@@ -124,4 +152,26 @@ void PQClear(pqueue_t *pqueue);
 void *PQErase(pqueue_t *pqueue, pq_is_match_t func, void *param);
 
 
+/***************************** PQReserve ***************************************
+ *	Description: Makes sure the queue can hold 'capacity' elements without
+ *				 reallocating, and keeps that capacity while elements are
+ *				 popped. used to keep reallocations out of a steady state.
+ *	Input:		 Pointer to priority queue, number of elements to hold.
+ *	Output:		 If succeed - returns 0. Otherwise - returns -1.
+ *	Complexity:	 O(n)
+ */
+int PQReserve(pqueue_t *pqueue, size_t capacity);
+
+
+/***************************** PQForEach ***************************************
+ *	Description: Applies func on every element of the queue, not in priority
+ *				 order. func must not change the priority of the elements.
+ *	Input:		 Pointer to priority queue, action function pointer and param.
+ *	Output:		 0 if func was applied on all the elements. Otherwise - the
+ *				 value returned by the func which stopped the iteration.
+ *	Complexity:	 O(n)
+ */
+int PQForEach(const pqueue_t *pqueue, pq_action_t func, void *param);
+
+
 #endif     /* _PQUEUE_H_ */
@@ -0,0 +1,218 @@
+/*******************************************************************************
+*	Filename :		pqueue_bench.c
+*	Developer :		Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	pqueue benchmark - the binary heap (PQCreate) vs. the
+*					radix heap (PQCreateRadix), head to head on monotone
+*					workloads: n elements are queued, and every popped one is
+*					pushed back later (pop + push is one operation), like the
+*					repeated tasks of the scheduler.
+*					usage: pqueue_bench.out [operations]
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* clock_gettime */
+
+#include <stdio.h> 		/* printf */
+#include <stdlib.h>		/* malloc, free, strtoul */
+#include <stdint.h>		/* uint64_t */
+#include <time.h>		/* clock_gettime */
+
+#include "pqueue.h"
+
+
+/*** MACROS ***/
+#define UNUSED(x) ((void) x)
+#define DEFAULT_OPERATIONS (2000000)
+#define NS_IN_SEC (1000000000.0)
+#define SEED (0x2545F4914F6CDD1DULL)
+
+/*** structures ***/
+typedef struct element
+{
+	uint64_t key;
+} element_t;
+
+/*	a workload - each popped key is pushed back after 1 to max_step */
+typedef struct workload
+{
+	const char *name;
+	size_t count;
+	uint64_t max_step;
+} workload_t;
+
+/*** benchmark functions ***/
+/*	runs operations pop + push on a queue of w->count elements. returns the ns
+	of one operation, or a negative value if the queue failed */
+static double RunWorkload(pqueue_t *pq, const workload_t *w,
+						  size_t operations, uint64_t *checksum);
+
+/*** internal functions ***/
+static int KeyIsBefore(void *current_data, const void *new_data, void *param);
+static uint64_t ElementKey(const void *data);
+static uint64_t NextRandom(uint64_t *state);
+static double Now(void);
+
+
+/*****************************************************************************
+*								main
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+	workload_t workloads[] =
+	{
+		{"deadlines (s)",	16,		5},		/* the WD: a few tasks, seconds */
+		{"timers",			256,	1000},
+		{"timers",			4096,	1000},
+		{"timers",			65536,	1000},
+		{"wide keys",		4096,	1000000000},
+		{"wide keys",		65536,	1000000000}
+	};
+	size_t operations = DEFAULT_OPERATIONS;
+	uint64_t heap_checksum = 0;
+	uint64_t radix_checksum = 0;
+	double heap_ns = 0;
+	double radix_ns = 0;
+	pqueue_t *pq = NULL;
+	size_t i = 0;
+	
+	if (1 < argc)
+	{
+		operations = strtoul(argv[1], NULL, 10);
+	}
+	
+	printf("\n***** PQUEUE BENCHMARK: BINARY HEAP VS. RADIX HEAP *****\n\n");
+	printf("%lu operations (pop + push) per run\n\n",
+		   (unsigned long)operations);
+	printf("%-16s %8s %10s %14s %14s %8s\n", "workload", "n", "max step",
+		   "heap ns/op", "radix ns/op", "speedup");
+	
+	for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); ++i)
+	{
+		pq = PQCreate(KeyIsBefore);
+		heap_ns = (NULL != pq) ?
+				  RunWorkload(pq, &workloads[i], operations, &heap_checksum) :
+				  -1;
+		if (NULL != pq)
+		{
+			PQDestroy(pq);
+		}
+		
+		pq = PQCreateRadix(ElementKey);
+		radix_ns = (NULL != pq) ?
+				   RunWorkload(pq, &workloads[i], operations, &radix_checksum) :
+				   -1;
+		if (NULL != pq)
+		{
+			PQDestroy(pq);
+		}
+		
+		printf("%-16s %8lu %10lu %14.1f %14.1f %7.2fx%s\n", workloads[i].name,
+			   (unsigned long)workloads[i].count,
+			   (unsigned long)workloads[i].max_step, heap_ns, radix_ns,
+			   (0 < radix_ns) ? heap_ns / radix_ns : 0,
+			   (heap_checksum == radix_checksum && 0 < heap_ns &&
+				0 < radix_ns) ? "" : "  FAIL");
+	}
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								benchmark
+*******************************************************************************/
+
+/***************************** RunWorkload ************************************/
+static double RunWorkload(pqueue_t *pq, const workload_t *w,
+						  size_t operations, uint64_t *checksum)
+{
+	element_t *elements = NULL;
+	element_t *popped = NULL;
+	uint64_t state = SEED;
+	double start = 0;
+	double ns = -1;
+	size_t i = 0;
+	
+	elements = (element_t *)malloc(w->count * sizeof(element_t));
+	if (NULL == elements)
+	{
+		return (-1);
+	}
+	
+	for (i = 0; i < w->count; ++i)
+	{
+		elements[i].key = NextRandom(&state) % w->max_step;
+		if (0 != PQPush(pq, &elements[i], NULL))
+		{
+			free(elements);
+			return (-1);
+		}
+	}
+	
+	/*	the popped keys are summed - both queues must pop the same keys (the
+		same random steps are drawn in the same order) */
+	*checksum = 0;
+	start = Now();
+	for (i = 0; i < operations; ++i)
+	{
+		popped = (element_t *)PQPop(pq);
+		*checksum += popped->key;
+		popped->key += 1 + NextRandom(&state) % w->max_step;
+		if (0 != PQPush(pq, popped, NULL))
+		{
+			break;
+		}
+	}
+	if (i == operations)
+	{
+		ns = (Now() - start) * NS_IN_SEC / (double)operations;
+	}
+	
+	PQClear(pq);
+	free(elements);
+	
+	return (ns);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/*************************** KeyIsBefore **************************************/
+static int KeyIsBefore(void *current_data, const void *new_data, void *param)
+{
+	UNUSED(param);
+	
+	return (((const element_t *)new_data)->key <
+			((element_t *)current_data)->key);
+}
+
+
+/*************************** ElementKey ***************************************/
+static uint64_t ElementKey(const void *data)
+{
+	return (((const element_t *)data)->key);
+}
+
+
+/*************************** NextRandom ***************************************/
+static uint64_t NextRandom(uint64_t *state)
+{
+	/* xorshift64 - the same sequence for both queues */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	
+	return (*state);
+}
+
+
+/*************************** Now **********************************************/
+static double Now(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return ((double)now.tv_sec + (double)now.tv_nsec / NS_IN_SEC);
+}
@@ -28,6 +28,7 @@ void PQPopTest(void);
 void PQIsEmptyTest(void);
 void PQClearTest(void);
 void PQEraseTest(void);
+void PQReserveTest(void);
 
 /*** internal functions ***/
 int SortIntByValue(void *list_data, const void *new_data, void *param);
@@ -68,6 +69,9 @@ int main(void)
 
 	PQEraseTest();
 	printf("\n\n--------------------------------------------------------\n\n");
+	
+	PQReserveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
 
 	return (0);
 }
@@ -298,6 +302,37 @@ void PQEraseTest(void)
 }
 
 
+/************************* PQReserveTest **************************************/
+void PQReserveTest(void)
+{
+	pqueue_t *pq = NULL;
+	int ret_val_1 = 0;
+	int ret_val_2 = 0;
+	int arr[5] = {15, 7, 20, 3, 11};
+	size_t i = 0;
+	
+	printf("PQReserve:\t\t\t");
+	
+	pq = PQCreate(SortIntByValue);
+	ret_val_1 = PQReserve(pq, 100);			/* expected: 0 */
+	
+	for (i = 0; i < 5; ++i)
+	{
+		PQPush(pq, &arr[i], NULL);
+	}
+	PQPop(pq);
+	ret_val_2 = *(int *)PQPeek(pq);			/* expected value: 7 */
+	
+	(0 == ret_val_1)	&&
+	(7 == ret_val_2)	&&
+	(4 == PQSize(pq))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	PQDestroy(pq);
+}
+
+
 /******************************************************************************
 *						internal functions
 *******************************************************************************/
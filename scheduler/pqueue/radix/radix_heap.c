@@ -0,0 +1,421 @@
+/*******************************************************************************
+*	Filename	:	radix_heap.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	radix heap source file
+*******************************************************************************/
+#include <stdlib.h>	/* malloc, free */
+#include <assert.h> /* assert */
+
+#include "../heap/dynamic_vctor/dynamic_vector.h"
+#include "radix_heap.h"
+
+/******************************* MACROS ***************************************/
+#define KEY_BITS (64)
+#define BUCKETS_COUNT (KEY_BITS + 1)	/* bucket 0 - the last popped key */
+#define BUCKET_CAPACITY (1)
+#define NO_SHRINK (0)
+#define NO_BUCKET (BUCKETS_COUNT)
+
+/***************************** structures *************************************/
+typedef struct radix_entry
+{
+	uint64_t key;
+	void *data;
+} radix_entry_t;
+
+/*	bucket i > 0 holds the keys whose highest bit which differs from last is
+	bit i - 1, i.e. last < key < last + 2^i. the buckets below the first
+	non-empty one are empty. the buckets keep their capacity (no automatic
+	shrinking), so a pop never reallocates & removing an entry can't fail */
+struct radix_heap_s
+{
+	radix_key_t key_func;
+	uint64_t last;						/* the last popped key */
+	size_t size;
+	dv_t *buckets[BUCKETS_COUNT];		/* radix_entry_t per element */
+};
+
+/************************* internal functions *********************************/
+/*	the bucket of key, relative to the last popped key */
+static size_t BucketOf(const radix_heap_t *heap, uint64_t key);
+
+/*	the first non-empty bucket - NO_BUCKET if the heap is empty */
+static size_t FirstBucket(const radix_heap_t *heap);
+
+/*	the index of the smallest key in a non-empty bucket */
+static size_t MinIndex(dv_t *bucket);
+
+/*	removes the entry at index from bucket - the last entry takes its place */
+static void RemoveEntry(dv_t *bucket, size_t index);
+
+/*	sets the last popped key to the smallest key in bucket 'index' and moves
+	its entries to the lower buckets - bucket 0 isn't empty afterwards. in
+	case a bucket failed to grow, the heap is left as it was & FAILURE is
+	returned */
+static status_t Redistribute(radix_heap_t *heap, size_t index);
+
+/******************************************************************************
+*							RadixHeapCreate
+*******************************************************************************/
+radix_heap_t *RadixHeapCreate(radix_key_t key_func)
+{
+	radix_heap_t *heap = NULL;
+	dv_policy_t policy = {0};
+	size_t i = 0;
+	
+	assert(key_func);
+	
+	heap = (radix_heap_t *)malloc(sizeof(radix_heap_t));
+	if (NULL == heap)
+	{
+		return (NULL);
+	}
+	
+	heap->key_func = key_func;
+	heap->last = 0;
+	heap->size = 0;
+	
+	for (i = 0; i < BUCKETS_COUNT; ++i)
+	{
+		heap->buckets[i] = DVCreate(BUCKET_CAPACITY, sizeof(radix_entry_t));
+		if (NULL == heap->buckets[i])
+		{
+			/* case DVCreate failed - destroys the created buckets */
+			while (0 < i)
+			{
+				--i;
+				DVDestroy(heap->buckets[i]);
+			}
+			free(heap);
+			
+			return (NULL);
+		}
+		
+		DVGetPolicy(heap->buckets[i], &policy);
+		policy.shrink_divisor = NO_SHRINK;
+		DVSetPolicy(heap->buckets[i], &policy);
+	}
+	
+	return (heap);
+}
+
+
+/******************************************************************************
+*							RadixHeapDestroy
+*******************************************************************************/
+void RadixHeapDestroy(radix_heap_t *heap)
+{
+	size_t i = 0;
+	
+	assert(heap);
+	
+	for (i = 0; i < BUCKETS_COUNT; ++i)
+	{
+		DVDestroy(heap->buckets[i]);
+		heap->buckets[i] = NULL;
+	}
+	
+	free(heap);
+	heap = NULL;
+}
+
+
+/******************************************************************************
+*							RadixHeapPush
+*******************************************************************************/
+status_t RadixHeapPush(radix_heap_t *heap, const void *data)
+{
+	radix_entry_t entry = {0};
+	
+	assert(heap);
+	
+	/*	a key which is already due is popped with the last one */
+	entry.key = heap->key_func(data);
+	if (entry.key < heap->last)
+	{
+		entry.key = heap->last;
+	}
+	entry.data = (void *)data;
+	
+	if (SUCCESS != DVPushBack(heap->buckets[BucketOf(heap, entry.key)],
+							  &entry))
+	{
+		return (FAILURE);
+	}
+	++heap->size;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							RadixHeapPop
+*******************************************************************************/
+void *RadixHeapPop(radix_heap_t *heap)
+{
+	dv_t *bucket = NULL;
+	void *data = NULL;
+	size_t index = 0;
+	size_t entry_index = 0;
+	
+	assert(heap);
+	
+	index = FirstBucket(heap);
+	if (NO_BUCKET == index)
+	{
+		return (NULL);
+	}
+	if (0 != index && SUCCESS == Redistribute(heap, index))
+	{
+		index = 0;
+	}
+	
+	/*	all the keys of bucket 0 are the last popped key - any one will do.
+		otherwise (the redistribution failed) the min is taken by a scan */
+	bucket = heap->buckets[index];
+	entry_index = (0 == index) ? DVSize(bucket) - 1 : MinIndex(bucket);
+	data = ((radix_entry_t *)DVGetItem(bucket, entry_index))->data;
+	RemoveEntry(bucket, entry_index);
+	--heap->size;
+	
+	return (data);
+}
+
+
+/******************************************************************************
+*							RadixHeapRemove
+*******************************************************************************/
+void *RadixHeapRemove(radix_heap_t *heap, void *data,
+					  radix_is_match_t is_match_func)
+{
+	radix_entry_t *entry = NULL;
+	void *ret_val = NULL;
+	size_t i = 0;
+	size_t j = 0;
+	
+	assert(heap);
+	assert(is_match_func);
+	
+	for (i = 0; i < BUCKETS_COUNT; ++i)
+	{
+		for (j = 0; j < DVSize(heap->buckets[i]); ++j)
+		{
+			entry = (radix_entry_t *)DVGetItem(heap->buckets[i], j);
+			if (is_match_func(data, entry->data))
+			{
+				ret_val = entry->data;
+				RemoveEntry(heap->buckets[i], j);
+				--heap->size;
+				
+				return (ret_val);
+			}
+		}
+	}
+	
+	return (NULL);
+}
+
+
+/******************************************************************************
+*							RadixHeapPeek
+*******************************************************************************/
+void *RadixHeapPeek(const radix_heap_t *heap)
+{
+	dv_t *bucket = NULL;
+	size_t index = 0;
+	size_t entry_index = 0;
+	
+	assert(heap);
+	
+	/*	the heap isn't redistributed here - the scheduler may still push a key
+		below the peeked one while it waits for it */
+	index = FirstBucket(heap);
+	if (NO_BUCKET == index)
+	{
+		return (NULL);
+	}
+	
+	/* as in RadixHeapPop - the keys of bucket 0 are all the same */
+	bucket = heap->buckets[index];
+	entry_index = (0 == index) ? DVSize(bucket) - 1 : MinIndex(bucket);
+	
+	return (((radix_entry_t *)DVGetItem(bucket, entry_index))->data);
+}
+
+
+/******************************************************************************
+*							RadixHeapIsEmpty
+*******************************************************************************/
+int RadixHeapIsEmpty(const radix_heap_t *heap)
+{
+	assert(heap);
+	
+	return (0 == heap->size);
+}
+
+
+/******************************************************************************
+*							RadixHeapSize
+*******************************************************************************/
+size_t RadixHeapSize(const radix_heap_t *heap)
+{
+	assert(heap);
+	
+	return (heap->size);
+}
+
+
+/******************************************************************************
+*							RadixHeapReserve
+*******************************************************************************/
+status_t RadixHeapReserve(radix_heap_t *heap, size_t capacity)
+{
+	size_t curr_capacity = 0;
+	size_t i = 0;
+	
+	assert(heap);
+	
+	/* the buckets don't shrink - the reserved capacity is retained */
+	for (i = 0; i < BUCKETS_COUNT; ++i)
+	{
+		curr_capacity = DVCapacity(heap->buckets[i]);
+		if (curr_capacity < capacity &&
+			SUCCESS != DVReserve(heap->buckets[i], capacity - curr_capacity))
+		{
+			return (FAILURE);
+		}
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							RadixHeapForEach
+*******************************************************************************/
+int RadixHeapForEach(const radix_heap_t *heap, radix_action_t action,
+					 void *param)
+{
+	int status = SUCCESS;
+	size_t i = 0;
+	size_t j = 0;
+	
+	assert(heap);
+	assert(action);
+	
+	for (i = 0; i < BUCKETS_COUNT && SUCCESS == status; ++i)
+	{
+		for (j = 0; j < DVSize(heap->buckets[i]) && SUCCESS == status; ++j)
+		{
+			status = action(((radix_entry_t *)
+							 DVGetItem(heap->buckets[i], j))->data, param);
+		}
+	}
+	
+	return (status);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/******************************* BucketOf *************************************/
+static size_t BucketOf(const radix_heap_t *heap, uint64_t key)
+{
+	uint64_t diff = key ^ heap->last;
+	
+	return ((0 == diff) ? 0 : (size_t)(KEY_BITS - __builtin_clzll(diff)));
+}
+
+
+/****************************** FirstBucket ***********************************/
+static size_t FirstBucket(const radix_heap_t *heap)
+{
+	size_t i = 0;
+	
+	if (0 == heap->size)
+	{
+		return (NO_BUCKET);
+	}
+	
+	while (0 == DVSize(heap->buckets[i]))
+	{
+		++i;
+	}
+	
+	return (i);
+}
+
+
+/******************************* MinIndex *************************************/
+static size_t MinIndex(dv_t *bucket)
+{
+	size_t min_index = 0;
+	size_t i = 0;
+	
+	for (i = 1; i < DVSize(bucket); ++i)
+	{
+		if (((radix_entry_t *)DVGetItem(bucket, i))->key <
+			((radix_entry_t *)DVGetItem(bucket, min_index))->key)
+		{
+			min_index = i;
+		}
+	}
+	
+	return (min_index);
+}
+
+
+/****************************** RemoveEntry ***********************************/
+static void RemoveEntry(dv_t *bucket, size_t index)
+{
+	size_t last_index = DVSize(bucket) - 1;
+	
+	if (index != last_index)
+	{
+		*(radix_entry_t *)DVGetItem(bucket, index) =
+			*(radix_entry_t *)DVGetItem(bucket, last_index);
+	}
+	DVPopBack(bucket);
+}
+
+
+/****************************** Redistribute **********************************/
+static status_t Redistribute(radix_heap_t *heap, size_t index)
+{
+	dv_t *bucket = heap->buckets[index];
+	radix_entry_t *entry = NULL;
+	uint64_t prev_last = heap->last;
+	size_t i = 0;
+	
+	heap->last = ((radix_entry_t *)DVGetItem(bucket, MinIndex(bucket)))->key;
+	
+	/*	every key of the bucket is now closer to last - it's copied to a lower
+		bucket. the bucket is emptied only once all the copies are in */
+	for (i = 0; i < DVSize(bucket); ++i)
+	{
+		entry = (radix_entry_t *)DVGetItem(bucket, i);
+		if (SUCCESS != DVPushBack(heap->buckets[BucketOf(heap, entry->key)],
+								  entry))
+		{
+			/* rolls back - the copies are the last entries of their buckets */
+			while (0 < i)
+			{
+				--i;
+				entry = (radix_entry_t *)DVGetItem(bucket, i);
+				DVPopBack(heap->buckets[BucketOf(heap, entry->key)]);
+			}
+			heap->last = prev_last;
+			
+			return (FAILURE);
+		}
+	}
+	
+	while (0 < DVSize(bucket))
+	{
+		DVPopBack(bucket);
+	}
+	
+	return (SUCCESS);
+}
@@ -0,0 +1,188 @@
+/*******************************************************************************
+* File name  : radix_heap.h
+* Developer  : Eyal Weizman
+* Date		 : 2020-03-08
+* Description: radix heap - a monotone priority queue over integer keys. the
+*			   elements are kept in buckets by the highest bit in which their
+*			   key differs from the last popped key, so a push is O(1) and a
+*			   pop scans & redistributes one bucket, with no comparisons
+*			   between the elements.
+*******************************************************************************/
+#ifndef _RADIX_HEAP_H_
+#define _RADIX_HEAP_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "../../../utils/general_types.h"
+
+
+typedef struct radix_heap_s radix_heap_t;
+
+/* radix_key_t returns the key of an element - the smaller the key, the closer
+*  the element is to the root. it's read once, when the element is pushed - the
+*  key of an element in the heap must not change.
+*/
+typedef uint64_t (*radix_key_t)(const void *data);
+
+/* radix_is_match_t determines if both data and heap_data are the same.
+*  Function receives two arguments and returns a boolean value.
+*
+*  Returns values:
+*  ---------------
+*  When function returns TRUE  (1) - data is the same as heap_data.
+*  When function returns FALSE (0) - data is different from heap_data.
+*/
+typedef int (*radix_is_match_t)(void *data, void *heap_data);
+
+/* radix_action_t is applied on the heap elements by RadixHeapForEach.
+*  Function receives an element's data and a user parameter.
+*
+*  Returns values:
+*  ---------------
+*  SUCCESS (0)  - continue to the next element.
+*  otherwise    - stop the iteration.
+*/
+typedef int (*radix_action_t)(void *heap_data, void *param);
+
+/***************************** RadixHeapCreate *********************************
+ *	Description: creates an empty radix heap.
+ *
+ *	Input:		 key_func - returns the key of an element.
+ *
+ *	Output:		 if success - returns a pointer to the new heap
+ *               Otherwise - returns NULL.
+ *
+ *	Complexity:	 O(1)
+ */
+radix_heap_t *RadixHeapCreate(radix_key_t key_func);
+
+
+/***************************** RadixHeapDestroy ********************************
+ *	Description: frees all the resources occupied by the heap.
+ *
+ *	Input:		 heap - Pointer to the heap data structure to be destroyed.
+ *
+ *	Output:		 None.
+ *
+ *	Complexity:	 O(1)
+ */
+void RadixHeapDestroy(radix_heap_t *heap);
+
+
+/***************************** RadixHeapPush ***********************************
+ *	Description: Stores the data pointer in the heap by its key. the heap is
+ *				 monotone - a key below the last popped key is taken as the
+ *				 last popped key (such an element is popped next).
+ *
+ *	Input:		 heap - pointer to the heap data structure.
+ *				 data - pointer to the user data.
+ *
+ *	Output:		 If succeed - returns SUCCESS (0). Otherwise - FAILURE .
+ *
+ *	Complexity:	 O(1) amortized
+ */
+status_t RadixHeapPush(radix_heap_t *heap, const void *data);
+
+
+/***************************** RadixHeapPop ************************************
+ *	Description: removes the element with the smallest key.
+ *
+ *	Input:		 Pointer to heap data structure.
+ *
+ *	Output:		 Pointer to the data of the removed element. NULL if empty.
+ *
+ *	Complexity:	 O(log(C)) amortized, C - the range of the keys.
+ */
+void *RadixHeapPop(radix_heap_t *heap);
+
+
+/***************************** RadixHeapRemove *********************************
+ *	Description: Removes the pointer data from the heap.
+ *
+ *	Input:		 heap - Pointer to the heap data structure.
+ *				 data - pointer to the data to be removed.
+ *               is_match_func - user defined function to detemine if two
+ *               elements are match.
+ *	Output:		 pointer to the element been removed.
+ *				 if not found, NULL will be returned.
+ *
+ *	Complexity:	 O(n)
+ */
+void *RadixHeapRemove(radix_heap_t *heap, void *data,
+					  radix_is_match_t is_match_func);
+
+
+/***************************** RadixHeapPeek ***********************************
+*	Description: fetches the data of the element with the smallest key. the
+*				 heap isn't changed, so a smaller key may still be pushed.
+*
+*	Input:		 Pointer to heap data structure.
+*
+*	Output:		 Pointer to the first element's data. NULL if empty.
+*
+*	Complexity:  O(1) once the last popped key is reached. otherwise - the
+*				 size of one bucket.
+*/
+void *RadixHeapPeek(const radix_heap_t *heap);
+
+
+/***************************** RadixHeapIsEmpty ********************************
+ *	Description: Checks whether the heap is empty
+ *
+ *	Input:		 Pointer to heap data structure.
+ *
+ *	Output:		 TRUE (1) if is empty. FALSE (0) - otherwise
+ *
+ *	Complexity:	 O(1)
+ */
+int RadixHeapIsEmpty(const radix_heap_t *heap);
+
+
+/***************************** RadixHeapSize ***********************************
+ *	Description: Checks the number of elements in the heap
+ *
+ *	Input:		 Pointer to heap data structure.
+ *
+ *	Output:		 The number of elements.
+ *
+ *	Complexity:	 O(1)
+ */
+size_t RadixHeapSize(const radix_heap_t *heap);
+
+
+/***************************** RadixHeapReserve ********************************
+ *	Description: Makes sure the heap can hold 'capacity' elements without
+ *				 reallocating, and keeps that capacity while elements are
+ *				 popped. the elements move between the buckets, so every
+ *				 bucket is reserved - the memory is 65 * capacity entries.
+ *
+ *	Input:		 heap - Pointer to the heap data structure.
+ *				 capacity - number of elements to hold.
+ *
+ *	Output:		 If succeed - returns SUCCESS (0). Otherwise - FAILURE.
+ *
+ *	Complexity:	 O(capacity)
+ */
+status_t RadixHeapReserve(radix_heap_t *heap, size_t capacity);
+
+
+/***************************** RadixHeapForEach ********************************
+ *	Description: Applies action on every element of the heap, not in key
+ *				 order. action must not change the keys of the elements.
+ *
+ *	Input:		 heap - Pointer to the heap data structure.
+ *				 action - applied on the data of every element.
+ *				 param - passed to action.
+ *
+ *	Output:		 SUCCESS (0) if action was applied on all the elements.
+ *				 Otherwise - the value returned by the action which stopped
+ *				 the iteration.
+ *
+ *	Complexity:	 O(n)
+ */
+int RadixHeapForEach(const radix_heap_t *heap, radix_action_t action,
+					 void *param);
+
+
+#endif /* _RADIX_HEAP_H_ */
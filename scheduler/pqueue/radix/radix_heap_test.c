@@ -0,0 +1,344 @@
+/******************************************************************************
+*	Filename	:	radix_heap_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	radix heap test file
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+#include <stdlib.h> 	/* rand, srand */
+
+#include "radix_heap.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+#define RANDOM_COUNT (1000)
+#define RANDOM_ROUNDS (20000)
+
+/************************** unit-test functions *******************************/
+void RadixHeapCreateDestroyTest(void);
+void RadixHeapPushPopTest(void);
+void RadixHeapPeekTest(void);
+void RadixHeapSizeTest(void);
+void RadixHeapMonotoneTest(void);
+void RadixHeapRemoveTest(void);
+void RadixHeapReserveTest(void);
+void RadixHeapForEachTest(void);
+
+/************************** internal functions ********************************/
+static uint64_t IntKey(const void *data);
+static int IntIsMatch(void *data, void *heap_data);
+static int SumInts(void *heap_data, void *param);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR RADIX HEAP'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	RadixHeapCreateDestroyTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapPushPopTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapPeekTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapSizeTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapMonotoneTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapRemoveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapReserveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RadixHeapForEachTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* RadixHeapCreateDestroyTest *************************/
+void RadixHeapCreateDestroyTest(void)
+{
+	radix_heap_t *heap = NULL;
+	
+	printf("Create + Destroy:\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	
+	(NULL != heap)					&&
+	(TRUE == RadixHeapIsEmpty(heap))	&&
+	(NULL == RadixHeapPop(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapPushPopTest *******************************/
+void RadixHeapPushPopTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[8] = {15, 7, 20, 3, 11, 7, 1000000, 0};
+	int expected[8] = {0, 3, 7, 7, 11, 15, 20, 1000000};
+	int is_sorted = TRUE;
+	size_t i = 0;
+	
+	printf("Push + Pop:\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	for (i = 0; i < 8; ++i)
+	{
+		RadixHeapPush(heap, &arr[i]);
+	}
+	
+	for (i = 0; i < 8; ++i)
+	{
+		is_sorted &= (expected[i] == *(int *)RadixHeapPop(heap));
+	}
+	
+	(TRUE == is_sorted)				&&
+	(TRUE == RadixHeapIsEmpty(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapPeekTest **********************************/
+void RadixHeapPeekTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int a = 15;
+	int b = 40;
+	int c = 9;
+	void *ret_val_1 = NULL;
+	void *ret_val_2 = NULL;
+	void *ret_val_3 = NULL;
+	
+	printf("Peek:\t\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	ret_val_1 = RadixHeapPeek(heap);				/* expected: NULL */
+	
+	RadixHeapPush(heap, &a);
+	RadixHeapPush(heap, &b);
+	ret_val_2 = RadixHeapPeek(heap);				/* expected: &a */
+	
+	/* a peek doesn't advance the heap - a smaller key may still come */
+	RadixHeapPush(heap, &c);
+	ret_val_3 = RadixHeapPeek(heap);				/* expected: &c */
+	
+	(NULL == ret_val_1)		&&
+	(&a == ret_val_2)		&&
+	(&c == ret_val_3)		&&
+	(&c == RadixHeapPop(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapSizeTest **********************************/
+void RadixHeapSizeTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[5] = {15, 7, 20, 3, 11};
+	size_t size_after_push = 0;
+	size_t i = 0;
+	
+	printf("Size:\t\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	for (i = 0; i < 5; ++i)
+	{
+		RadixHeapPush(heap, &arr[i]);
+	}
+	size_after_push = RadixHeapSize(heap);			/* expected: 5 */
+	RadixHeapPop(heap);
+	
+	(5 == size_after_push)			&&
+	(4 == RadixHeapSize(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapMonotoneTest ******************************/
+void RadixHeapMonotoneTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[RANDOM_COUNT] = {0};
+	int late = 0;
+	int *popped = NULL;
+	int last = 0;
+	int is_sorted = TRUE;
+	size_t i = 0;
+	
+	printf("Monotone pushes & pops:\t\t\t");
+	
+	srand(0);
+	heap = RadixHeapCreate(IntKey);
+	for (i = 0; i < RANDOM_COUNT; ++i)
+	{
+		arr[i] = rand() % 1000;
+		RadixHeapPush(heap, &arr[i]);
+	}
+	
+	/*	every popped element comes back later, like a repeated task. the keys
+		never go below the last popped one */
+	for (i = 0; i < RANDOM_ROUNDS; ++i)
+	{
+		popped = (int *)RadixHeapPop(heap);
+		is_sorted &= (last <= *popped);
+		last = *popped;
+		*popped += rand() % 100;
+		RadixHeapPush(heap, popped);
+	}
+	
+	/* a key below the last popped one is popped next */
+	late = last - 5;
+	RadixHeapPush(heap, &late);
+	
+	(TRUE == is_sorted)						&&
+	(&late == RadixHeapPop(heap))			&&
+	(RANDOM_COUNT == RadixHeapSize(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapRemoveTest ********************************/
+void RadixHeapRemoveTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[5] = {15, 7, 20, 3, 11};
+	int to_remove = 7;
+	int not_found = 8;
+	void *ret_val_1 = NULL;
+	void *ret_val_2 = NULL;
+	size_t i = 0;
+	
+	printf("Remove:\t\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	for (i = 0; i < 5; ++i)
+	{
+		RadixHeapPush(heap, &arr[i]);
+	}
+	RadixHeapPop(heap);
+	
+	ret_val_1 = RadixHeapRemove(heap, &to_remove, IntIsMatch);	/* &arr[1] */
+	ret_val_2 = RadixHeapRemove(heap, &not_found, IntIsMatch);	/* NULL */
+	
+	(&arr[1] == ret_val_1)				&&
+	(NULL == ret_val_2)					&&
+	(3 == RadixHeapSize(heap))			&&
+	(&arr[4] == RadixHeapPop(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapReserveTest *******************************/
+void RadixHeapReserveTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[5] = {15, 7, 20, 3, 11};
+	status_t ret_val = FAILURE;
+	size_t i = 0;
+	
+	printf("Reserve:\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	ret_val = RadixHeapReserve(heap, 100);			/* expected: SUCCESS */
+	for (i = 0; i < 5; ++i)
+	{
+		RadixHeapPush(heap, &arr[i]);
+	}
+	RadixHeapPop(heap);
+	
+	(SUCCESS == ret_val)				&&
+	(7 == *(int *)RadixHeapPeek(heap))	&&
+	(4 == RadixHeapSize(heap))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/************************* RadixHeapForEachTest *******************************/
+void RadixHeapForEachTest(void)
+{
+	radix_heap_t *heap = NULL;
+	int arr[5] = {15, 7, 20, 3, 11};
+	int sum = 0;
+	int ret_val = 0;
+	size_t i = 0;
+	
+	printf("ForEach:\t\t\t\t");
+	
+	heap = RadixHeapCreate(IntKey);
+	for (i = 0; i < 5; ++i)
+	{
+		RadixHeapPush(heap, &arr[i]);
+	}
+	RadixHeapPop(heap);
+	ret_val = RadixHeapForEach(heap, SumInts, &sum);	/* expected: 53 */
+	
+	(SUCCESS == ret_val)	&&
+	(53 == sum)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	RadixHeapDestroy(heap);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/*************************** IntKey *******************************************/
+static uint64_t IntKey(const void *data)
+{
+	return ((uint64_t)*(const int *)data);
+}
+
+
+/*************************** IntIsMatch ***************************************/
+static int IntIsMatch(void *data, void *heap_data)
+{
+	return (*(int *)data == *(int *)heap_data);
+}
+
+
+/*************************** SumInts ******************************************/
+static int SumInts(void *heap_data, void *param)
+{
+	*(int *)param += *(int *)heap_data;
+	
+	return (SUCCESS);
+}
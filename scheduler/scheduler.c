@@ -4,28 +4,120 @@
 *	Last Update :	2019-02-24
 *	Description:	source file of a single-threaded scheduler
 *******************************************************************************/
-#include <stdlib.h>	/* malloc, free */
-#include <assert.h> /* assert */
-#include <time.h>   /* time */
-#include <unistd.h>	/* sleep */
-#include <stdio.h> 	/* fprintf */
+#define _POSIX_C_SOURCE 200112L	/* clock_gettime */
+
+#include <stdlib.h>		/* malloc, free */
+#include <string.h>		/* memset */
+#include <assert.h> 	/* assert */
+#include <time.h>   	/* time, clock_gettime */
+#include <stdio.h> 		/* fprintf */
+#include <limits.h>		/* INT_MAX */
+#include <poll.h>		/* poll, struct pollfd */
+#include <stdatomic.h>	/* atomic_int */
+#include <stdint.h>		/* uint64_t */
+#include <signal.h>		/* sigset_t, sigemptyset, sigaddset */
+#include <sys/signalfd.h>	/* signalfd */
+#include <unistd.h>		/* read, close */
+#include <sys/prctl.h>	/* prctl, PR_SET_TIMERSLACK */
 
 #include "./pqueue/pqueue.h"
+#include "./pqueue/heap/dynamic_vctor/dynamic_vector.h"
 #include "./task/task.h"
+#include "./coro/coro.h"
+#include "./group/group.h"
 #include "scheduler.h"
 
 /***************************** MACROS *****************************************/
 #define UNUSED(x) ((void) x)
+#define FDS_CAPACITY (4)
+#define REMOVED_FD (-1)
+#define MS_IN_SEC (1000)
+#define NS_IN_MS (1000000)
+#define AWAITING (REPEAT + 1)	/* returned by the task of a waiting coroutine */
+#define PARKED (REPEAT + 2)		/*	of a coroutine which waits for its fd with
+									no deadline */
+#define NO_FD (-1)
+#define FOREVER (3600)			/*	seconds - a wait with no timeout wakes up
+									& waits again */
+#define MAX_GROUPS (64)			/*	interval groups - the repeated tasks of
+									other intervals are queued one by one */
+#define GROUP_SLOTS (2 * MAX_GROUPS)	/*	of the hash of the groups - a power
+											of 2 */
 
 
 /***************************** structures *************************************/
 struct scheduler
 {
-	pqueue_t *queue;	/*	pointer to a priority queue */
-	int is_running;		/*	a flag witch determines whether the scheduler
-						 	runs/stops */
+	pqueue_t *queues[TASK_CLASSES];	/*	a priority queue per class */
+	pqueue_t *group_queues[TASK_CLASSES];	/*	the groups which have tasks,
+												by their heads */
+	group_t *groups[MAX_GROUPS];	/*	all the interval groups */
+	size_t groups_count;
+	group_t *group_slots[GROUP_SLOTS];	/*	the groups by interval, slack &
+											class (linear probing) */
+	atomic_int is_running;	/*	a flag witch determines whether the scheduler
+						 		runs/stops. may be cleared by other threads */
+	dv_t *pollfds;			/*	struct pollfd per watched fd - given to poll */
+	dv_t *fd_handlers;		/*	fd_handler_t per watched fd (same index) */
+	size_t removed_fds;		/*	fds removed while dispatching - to compact */
+	overrun_func_t overrun_func;	/*	called when a task overruns */
+	void *overrun_param;
+	wait_func_t wait_func;			/*	called before waiting for a task */
+	void *wait_param;
+	sched_clock_t clock;			/*	NULL funcs - the real time */
+	unsigned long timer_slack_ns;	/*	of the running thread. 0 - kept */
+	size_t wakeups;					/*	waits so far */
+	size_t queued;					/*	tasks in the queues & the groups */
+	size_t burst;					/*	tasks run since the last wait */
+	size_t backlog;					/*	the burst before the last wait */
+	size_t max_backlog;
+	sched_class_stats_t class_stats[TASK_CLASSES];
+	time_t late_time;				/*	when a critical or normal task has
+										last started late */
+	time_t run_time;				/*	of the running task. 0 - none */
+	struct coro_task *parked;		/*	the coroutines which wait for their
+										fds with no deadline - out of the
+										queues, so a ready fd puts its one
+										back in O(log(n)) */
 };
 
+typedef struct fd_handler
+{
+	fd_func_t fd_func;
+	void *param;
+} fd_handler_t;
+
+/*	the data of the task of a coroutine. while the coroutine waits, its task
+	is in the queue with wake_time as its run time */
+typedef struct coro_task
+{
+	scheduler_t *scheduler;
+	coro_t *coro;
+	task_t *task;
+	time_t wake_time;
+	int fd;					/*	the awaited fd, or NO_FD */
+	short revents;			/*	of the awaited fd - 0 until it's ready */
+	int own_fd;				/*	an fd to close if it's discarded, or NO_FD */
+	int is_parked;			/*	waits for its fd with no deadline - in the
+								parked list, not in a queue */
+	struct coro_task *prev;	/*	in the parked list */
+	struct coro_task *next;
+} coro_task_t;
+
+/* the param of ForEachTaskStats - the user's func & param */
+typedef struct for_each_pack
+{
+	task_stats_func_t func;
+	void *param;
+} for_each_pack_t;
+
+/* the param of SetBudgetIfMatch */
+typedef struct budget_pack
+{
+	unique_id_t id;
+	unsigned long budget_ns;
+} budget_pack_t;
+
 /**************************** local functions *********************************/
 
 
@@ -41,6 +133,147 @@ struct scheduler
 static int HasHigherPriority(void *queue_tasks, const void *new_task, void *param);
 
 
+/*	Description: returns the latest time a task may run at - its run time
+ *	plus its slack. the queues are ordered by it.
+ *
+ *	Used in functions: HasHigherPriority, RunTimeKey, NextWakeup, PeekClass,
+ *					   GroupHasHigherPriority, GroupKey;
+ */
+static time_t LatestRunTime(task_t *task);
+
+
+/*	Description: pushes a task into the queue of its class.
+ *
+ *	Used in functions: SchedulerAddTask, SchedulerRun, SchedulerSetTaskClass,
+ *					   and wherever a task is queued again;
+ */
+static status_t PushTask(scheduler_t *scheduler, task_t *task);
+
+
+/*	Description: erases the first task matched by is_match from the queues.
+ *	returns it, or NULL if none matches.
+ *
+ *	Used in functions: SchedulerRemoveTask, SchedulerSetTaskSlack,
+ *					   SchedulerSetTaskClass, CoroFdReady;
+ */
+static task_t *EraseTask(scheduler_t *scheduler, pq_is_match_t is_match,
+						 void *param);
+
+
+/*	Description: returns the next task of a class - the earlier of the head
+ *	of its queue & the head of its first group. NULL if it has none. *group
+ *	is set to the group of the task if it's the head of one, or to NULL.
+ *
+ *	Used in functions: PeekDue, NextWakeup;
+ */
+static task_t *PeekClass(scheduler_t *scheduler, task_class_t task_class,
+						 group_t **group);
+
+
+/*	Description: pops the task returned by PeekDue (with its group) from the
+ *	queues, and returns it. a radix queue may return another task of the
+ *	same latest run time instead.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static task_t *PopDue(scheduler_t *scheduler, task_t *task, group_t *group);
+
+
+/*	Description: queues a repeated task again at now + its interval - at the
+ *	tail of its interval group in O(1), or by PushTask when it has no group.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static status_t RearmTask(scheduler_t *scheduler, task_t *task);
+
+
+/*	Description: returns the interval group of a task - the one it was last
+ *	re-armed into, or a matching one, or a new one. NULL if it has an
+ *	interval of 0 or there are MAX_GROUPS groups already.
+ *
+ *	Used in function: RearmTask;
+ */
+static group_t *FindGroup(scheduler_t *scheduler, task_t *task);
+
+
+/*	Description: puts a group which has been taken out of the queue of the
+ *	groups (or has been empty) back in it, if it has tasks. if it can't - its
+ *	tasks are moved to the queue of their class.
+ *
+ *	Used in functions: RearmTask, PopDue, EraseFromGroup;
+ */
+static void RequeueGroup(scheduler_t *scheduler, group_t *group);
+
+
+/*	Description: erases the first task of a group matched by is_match. the
+ *	group is taken out of the queue of the groups while its head changes.
+ *
+ *	Used in function: EraseTask;
+ */
+static task_t *EraseFromGroup(scheduler_t *scheduler, group_t *group,
+							  pq_is_match_t is_match, void *param);
+
+
+/*	Description: orders the groups by the latest run times of their heads.
+ *
+ *	Used in function: PQCreate (inside funciton SchedulerCreateWithOptions);
+ */
+static int GroupHasHigherPriority(void *queue_group, const void *new_group,
+								  void *param);
+
+
+/*	Description: returns the latest run time of the head of a group as the
+ *	key of a radix queue.
+ *
+ *	Used in function: PQCreateRadix (inside funciton
+ *					  SchedulerCreateWithOptions);
+ */
+static uint64_t GroupKey(const void *group);
+
+
+/*	Description: returns the next task of the first class (critical, normal,
+ *	background) whose next task is due by now, and its group (see
+ *	PeekClass). NULL if none is due.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static task_t *PeekDue(scheduler_t *scheduler, time_t now, group_t **group);
+
+
+/*	Description: returns the earliest of the latest run times of the next
+ *	tasks of the classes - when the scheduler must wake up. the scheduler
+ *	isn't empty.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static time_t NextWakeup(scheduler_t *scheduler);
+
+
+/*	Description: puts off a due background task to the next second, if a
+ *	critical or normal task has started late this second, and it isn't an
+ *	interval late yet. returns TRUE if it was put off (and queued again).
+ *
+ *	Used in function: SchedulerRun;
+ */
+static int DeferIfBehind(scheduler_t *scheduler, task_t *task, time_t now);
+
+
+/*	Description: counts the lateness of a task about to run in the stats of
+ *	its class.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static void CountLateness(scheduler_t *scheduler, task_t *task, time_t now);
+
+
+/*	Description: returns the run time of a task as the key of a radix queue.
+ *
+ *	Used in function: PQCreateRadix (inside funciton
+ *					  SchedulerCreateWithOptions);
+ */
+static uint64_t RunTimeKey(const void *task);
+
+
 /*	Description: this function checks whether 2 IDs are identical or not.
  *	
  *	Argument 1: a pointer to a task from the queue. the ID of this task will be
@@ -51,25 +284,267 @@ static int HasHigherPriority(void *queue_tasks, const void *new_task, void *para
  */
 static int IDIsMatch(void *task_in_queue, void *ptr_id_to_check);
 
+
+/*	Description: pq_action_t which calls the user's task_stats_func_t with
+ *	the stats of a task.
+ *
+ *	Used in function: SchedulerForEachTask;
+ */
+static int ForEachTaskStats(void *task, void *for_each_pack);
+
+
+/*	Description: pq_action_t which sets the budget of the task with the
+ *	matching id, and stops the iteration.
+ *
+ *	Used in function: SchedulerSetTaskBudget;
+ */
+static int SetBudgetIfMatch(void *task, void *budget_pack);
+
+
+#ifdef WD_TASK_STATS
+/*	Description: reports a task which has overrun its budget to the overrun
+ *	handler, or to stderr when there is none.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static void ReportOverrun(scheduler_t *scheduler, task_t *task);
+
+
+/*	Description: returns the current time of the clock of scheduler in
+ *	milliseconds - now (of Now) by a custom clock, and the real time with
+ *	its fraction of a second by the default one.
+ *
+ *	Used in function: SchedulerRun (the lateness of TaskRun);
+ */
+static long NowMs(scheduler_t *scheduler, time_t now);
+#endif
+
+
+/*	Description: waits (poll) for the registered fds untill run_time arrives,
+ *	and dispatches the ready fds. returns after the first poll - the caller
+ *	re-checks the queue, since an fd_func may have changed it.
+ *	when run_time has already arrived - only collects the ready fds.
+ *	with a clock of the user - collects the ready fds, or else lets the
+ *	clock wait until run_time.
+ *
+ *	Used in function: SchedulerRun;
+ */
+static void WaitForEvents(scheduler_t *scheduler, time_t run_time);
+
+
+/*	Description: calls the fd_func of every fd returned ready by poll. fds
+ *	removed by the handlers are compacted afterwards.
+ *
+ *	Used in function: WaitForEvents;
+ */
+static void DispatchFds(scheduler_t *scheduler);
+
+
+/*	Description: marks the entry at 'index' as removed. a negative fd is
+ *	ignored by poll, and the entry is compacted after the next dispatch.
+ *
+ *	Used in functions: SchedulerRemoveFd, DispatchFds;
+ */
+static void MarkFdRemoved(scheduler_t *scheduler, size_t index);
+
+
+/*	Description: removes the entries marked as REMOVED_FD from the vectors.
+ *
+ *	Used in function: DispatchFds;
+ */
+static void CompactFds(scheduler_t *scheduler);
+
+
+/*	Description: task_func_t of every coroutine task - resumes the coroutine
+ *	until it waits (returns AWAITING, with its wake time set as the run time
+ *	of the task) or ends (frees it and returns its result).
+ *
+ *	Used in functions: SchedulerAddCoroutine, DestroyTask;
+ */
+static int RunCoroutine(void *coro_task);
+
+
+/*	Description: suspends the calling coroutine until wake_time (or until an
+ *	fd handler moves its task up).
+ *
+ *	Used in functions: SchedulerAwaitFd, SchedulerSleepFor;
+ */
+static void Suspend(coro_task_t *coro_task, time_t wake_time);
+
+
+/*	Description: suspends the calling coroutine until its fd is ready - its
+ *	task is parked (out of the queues) by SchedulerRun.
+ *
+ *	Used in function: SchedulerAwaitFd;
+ */
+static void Park(coro_task_t *coro_task);
+
+
+/*	Description: links the task of a coroutine which has parked into the
+ *	parked list / unlinks it. O(1).
+ *
+ *	Used in functions: SchedulerRun / SchedulerDestroy, EraseTask,
+ *					   CoroFdReady;
+ */
+static void LinkParked(scheduler_t *scheduler, coro_task_t *coro_task);
+static void UnlinkParked(scheduler_t *scheduler, coro_task_t *coro_task);
+
+
+/*	Description: fd_func_t of an awaited fd - keeps its revents, and moves
+ *	the task of the coroutine up to now. a parked one is pushed back, any
+ *	other is erased from its queue first.
+ *
+ *	Used in function: SchedulerAwaitFd;
+ */
+static int CoroFdReady(int fd, short revents, void *coro_task);
+
+
+/*	Description: matches the task in queue which is the very same task (or
+ *	the very same group).
+ *
+ *	Used in functions: PQErase (inside funcitons CoroFdReady,
+ *					   EraseFromGroup);
+ */
+static int IsSameTask(void *task_in_queue, void *task);
+
+
+/*	Description: destroys a task which isn't in the queue - a waiting
+ *	coroutine is discarded with it.
+ *
+ *	Used in functions: SchedulerDestroy, SchedulerRemoveTask, SchedulerRun;
+ */
+static void DestroyTask(task_t *task);
+
+
+/*	Description: discards a coroutine which hasn't ended, and what it waits
+ *	for.
+ *
+ *	Used in functions: DestroyTask, CoroFdReady;
+ */
+static void DestroyCoroutine(coro_task_t *coro_task);
+
+
+/*	Description: returns the current time by the clock of the scheduler.
+ *
+ *	Used in functions: SchedulerRun, SchedulerNow, the coroutine functions;
+ */
+static time_t Now(scheduler_t *scheduler);
+
+
+/*	Description: returns the milliseconds left untill run_time (absolute time
+ *	in seconds, as returned by time()). may be negative.
+ *
+ *	Used in function: WaitForEvents;
+ */
+static long MsUntil(time_t run_time);
+
+/******************************* globals **************************************/
+/* the coroutine task run by this thread right now */
+static _Thread_local coro_task_t *g_coro_task = NULL;
+
 /******************************************************************************
 *								SchedulerCreate
 *******************************************************************************/
 scheduler_t *SchedulerCreate(void)
+{
+	return (SchedulerCreateWithOptions(NULL));
+}
+
+
+/******************************************************************************
+*							SchedulerCreateWithOptions
+*******************************************************************************/
+scheduler_t *SchedulerCreateWithOptions(const scheduler_options_t *options)
 {
 	scheduler_t *new_sched = NULL;
-	pqueue_t *new_pqueue = NULL;
+	int is_radix = FALSE;
+	int are_queues_created = TRUE;
+	int i = 0;
+	
+	assert(NULL == options ||
+		   (NULL == options->clock.now_func) ==
+		   (NULL == options->clock.sleep_func));
 	
 	new_sched = (scheduler_t *) malloc(sizeof(scheduler_t));
 	if (NULL != new_sched)
 	{
-		new_pqueue = PQCreate(HasHigherPriority);
-		if (NULL != new_pqueue)
+		is_radix = (NULL != options && SCHED_QUEUE_RADIX == options->queue);
+		for (i = 0; i < TASK_CLASSES; ++i)
+		{
+			new_sched->queues[i] = is_radix ? PQCreateRadix(RunTimeKey) :
+											  PQCreate(HasHigherPriority);
+			new_sched->group_queues[i] = is_radix ? PQCreateRadix(GroupKey) :
+											PQCreate(GroupHasHigherPriority);
+			are_queues_created &= (NULL != new_sched->queues[i] &&
+								   NULL != new_sched->group_queues[i]);
+		}
+		
+		/*	the queue of the groups holds their heads - MAX_GROUPS at most */
+		for (i = 0; i < TASK_CLASSES && are_queues_created &&
+			 NULL != options && 0 < options->capacity; ++i)
 		{
-			new_sched->queue		= new_pqueue;
-			new_sched->is_running	= FALSE;
+			are_queues_created &=
+				(SUCCESS == PQReserve(new_sched->queues[i],
+									  options->capacity)) &&
+				(SUCCESS == PQReserve(new_sched->group_queues[i],
+									  (MAX_GROUPS < options->capacity) ?
+									  MAX_GROUPS : options->capacity));
+		}
+		new_sched->pollfds = DVCreate(FDS_CAPACITY, sizeof(struct pollfd));
+		new_sched->fd_handlers = DVCreate(FDS_CAPACITY, sizeof(fd_handler_t));
+		
+		if (are_queues_created &&
+			NULL != new_sched->pollfds &&
+			NULL != new_sched->fd_handlers)
+		{
+			memset(new_sched->class_stats, 0, sizeof(new_sched->class_stats));
+			new_sched->late_time	= (time_t)-1;
+			new_sched->run_time		= 0;
+			new_sched->parked		= NULL;
+			new_sched->groups_count	= 0;
+			memset(new_sched->group_slots, 0, sizeof(new_sched->group_slots));
+			new_sched->removed_fds	= 0;
+			new_sched->overrun_func	= NULL;
+			new_sched->overrun_param= NULL;
+			new_sched->wait_func	= NULL;
+			new_sched->wait_param	= NULL;
+			new_sched->clock.now_func	= NULL;
+			new_sched->clock.sleep_func	= NULL;
+			new_sched->clock.param		= NULL;
+			new_sched->timer_slack_ns	= 0;
+			new_sched->wakeups			= 0;
+			new_sched->queued			= 0;
+			new_sched->burst			= 0;
+			new_sched->backlog			= 0;
+			new_sched->max_backlog		= 0;
+			if (NULL != options)
+			{
+				new_sched->clock = options->clock;
+				new_sched->timer_slack_ns = options->timer_slack_ns;
+			}
+			atomic_init(&new_sched->is_running, FALSE);
 		}
-		else /* case PQCreate failed */
+		else /* case one of the creations failed */
 		{
+			for (i = 0; i < TASK_CLASSES; ++i)
+			{
+				if (NULL != new_sched->queues[i])
+				{
+					PQDestroy(new_sched->queues[i]);
+				}
+				if (NULL != new_sched->group_queues[i])
+				{
+					PQDestroy(new_sched->group_queues[i]);
+				}
+			}
+			if (NULL != new_sched->pollfds)
+			{
+				DVDestroy(new_sched->pollfds);
+			}
+			if (NULL != new_sched->fd_handlers)
+			{
+				DVDestroy(new_sched->fd_handlers);
+			}
 			free(new_sched);
 			new_sched = NULL;
 		}
@@ -84,17 +559,49 @@ scheduler_t *SchedulerCreate(void)
 *******************************************************************************/
 void SchedulerDestroy(scheduler_t *scheduler)
 {
+	task_t *task = NULL;
+	int i = 0;
+	
 	assert(scheduler);
 	
-	/* popout all of the tasks + destroys them */
-	while (!SchedulerIsEmpty(scheduler))
+	/* popout all of the tasks + destroys them, then the queues */
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		while (!PQIsEmpty(scheduler->queues[i]))
+		{
+			DestroyTask(PQPop(scheduler->queues[i]));
+		}
+		
+		PQDestroy(scheduler->queues[i]);
+		scheduler->queues[i] = NULL;
+		
+		/* the tasks of the groups are popped with their groups below */
+		PQDestroy(scheduler->group_queues[i]);
+		scheduler->group_queues[i] = NULL;
+	}
+	
+	for (i = 0; i < (int)scheduler->groups_count; ++i)
+	{
+		while (!GroupIsEmpty(scheduler->groups[i]))
+		{
+			DestroyTask(GroupPop(scheduler->groups[i]));
+		}
+		GroupDestroy(scheduler->groups[i]);
+		scheduler->groups[i] = NULL;
+	}
+	
+	while (NULL != scheduler->parked)
 	{
-		TaskDestroy(PQPop(scheduler->queue));
+		task = scheduler->parked->task;
+		UnlinkParked(scheduler, scheduler->parked);
+		DestroyTask(task);
 	}
 	
-	/* destroys the queue */
-	PQDestroy(scheduler->queue);
-	scheduler->queue = NULL;
+	/* the fds themselves belong to the user */
+	DVDestroy(scheduler->pollfds);
+	scheduler->pollfds = NULL;
+	DVDestroy(scheduler->fd_handlers);
+	scheduler->fd_handlers = NULL;
 	
 	/* destroys the scheduler */
 	free(scheduler);
@@ -118,7 +625,7 @@ unique_id_t SchedulerAddTask(scheduler_t *scheduler, task_func_t task_func,
 	if (NULL != new_task)
 	{
 		/* adds new_task to the queue */
-		if (SUCCESS == PQPush(scheduler->queue, new_task, NULL))
+		if (SUCCESS == PushTask(scheduler, new_task))
 		{
 			return (TaskGetId(new_task));
 		}
@@ -131,6 +638,37 @@ unique_id_t SchedulerAddTask(scheduler_t *scheduler, task_func_t task_func,
 }
 
 
+/******************************************************************************
+*								SchedulerAddTaskById
+*******************************************************************************/
+status_t SchedulerAddTaskById(scheduler_t *scheduler, unique_id_t id,
+							  task_func_t task_func, void *data,
+							  time_t start_time, time_t interval)
+{
+	task_t *new_task = NULL;
+	
+	assert(scheduler);
+	assert(task_func);
+	
+	new_task = TaskCreate(task_func, data, start_time, interval);
+	if (NULL == new_task)
+	{
+		return (FAILURE);
+	}
+	
+	TaskSetId(new_task, id);
+	if (SUCCESS != PushTask(scheduler, new_task))
+	{
+		TaskDestroy(new_task);
+		new_task = NULL;
+		
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
 /******************************************************************************
 *								SchedulerRemoveTask
 *******************************************************************************/
@@ -142,10 +680,10 @@ int SchedulerRemoveTask(scheduler_t *scheduler, unique_id_t id)
 	assert(scheduler);
 	
 	/* searches for a matching ID + erases the matched task from list */
-	task_to_delete = PQErase(scheduler->queue, IDIsMatch, &id);
+	task_to_delete = EraseTask(scheduler, IDIsMatch, &id);
 	if (NULL != task_to_delete)
 	{
-		TaskDestroy(task_to_delete);
+		DestroyTask(task_to_delete);
 		task_to_delete = NULL;
 	}
 	else
@@ -158,125 +696,1111 @@ int SchedulerRemoveTask(scheduler_t *scheduler, unique_id_t id)
 
 
 /******************************************************************************
-*								SchedulerRun
+*								SchedulerAddFd
 *******************************************************************************/
-int SchedulerRun(scheduler_t *scheduler)
+status_t SchedulerAddFd(scheduler_t *scheduler, int fd, short events,
+						fd_func_t fd_func, void *param)
 {
-	task_t *task_to_execute = NULL;
-	int task_run_status = 0;
-	time_t task_run_time = 0;
-	time_t time_to_sleep = 0;
+	struct pollfd new_pollfd = {0};
+	fd_handler_t new_handler = {0};
 	
 	assert(scheduler);
+	assert(fd_func);
+	assert(0 <= fd);
 	
-	scheduler->is_running = TRUE;
+	new_pollfd.fd = fd;
+	new_pollfd.events = events;
+	new_handler.fd_func = fd_func;
+	new_handler.param = param;
 	
-	while (!SchedulerIsEmpty(scheduler) &&
-			TRUE == scheduler->is_running)
+	/* both vectors must keep the same indexes */
+	if (SUCCESS != DVPushBack(scheduler->pollfds, &new_pollfd))
 	{
-		task_to_execute = PQPeek(scheduler->queue);
-		task_run_time = TaskGetRunTime(task_to_execute);
-		
-		/* case the time hasn't come to execute the next mission - sleeps
-		   until then */
-		if (task_run_time > time(NULL))
-		{
-			/* makes sure it sleeps enough time */
-			time_to_sleep = task_run_time - time(NULL);
-			while (time_to_sleep > 0)
-			{
-				time_to_sleep = sleep(time_to_sleep);
-			}
-		}
-		
-		task_to_execute = PQPop(scheduler->queue);
-		
-		task_run_status = TaskRun(task_to_execute);
-		switch (task_run_status)
-		{
-			case FAIL:
-				fprintf(stderr, "ERROR: the task has failed.\n");
-				TaskDestroy(task_to_execute);
-				break;
-				
-			case DONE:
-				TaskDestroy(task_to_execute);
-				task_to_execute = NULL;
-				break;
-				
-			case REPEAT:
-				TaskUpdateRunTime(task_to_execute);
-				/* push it back & checks */
-				if (SUCCESS != PQPush(scheduler->queue, task_to_execute, NULL))
-				{
-					fprintf(stderr, "ERROR: cannot repeat this task.\n");
-					TaskDestroy(task_to_execute);
-					task_to_execute = NULL;
-				}
-				break;
-				
-			default:
-				break;
-		}
+		return (FAILURE);
+	}
+	if (SUCCESS != DVPushBack(scheduler->fd_handlers, &new_handler))
+	{
+		DVPopBack(scheduler->pollfds);
+		return (FAILURE);
 	}
 	
-	return ((TRUE == scheduler->is_running) ? COMPLETE : STOP);
+	return (SUCCESS);
 }
 
 
 /******************************************************************************
-*								SchedulerStop
+*								SchedulerRemoveFd
 *******************************************************************************/
-void SchedulerStop(scheduler_t *scheduler)
+int SchedulerRemoveFd(scheduler_t *scheduler, int fd)
 {
+	struct pollfd *curr_pollfd = NULL;
+	size_t i = 0;
+	size_t nfds = 0;
+	
 	assert(scheduler);
 	
-	scheduler->is_running = FALSE;
+	nfds = DVSize(scheduler->pollfds);
+	for (i = 0; i < nfds; ++i)
+	{
+		curr_pollfd = DVGetItem(scheduler->pollfds, i);
+		if (fd == curr_pollfd->fd && REMOVED_FD != fd)
+		{
+			/*	only marked - the vectors may be iterated by DispatchFds
+				right now */
+			MarkFdRemoved(scheduler, i);
+			
+			return (SUCCESS);
+		}
+	}
+	
+	return (FAILURE);
 }
 
 
 /******************************************************************************
-*								SchedulerSize
+*								SchedulerRun
 *******************************************************************************/
-size_t SchedulerSize(scheduler_t *scheduler)
+int SchedulerRun(scheduler_t *scheduler)
 {
-	assert(scheduler);
+	task_t *task_to_execute = NULL;
+	group_t *group = NULL;
+	int task_run_status = 0;
+	time_t task_run_time = 0;
+	time_t now = 0;
+	
+	assert(scheduler);
+	
+	atomic_store(&scheduler->is_running, TRUE);
+	
+	/* of the calling thread - best effort */
+	if (0 != scheduler->timer_slack_ns)
+	{
+		prctl(PR_SET_TIMERSLACK, scheduler->timer_slack_ns, 0, 0, 0);
+	}
+	
+	while (TRUE == atomic_load(&scheduler->is_running))
+	{
+		now = Now(scheduler);
+		task_to_execute = PeekDue(scheduler, now, &group);
+		
+		/*	case the time hasn't come to execute the next mission - waits
+			for the fds until the latest time it may run at (the queues are
+			ordered by it). every task whose run time has come by then runs
+			in the same wakeup. the queues are checked again afterwards,
+			since the fd handlers may have changed them */
+		if (NULL == task_to_execute)
+		{
+			if (SchedulerIsEmpty(scheduler))
+			{
+				break;
+			}
+			
+			/* the tasks which were due together when it woke up */
+			if (0 < scheduler->burst)
+			{
+				scheduler->backlog = scheduler->burst;
+				scheduler->max_backlog = (scheduler->burst >
+										  scheduler->max_backlog) ?
+										 scheduler->burst :
+										 scheduler->max_backlog;
+				scheduler->burst = 0;
+			}
+			
+			task_run_time = NextWakeup(scheduler);
+			if (NULL != scheduler->wait_func)
+			{
+				scheduler->wait_func(task_run_time, scheduler->wait_param);
+			}
+			WaitForEvents(scheduler, task_run_time);
+			continue;
+		}
+		
+		/*	collects the fds which became ready while tasks were running -
+			but not ahead of a due critical task. the critical ones of a
+			wakeup all run before its fds are served */
+		if (TASK_CRITICAL != TaskGetClass(task_to_execute) &&
+			0 < DVSize(scheduler->pollfds))
+		{
+			WaitForEvents(scheduler, now);
+			if (TRUE != atomic_load(&scheduler->is_running))
+			{
+				break;
+			}
+			
+			/* a handler may have woken a task of a higher class */
+			now = Now(scheduler);
+			task_to_execute = PeekDue(scheduler, now, &group);
+			if (NULL == task_to_execute)
+			{
+				continue;
+			}
+		}
+		
+		/* the due tasks by class - critical first, background last */
+		task_to_execute = PopDue(scheduler, task_to_execute, group);
+		if (TaskGetRunTime(task_to_execute) > now)
+		{
+			/* one of the same key, with a slack - not due yet */
+			if (SUCCESS != PushTask(scheduler, task_to_execute))
+			{
+				fprintf(stderr, "ERROR: cannot reschedule this task.\n");
+				DestroyTask(task_to_execute);
+			}
+			continue;
+		}
+		if (DeferIfBehind(scheduler, task_to_execute, now))
+		{
+			continue;
+		}
+		CountLateness(scheduler, task_to_execute, now);
+		++scheduler->burst;
+		
+		scheduler->run_time = TaskGetRunTime(task_to_execute);
+#ifdef WD_TASK_STATS
+		task_run_status = TaskRun(task_to_execute, NowMs(scheduler, now));
+		if (TaskIsOverrun(task_to_execute))
+		{
+			ReportOverrun(scheduler, task_to_execute);
+		}
+#else
+		task_run_status = TaskRun(task_to_execute, 0);
+#endif
+		scheduler->run_time = 0;
+		switch (task_run_status)
+		{
+			case FAIL:
+				fprintf(stderr, "ERROR: the task has failed.\n");
+				TaskDestroy(task_to_execute);
+				break;
+				
+			case DONE:
+				TaskDestroy(task_to_execute);
+				task_to_execute = NULL;
+				break;
+				
+			case REPEAT:
+				/* push it back & checks */
+				if (SUCCESS != RearmTask(scheduler, task_to_execute))
+				{
+					fprintf(stderr, "ERROR: cannot repeat this task.\n");
+					TaskDestroy(task_to_execute);
+					task_to_execute = NULL;
+				}
+				break;
+				
+			case AWAITING:
+				/* a coroutine - waits in the queue until its wake time */
+				if (SUCCESS != PushTask(scheduler, task_to_execute))
+				{
+					fprintf(stderr, "ERROR: cannot suspend this coroutine.\n");
+					DestroyTask(task_to_execute);
+					task_to_execute = NULL;
+				}
+				break;
+			
+			case PARKED:
+				/* a coroutine - waits out of the queues until its fd */
+				LinkParked(scheduler,
+						   (coro_task_t *)TaskGetData(task_to_execute));
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	return ((TRUE == atomic_load(&scheduler->is_running)) ? COMPLETE : STOP);
+}
+
+
+/******************************************************************************
+*								SchedulerStop
+*******************************************************************************/
+void SchedulerStop(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	atomic_store(&scheduler->is_running, FALSE);
+}
+
+
+/******************************************************************************
+*								SchedulerForEachTask
+*******************************************************************************/
+int SchedulerForEachTask(scheduler_t *scheduler, task_stats_func_t func,
+						 void *param)
+{
+	for_each_pack_t for_each_pack = {0};
+	coro_task_t *coro_task = NULL;
+	int ret_status = SUCCESS;
+	int i = 0;
+	
+	assert(scheduler);
+	assert(func);
+	
+	for_each_pack.func = func;
+	for_each_pack.param = param;
+	
+	for (i = 0; i < TASK_CLASSES && SUCCESS == ret_status; ++i)
+	{
+		ret_status = PQForEach(scheduler->queues[i], ForEachTaskStats,
+							   &for_each_pack);
+	}
+	for (i = 0; i < (int)scheduler->groups_count && SUCCESS == ret_status; ++i)
+	{
+		ret_status = GroupForEach(scheduler->groups[i], ForEachTaskStats,
+								  &for_each_pack);
+	}
+	for (coro_task = scheduler->parked;
+		 NULL != coro_task && SUCCESS == ret_status;
+		 coro_task = coro_task->next)
+	{
+		ret_status = ForEachTaskStats(coro_task->task, &for_each_pack);
+	}
+	
+	return (ret_status);
+}
+
+
+/******************************************************************************
+*								SchedulerSetTaskBudget
+*******************************************************************************/
+int SchedulerSetTaskBudget(scheduler_t *scheduler, unique_id_t id,
+						   unsigned long budget_ns)
+{
+	budget_pack_t budget_pack = {0};
+	coro_task_t *coro_task = NULL;
+	int i = 0;
+	
+	assert(scheduler);
+	
+	budget_pack.id = id;
+	budget_pack.budget_ns = budget_ns;
+	
+	/* the budget doesn't change the priority - the task stays in place */
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		if (SUCCESS != PQForEach(scheduler->queues[i], SetBudgetIfMatch,
+								 &budget_pack))
+		{
+			return (SUCCESS);
+		}
+	}
+	for (i = 0; i < (int)scheduler->groups_count; ++i)
+	{
+		if (SUCCESS != GroupForEach(scheduler->groups[i], SetBudgetIfMatch,
+									&budget_pack))
+		{
+			return (SUCCESS);
+		}
+	}
+	for (coro_task = scheduler->parked; NULL != coro_task;
+		 coro_task = coro_task->next)
+	{
+		if (SUCCESS != SetBudgetIfMatch(coro_task->task, &budget_pack))
+		{
+			return (SUCCESS);
+		}
+	}
+	
+	return (FAILURE);
+}
+
+
+/******************************************************************************
+*								SchedulerSetTaskSlack
+*******************************************************************************/
+int SchedulerSetTaskSlack(scheduler_t *scheduler, unique_id_t id,
+						  time_t slack)
+{
+	task_t *task = NULL;
+	
+	assert(scheduler);
+	assert(0 <= slack);
+	
+	/* the slack moves the task in the queue - it's taken out & put back */
+	task = EraseTask(scheduler, IDIsMatch, &id);
+	if (NULL == task)
+	{
+		return (FAILURE);
+	}
+	
+	TaskSetSlack(task, slack);
+	if (SUCCESS != PushTask(scheduler, task))
+	{
+		fprintf(stderr, "ERROR: cannot reschedule this task.\n");
+		DestroyTask(task);
+		task = NULL;
+		
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*								SchedulerSetTaskInterval
+*******************************************************************************/
+int SchedulerSetTaskInterval(scheduler_t *scheduler, unique_id_t id,
+							 time_t interval)
+{
+	task_t *task = NULL;
+	time_t latest = 0;
+	
+	assert(scheduler);
+	
+	/*	the task leaves its interval group - it's queued by itself until its
+		next re-arm */
+	task = EraseTask(scheduler, IDIsMatch, &id);
+	if (NULL == task)
+	{
+		return (FAILURE);
+	}
+	
+	TaskSetInterval(task, interval);
+	latest = Now(scheduler) + interval;
+	if (TaskGetRunTime(task) > latest)
+	{
+		TaskSetRunTime(task, latest);
+	}
+	
+	if (SUCCESS != PushTask(scheduler, task))
+	{
+		fprintf(stderr, "ERROR: cannot reschedule this task.\n");
+		DestroyTask(task);
+		task = NULL;
+		
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*								SchedulerSetTaskClass
+*******************************************************************************/
+int SchedulerSetTaskClass(scheduler_t *scheduler, unique_id_t id,
+						  task_class_t task_class)
+{
+	task_t *task = NULL;
+	
+	assert(scheduler);
+	assert(TASK_CLASSES > task_class);
+	
+	/* moves the task to the queue of its new class */
+	task = EraseTask(scheduler, IDIsMatch, &id);
+	if (NULL == task)
+	{
+		return (FAILURE);
+	}
+	
+	TaskSetClass(task, task_class);
+	if (SUCCESS != PushTask(scheduler, task))
+	{
+		fprintf(stderr, "ERROR: cannot reschedule this task.\n");
+		DestroyTask(task);
+		task = NULL;
+		
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*								SchedulerGetClassStats
+*******************************************************************************/
+void SchedulerGetClassStats(scheduler_t *scheduler, task_class_t task_class,
+							sched_class_stats_t *stats)
+{
+	assert(scheduler);
+	assert(TASK_CLASSES > task_class);
+	assert(stats);
+	
+	*stats = scheduler->class_stats[task_class];
+}
+
+
+/******************************************************************************
+*								SchedulerSetOverrunHandler
+*******************************************************************************/
+void SchedulerSetOverrunHandler(scheduler_t *scheduler,
+								overrun_func_t overrun_func, void *param)
+{
+	assert(scheduler);
+	
+	scheduler->overrun_func = overrun_func;
+	scheduler->overrun_param = param;
+}
+
+
+/******************************************************************************
+*								SchedulerSetWaitHandler
+*******************************************************************************/
+void SchedulerSetWaitHandler(scheduler_t *scheduler, wait_func_t wait_func,
+							 void *param)
+{
+	assert(scheduler);
+	
+	scheduler->wait_func = wait_func;
+	scheduler->wait_param = param;
+}
+
+
+/******************************************************************************
+*								SchedulerAddCoroutine
+*******************************************************************************/
+unique_id_t SchedulerAddCoroutine(scheduler_t *scheduler, task_func_t task_func,
+								  void *data, time_t start_time)
+{
+	coro_task_t *new_coro_task = NULL;
+	
+	assert(scheduler);
+	assert(task_func);
+	
+	new_coro_task = (coro_task_t *)malloc(sizeof(coro_task_t));
+	if (NULL == new_coro_task)
+	{
+		return (UIDCreateBad());
+	}
+	
+	new_coro_task->scheduler = scheduler;
+	new_coro_task->wake_time = start_time;
+	new_coro_task->fd = NO_FD;
+	new_coro_task->revents = 0;
+	new_coro_task->own_fd = NO_FD;
+	new_coro_task->is_parked = FALSE;
+	new_coro_task->prev = NULL;
+	new_coro_task->next = NULL;
+	new_coro_task->task = NULL;
+	new_coro_task->coro = CoroCreate(task_func, data);
+	if (NULL != new_coro_task->coro)
+	{
+		new_coro_task->task = TaskCreate(RunCoroutine, new_coro_task,
+										 start_time, 0);
+	}
+	
+	if (NULL != new_coro_task->task &&
+		SUCCESS == PushTask(scheduler, new_coro_task->task))
+	{
+		return (TaskGetId(new_coro_task->task));
+	}
+	
+	/* case one of the creations failed */
+	if (NULL != new_coro_task->task)
+	{
+		TaskDestroy(new_coro_task->task);
+	}
+	if (NULL != new_coro_task->coro)
+	{
+		CoroDestroy(new_coro_task->coro);
+	}
+	free(new_coro_task);
+	new_coro_task = NULL;
+	
+	return (UIDCreateBad());
+}
+
+
+/******************************************************************************
+*								SchedulerAwaitFd
+*******************************************************************************/
+short SchedulerAwaitFd(int fd, short events, time_t timeout)
+{
+	coro_task_t *coro_task = g_coro_task;
+	time_t deadline = 0;
+	short revents = 0;
+	
+	if (NULL == coro_task ||
+		SUCCESS != SchedulerAddFd(coro_task->scheduler, fd, events,
+								  CoroFdReady, coro_task))
+	{
+		return (-1);
+	}
+	
+	coro_task->fd = fd;
+	coro_task->revents = 0;
+	deadline = Now(coro_task->scheduler) + timeout;
+	
+	/*	wakes up when the fd is ready (CoroFdReady moves the task up) or at
+		the deadline. with no timeout - parked out of the queues, and put
+		back into one only by the fd (or by a change of the task, then it
+		waits again every FOREVER) */
+	do
+	{
+		if (0 > timeout)
+		{
+			Park(coro_task);
+		}
+		else
+		{
+			Suspend(coro_task, deadline);
+		}
+	}
+	while (0 == coro_task->revents &&
+		   (0 > timeout || Now(coro_task->scheduler) < deadline));
+	
+	/* a ready fd has been removed by its handler already */
+	if (0 == coro_task->revents)
+	{
+		SchedulerRemoveFd(coro_task->scheduler, fd);
+	}
+	revents = coro_task->revents;
+	coro_task->fd = NO_FD;
+	coro_task->revents = 0;
+	
+	return (revents);
+}
+
+
+/******************************************************************************
+*								SchedulerSleepFor
+*******************************************************************************/
+int SchedulerSleepFor(time_t seconds)
+{
+	if (NULL == g_coro_task)
+	{
+		return (FAILURE);
+	}
+	
+	Suspend(g_coro_task, Now(g_coro_task->scheduler) + seconds);
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*								SchedulerAwaitSignal
+*******************************************************************************/
+int SchedulerAwaitSignal(int signo, time_t timeout)
+{
+	coro_task_t *coro_task = g_coro_task;
+	struct signalfd_siginfo info = {0};
+	sigset_t mask;
+	ssize_t read_bytes = 0;
+	
+	if (NULL == coro_task)
+	{
+		return (FAILURE);
+	}
+	
+	sigemptyset(&mask);
+	sigaddset(&mask, signo);
+	
+	/*	kept in own_fd - closed by DestroyCoroutine if the coroutine is
+		discarded while it waits */
+	coro_task->own_fd = signalfd(NO_FD, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (NO_FD == coro_task->own_fd)
+	{
+		return (FAILURE);
+	}
+	
+	if (0 < (SchedulerAwaitFd(coro_task->own_fd, POLLIN, timeout) & POLLIN))
+	{
+		read_bytes = read(coro_task->own_fd, &info, sizeof(info));
+	}
+	
+	close(coro_task->own_fd);
+	coro_task->own_fd = NO_FD;
+	
+	return ((sizeof(info) == read_bytes) ? SUCCESS : FAILURE);
+}
+
+
+/******************************************************************************
+*								SchedulerNow
+*******************************************************************************/
+time_t SchedulerNow(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	return (Now(scheduler));
+}
+
+
+/******************************************************************************
+*								SchedulerRunTime
+*******************************************************************************/
+time_t SchedulerRunTime(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	return (scheduler->run_time);
+}
+
+
+/******************************************************************************
+*								SchedulerWakeups
+*******************************************************************************/
+size_t SchedulerWakeups(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	return (scheduler->wakeups);
+}
+
+
+/******************************************************************************
+*								SchedulerBacklog
+*******************************************************************************/
+size_t SchedulerBacklog(scheduler_t *scheduler, size_t *max_backlog)
+{
+	assert(scheduler);
+	
+	if (NULL != max_backlog)
+	{
+		*max_backlog = scheduler->max_backlog;
+	}
+	
+	return (scheduler->backlog);
+}
+
+
+/******************************************************************************
+*								SchedulerSize
+*******************************************************************************/
+size_t SchedulerSize(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	return (scheduler->queued);
+}
+
+
+/******************************************************************************
+*								SchedulerIsEmpty
+*******************************************************************************/
+int SchedulerIsEmpty(scheduler_t *scheduler)
+{
+	int i = 0;
+	
+	assert(scheduler);
+	
+	/* a group with tasks is in the queue of the groups */
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		if (!PQIsEmpty(scheduler->queues[i]) ||
+			!PQIsEmpty(scheduler->group_queues[i]))
+		{
+			return (FALSE);
+		}
+	}
+	
+	return (NULL == scheduler->parked);
+}
+
+
+
+/******************************************************************************
+*************************** internal functions ********************************
+*******************************************************************************/
+
+/*************************** HasHigherPriority *******************************/
+static int HasHigherPriority(void *queue_tasks, const void *new_task, void *param)
+{
+	time_t run_time_queue_task = 0;
+	time_t run_time_new_task = 0;
+	UNUSED(param);
+	
+	assert(queue_tasks);
+	assert(new_task);
+	
+	/* extract the latest run_time from the tasks */
+	run_time_queue_task = LatestRunTime((task_t *) queue_tasks);
+	run_time_new_task = LatestRunTime((task_t *) new_task);
+	
+	return (run_time_queue_task > run_time_new_task);
+}
+
+/****************************** RunTimeKey ************************************/
+static uint64_t RunTimeKey(const void *task)
+{
+	assert(task);
+	
+	return ((uint64_t)LatestRunTime((task_t *)task));
+}
+
+/**************************** LatestRunTime ***********************************/
+static time_t LatestRunTime(task_t *task)
+{
+	assert(task);
+	
+	return (TaskGetRunTime(task) + TaskGetSlack(task));
+}
+
+/******************************* PushTask *************************************/
+static status_t PushTask(scheduler_t *scheduler, task_t *task)
+{
+	assert(scheduler);
+	assert(task);
+	
+	if (SUCCESS != PQPush(scheduler->queues[TaskGetClass(task)], task, NULL))
+	{
+		return (FAILURE);
+	}
+	++scheduler->queued;
+	
+	return (SUCCESS);
+}
+
+/******************************* EraseTask ************************************/
+static task_t *EraseTask(scheduler_t *scheduler, pq_is_match_t is_match,
+						 void *param)
+{
+	coro_task_t *coro_task = NULL;
+	task_t *task = NULL;
+	int i = 0;
+	
+	assert(scheduler);
+	
+	for (i = 0; i < TASK_CLASSES && NULL == task; ++i)
+	{
+		task = PQErase(scheduler->queues[i], is_match, param);
+	}
+	for (i = 0; i < (int)scheduler->groups_count && NULL == task; ++i)
+	{
+		task = EraseFromGroup(scheduler, scheduler->groups[i], is_match, param);
+	}
+	scheduler->queued -= (NULL != task);
+	
+	/*	a parked one is put back by the caller into a queue - it wakes up
+		at its wake time, or as its fd is ready */
+	for (coro_task = scheduler->parked; NULL != coro_task && NULL == task;
+		 coro_task = coro_task->next)
+	{
+		if (is_match(coro_task->task, param))
+		{
+			task = coro_task->task;
+			UnlinkParked(scheduler, coro_task);
+		}
+	}
+	
+	return (task);
+}
+
+/******************************** PeekDue *************************************/
+static task_t *PeekDue(scheduler_t *scheduler, time_t now, group_t **group)
+{
+	task_t *task = NULL;
+	int i = 0;
+	
+	assert(scheduler);
+	assert(group);
+	
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		task = PeekClass(scheduler, (task_class_t)i, group);
+		if (NULL != task && TaskGetRunTime(task) <= now)
+		{
+			return (task);
+		}
+	}
+	
+	return (NULL);
+}
+
+/****************************** NextWakeup ************************************/
+static time_t NextWakeup(scheduler_t *scheduler)
+{
+	task_t *task = NULL;
+	group_t *group = NULL;
+	time_t wakeup = 0;
+	time_t latest = 0;
+	int is_found = FALSE;
+	int i = 0;
+	
+	assert(scheduler);
+	
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		task = PeekClass(scheduler, (task_class_t)i, &group);
+		if (NULL != task)
+		{
+			latest = LatestRunTime(task);
+			wakeup = (!is_found || latest < wakeup) ? latest : wakeup;
+			is_found = TRUE;
+		}
+	}
+	
+	/*	only parked coroutines - they're woken by their fds */
+	return (is_found ? wakeup : Now(scheduler) + FOREVER);
+}
+
+/******************************* PeekClass ************************************/
+static task_t *PeekClass(scheduler_t *scheduler, task_class_t task_class,
+						 group_t **group)
+{
+	task_t *queued = NULL;
+	task_t *grouped = NULL;
+	
+	assert(scheduler);
+	assert(group);
+	
+	*group = NULL;
+	if (!PQIsEmpty(scheduler->queues[task_class]))
+	{
+		queued = PQPeek(scheduler->queues[task_class]);
+	}
+	if (!PQIsEmpty(scheduler->group_queues[task_class]))
+	{
+		*group = PQPeek(scheduler->group_queues[task_class]);
+		grouped = GroupPeek(*group);
+	}
+	
+	if (NULL != grouped &&
+		(NULL == queued || LatestRunTime(grouped) < LatestRunTime(queued)))
+	{
+		return (grouped);
+	}
+	
+	*group = NULL;
+	
+	return (queued);
+}
+
+/********************************* PopDue *************************************/
+static task_t *PopDue(scheduler_t *scheduler, task_t *task, group_t *group)
+{
+	assert(scheduler);
+	assert(task);
+	
+	--scheduler->queued;
+	if (NULL == group)
+	{
+		return (PQPop(scheduler->queues[TaskGetClass(task)]));
+	}
+	
+	/* the head of the group changes - it's ordered again by the next one */
+	group = PQPop(scheduler->group_queues[TaskGetClass(task)]);
+	task = GroupPop(group);
+	RequeueGroup(scheduler, group);
+	
+	return (task);
+}
+
+/******************************* RearmTask ************************************/
+static status_t RearmTask(scheduler_t *scheduler, task_t *task)
+{
+	group_t *group = NULL;
+	
+	assert(scheduler);
+	assert(task);
+	
+	TaskSetRunTime(task, Now(scheduler) + TaskGetInterval(task));
+	
+	/*	the tail of the group was re-armed earlier by the same interval. a
+		clock set back (time()) breaks the order - then it's queued alone */
+	group = FindGroup(scheduler, task);
+	if (NULL == group ||
+		(!GroupIsEmpty(group) &&
+		 TaskGetRunTime(GroupTail(group)) > TaskGetRunTime(task)))
+	{
+		return (PushTask(scheduler, task));
+	}
+	
+	if (SUCCESS != GroupAppend(group, task))
+	{
+		return (PushTask(scheduler, task));
+	}
+	++scheduler->queued;
+	
+	/* an empty group isn't in the queue of the groups */
+	if (1 == GroupSize(group))
+	{
+		RequeueGroup(scheduler, group);
+	}
+	
+	return (SUCCESS);
+}
+
+/******************************* FindGroup ************************************/
+static group_t *FindGroup(scheduler_t *scheduler, task_t *task)
+{
+	group_t *group = NULL;
+	size_t slot = 0;
+	
+	assert(scheduler);
+	assert(task);
+	
+	group = (group_t *)TaskGetGroup(task);
+	if (NULL != group && GroupIsMatch(group, task))
+	{
+		return (group);
+	}
+	
+	if (0 >= TaskGetInterval(task))
+	{
+		return (NULL);
+	}
+	
+	/*	its slack or class has changed, or it isn't in a group yet. the
+		slots are never full - at most half of them are taken */
+	slot = (size_t)(TaskGetInterval(task) * 31 + TaskGetSlack(task)) *
+		   TASK_CLASSES + TaskGetClass(task);
+	for (slot &= GROUP_SLOTS - 1; NULL != scheduler->group_slots[slot];
+		 slot = (slot + 1) & (GROUP_SLOTS - 1))
+	{
+		if (GroupIsMatch(scheduler->group_slots[slot], task))
+		{
+			TaskSetGroup(task, scheduler->group_slots[slot]);
+			
+			return (scheduler->group_slots[slot]);
+		}
+	}
+	
+	if (MAX_GROUPS == scheduler->groups_count)
+	{
+		return (NULL);
+	}
 	
-	return (PQSize(scheduler->queue));
+	group = GroupCreate(TaskGetInterval(task), TaskGetSlack(task),
+						TaskGetClass(task));
+	if (NULL != group)
+	{
+		scheduler->groups[scheduler->groups_count] = group;
+		++scheduler->groups_count;
+		scheduler->group_slots[slot] = group;
+	}
+	TaskSetGroup(task, group);
+	
+	return (group);
 }
 
+/****************************** RequeueGroup **********************************/
+static void RequeueGroup(scheduler_t *scheduler, group_t *group)
+{
+	task_t *task = NULL;
+	pqueue_t *group_queue = NULL;
+	
+	assert(scheduler);
+	assert(group);
+	
+	if (GroupIsEmpty(group))
+	{
+		return;
+	}
+	
+	group_queue = scheduler->group_queues[TaskGetClass(GroupPeek(group))];
+	if (SUCCESS == PQPush(group_queue, group, NULL))
+	{
+		return;
+	}
+	
+	while (!GroupIsEmpty(group))
+	{
+		task = GroupPop(group);
+		--scheduler->queued;
+		if (SUCCESS != PushTask(scheduler, task))
+		{
+			fprintf(stderr, "ERROR: cannot reschedule this task.\n");
+			DestroyTask(task);
+		}
+	}
+}
 
-/******************************************************************************
-*								SchedulerIsEmpty
-*******************************************************************************/
-int SchedulerIsEmpty(scheduler_t *scheduler)
+/***************************** EraseFromGroup *********************************/
+static task_t *EraseFromGroup(scheduler_t *scheduler, group_t *group,
+							  pq_is_match_t is_match, void *param)
 {
+	task_t *task = NULL;
+	
 	assert(scheduler);
+	assert(group);
+	
+	if (GroupIsEmpty(group))
+	{
+		return (NULL);
+	}
+	
+	if (!is_match(GroupPeek(group), param))
+	{
+		return (GroupErase(group, is_match, param));
+	}
+	
+	/* the head is taken - the group is ordered again by the next one */
+	task = GroupPeek(group);
+	PQErase(scheduler->group_queues[TaskGetClass(task)], IsSameTask, group);
+	GroupPop(group);
+	RequeueGroup(scheduler, group);
 	
-	return (PQIsEmpty(scheduler->queue));
+	return (task);
 }
 
+/************************* GroupHasHigherPriority *****************************/
+static int GroupHasHigherPriority(void *queue_group, const void *new_group,
+								  void *param)
+{
+	UNUSED(param);
+	
+	assert(queue_group);
+	assert(new_group);
+	
+	return (LatestRunTime(GroupPeek((group_t *)queue_group)) >
+			LatestRunTime(GroupPeek((const group_t *)new_group)));
+}
 
+/******************************** GroupKey ************************************/
+static uint64_t GroupKey(const void *group)
+{
+	assert(group);
+	
+	return ((uint64_t)LatestRunTime(GroupPeek((const group_t *)group)));
+}
 
-/******************************************************************************
-*************************** internal functions ********************************
-*******************************************************************************/
+/***************************** DeferIfBehind **********************************/
+static int DeferIfBehind(scheduler_t *scheduler, task_t *task, time_t now)
+{
+	assert(scheduler);
+	assert(task);
+	
+	if (TASK_BACKGROUND != TaskGetClass(task) ||
+		scheduler->late_time != now ||
+		now - TaskGetRunTime(task) >= TaskGetInterval(task))
+	{
+		return (FALSE);
+	}
+	
+	TaskSetRunTime(task, now + 1);
+	if (SUCCESS != PushTask(scheduler, task))
+	{
+		fprintf(stderr, "ERROR: cannot defer this task.\n");
+		DestroyTask(task);
+	}
+	++scheduler->class_stats[TASK_BACKGROUND].deferrals;
+	
+	return (TRUE);
+}
 
-/*************************** HasHigherPriority *******************************/
-static int HasHigherPriority(void *queue_tasks, const void *new_task, void *param)
+/***************************** CountLateness **********************************/
+static void CountLateness(scheduler_t *scheduler, task_t *task, time_t now)
 {
-	time_t run_time_queue_task = 0;
-	time_t run_time_new_task = 0;
-	UNUSED(param);
+	sched_class_stats_t *stats = NULL;
+	time_t lateness = 0;
 	
-	assert(queue_tasks);
-	assert(new_task);
+	assert(scheduler);
+	assert(task);
 	
-	/* extract the run_time from the tasks */
-	run_time_queue_task = TaskGetRunTime((task_t *) queue_tasks);
-	run_time_new_task = TaskGetRunTime((task_t *) new_task);
+	stats = &scheduler->class_stats[TaskGetClass(task)];
+	lateness = now - TaskGetRunTime(task);
+	lateness = (0 > lateness) ? 0 : lateness;
 	
-	return (run_time_queue_task > run_time_new_task);
+	++stats->runs;
+	stats->total_lateness += lateness;
+	stats->max_lateness = (lateness > stats->max_lateness) ?
+						  lateness : stats->max_lateness;
+	if (0 < lateness)
+	{
+		++stats->late_runs;
+		
+		/* the background tasks make way for the rest of this second */
+		if (TASK_BACKGROUND != TaskGetClass(task))
+		{
+			scheduler->late_time = now;
+		}
+	}
 }
 
 /****************************** IDIsMatch *************************************/
@@ -296,16 +1820,423 @@ static int IDIsMatch(void *task_in_queue, void *ptr_id_to_check)
 }
 
 
+/**************************** ForEachTaskStats ********************************/
+static int ForEachTaskStats(void *task, void *for_each_pack)
+{
+	for_each_pack_t *pack = (for_each_pack_t *)for_each_pack;
+	task_stats_t stats = {0};
+	
+	assert(task);
+	assert(for_each_pack);
+	
+	TaskGetStats((task_t *)task, &stats);
+	
+	return (pack->func(TaskGetId((task_t *)task), &stats, pack->param));
+}
+
+
+/**************************** SetBudgetIfMatch ********************************/
+static int SetBudgetIfMatch(void *task, void *budget_pack)
+{
+	budget_pack_t *pack = (budget_pack_t *)budget_pack;
+	
+	assert(task);
+	assert(budget_pack);
+	
+	if (IDIsMatch(task, &pack->id))
+	{
+		TaskSetBudget((task_t *)task, pack->budget_ns);
+		
+		/* found - stops the iteration */
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
+#ifdef WD_TASK_STATS
+/****************************** ReportOverrun *********************************/
+static void ReportOverrun(scheduler_t *scheduler, task_t *task)
+{
+	task_stats_t stats = {0};
+	
+	assert(scheduler);
+	assert(task);
+	
+	TaskGetStats(task, &stats);
+	
+	if (NULL != scheduler->overrun_func)
+	{
+		scheduler->overrun_func(TaskGetId(task), &stats,
+								scheduler->overrun_param);
+	}
+	else
+	{
+		fprintf(stderr, "WARNING: a task has run %lu ns (budget %lu ns).\n",
+				stats.last_ns, stats.budget_ns);
+	}
+}
+
+
+/******************************** NowMs ***************************************/
+static long NowMs(scheduler_t *scheduler, time_t now)
+{
+	struct timespec real = {0};
+	
+	assert(scheduler);
+	
+	if (NULL != scheduler->clock.now_func)
+	{
+		return ((long)now * MS_IN_SEC);
+	}
+	
+	clock_gettime(CLOCK_REALTIME, &real);
+	
+	return ((long)real.tv_sec * MS_IN_SEC + real.tv_nsec / NS_IN_MS);
+}
+#endif
+
+
+/****************************** WaitForEvents *********************************/
+static void WaitForEvents(scheduler_t *scheduler, time_t run_time)
+{
+	struct pollfd *pollfds = NULL;
+	size_t nfds = 0;
+	long timeout = 0;
+	
+	assert(scheduler);
+	
+	nfds = DVSize(scheduler->pollfds);
+	if (0 < nfds)
+	{
+		pollfds = DVGetItem(scheduler->pollfds, 0);
+	}
+	
+	/*	a clock of the user - the fds are only collected, and the clock
+		waits (a virtual clock jumps) when none is ready */
+	if (NULL != scheduler->clock.sleep_func)
+	{
+		if (0 < nfds && 0 < poll(pollfds, nfds, 0))
+		{
+			DispatchFds(scheduler);
+		}
+		else if (run_time > Now(scheduler))
+		{
+			++scheduler->wakeups;
+			scheduler->clock.sleep_func(run_time, scheduler->clock.param);
+		}
+		
+		return;
+	}
+	
+	timeout = MsUntil(run_time);
+	timeout = (0 > timeout) ? 0 : timeout;
+	timeout = (INT_MAX < timeout) ? INT_MAX : timeout;
+	scheduler->wakeups += (0 < timeout);
+	
+	/*	with no fds - poll is a plain sleep. when interrupted by a signal
+		the caller simply waits again */
+	if (0 < poll(pollfds, nfds, (int)timeout))
+	{
+		DispatchFds(scheduler);
+	}
+}
+
+
+/****************************** DispatchFds ***********************************/
+static void DispatchFds(scheduler_t *scheduler)
+{
+	struct pollfd *curr_pollfd = NULL;
+	fd_handler_t handler = {0};
+	short revents = 0;
+	size_t i = 0;
+	size_t nfds = 0;
+	
+	assert(scheduler);
+	
+	/*	fds added by the handlers are appended after nfds and are not
+		dispatched in this round */
+	nfds = DVSize(scheduler->pollfds);
+	for (i = 0; i < nfds; ++i)
+	{
+		/* the vectors may be reallocated by a handler - fetch every round */
+		curr_pollfd = DVGetItem(scheduler->pollfds, i);
+		revents = curr_pollfd->revents;
+		curr_pollfd->revents = 0;
+		
+		if (0 == revents || REMOVED_FD == curr_pollfd->fd)
+		{
+			continue;
+		}
+		
+		handler = *(fd_handler_t *)DVGetItem(scheduler->fd_handlers, i);
+		switch (handler.fd_func(curr_pollfd->fd, revents, handler.param))
+		{
+			case FAIL:
+				fprintf(stderr, "ERROR: the fd handler has failed.\n");
+				MarkFdRemoved(scheduler, i);
+				break;
+			
+			case DONE:
+				MarkFdRemoved(scheduler, i);
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	CompactFds(scheduler);
+}
+
+
+/***************************** MarkFdRemoved **********************************/
+static void MarkFdRemoved(scheduler_t *scheduler, size_t index)
+{
+	struct pollfd *pollfd_to_remove = NULL;
+	
+	assert(scheduler);
+	
+	pollfd_to_remove = DVGetItem(scheduler->pollfds, index);
+	if (REMOVED_FD != pollfd_to_remove->fd)
+	{
+		pollfd_to_remove->fd = REMOVED_FD;
+		pollfd_to_remove->revents = 0;
+		++scheduler->removed_fds;
+	}
+}
+
+
+/****************************** CompactFds ************************************/
+static void CompactFds(scheduler_t *scheduler)
+{
+	struct pollfd *curr_pollfd = NULL;
+	size_t last_index = 0;
+	size_t i = 0;
+	
+	assert(scheduler);
+	
+	while (0 < scheduler->removed_fds)
+	{
+		/* finds a removed entry, and replaces it with the last entry */
+		curr_pollfd = DVGetItem(scheduler->pollfds, i);
+		if (REMOVED_FD == curr_pollfd->fd)
+		{
+			last_index = DVSize(scheduler->pollfds) - 1;
+			*curr_pollfd =
+					*(struct pollfd *)DVGetItem(scheduler->pollfds, last_index);
+			*(fd_handler_t *)DVGetItem(scheduler->fd_handlers, i) =
+					*(fd_handler_t *)DVGetItem(scheduler->fd_handlers,
+											   last_index);
+			DVPopBack(scheduler->pollfds);
+			DVPopBack(scheduler->fd_handlers);
+			--scheduler->removed_fds;
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+
+/****************************** RunCoroutine **********************************/
+static int RunCoroutine(void *coro_task)
+{
+	coro_task_t *this_coro_task = (coro_task_t *)coro_task;
+	coro_task_t *outer_coro_task = g_coro_task;
+	int is_finished = FALSE;
+	int result = 0;
+	
+	assert(coro_task);
+	
+	g_coro_task = this_coro_task;
+	is_finished = CoroResume(this_coro_task->coro);
+	g_coro_task = outer_coro_task;
+	
+	if (FALSE == is_finished)
+	{
+		TaskSetRunTime(this_coro_task->task, this_coro_task->wake_time);
+		
+		return (this_coro_task->is_parked ? PARKED : AWAITING);
+	}
+	
+	/* the task is destroyed by SchedulerRun right afterwards */
+	result = CoroResult(this_coro_task->coro);
+	CoroDestroy(this_coro_task->coro);
+	free(this_coro_task);
+	this_coro_task = NULL;
+	
+	return ((FAIL == result) ? FAIL : DONE);
+}
+
+
+/******************************* Suspend **************************************/
+static void Suspend(coro_task_t *coro_task, time_t wake_time)
+{
+	assert(coro_task);
+	
+	coro_task->wake_time = wake_time;
+	CoroYield();
+}
+
+
+/********************************* Park ***************************************/
+static void Park(coro_task_t *coro_task)
+{
+	assert(coro_task);
+	
+	/* its run time if it's put back into a queue (by a change of the task) */
+	coro_task->wake_time = Now(coro_task->scheduler) + FOREVER;
+	coro_task->is_parked = TRUE;
+	CoroYield();
+}
+
+
+/****************************** LinkParked ************************************/
+static void LinkParked(scheduler_t *scheduler, coro_task_t *coro_task)
+{
+	assert(scheduler);
+	assert(coro_task);
+	
+	coro_task->prev = NULL;
+	coro_task->next = scheduler->parked;
+	if (NULL != scheduler->parked)
+	{
+		scheduler->parked->prev = coro_task;
+	}
+	scheduler->parked = coro_task;
+	++scheduler->queued;
+}
+
+
+/***************************** UnlinkParked ***********************************/
+static void UnlinkParked(scheduler_t *scheduler, coro_task_t *coro_task)
+{
+	assert(scheduler);
+	assert(coro_task);
+	assert(coro_task->is_parked);
+	
+	if (NULL != coro_task->prev)
+	{
+		coro_task->prev->next = coro_task->next;
+	}
+	else
+	{
+		scheduler->parked = coro_task->next;
+	}
+	if (NULL != coro_task->next)
+	{
+		coro_task->next->prev = coro_task->prev;
+	}
+	coro_task->prev = NULL;
+	coro_task->next = NULL;
+	coro_task->is_parked = FALSE;
+	--scheduler->queued;
+}
 
 
+/****************************** CoroFdReady ***********************************/
+static int CoroFdReady(int fd, short revents, void *coro_task)
+{
+	coro_task_t *ready_coro_task = (coro_task_t *)coro_task;
+	scheduler_t *scheduler = NULL;
+	task_t *task = NULL;
+	UNUSED(fd);
+	
+	assert(coro_task);
+	
+	scheduler = ready_coro_task->scheduler;
+	ready_coro_task->revents = revents;
+	
+	/* the fd is removed by the scheduler as this handler returns DONE */
+	ready_coro_task->fd = NO_FD;
+	
+	/*	runs the coroutine as soon as the due tasks. a parked one is taken
+		as is - a wait with a deadline is searched for in the queues */
+	if (ready_coro_task->is_parked)
+	{
+		UnlinkParked(scheduler, ready_coro_task);
+		task = ready_coro_task->task;
+	}
+	else
+	{
+		task = EraseTask(scheduler, IsSameTask, ready_coro_task->task);
+	}
+	
+	if (NULL != task)
+	{
+		TaskSetRunTime(ready_coro_task->task, Now(scheduler));
+		if (SUCCESS != PushTask(scheduler, ready_coro_task->task))
+		{
+			fprintf(stderr, "ERROR: cannot wake this coroutine.\n");
+			DestroyTask(ready_coro_task->task);
+		}
+	}
+	
+	return (DONE);
+}
+
 
+/****************************** IsSameTask ************************************/
+static int IsSameTask(void *task_in_queue, void *task)
+{
+	return (task_in_queue == task);
+}
 
 
+/****************************** DestroyTask ***********************************/
+static void DestroyTask(task_t *task)
+{
+	assert(task);
+	
+	if (RunCoroutine == TaskGetFunc(task))
+	{
+		DestroyCoroutine((coro_task_t *)TaskGetData(task));
+	}
+	
+	TaskDestroy(task);
+}
 
 
+/**************************** DestroyCoroutine ********************************/
+static void DestroyCoroutine(coro_task_t *coro_task)
+{
+	assert(coro_task);
+	
+	if (NO_FD != coro_task->fd)
+	{
+		SchedulerRemoveFd(coro_task->scheduler, coro_task->fd);
+	}
+	if (NO_FD != coro_task->own_fd)
+	{
+		close(coro_task->own_fd);
+	}
+	
+	/* the stack is discarded as is */
+	CoroDestroy(coro_task->coro);
+	free(coro_task);
+}
 
 
+/********************************* Now ****************************************/
+static time_t Now(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	return ((NULL != scheduler->clock.now_func) ?
+			scheduler->clock.now_func(scheduler->clock.param) : time(NULL));
+}
 
 
+/******************************* MsUntil **************************************/
+static long MsUntil(time_t run_time)
+{
+	struct timespec now = {0};
 
+	clock_gettime(CLOCK_REALTIME, &now);
 
+	return ((long)(run_time - now.tv_sec) * MS_IN_SEC -
+			(now.tv_nsec / NS_IN_MS));
+}
@@ -25,6 +25,122 @@ enum state
  */
 typedef struct scheduler scheduler_t;
 
+/*******************************************************************************
+ *  Description:   the priority queue which orders the tasks by run time.
+ *				   SCHED_QUEUE_HEAP  - a binary heap (the default).
+ *				   SCHED_QUEUE_RADIX - a radix heap over the run times (in
+ *									   seconds). fits a scheduler whose new
+ *									   tasks are rarely due before the last
+ *									   one run - such a task runs next.
+ */
+typedef enum sched_queue
+{
+	SCHED_QUEUE_HEAP,
+	SCHED_QUEUE_RADIX
+} sched_queue_t;
+
+/*******************************************************************************
+ *  Description:   the clock of a scheduler - by which the run times are set
+ *				   (SchedulerNow, REPEAT, the coroutine waits) and reached.
+ *				   both functions are set, or both are NULL - the real time
+ *				   (time & poll, the default).
+ *
+ *				   now_func	  - returns the current time, in seconds.
+ *				   sleep_func - waits until run_time. called after the ready
+ *								fds have been collected (with no wait), so a
+ *								virtual clock may simply jump to run_time.
+ *				   param	  - passed to both.
+ */
+typedef time_t (*clock_now_t)(void *param);
+typedef void (*clock_sleep_t)(time_t run_time, void *param);
+
+typedef struct sched_clock
+{
+	clock_now_t now_func;
+	clock_sleep_t sleep_func;
+	void *param;
+} sched_clock_t;
+
+/*******************************************************************************
+ *  Description:   the options of SchedulerCreateWithOptions. a zeroed struct
+ *				   holds the defaults of SchedulerCreate.
+ *
+ *				   timer_slack_ns - set as the timer slack of the thread
+ *									which runs the scheduler (prctl
+ *									PR_SET_TIMERSLACK) - the kernel may
+ *									delay its wakeups by up to this, to
+ *									serve them with other timers of the
+ *									system. 0 - the slack of the thread is
+ *									kept (50 us by default).
+ *
+ *				   capacity		  - tasks which every class queue holds
+ *									without reallocating (PQReserve), and
+ *									keeps while they're run - no
+ *									reallocations in a steady state of up
+ *									to capacity tasks. a radix queue keeps
+ *									65 entries per task. 0 - the queues
+ *									grow & shrink on demand.
+ */
+typedef struct scheduler_options
+{
+	sched_queue_t queue;
+	sched_clock_t clock;
+	unsigned long timer_slack_ns;
+	size_t capacity;
+} scheduler_options_t;
+
+/*******************************************************************************
+ *  Description:   task_stats_func_t is applied on every task by
+ *				   SchedulerForEachTask.
+ *
+ *  Input:         id    - the id of the task.
+ *				   stats - the run-time statistics of the task (all 0 unless
+ *						   compiled with WD_TASK_STATS).
+ *				   param - pointer to user data.
+ *
+ *  Return values: SUCCESS (0) - continue to the next task.
+ *				   otherwise   - stop the iteration.
+ */
+typedef int (*task_stats_func_t)(unique_id_t id, const task_stats_t *stats,
+								 void *param);
+
+/*******************************************************************************
+ *  Description:   overrun_func_t is called right after a task has run longer
+ *				   than its budget (see SchedulerSetTaskBudget).
+ *
+ *  Input:         id    - the id of the task.
+ *				   stats - the run-time statistics of the task.
+ *				   param - pointer to user data.
+ */
+typedef void (*overrun_func_t)(unique_id_t id, const task_stats_t *stats,
+							   void *param);
+
+/*******************************************************************************
+ *  Description:   wait_func_t is called right before the scheduler waits for
+ *				   its next task.
+ *
+ *  Input:         run_time - the run time of the next task.
+ *				   param    - pointer to user data.
+ */
+typedef void (*wait_func_t)(time_t run_time, void *param);
+
+/*******************************************************************************
+ *  Description:   the lateness of the runs of a priority class, in seconds of
+ *				   the scheduler's clock - how long after its run time each
+ *				   task has started. collected always.
+ *
+ *				   deferrals - runs of background tasks put off while the
+ *							   scheduler was behind schedule.
+ */
+typedef struct sched_class_stats
+{
+	size_t runs;
+	size_t late_runs;			/* runs which started after the run time */
+	time_t total_lateness;
+	time_t max_lateness;
+	size_t deferrals;
+} sched_class_stats_t;
+
 /******************************** SchedulerCreate ******************************
  *	Description:   Creates a new scheduler.
  *
@@ -37,6 +153,18 @@ typedef struct scheduler scheduler_t;
  */
 scheduler_t *SchedulerCreate(void);
 
+/************************** SchedulerCreateWithOptions *************************
+ *	Description:   Creates a new scheduler by options.
+ *
+ *	Input:		   options - the options. NULL - the defaults.
+ *
+ *	Return Values: On success    - returns a pointer to the new scheduler.
+ *				   Otherwise     - returns NULL.
+ *
+ *	Complexity:	   O(1)
+ */
+scheduler_t *SchedulerCreateWithOptions(const scheduler_options_t *options);
+
 /******************************** SchedulerDestroy *****************************
  *	Description:   Destroys a scheduler and release the memory of the scheduler
  *				   and tasks inside.
@@ -70,6 +198,23 @@ void SchedulerDestroy(scheduler_t *scheduler);
 unique_id_t SchedulerAddTask(scheduler_t *scheduler, task_func_t task_func,
 	 				void * data, time_t start_time, time_t interval);
 
+/*************************** SchedulerAddTaskById *****************************
+ *	Description:   Adds new task to scheduler, with an id created by the
+ *				   caller. lets another thread know the id of a task before
+ *				   the thread running the scheduler adds it.
+ *
+ *	Input:		   as SchedulerAddTask, and:
+ *				   id			 - the id of the task (by UIDCreate).
+ *
+ *	Return Values: SUCCESS 		 - task added.
+ *				   FAILURE		 - allocation has failed.
+ *
+ *	Complexity:	   O(n)
+ */
+status_t SchedulerAddTaskById(scheduler_t *scheduler, unique_id_t id,
+							  task_func_t task_func, void *data,
+							  time_t start_time, time_t interval);
+
 /**************************** SchedulerRemoveTask *****
 	FAIL   = -1,
 	DONE   = 0,
@@ -85,8 +230,47 @@ unique_id_t SchedulerAddTask(scheduler_t *scheduler, task_func_t task_func,
  */
 int SchedulerRemoveTask(scheduler_t *scheduler, unique_id_t id);
 
+/****************************** SchedulerAddFd *********************************
+ *	Description:   Registers a file descriptor to be watched by the scheduler.
+ *				   while the scheduler waits for its next task it polls all
+ *				   the registered fds, and calls fd_func for every ready fd.
+ *				   fd_func is always called between tasks - never during one.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   fd			 - file descriptor to watch. must not be
+ *								   registered already.
+ *				   events		 - poll events to wait for (POLLIN, POLLOUT).
+ *				   fd_func		 - function to call when fd is ready.
+ *				   param		 - pointer to data to be used by fd_func.
+ *
+ *	Return Values: SUCCESS 		 - fd is watched.
+ *				   FAILURE		 - allocation has failed.
+ *
+ *	Complexity:	   O(1) amortized
+ */
+status_t SchedulerAddFd(scheduler_t *scheduler, int fd, short events,
+						fd_func_t fd_func, void *param);
+
+/**************************** SchedulerRemoveFd ********************************
+ *	Description:   Stops watching a file descriptor. the fd isn't closed.
+ *				   may be called from within an fd_func.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   fd			 - file descriptor to stop watching.
+ *
+ *	Return Values: SUCCESS 		 - fd removed
+ *				   FAILURE		 - fd not found
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerRemoveFd(scheduler_t *scheduler, int fd);
+
 /****************************** SchedulerRun ***********************************
  *	Description:   Executes the scheduler to run all the tasks.
+ *				   between tasks, waits for the registered fds (poll) instead
+ *				   of sleeping, and dispatches the ready ones. the due
+ *				   critical tasks run before any ready fd is dispatched - the
+ *				   fds are collected again only ahead of the other due tasks.
  *
  *	Input:		   scheduler_t * - pointer to a scheduler.
  *
@@ -99,6 +283,8 @@ int SchedulerRun(scheduler_t *scheduler);
 
 /****************************** SchedulerStop ***********************************
  *	Description:   Stop a scheduler from runnning.
+ *				   may be called from another thread. the scheduler stops
+ *				   before its next task, or after its current wait.
  *
  *	Input:		   scheduler_t * - pointer to a scheduler.
  *
@@ -108,6 +294,276 @@ int SchedulerRun(scheduler_t *scheduler);
  */
 void SchedulerStop(scheduler_t *scheduler);
 
+/*************************** SchedulerForEachTask ******************************
+ *	Description:   Applies func on every task in the scheduler, with the task's
+ *				   run-time statistics. tasks are not visited by run time.
+ *				   func must not add/remove tasks.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   func			 - function to apply.
+ *				   param		 - pointer to data to be used by func.
+ *
+ *	Return Values: SUCCESS 		 - func was applied on all the tasks.
+ *				   otherwise	 - the value returned by func which stopped.
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerForEachTask(scheduler_t *scheduler, task_stats_func_t func,
+						 void *param);
+
+/************************** SchedulerSetTaskBudget *****************************
+ *	Description:   Sets the max duration of a single run of a task. a longer
+ *				   run is counted in the task's stats and reported to the
+ *				   overrun handler. has no effect unless compiled with
+ *				   WD_TASK_STATS.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   unique_id_t   - uid of the task.
+ *				   budget_ns	 - max duration in nanoseconds. 0 - no budget.
+ *
+ *	Return Values: SUCCESS 		 - budget set.
+ *				   FAILURE		 - task not found.
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerSetTaskBudget(scheduler_t *scheduler, unique_id_t id,
+						   unsigned long budget_ns);
+
+/************************** SchedulerSetTaskSlack ******************************
+ *	Description:   Lets a task run up to slack seconds after its run time.
+ *				   the scheduler wakes up by the latest time of its next task
+ *				   (run time + slack) and runs every task whose run time has
+ *				   come by then, so tasks with overlapping windows share one
+ *				   wakeup. applies to the next runs of the task as well.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   id			 - id of a task in the scheduler (not the one
+ *								   running now).
+ *				   slack		 - in seconds. 0 (the default) - on time.
+ *
+ *	Return Values: SUCCESS 		 - the slack was set.
+ *				   FAILURE		 - task not found, or it couldn't be queued
+ *								   again (then it is removed).
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerSetTaskSlack(scheduler_t *scheduler, unique_id_t id,
+						  time_t slack);
+
+/************************* SchedulerSetTaskInterval ****************************
+ *	Description:   Sets the interval of a repeated task. its next run is
+ *				   brought forward to interval seconds from now if it is
+ *				   later than that - a shorter interval applies at once.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   id			 - id of a task in the scheduler (not the one
+ *								   running now).
+ *				   interval		 - in seconds.
+ *
+ *	Return Values: SUCCESS 		 - the interval was set.
+ *				   FAILURE		 - task not found, or it couldn't be queued
+ *								   again (then it is removed).
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerSetTaskInterval(scheduler_t *scheduler, unique_id_t id,
+							 time_t interval);
+
+/************************** SchedulerSetTaskClass ******************************
+ *	Description:   Sets the priority class of a task (TASK_NORMAL by default).
+ *				   among the due tasks, the critical ones run first and the
+ *				   background ones last. while a critical or normal task has
+ *				   started late in the current second, a due background task
+ *				   is put off to the next second - but never by more than its
+ *				   interval.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   id			 - id of a task (or a coroutine) in the
+ *								   scheduler (not the one running now).
+ *				   task_class	 - TASK_CRITICAL, TASK_NORMAL or
+ *								   TASK_BACKGROUND.
+ *
+ *	Return Values: SUCCESS 		 - the class was set.
+ *				   FAILURE		 - task not found, or it couldn't be queued
+ *								   again (then it is removed).
+ *
+ *	Complexity:	   O(n)
+ */
+int SchedulerSetTaskClass(scheduler_t *scheduler, unique_id_t id,
+						  task_class_t task_class);
+
+/************************** SchedulerGetClassStats *****************************
+ *	Description:   Returns the lateness statistics of a priority class.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   task_class	 - the class.
+ *				   stats		 - pointer to fill.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void SchedulerGetClassStats(scheduler_t *scheduler, task_class_t task_class,
+							sched_class_stats_t *stats);
+
+/************************ SchedulerSetOverrunHandler ***************************
+ *	Description:   Sets the function called when a task overruns its budget.
+ *				   with no handler (NULL - the default) the overrun is logged
+ *				   to stderr.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   overrun_func	 - function to call, or NULL.
+ *				   param		 - pointer to data to be used by overrun_func.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void SchedulerSetOverrunHandler(scheduler_t *scheduler,
+								overrun_func_t overrun_func, void *param);
+
+/************************** SchedulerSetWaitHandler ****************************
+ *	Description:   Sets the function called right before the scheduler waits
+ *				   for its next task (not when the task is due already).
+ *				   NULL (the default) - none.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   wait_func	 - function to call, or NULL.
+ *				   param		 - pointer to data to be used by wait_func.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void SchedulerSetWaitHandler(scheduler_t *scheduler, wait_func_t wait_func,
+							 void *param);
+
+/*************************** SchedulerAddCoroutine *****************************
+ *	Description:   Adds a coroutine task - task_func runs on a stack of its
+ *				   own, and may wait in the middle (SchedulerAwaitFd,
+ *				   SchedulerSleepFor, SchedulerAwaitSignal) while the other
+ *				   tasks run. it runs once, to its end - a REPEAT is as DONE.
+ *				   removing it (SchedulerRemoveTask, SchedulerDestroy) while
+ *				   it waits discards its stack as is.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   task_func	 - the body of the coroutine.
+ *				   data			 - pointer to data to be used by task_func.
+ *				   start_time	 - time to start the coroutine (absolute).
+ *
+ *	Return Values: On success    - id of the added task.
+ *				   othrwise      - a Bad id (UIDIsBad).
+ *
+ *	Complexity:	   O(log(n))
+ */
+unique_id_t SchedulerAddCoroutine(scheduler_t *scheduler, task_func_t task_func,
+								  void *data, time_t start_time);
+
+/***************************** SchedulerAwaitFd ********************************
+ *	Description:   Suspends the calling coroutine until fd is ready for
+ *				   events, or the timeout passes. the fd is watched as by
+ *				   SchedulerAddFd, and removed from the scheduler afterwards
+ *				   (by SchedulerRemoveFd - better not watched otherwise).
+ *
+ *	Input:		   fd			 - a file descriptor.
+ *				   events		 - as in poll.
+ *				   timeout		 - in seconds. negative - no timeout.
+ *
+ *	Return Values: the revents of the fd (as in poll).
+ *				   0			 - the timeout has passed.
+ *				   -1			 - not called by a coroutine task, or the fd
+ *								   couldn't be watched.
+ *
+ *	Complexity:	   O(log(n)) per wake-up with no timeout (the coroutine
+ *				   waits out of the queues). O(n) with a timeout - its
+ *				   task is searched for as the fd is ready.
+ */
+short SchedulerAwaitFd(int fd, short events, time_t timeout);
+
+/**************************** SchedulerSleepFor ********************************
+ *	Description:   Suspends the calling coroutine for 'seconds' - the other
+ *				   tasks run meanwhile. 0 - lets the tasks which are due run
+ *				   first.
+ *
+ *	Input:		   seconds		 - how long to sleep.
+ *
+ *	Return Values: SUCCESS 		 - slept.
+ *				   FAILURE		 - not called by a coroutine task.
+ *
+ *	Complexity:	   O(log(n))
+ */
+int SchedulerSleepFor(time_t seconds);
+
+/*************************** SchedulerAwaitSignal ******************************
+ *	Description:   Suspends the calling coroutine until signo is pending, and
+ *				   accepts it (by a signalfd). signo must be blocked by the
+ *				   caller in every thread, otherwise it is delivered as usual.
+ *
+ *	Input:		   signo		 - the signal.
+ *				   timeout		 - in seconds. negative - no timeout.
+ *
+ *	Return Values: SUCCESS 		 - the signal was accepted.
+ *				   FAILURE		 - timeout, not called by a coroutine task, or
+ *								   the signal couldn't be watched.
+ *
+ *	Complexity:	   O(log(n)) per wake-up
+ */
+int SchedulerAwaitSignal(int signo, time_t timeout);
+
+/****************************** SchedulerNow ***********************************
+ *	Description:   The current time by the clock of the scheduler - the start
+ *				   times of its tasks are relative to it.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *
+ *	Return Values: time_t        - the current time, in seconds.
+ *
+ *	Complexity:	   O(1)
+ */
+time_t SchedulerNow(scheduler_t *scheduler);
+
+/**************************** SchedulerRunTime *********************************
+ *	Description:   The run time of the task which is running - when it was
+ *				   due, by the clock of the scheduler. how late it has started
+ *				   is the time since then.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *
+ *	Return Values: time_t        - the run time, in seconds. 0 if no task
+ *								   is running.
+ *
+ *	Complexity:	   O(1)
+ */
+time_t SchedulerRunTime(scheduler_t *scheduler);
+
+/**************************** SchedulerWakeups *********************************
+ *	Description:   The number of times the scheduler has waited (for its next
+ *				   task or for an fd) - the wakeups of its thread.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *
+ *	Return Values: size_t        - number of wakeups since created.
+ *
+ *	Complexity:	   O(1)
+ */
+size_t SchedulerWakeups(scheduler_t *scheduler);
+
+/**************************** SchedulerBacklog *********************************
+ *	Description:   The depth of the run queue - the tasks run in a row, with
+ *				   no wait between them, before the last wait which followed
+ *				   any. more than the tasks due together means the scheduler
+ *				   is behind.
+ *
+ *	Input:		   scheduler_t * - pointer to a scheduler.
+ *				   max_backlog	 - filled with the deepest so far. may be
+ *								   NULL.
+ *
+ *	Return Values: size_t        - the tasks run before the last wait.
+ *
+ *	Complexity:	   O(1)
+ */
+size_t SchedulerBacklog(scheduler_t *scheduler, size_t *max_backlog);
+
 /****************************** SchedulerSize **********************************
  *	Description:   Number of tasks in scheduler.
  *
@@ -115,7 +571,7 @@ void SchedulerStop(scheduler_t *scheduler);
  *
  *	Return Values: size_t        - number of tasks in the scheduler.
  *
- *	Complexity:	   O(n)
+ *	Complexity:	   O(1)
  */
 size_t SchedulerSize(scheduler_t *scheduler);
 
@@ -4,29 +4,70 @@
 *	Last Update :	2019-02-24
 *	Description :	scheduler test file
 *******************************************************************************/
+#define _POSIX_C_SOURCE 200112L	/* sigprocmask */
+
 #include <stdio.h> 		/* printf */
 #include <time.h>		/* time */
+#include <signal.h>		/* sigprocmask, raise */
+#include <unistd.h>		/* pipe, read, write, close */
+#include <poll.h>		/* POLLIN */
 
 #include "scheduler.h"
 
 
 /*** MACROS ***/
 #define UNUSED(x) ((void) x)
+#define COROUTINES (1000)
+#define PARKED_COROUTINES (200)		/* a pipe each - within the fds limit */
 
+/*** structures ***/
+typedef struct coro_test
+{
+	int pipe_fds[2];		/* written by TaskWritePipe */
+	int idle_fds[2];		/* never written */
+	int sleeps;
+	short revents;
+	short idle_revents;
+	int signal_status;
+} coro_test_t;
+
+typedef struct park_test
+{
+	int pipe_fds[2];		/* written by TaskWriteAll */
+	int *woken;
+} park_test_t;
 
 /*** unit-test functions ***/
 void SchedulerCreateTest(void);
+void SchedulerCreateWithOptionsTest(void);
 void SchedulerIsEmptyTest(void);
 void SchedulerAddTaskTest(void);
 void SchedulerSizeTest(void);
 void SchedulerRemoveTaskTest(void);
 void SchedulerRunTest(void);
+void SchedulerForEachTaskTest(void);
+void SchedulerCoroutineTest(void);
+void SchedulerParkTest(void);
 
 /*** task functions ***/
 int TaskCountDown(void * data);
 int TaskStop(void * data);
 int TaskEternal(void * data);
 int TaskFail(void * data);
+int TaskWritePipe(void * data);
+int TaskWriteAll(void * data);
+
+/*** coroutine functions ***/
+int CoroReadPipe(void * data);
+int CoroTimeout(void * data);
+int CoroSleeper(void * data);
+int CoroAwaitSignal(void * data);
+int CoroForever(void * data);
+int CoroReadForever(void * data);
+
+/*** stats functions ***/
+int CountTasks(unique_id_t id, const task_stats_t *stats, void *param);
+void CountOverruns(unique_id_t id, const task_stats_t *stats, void *param);
 
 /*****************************************************************************
 *								main
@@ -39,6 +80,9 @@ int main(void)
 	SchedulerCreateTest();
 	printf("\n\n--------------------------------------------------------\n\n");
 	
+	SchedulerCreateWithOptionsTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
 	printf("SchedulerDestroy:\t\t\tRUN VALGRIND");
 	printf("\n\n--------------------------------------------------------\n\n");
 		
@@ -56,6 +100,15 @@ int main(void)
 	
 	SchedulerRunTest();
 	printf("\n\n--------------------------------------------------------\n\n");
+	
+	SchedulerForEachTaskTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	SchedulerCoroutineTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	SchedulerParkTest();
+	printf("\n\n--------------------------------------------------------\n\n");
 		
 	return (0);
 }
@@ -77,6 +130,40 @@ void SchedulerCreateTest(void)
 	(NULL != sch_1)
 	?
 	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(sch_1);
+}
+
+
+/********************** SchedulerCreateWithOptionsTest ************************/
+void SchedulerCreateWithOptionsTest(void)
+{
+	scheduler_t *sch_1 = NULL;
+	scheduler_options_t options = {0};
+	unique_id_t id_task_1 = {0};
+	int ret_val_1 = 0;
+	int ret_val_2 = 0;
+	
+	printf("SchedulerCreateWithOptions:\t\t");
+	
+	options.queue = SCHED_QUEUE_RADIX;
+	options.capacity = 16;
+	sch_1 = SchedulerCreateWithOptions(&options);
+	
+	/* the tasks run in the order of their run time - the stop task first */
+	SchedulerAddTask(sch_1, TaskEternal, NULL, time(NULL) + 2, 3);
+	id_task_1 = SchedulerAddTask(sch_1, TaskCountDown, NULL, time(NULL), 3);
+	SchedulerAddTask(sch_1, TaskStop, sch_1, time(NULL) - 1, 0);
+	
+	ret_val_1 = SchedulerRemoveTask(sch_1, id_task_1);	/* expected: SUCCESS */
+	ret_val_2 = SchedulerRun(sch_1);					/* expected: STOP */
+	
+	(NULL != sch_1)					&&
+	(SUCCESS == ret_val_1)			&&
+	(STOP == ret_val_2)				&&
+	(1 == SchedulerSize(sch_1))
+	?
+	printf("SUCCESS") : printf("FAIL");
 
 	SchedulerDestroy(sch_1);
 }
@@ -225,6 +312,195 @@ void SchedulerRunTest(void)
 }
 
 
+/************************* SchedulerForEachTaskTest ***************************/
+void SchedulerForEachTaskTest(void)
+{
+	scheduler_t *sch_1 = NULL;
+	unique_id_t id_task_eternal = {0};
+	unique_id_t bad_id = UIDCreateBad();
+	size_t runs_count = 0;
+	size_t overruns_count = 0;
+	int ret_val_1 = FAILURE;
+	int ret_val_2 = SUCCESS;
+	
+	printf("SchedulerForEachTask + budget:\t\t");
+	
+	sch_1 = SchedulerCreate();
+	id_task_eternal = SchedulerAddTask(sch_1, TaskEternal, NULL, time(NULL), 1);
+	SchedulerAddTask(sch_1, TaskStop, sch_1, time(NULL) + 1, 1);
+	
+	/* every run of TaskEternal overruns a budget of 1 ns */
+	ret_val_1 = SchedulerSetTaskBudget(sch_1, id_task_eternal, 1);
+	ret_val_2 = SchedulerSetTaskBudget(sch_1, bad_id, 1);
+	SchedulerSetOverrunHandler(sch_1, CountOverruns, &overruns_count);
+	
+	SchedulerRun(sch_1);
+	
+	/* TaskStop is done - only TaskEternal is left */
+	SchedulerForEachTask(sch_1, CountTasks, &runs_count);
+	
+	#ifdef WD_TASK_STATS
+	(SUCCESS == ret_val_1)	&&
+	(FAILURE == ret_val_2)	&&
+	(1 <= runs_count)		&&
+	(runs_count == overruns_count)
+	#else
+	(SUCCESS == ret_val_1)	&&
+	(FAILURE == ret_val_2)	&&
+	(0 == runs_count)		&&
+	(0 == overruns_count)
+	#endif
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(sch_1);
+}
+
+
+/************************* SchedulerCoroutineTest *****************************/
+void SchedulerCoroutineTest(void)
+{
+	scheduler_t *sch_1 = NULL;
+	coro_test_t data = {{0}, {0}, 0, 0, 0, FAILURE};
+	sigset_t mask;
+	sigset_t old_mask;
+	unique_id_t id = {0};
+	int is_added = TRUE;
+	int ret_val_1 = SUCCESS;
+	short ret_val_2 = 0;
+	int i = 0;
+	
+	printf("SchedulerAddCoroutine + Await:\t\t");
+	
+	/* the awaited signals are accepted by signalfd only while blocked */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+	sigaddset(&mask, SIGUSR2);
+	sigprocmask(SIG_BLOCK, &mask, &old_mask);
+	pipe(data.pipe_fds);
+	pipe(data.idle_fds);
+	
+	/* not in a coroutine */
+	ret_val_1 = SchedulerSleepFor(1);
+	ret_val_2 = SchedulerAwaitFd(data.idle_fds[0], POLLIN, 1);
+	
+	sch_1 = SchedulerCreate();
+	SchedulerAddCoroutine(sch_1, CoroReadPipe, &data, time(NULL));
+	SchedulerAddCoroutine(sch_1, CoroTimeout, &data, time(NULL));
+	SchedulerAddCoroutine(sch_1, CoroAwaitSignal, &data, time(NULL));
+	SchedulerAddCoroutine(sch_1, CoroForever, &data, time(NULL));
+	for (i = 0; i < COROUTINES; ++i)
+	{
+		id = SchedulerAddCoroutine(sch_1, CoroSleeper, &data, time(NULL));
+		is_added &= !UIDIsBad(id);
+	}
+	SchedulerAddTask(sch_1, TaskWritePipe, &data, time(NULL) + 1, 0);
+	SchedulerAddTask(sch_1, TaskStop, sch_1, time(NULL) + 3, 0);
+	
+	SchedulerRun(sch_1);
+	
+	/* CoroForever still waits - discarded by SchedulerDestroy */
+	(FAILURE == ret_val_1)					&&
+	(-1 == ret_val_2)						&&
+	(TRUE == is_added)						&&
+	(0 != (data.revents & POLLIN))			&&
+	(0 == data.idle_revents)				&&
+	(SUCCESS == data.signal_status)			&&
+	(2 * COROUTINES == data.sleeps)			&&
+	(1 == SchedulerSize(sch_1))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(sch_1);
+	close(data.pipe_fds[0]);
+	close(data.pipe_fds[1]);
+	close(data.idle_fds[0]);
+	close(data.idle_fds[1]);
+	sigprocmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+
+/************************* SchedulerParkTest **********************************/
+void SchedulerParkTest(void)
+{
+	static park_test_t data[PARKED_COROUTINES];
+	scheduler_t *sch_1 = NULL;
+	unique_id_t removed_id = {0};
+	size_t parked_size = 0;
+	size_t removed_size = 0;
+	int is_empty = TRUE;
+	int is_piped = TRUE;
+	int woken = 0;
+	int i = 0;
+	
+	printf("SchedulerAwaitFd (no timeout):\t\t");
+	
+	/*	they all wait with no deadline - out of the queues, yet counted. one
+		is removed while it waits */
+	sch_1 = SchedulerCreate();
+	for (i = 0; i < PARKED_COROUTINES; ++i)
+	{
+		is_piped &= (0 == pipe(data[i].pipe_fds));
+		data[i].woken = &woken;
+		removed_id = SchedulerAddCoroutine(sch_1, CoroReadForever, &data[i],
+										   time(NULL));
+	}
+	SchedulerAddTask(sch_1, TaskStop, sch_1, time(NULL), 0);
+	SchedulerRun(sch_1);
+	
+	parked_size = SchedulerSize(sch_1);
+	is_empty = SchedulerIsEmpty(sch_1);
+	SchedulerRemoveTask(sch_1, removed_id);
+	removed_size = SchedulerSize(sch_1);
+	
+	/* the fds wake all the others */
+	SchedulerAddTask(sch_1, TaskWriteAll, data, time(NULL), 0);
+	SchedulerAddTask(sch_1, TaskStop, sch_1, time(NULL) + 1, 0);
+	SchedulerRun(sch_1);
+	
+	(TRUE == is_piped)									&&
+	(PARKED_COROUTINES == parked_size)					&&
+	(FALSE == is_empty)									&&
+	(PARKED_COROUTINES - 1 == removed_size)				&&
+	(PARKED_COROUTINES - 1 == woken)					&&
+	(TRUE == SchedulerIsEmpty(sch_1))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	SchedulerDestroy(sch_1);
+	for (i = 0; i < PARKED_COROUTINES; ++i)
+	{
+		close(data[i].pipe_fds[0]);
+		close(data[i].pipe_fds[1]);
+	}
+}
+
+
+/******************************************************************************
+*								Stats-functions
+*******************************************************************************/
+
+/****************************** CountTasks ************************************/
+int CountTasks(unique_id_t id, const task_stats_t *stats, void *param)
+{
+	UNUSED(id);
+	
+	*(size_t *)param += stats->runs;
+	
+	return (SUCCESS);
+}
+
+
+/****************************** CountOverruns *********************************/
+void CountOverruns(unique_id_t id, const task_stats_t *stats, void *param)
+{
+	UNUSED(id);
+	UNUSED(stats);
+	
+	++*(size_t *)param;
+}
+
+
 /******************************************************************************
 *								Task-functions
 *******************************************************************************/
@@ -279,3 +555,114 @@ int TaskFail(void * data)
 	printf("TaskFail: this funciton should fail.... \n");
 	return (FAIL);
 }
+
+
+/****************************** TaskWritePipe *********************************/
+int TaskWritePipe(void * data)
+{
+	coro_test_t *test_data = (coro_test_t *)data;
+	
+	write(test_data->pipe_fds[1], "x", 1);
+	raise(SIGUSR1);
+	
+	return (DONE);
+}
+
+
+/****************************** TaskWriteAll **********************************/
+int TaskWriteAll(void * data)
+{
+	park_test_t *test_data = (park_test_t *)data;
+	int i = 0;
+	
+	for (i = 0; i < PARKED_COROUTINES; ++i)
+	{
+		write(test_data[i].pipe_fds[1], "x", 1);
+	}
+	
+	return (DONE);
+}
+
+
+/******************************************************************************
+*								Coroutine-functions
+*******************************************************************************/
+
+/****************************** CoroReadPipe **********************************/
+int CoroReadPipe(void * data)
+{
+	coro_test_t *test_data = (coro_test_t *)data;
+	char byte = 0;
+	
+	test_data->revents = SchedulerAwaitFd(test_data->pipe_fds[0], POLLIN, 10);
+	if (0 != (test_data->revents & POLLIN))
+	{
+		read(test_data->pipe_fds[0], &byte, 1);
+	}
+	
+	return (DONE);
+}
+
+
+/****************************** CoroTimeout ***********************************/
+int CoroTimeout(void * data)
+{
+	coro_test_t *test_data = (coro_test_t *)data;
+	
+	test_data->idle_revents = SchedulerAwaitFd(test_data->idle_fds[0],
+											   POLLIN, 1);
+	
+	return (DONE);
+}
+
+
+/****************************** CoroSleeper ***********************************/
+int CoroSleeper(void * data)
+{
+	coro_test_t *test_data = (coro_test_t *)data;
+	
+	SchedulerSleepFor(1);
+	++test_data->sleeps;
+	SchedulerSleepFor(1);
+	++test_data->sleeps;
+	
+	return (DONE);
+}
+
+
+/**************************** CoroAwaitSignal *********************************/
+int CoroAwaitSignal(void * data)
+{
+	coro_test_t *test_data = (coro_test_t *)data;
+	
+	test_data->signal_status = SchedulerAwaitSignal(SIGUSR1, 10);
+	
+	return (DONE);
+}
+
+
+/****************************** CoroForever ***********************************/
+int CoroForever(void * data)
+{
+	UNUSED(data);
+	
+	SchedulerAwaitSignal(SIGUSR2, -1);
+	
+	return (DONE);
+}
+
+
+/**************************** CoroReadForever *********************************/
+int CoroReadForever(void * data)
+{
+	park_test_t *test_data = (park_test_t *)data;
+	char byte = 0;
+	
+	if (0 != (SchedulerAwaitFd(test_data->pipe_fds[0], POLLIN, -1) & POLLIN))
+	{
+		read(test_data->pipe_fds[0], &byte, 1);
+		++*test_data->woken;
+	}
+	
+	return (DONE);
+}
@@ -0,0 +1,189 @@
+/*******************************************************************************
+*	Filename :		sharded_bench.c
+*	Developer :		Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	sharded scheduler benchmark - the throughput of due tasks
+*					(every task repeats at once) with 1 shard up to a shard
+*					per CPU. each shard counts into a cache line of its own,
+*					so the throughput should grow with the shards as long as
+*					each has a CPU.
+*					usage: sharded_bench.out [ms per run] [tasks per shard]
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* nanosleep, clock_gettime */
+
+#include <stdio.h> 		/* printf */
+#include <stdlib.h>		/* calloc, free, strtoul */
+#include <unistd.h>		/* sysconf */
+#include <time.h>		/* time, nanosleep, clock_gettime */
+
+#include "sharded_scheduler.h"
+
+
+/*** MACROS ***/
+#define UNUSED(x) ((void) x)
+#define DEFAULT_RUN_MS (1000)
+#define DEFAULT_TASKS (64)
+#define CACHE_LINE (64)
+#define NS_IN_SEC (1000000000.0)
+
+/*** structures ***/
+/* the counter of a shard - only its thread writes it */
+typedef struct counter
+{
+	unsigned long runs;
+	char pad[CACHE_LINE - sizeof(unsigned long)];
+} counter_t;
+
+/*** benchmark functions ***/
+/*	runs 'tasks' due tasks per shard for run_ms. returns the tasks per sec,
+	or a negative value if the sharded scheduler failed */
+static double RunShards(size_t shards, size_t tasks, long run_ms);
+
+/*** task functions ***/
+static int TaskCount(void *counter);
+
+/*** internal functions ***/
+static void SleepMs(long ms);
+static double Now(void);
+
+
+/*****************************************************************************
+*								main
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+	long run_ms = DEFAULT_RUN_MS;
+	size_t tasks = DEFAULT_TASKS;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	double base_rate = 0;
+	double rate = 0;
+	size_t shards = 0;
+	
+	if (1 < argc)
+	{
+		run_ms = (long)strtoul(argv[1], NULL, 10);
+	}
+	if (2 < argc)
+	{
+		tasks = strtoul(argv[2], NULL, 10);
+	}
+	cpus = (0 < cpus) ? cpus : 1;
+	
+	printf("\n***** SHARDED SCHEDULER BENCHMARK *****\n\n");
+	printf("%ld online CPUs, %lu tasks per shard, %ld ms per run\n\n", cpus,
+		   (unsigned long)tasks, run_ms);
+	printf("%8s %16s %16s %10s\n", "shards", "tasks/sec", "per shard",
+		   "scaling");
+	
+	for (shards = 1; shards <= (size_t)cpus; shards *= 2)
+	{
+		rate = RunShards(shards, tasks, run_ms);
+		base_rate = (1 == shards) ? rate : base_rate;
+		
+		printf("%8lu %16.0f %16.0f %9.2fx%s\n", (unsigned long)shards, rate,
+			   rate / (double)shards, (0 < base_rate) ? rate / base_rate : 0,
+			   (0 < rate) ? "" : "  FAIL");
+	}
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								benchmark
+*******************************************************************************/
+
+/****************************** RunShards *************************************/
+static double RunShards(size_t shards, size_t tasks, long run_ms)
+{
+	sharded_scheduler_t *sharded = NULL;
+	counter_t *counters = NULL;
+	unsigned long runs = 0;
+	double start = 0;
+	double end = 0;
+	size_t i = 0;
+	size_t j = 0;
+	
+	sharded = ShardedCreate(shards);
+	counters = (counter_t *)calloc(shards, sizeof(counter_t));
+	if (NULL == sharded || NULL == counters)
+	{
+		if (NULL != sharded)
+		{
+			ShardedDestroy(sharded);
+		}
+		free(counters);
+		
+		return (-1);
+	}
+	
+	for (i = 0; i < shards; ++i)
+	{
+		for (j = 0; j < tasks; ++j)
+		{
+			ShardedAddTaskOn(sharded, i, TaskCount, &counters[i], time(NULL),
+							 0);
+		}
+	}
+	
+	start = Now();
+	if (SUCCESS != ShardedStart(sharded))
+	{
+		ShardedDestroy(sharded);
+		free(counters);
+		
+		return (-1);
+	}
+	SleepMs(run_ms);
+	ShardedStop(sharded);
+	end = Now();
+	
+	for (i = 0; i < shards; ++i)
+	{
+		runs += counters[i].runs;
+	}
+	
+	ShardedDestroy(sharded);
+	free(counters);
+	
+	return ((double)runs / (end - start));
+}
+
+
+/******************************************************************************
+*								Task-functions
+*******************************************************************************/
+
+/****************************** TaskCount *************************************/
+static int TaskCount(void *counter)
+{
+	++((counter_t *)counter)->runs;
+	
+	return (REPEAT);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/******************************* SleepMs **************************************/
+static void SleepMs(long ms)
+{
+	struct timespec duration = {0};
+	
+	duration.tv_sec = ms / 1000;
+	duration.tv_nsec = (ms % 1000) * 1000000;
+	nanosleep(&duration, NULL);
+}
+
+
+/*************************** Now **********************************************/
+static double Now(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return ((double)now.tv_sec + (double)now.tv_nsec / NS_IN_SEC);
+}
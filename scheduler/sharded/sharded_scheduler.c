@@ -0,0 +1,723 @@
+/*******************************************************************************
+*	Filename	:	sharded_scheduler.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	sharded scheduler source file. every shard is a plain
+*					scheduler_t, touched only by its own thread. the other
+*					threads post messages to its mailbox - a vector under a
+*					lock of the shard, and an eventfd which the shard's
+*					scheduler watches like any other fd.
+*******************************************************************************/
+#define _GNU_SOURCE				/* sched_getcpu, pthread_setaffinity_np */
+
+#include <stdlib.h>				/* malloc, free */
+#include <assert.h> 			/* assert */
+#include <stdio.h> 				/* fprintf */
+#include <stdint.h>				/* uint64_t */
+#include <unistd.h>				/* read, write, close, sysconf */
+#include <poll.h>				/* poll, struct pollfd */
+#include <sched.h>				/* sched_getcpu, cpu_set_t */
+#include <pthread.h>			/* pthread_create, pthread_mutex_t */
+#include <stdatomic.h>			/* atomic_int */
+#include <sys/eventfd.h>		/* eventfd */
+
+#include "../scheduler.h"
+#include "../pqueue/heap/dynamic_vctor/dynamic_vector.h"
+#include "sharded_scheduler.h"
+
+/***************************** MACROS *****************************************/
+#define UNUSED(x) ((void) x)
+#define MAILBOX_CAPACITY (16)
+#define CACHE_LINE (64)
+#define NO_DEADLINE (0)
+
+
+/***************************** structures *************************************/
+typedef enum message_type
+{
+	MSG_ADD,
+	MSG_REMOVE
+} message_type_t;
+
+/*	a request of another thread to the shard */
+typedef struct message
+{
+	message_type_t type;
+	unique_id_t id;
+	task_func_t task_func;		/* MSG_ADD only */
+	void *data;
+	time_t start_time;
+	time_t interval;
+} message_t;
+
+typedef struct shard
+{
+	sharded_scheduler_t *owner;
+	size_t index;
+	scheduler_t *sched;			/*	only by the thread of the shard */
+	dv_t *handled;				/*	message_t - swapped with the inbox, and
+									handled by the thread of the shard */
+	pthread_t thread;
+	
+	/*	the mailbox - written by the other threads */
+	char pad1[CACHE_LINE];
+	pthread_mutex_t lock;		/*	of the inbox */
+	dv_t *inbox;				/*	message_t */
+	int mailbox_fd;				/*	eventfd - signalled on a first message */
+	atomic_int is_stopping;
+	
+	/*	read by the coordinator */
+	char pad2[CACHE_LINE];
+	_Atomic time_t deadline;	/*	of the next task. NO_DEADLINE - none */
+	char pad3[CACHE_LINE];
+} shard_t;
+
+struct sharded_scheduler
+{
+	size_t count;
+	shard_t **shards;
+	int is_running;
+};
+
+
+/************************* global variable ************************************/
+/*	the shard run by this thread - NULL in the other threads */
+static _Thread_local shard_t *t_shard = NULL;
+
+
+/**************************** local functions *********************************/
+
+/*	Description: creates a shard of sharded, with its mailbox. NULL on failure.
+ *
+ *	Used in function: ShardedCreate;
+ */
+static shard_t *CreateShard(sharded_scheduler_t *sharded, size_t index);
+
+
+/*	Description: destroys a shard, with its tasks & unhandled messages.
+ *
+ *	Used in functions: ShardedCreate, ShardedDestroy;
+ */
+static void DestroyShard(shard_t *shard);
+
+
+/*	Description: the thread of a shard - runs its scheduler until the shard
+ *	is stopped. an empty shard waits for its mailbox.
+ *
+ *	Used in function: ShardedStart;
+ */
+static void *ShardThread(void *shard);
+
+
+/*	Description: stops the threads of the first 'count' shards & waits for
+ *	them.
+ *
+ *	Used in functions: ShardedStart, ShardedStop;
+ */
+static void StopShards(sharded_scheduler_t *sharded, size_t count);
+
+
+/*	Description: binds the calling thread to the CPUs of the shard (CPU c
+ *	belongs to shard c % count) which the proc may run on.
+ *
+ *	Used in function: ShardThread;
+ */
+static void BindToCpus(shard_t *shard);
+
+
+/*	Description: fd_func_t of the mailbox - handles the messages, and stops
+ *	the scheduler of a stopping shard.
+ *
+ *	Used in function: CreateShard (SchedulerAddFd);
+ */
+static int MailboxHandler(int fd, short revents, void *shard);
+
+
+/*	Description: handles all the messages posted to the shard so far.
+ *
+ *	Used in functions: MailboxHandler, ShardThread;
+ */
+static void HandleMessages(shard_t *shard);
+
+
+/*	Description: posts a message to the mailbox of shard. the eventfd is
+ *	signalled only by the message which finds the mailbox empty.
+ *
+ *	Used in functions: ShardedAddTaskOn, ShardedRemoveTask;
+ */
+static status_t PostMessage(shard_t *shard, const message_t *message);
+
+
+/*	Description: wait_func_t of the shards - publishes the next deadline.
+ *
+ *	Used in function: CreateShard (SchedulerSetWaitHandler);
+ */
+static void PublishDeadline(time_t run_time, void *shard);
+
+
+/*	Description: lowers the published deadline of shard to run_time.
+ *
+ *	Used in functions: ShardedAddTaskOn, HandleMessages;
+ */
+static void LowerDeadline(shard_t *shard, time_t run_time);
+
+
+/*	Description: wakes the thread of shard (signals its eventfd).
+ *
+ *	Used in functions: PostMessage, ShardedStop;
+ */
+static void WakeShard(shard_t *shard);
+
+
+/*	Description: the shard of the CPU the calling thread runs on.
+ *
+ *	Used in function: ShardedAddTask;
+ */
+static size_t CpuShard(const sharded_scheduler_t *sharded);
+
+
+/******************************************************************************
+*								ShardedCreate
+*******************************************************************************/
+sharded_scheduler_t *ShardedCreate(size_t shards)
+{
+	sharded_scheduler_t *sharded = NULL;
+	long cpus = 0;
+	size_t i = 0;
+	
+	if (0 == shards)
+	{
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		shards = (0 < cpus) ? (size_t)cpus : 1;
+	}
+	
+	sharded = (sharded_scheduler_t *) malloc(sizeof(sharded_scheduler_t));
+	if (NULL == sharded)
+	{
+		return (NULL);
+	}
+	
+	sharded->shards = (shard_t **) calloc(shards, sizeof(shard_t *));
+	if (NULL == sharded->shards)
+	{
+		free(sharded);
+		return (NULL);
+	}
+	sharded->count = shards;
+	sharded->is_running = FALSE;
+	
+	for (i = 0; i < shards; ++i)
+	{
+		sharded->shards[i] = CreateShard(sharded, i);
+		if (NULL == sharded->shards[i])
+		{
+			/* case one of the creations failed */
+			ShardedDestroy(sharded);
+			return (NULL);
+		}
+	}
+	
+	return (sharded);
+}
+
+
+/******************************************************************************
+*								ShardedDestroy
+*******************************************************************************/
+void ShardedDestroy(sharded_scheduler_t *sharded)
+{
+	size_t i = 0;
+	
+	assert(sharded);
+	
+	ShardedStop(sharded);
+	
+	for (i = 0; i < sharded->count; ++i)
+	{
+		if (NULL != sharded->shards[i])
+		{
+			DestroyShard(sharded->shards[i]);
+			sharded->shards[i] = NULL;
+		}
+	}
+	
+	free(sharded->shards);
+	sharded->shards = NULL;
+	free(sharded);
+	sharded = NULL;
+}
+
+
+/******************************************************************************
+*								ShardedStart
+*******************************************************************************/
+status_t ShardedStart(sharded_scheduler_t *sharded)
+{
+	shard_t *shard = NULL;
+	size_t i = 0;
+	
+	assert(sharded);
+	
+	if (TRUE == sharded->is_running)
+	{
+		return (SUCCESS);
+	}
+	
+	for (i = 0; i < sharded->count; ++i)
+	{
+		shard = sharded->shards[i];
+		atomic_store(&shard->is_stopping, FALSE);
+		if (0 != pthread_create(&shard->thread, NULL, ShardThread, shard))
+		{
+			/* stops the started ones */
+			StopShards(sharded, i);
+			
+			return (FAILURE);
+		}
+	}
+	sharded->is_running = TRUE;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*								ShardedStop
+*******************************************************************************/
+void ShardedStop(sharded_scheduler_t *sharded)
+{
+	assert(sharded);
+	assert(NULL == t_shard || sharded != t_shard->owner);
+	
+	if (TRUE == sharded->is_running)
+	{
+		StopShards(sharded, sharded->count);
+		sharded->is_running = FALSE;
+	}
+}
+
+
+/******************************************************************************
+*								ShardedAddTask
+*******************************************************************************/
+shard_task_id_t ShardedAddTask(sharded_scheduler_t *sharded,
+							   task_func_t task_func, void *data,
+							   time_t start_time, time_t interval)
+{
+	size_t index = 0;
+	
+	assert(sharded);
+	
+	index = (NULL != t_shard && sharded == t_shard->owner) ?
+			t_shard->index : CpuShard(sharded);
+	
+	return (ShardedAddTaskOn(sharded, index, task_func, data, start_time,
+							 interval));
+}
+
+
+/******************************************************************************
+*								ShardedAddTaskOn
+*******************************************************************************/
+shard_task_id_t ShardedAddTaskOn(sharded_scheduler_t *sharded, size_t shard,
+								 task_func_t task_func, void *data,
+								 time_t start_time, time_t interval)
+{
+	shard_task_id_t task_id = {0};
+	message_t message = {0};
+	status_t status = SUCCESS;
+	
+	assert(sharded);
+	assert(task_func);
+	assert(shard < sharded->count);
+	
+	/*	the id is known before the shard adds the task - it can be removed
+		by a message which follows */
+	task_id.shard = shard;
+	task_id.id = UIDCreate();
+	
+	if (t_shard == sharded->shards[shard])
+	{
+		status = SchedulerAddTaskById(t_shard->sched, task_id.id, task_func,
+									  data, start_time, interval);
+	}
+	else
+	{
+		message.type = MSG_ADD;
+		message.id = task_id.id;
+		message.task_func = task_func;
+		message.data = data;
+		message.start_time = start_time;
+		message.interval = interval;
+		
+		status = PostMessage(sharded->shards[shard], &message);
+	}
+	
+	if (SUCCESS != status)
+	{
+		task_id.id = UIDCreateBad();
+		
+		return (task_id);
+	}
+	
+	LowerDeadline(sharded->shards[shard], start_time);
+	
+	return (task_id);
+}
+
+
+/******************************************************************************
+*								ShardedRemoveTask
+*******************************************************************************/
+int ShardedRemoveTask(sharded_scheduler_t *sharded, shard_task_id_t id)
+{
+	message_t message = {0};
+	
+	assert(sharded);
+	
+	if (sharded->count <= id.shard)
+	{
+		return (FAILURE);
+	}
+	
+	if (t_shard == sharded->shards[id.shard])
+	{
+		return (SchedulerRemoveTask(t_shard->sched, id.id));
+	}
+	
+	message.type = MSG_REMOVE;
+	message.id = id.id;
+	
+	return (PostMessage(sharded->shards[id.shard], &message));
+}
+
+
+/******************************************************************************
+*								ShardedNextDeadline
+*******************************************************************************/
+time_t ShardedNextDeadline(sharded_scheduler_t *sharded)
+{
+	time_t next_deadline = NO_DEADLINE;
+	time_t deadline = NO_DEADLINE;
+	size_t i = 0;
+	
+	assert(sharded);
+	
+	for (i = 0; i < sharded->count; ++i)
+	{
+		deadline = atomic_load(&sharded->shards[i]->deadline);
+		if (NO_DEADLINE != deadline &&
+			(NO_DEADLINE == next_deadline || deadline < next_deadline))
+		{
+			next_deadline = deadline;
+		}
+	}
+	
+	return (next_deadline);
+}
+
+
+/******************************************************************************
+*								ShardedCount
+*******************************************************************************/
+size_t ShardedCount(const sharded_scheduler_t *sharded)
+{
+	assert(sharded);
+	
+	return (sharded->count);
+}
+
+
+/******************************************************************************
+*************************** internal functions ********************************
+*******************************************************************************/
+
+/******************************* CreateShard **********************************/
+static shard_t *CreateShard(sharded_scheduler_t *sharded, size_t index)
+{
+	shard_t *shard = NULL;
+	
+	shard = (shard_t *) calloc(1, sizeof(shard_t));
+	if (NULL == shard)
+	{
+		return (NULL);
+	}
+	
+	shard->owner = sharded;
+	shard->index = index;
+	shard->mailbox_fd = -1;
+	atomic_init(&shard->is_stopping, FALSE);
+	atomic_init(&shard->deadline, NO_DEADLINE);
+	pthread_mutex_init(&shard->lock, NULL);
+	
+	shard->sched = SchedulerCreate();
+	shard->inbox = DVCreate(MAILBOX_CAPACITY, sizeof(message_t));
+	shard->handled = DVCreate(MAILBOX_CAPACITY, sizeof(message_t));
+	shard->mailbox_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	
+	if (NULL == shard->sched || NULL == shard->inbox ||
+		NULL == shard->handled || 0 > shard->mailbox_fd ||
+		SUCCESS != SchedulerAddFd(shard->sched, shard->mailbox_fd, POLLIN,
+								  MailboxHandler, shard))
+	{
+		DestroyShard(shard);
+		return (NULL);
+	}
+	SchedulerSetWaitHandler(shard->sched, PublishDeadline, shard);
+	
+	return (shard);
+}
+
+
+/****************************** DestroyShard **********************************/
+static void DestroyShard(shard_t *shard)
+{
+	assert(shard);
+	
+	if (NULL != shard->sched)
+	{
+		SchedulerDestroy(shard->sched);
+		shard->sched = NULL;
+	}
+	if (NULL != shard->inbox)
+	{
+		DVDestroy(shard->inbox);
+		shard->inbox = NULL;
+	}
+	if (NULL != shard->handled)
+	{
+		DVDestroy(shard->handled);
+		shard->handled = NULL;
+	}
+	if (0 <= shard->mailbox_fd)
+	{
+		close(shard->mailbox_fd);
+		shard->mailbox_fd = -1;
+	}
+	pthread_mutex_destroy(&shard->lock);
+	
+	free(shard);
+	shard = NULL;
+}
+
+
+/******************************* ShardThread **********************************/
+static void *ShardThread(void *shard)
+{
+	shard_t *this_shard = (shard_t *)shard;
+	struct pollfd mailbox = {0};
+	
+	assert(shard);
+	
+	t_shard = this_shard;
+	BindToCpus(this_shard);
+	
+	mailbox.fd = this_shard->mailbox_fd;
+	mailbox.events = POLLIN;
+	
+	/*	SchedulerRun returns COMPLETE once the shard is empty - then only the
+		mailbox is waited for */
+	while (TRUE != atomic_load(&this_shard->is_stopping))
+	{
+		if (COMPLETE == SchedulerRun(this_shard->sched))
+		{
+			atomic_store(&this_shard->deadline, NO_DEADLINE);
+			if (0 < poll(&mailbox, 1, -1))
+			{
+				HandleMessages(this_shard);
+			}
+		}
+	}
+	
+	t_shard = NULL;
+	
+	return (NULL);
+}
+
+
+/******************************* StopShards ***********************************/
+static void StopShards(sharded_scheduler_t *sharded, size_t count)
+{
+	shard_t *shard = NULL;
+	size_t i = 0;
+	
+	/*	all the shards are told before the first one is waited for */
+	for (i = 0; i < count; ++i)
+	{
+		shard = sharded->shards[i];
+		atomic_store(&shard->is_stopping, TRUE);
+		WakeShard(shard);
+	}
+	for (i = 0; i < count; ++i)
+	{
+		pthread_join(sharded->shards[i]->thread, NULL);
+	}
+}
+
+
+/******************************* BindToCpus ***********************************/
+static void BindToCpus(shard_t *shard)
+{
+	cpu_set_t allowed;
+	cpu_set_t cpus;
+	size_t cpu = 0;
+	
+	CPU_ZERO(&cpus);
+	if (0 != sched_getaffinity(0, sizeof(allowed), &allowed))
+	{
+		return;
+	}
+	
+	for (cpu = shard->index; cpu < CPU_SETSIZE; cpu += shard->owner->count)
+	{
+		if (CPU_ISSET(cpu, &allowed))
+		{
+			CPU_SET(cpu, &cpus);
+		}
+	}
+	
+	/* a shard with no CPU of its own runs anywhere */
+	if (0 < CPU_COUNT(&cpus))
+	{
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+}
+
+
+/***************************** MailboxHandler *********************************/
+static int MailboxHandler(int fd, short revents, void *shard)
+{
+	shard_t *this_shard = (shard_t *)shard;
+	
+	UNUSED(fd);
+	UNUSED(revents);
+	assert(shard);
+	
+	HandleMessages(this_shard);
+	
+	if (TRUE == atomic_load(&this_shard->is_stopping))
+	{
+		SchedulerStop(this_shard->sched);
+	}
+	
+	return (REPEAT);
+}
+
+
+/***************************** HandleMessages *********************************/
+static void HandleMessages(shard_t *shard)
+{
+	message_t *message = NULL;
+	dv_t *messages = NULL;
+	uint64_t count = 0;
+	size_t i = 0;
+	
+	/* resets the eventfd - a message posted from now on signals it again */
+	if (sizeof(count) != read(shard->mailbox_fd, &count, sizeof(count)))
+	{
+		count = 0;
+	}
+	
+	/*	the posters are held only for the swap - the messages are handled
+		out of the lock */
+	pthread_mutex_lock(&shard->lock);
+	messages = shard->inbox;
+	shard->inbox = shard->handled;
+	shard->handled = messages;
+	pthread_mutex_unlock(&shard->lock);
+	
+	for (i = 0; i < DVSize(messages); ++i)
+	{
+		message = (message_t *)DVGetItem(messages, i);
+		switch (message->type)
+		{
+			case MSG_ADD:
+				if (SUCCESS != SchedulerAddTaskById(shard->sched, message->id,
+													message->task_func,
+													message->data,
+													message->start_time,
+													message->interval))
+				{
+					fprintf(stderr, "ERROR: cannot add a task to a shard.\n");
+				}
+				break;
+			
+			case MSG_REMOVE:
+				SchedulerRemoveTask(shard->sched, message->id);
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	while (0 < DVSize(messages))
+	{
+		DVPopBack(messages);
+	}
+}
+
+
+/****************************** PostMessage ***********************************/
+static status_t PostMessage(shard_t *shard, const message_t *message)
+{
+	status_t status = SUCCESS;
+	int is_first = FALSE;
+	
+	pthread_mutex_lock(&shard->lock);
+	status = DVPushBack(shard->inbox, message);
+	is_first = (1 == DVSize(shard->inbox));
+	pthread_mutex_unlock(&shard->lock);
+	
+	if (SUCCESS == status && is_first)
+	{
+		WakeShard(shard);
+	}
+	
+	return (status);
+}
+
+
+/***************************** PublishDeadline ********************************/
+static void PublishDeadline(time_t run_time, void *shard)
+{
+	assert(shard);
+	
+	atomic_store(&((shard_t *)shard)->deadline, run_time);
+}
+
+
+/****************************** LowerDeadline *********************************/
+static void LowerDeadline(shard_t *shard, time_t run_time)
+{
+	time_t deadline = atomic_load(&shard->deadline);
+	
+	while ((NO_DEADLINE == deadline || run_time < deadline) &&
+		   !atomic_compare_exchange_weak(&shard->deadline, &deadline,
+										 run_time))
+	{
+		/* deadline was reloaded - try again */
+	}
+}
+
+
+/******************************** WakeShard ***********************************/
+static void WakeShard(shard_t *shard)
+{
+	uint64_t one = 1;
+	
+	/*	may fail only when the counter is full - then it's signalled anyway */
+	if (sizeof(one) != write(shard->mailbox_fd, &one, sizeof(one)))
+	{
+		one = 0;
+	}
+}
+
+
+/******************************** CpuShard ************************************/
+static size_t CpuShard(const sharded_scheduler_t *sharded)
+{
+	int cpu = sched_getcpu();
+	
+	return ((0 > cpu) ? 0 : (size_t)cpu % sharded->count);
+}
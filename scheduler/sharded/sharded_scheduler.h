@@ -0,0 +1,164 @@
+/*******************************************************************************
+*	Filename    :	sharded_scheduler.h
+*	Developer	:	Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	sharded scheduler header - a scheduler per CPU, each run by
+*					a thread of its own. a task is added & removed in its
+*					shard only by the shard's thread - other threads pass
+*					messages to it, so the shards share no locked structure.
+*					a coordinator keeps only the next deadline of each shard.
+*******************************************************************************/
+#ifndef _SHARDED_SCHEDULER_H_
+#define _SHARDED_SCHEDULER_H_
+
+#include <sys/types.h> /* size_t time_t*/
+
+#include "../../utils/general_types.h"
+#include "../task/types.h"
+#include "../task/uid/uid.h"
+
+
+/*******************************************************************************
+ *  Description:   Holds the struct sharded_scheduler.
+ */
+typedef struct sharded_scheduler sharded_scheduler_t;
+
+/*******************************************************************************
+ *  Description:   the id of a task in a sharded scheduler - its shard & its
+ *				   id in the shard.
+ */
+typedef struct shard_task_id
+{
+	size_t shard;
+	unique_id_t id;
+} shard_task_id_t;
+
+/******************************** ShardedCreate ********************************
+ *	Description:   Creates a sharded scheduler. the shards don't run yet.
+ *
+ *	Input:		   shards - the number of shards. 0 - one per online CPU.
+ *
+ *	Return Values: On success    - returns a pointer to the new scheduler.
+ *				   Otherwise     - returns NULL.
+ *
+ *	Complexity:	   O(shards)
+ */
+sharded_scheduler_t *ShardedCreate(size_t shards);
+
+/******************************** ShardedDestroy *******************************
+ *	Description:   Stops the shards (see ShardedStop) and destroys them with
+ *				   their tasks.
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(n)
+ */
+void ShardedDestroy(sharded_scheduler_t *sharded);
+
+/******************************** ShardedStart *********************************
+ *	Description:   Starts a thread per shard, bound to the CPU of the shard
+ *				   (shard i - the i-th online CPU, when it may). each thread
+ *				   runs its shard until ShardedStop - an empty shard waits
+ *				   for messages.
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *
+ *	Return Values: SUCCESS 		 - all the shards run.
+ *				   FAILURE		 - a thread couldn't be created (the
+ *								   started ones are stopped).
+ *
+ *	Complexity:	   O(shards)
+ */
+status_t ShardedStart(sharded_scheduler_t *sharded);
+
+/******************************** ShardedStop **********************************
+ *	Description:   Stops the shards & waits for their threads. a running task
+ *				   is completed first. the tasks are kept - ShardedStart runs
+ *				   them again. must not be called by a task of a shard.
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(shards)
+ */
+void ShardedStop(sharded_scheduler_t *sharded);
+
+/****************************** ShardedAddTask *********************************
+ *	Description:   Adds a task to the shard of the calling thread: a task (or
+ *				   fd handler) of a shard adds into its own shard directly.
+ *				   any other thread - into the shard of the CPU it runs on,
+ *				   by a message (the task is added before the shard's next
+ *				   task).
+ *
+ *	Input:		   as SchedulerAddTask.
+ *
+ *	Return Values: On success    - id of the added task.
+ *				   othrwise      - a Bad id (UIDIsBad).
+ *
+ *	Complexity:	   O(log(n)) in the shard
+ */
+shard_task_id_t ShardedAddTask(sharded_scheduler_t *sharded,
+							   task_func_t task_func, void *data,
+							   time_t start_time, time_t interval);
+
+/****************************** ShardedAddTaskOn *******************************
+ *	Description:   As ShardedAddTask, into a given shard (directly if it's the
+ *				   shard of the calling thread, otherwise by a message).
+ *
+ *	Input:		   shard - the index of the shard, below ShardedCount.
+ *
+ *	Return Values: On success    - id of the added task.
+ *				   othrwise      - a Bad id (UIDIsBad).
+ *
+ *	Complexity:	   O(log(n)) in the shard
+ */
+shard_task_id_t ShardedAddTaskOn(sharded_scheduler_t *sharded, size_t shard,
+								 task_func_t task_func, void *data,
+								 time_t start_time, time_t interval);
+
+/**************************** ShardedRemoveTask ********************************
+ *	Description:   Removes a task. by the thread of its shard - directly.
+ *				   by any other thread - a cancellation message is passed to
+ *				   the shard, and the task is removed before the shard's next
+ *				   task (a task which runs right now may still run once).
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *				   id					 - id of a task to remove.
+ *
+ *	Return Values: SUCCESS 		 - task removed, or the message was passed.
+ *				   FAILURE		 - task not found (by its own shard), or the
+ *								   message couldn't be passed.
+ *
+ *	Complexity:	   O(n) in the shard
+ */
+int ShardedRemoveTask(sharded_scheduler_t *sharded, shard_task_id_t id);
+
+/**************************** ShardedNextDeadline ******************************
+ *	Description:   The earliest deadline over all the shards - each shard
+ *				   publishes the run time of its next task before it waits
+ *				   for it. a shard busy with due tasks keeps the last one it
+ *				   published (a deadline which has passed).
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *
+ *	Return Values: the earliest run time. 0 - no shard has a task.
+ *
+ *	Complexity:	   O(shards)
+ */
+time_t ShardedNextDeadline(sharded_scheduler_t *sharded);
+
+/****************************** ShardedCount ***********************************
+ *	Description:   Number of shards.
+ *
+ *	Input:		   sharded_scheduler_t * - pointer to a sharded scheduler.
+ *
+ *	Return Values: size_t        - number of shards.
+ *
+ *	Complexity:	   O(1)
+ */
+size_t ShardedCount(const sharded_scheduler_t *sharded);
+
+#endif     /* _SHARDED_SCHEDULER_H_ */
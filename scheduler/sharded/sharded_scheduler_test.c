@@ -0,0 +1,278 @@
+/*******************************************************************************
+*	Filename :		sharded_scheduler_test.c
+*	Developer :		Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	sharded scheduler test file
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* nanosleep */
+
+#include <stdio.h> 		/* printf */
+#include <time.h>		/* time, nanosleep */
+#include <stdatomic.h>	/* atomic_int */
+
+#include "sharded_scheduler.h"
+
+
+/*** MACROS ***/
+#define UNUSED(x) ((void) x)
+#define WAIT_ROUNDS (300)		/* of 10 ms */
+#define LATE (100)				/* seconds - a task which never runs */
+
+/*** structures ***/
+typedef struct test_data
+{
+	sharded_scheduler_t *sharded;
+	atomic_int runs;
+	shard_task_id_t child_id;
+	shard_task_id_t victim_id;
+} test_data_t;
+
+/*** unit-test functions ***/
+void ShardedCreateTest(void);
+void ShardedForeignAddTest(void);
+void ShardedLocalAddTest(void);
+void ShardedRemoveTest(void);
+
+/*** task functions ***/
+int TaskCount(void *data);
+int TaskAddChild(void *data);
+int TaskRemoveVictim(void *data);
+int TaskNever(void *data);
+
+/*** internal functions ***/
+/* waits until *runs reaches expected - returns TRUE if it has */
+static int WaitForRuns(atomic_int *runs, int expected);
+static void SleepMs(long ms);
+
+
+/*****************************************************************************
+*								main
+******************************************************************************/
+int main(void)
+{
+	printf("\n***** TEST FOR SHARDED SCHEDULER FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	ShardedCreateTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ShardedForeignAddTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ShardedLocalAddTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ShardedRemoveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* ShardedCreateTest **********************************/
+void ShardedCreateTest(void)
+{
+	sharded_scheduler_t *sharded_1 = NULL;
+	sharded_scheduler_t *sharded_2 = NULL;
+	
+	printf("ShardedCreate:\t\t\t\t");
+	
+	sharded_1 = ShardedCreate(0);		/* one per CPU */
+	sharded_2 = ShardedCreate(3);
+	
+	(NULL != sharded_1)						&&
+	(0 < ShardedCount(sharded_1))			&&
+	(NULL != sharded_2)						&&
+	(3 == ShardedCount(sharded_2))			&&
+	(0 == ShardedNextDeadline(sharded_2))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	ShardedDestroy(sharded_1);
+	ShardedDestroy(sharded_2);
+}
+
+
+/************************* ShardedForeignAddTest ******************************/
+void ShardedForeignAddTest(void)
+{
+	test_data_t data = {0};
+	shard_task_id_t id_1 = {0};
+	shard_task_id_t id_2 = {0};
+	shard_task_id_t id_3 = {0};
+	time_t now = time(NULL);
+	int is_run = FALSE;
+	
+	printf("ShardedAddTask (other thread):\t\t");
+	
+	data.sharded = ShardedCreate(2);
+	
+	/* passed as messages - before & after the shards have started */
+	id_1 = ShardedAddTaskOn(data.sharded, 0, TaskCount, &data, now, 0);
+	id_2 = ShardedAddTaskOn(data.sharded, 1, TaskCount, &data, now, 0);
+	ShardedStart(data.sharded);
+	id_3 = ShardedAddTask(data.sharded, TaskCount, &data, now, 0);
+	
+	is_run = WaitForRuns(&data.runs, 3);
+	ShardedStop(data.sharded);
+	
+	(FALSE == UIDIsBad(id_1.id))	&&
+	(0 == id_1.shard)				&&
+	(1 == id_2.shard)				&&
+	(2 > id_3.shard)				&&
+	(TRUE == is_run)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	ShardedDestroy(data.sharded);
+}
+
+
+/************************* ShardedLocalAddTest ********************************/
+void ShardedLocalAddTest(void)
+{
+	test_data_t data = {0};
+	int is_run = FALSE;
+	
+	printf("ShardedAddTask (task of a shard):\t");
+	
+	data.sharded = ShardedCreate(2);
+	data.child_id.shard = 2;
+	
+	/* the task on shard 1 adds its child to shard 1 */
+	ShardedAddTaskOn(data.sharded, 1, TaskAddChild, &data, time(NULL), 0);
+	ShardedStart(data.sharded);
+	
+	is_run = WaitForRuns(&data.runs, 1);
+	ShardedStop(data.sharded);
+	
+	(TRUE == is_run)					&&
+	(1 == data.child_id.shard)			&&
+	(FALSE == UIDIsBad(data.child_id.id))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	ShardedDestroy(data.sharded);
+}
+
+
+/************************* ShardedRemoveTest **********************************/
+void ShardedRemoveTest(void)
+{
+	test_data_t data = {0};
+	time_t late = time(NULL) + LATE;
+	time_t deadline_before = 0;
+	int ret_val_1 = 0;
+	size_t i = 0;
+	
+	printf("ShardedRemoveTask (other shard):\t");
+	
+	data.sharded = ShardedCreate(2);
+	data.victim_id = ShardedAddTaskOn(data.sharded, 1, TaskNever, &data,
+									  late, 1);
+	deadline_before = ShardedNextDeadline(data.sharded);	/* late */
+	
+	/* a task of shard 0 cancels the task of shard 1 - by a message */
+	ShardedStart(data.sharded);
+	ShardedAddTaskOn(data.sharded, 0, TaskRemoveVictim, &data, time(NULL), 0);
+	
+	WaitForRuns(&data.runs, 1);
+	for (i = 0; i < WAIT_ROUNDS && 0 != ShardedNextDeadline(data.sharded); ++i)
+	{
+		SleepMs(10);
+	}
+	ShardedStop(data.sharded);
+	
+	/* removing it again by this thread is only a message */
+	ret_val_1 = ShardedRemoveTask(data.sharded, data.victim_id);
+	
+	(late == deadline_before)					&&
+	(1 == atomic_load(&data.runs))				&&
+	(0 == ShardedNextDeadline(data.sharded))	&&
+	(SUCCESS == ret_val_1)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	ShardedDestroy(data.sharded);
+}
+
+
+/******************************************************************************
+*								Task-functions
+*******************************************************************************/
+
+/****************************** TaskCount *************************************/
+int TaskCount(void *data)
+{
+	atomic_fetch_add(&((test_data_t *)data)->runs, 1);
+	
+	return (DONE);
+}
+
+
+/****************************** TaskAddChild **********************************/
+int TaskAddChild(void *data)
+{
+	test_data_t *test_data = (test_data_t *)data;
+	
+	test_data->child_id = ShardedAddTask(test_data->sharded, TaskCount, data,
+										 time(NULL), 0);
+	
+	return (DONE);
+}
+
+
+/**************************** TaskRemoveVictim ********************************/
+int TaskRemoveVictim(void *data)
+{
+	test_data_t *test_data = (test_data_t *)data;
+	
+	if (SUCCESS == ShardedRemoveTask(test_data->sharded, test_data->victim_id))
+	{
+		atomic_fetch_add(&test_data->runs, 1);
+	}
+	
+	return (DONE);
+}
+
+
+/****************************** TaskNever *************************************/
+int TaskNever(void *data)
+{
+	atomic_fetch_add(&((test_data_t *)data)->runs, 100);
+	
+	return (REPEAT);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/****************************** WaitForRuns ***********************************/
+static int WaitForRuns(atomic_int *runs, int expected)
+{
+	size_t i = 0;
+	
+	for (i = 0; i < WAIT_ROUNDS && expected > atomic_load(runs); ++i)
+	{
+		SleepMs(10);
+	}
+	
+	return (expected <= atomic_load(runs));
+}
+
+
+/******************************* SleepMs **************************************/
+static void SleepMs(long ms)
+{
+	struct timespec duration = {0};
+	
+	duration.tv_sec = ms / 1000;
+	duration.tv_nsec = (ms % 1000) * 1000000;
+	nanosleep(&duration, NULL);
+}
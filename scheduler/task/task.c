@@ -4,13 +4,19 @@
 *	Last Update :	21 Feb 2019
 *	Description:	task source file
 *******************************************************************************/
+#define _POSIX_C_SOURCE 200112L	/* clock_gettime */
+
 #include <stdlib.h>		/* malloc, free */
 #include <assert.h> 	/* assert */
 #include <string.h> 	/* memset */
-#include <time.h>		/* time */
+#include <time.h>		/* time, clock_gettime */
 
 #include "task.h"
 
+/*** MACROS ***/
+#define UNUSED(x) ((void) x)
+#define NS_IN_SEC (1000000000UL)
+#define MS_IN_SEC (1000L)
 
 /*** structures ***/
 struct task
@@ -18,10 +24,24 @@ struct task
 	unique_id_t id;
 	time_t run_time;
 	time_t interval;
+	time_t slack;				/* may run up to run_time + slack */
+	task_class_t task_class;
+	void *group;				/* of the scheduler - where it's re-armed */
 	int(*task_func)(void *data);
 	void *data;
+#ifdef WD_TASK_STATS
+	task_stats_t stats;
+#endif
 };
 
+#ifdef WD_TASK_STATS
+/*** internal functions ***/
+/*	updates the stats of a task which has started at 'start' (monotonic) and
+	ended now. start_ms - the start by the clock of its run time */
+static void UpdateStats(task_t *task, const struct timespec *start,
+						long start_ms);
+#endif
+
 
 /******************************************************************************
 *								TaskCreate
@@ -42,8 +62,14 @@ task_t *TaskCreate(task_func_t task_func, void * data,
 	new_task->id = UIDCreate();
 	new_task->run_time = start_time;
 	new_task->interval = interval;
+	new_task->slack = 0;
+	new_task->task_class = TASK_NORMAL;
+	new_task->group = NULL;
 	new_task->task_func = task_func;
 	new_task->data = data;
+#ifdef WD_TASK_STATS
+	memset(&new_task->stats, 0, sizeof(new_task->stats));
+#endif
 	
 	return (new_task);
 }
@@ -73,6 +99,17 @@ unique_id_t TaskGetId(task_t *task)
 }
 
 
+/******************************************************************************
+*								TaskSetId
+*******************************************************************************/
+void TaskSetId(task_t *task, unique_id_t id)
+{
+	assert(task);
+	
+	task->id = id;
+}
+
+
 /******************************************************************************
 *								TaskGetRunTime
 *******************************************************************************/
@@ -95,15 +132,243 @@ void TaskUpdateRunTime(task_t *task)
 }
 
 
+/******************************************************************************
+*								TaskSetRunTime
+*******************************************************************************/
+void TaskSetRunTime(task_t *task, time_t run_time)
+{
+	assert(task);
+	
+	task->run_time = run_time;
+}
+
+
+/******************************************************************************
+*								TaskGetInterval
+*******************************************************************************/
+time_t TaskGetInterval(task_t *task)
+{
+	assert(task);
+	
+	return (task->interval);
+}
+
+
+/******************************************************************************
+*								TaskSetInterval
+*******************************************************************************/
+void TaskSetInterval(task_t *task, time_t interval)
+{
+	assert(task);
+	
+	task->interval = interval;
+}
+
+
+/******************************************************************************
+*								TaskSetSlack
+*******************************************************************************/
+void TaskSetSlack(task_t *task, time_t slack)
+{
+	assert(task);
+	assert(0 <= slack);
+	
+	task->slack = slack;
+}
+
+
+/******************************************************************************
+*								TaskGetSlack
+*******************************************************************************/
+time_t TaskGetSlack(task_t *task)
+{
+	assert(task);
+	
+	return (task->slack);
+}
+
+
+/******************************************************************************
+*								TaskSetClass
+*******************************************************************************/
+void TaskSetClass(task_t *task, task_class_t task_class)
+{
+	assert(task);
+	assert(TASK_CLASSES > task_class);
+	
+	task->task_class = task_class;
+}
+
+
+/******************************************************************************
+*								TaskGetClass
+*******************************************************************************/
+task_class_t TaskGetClass(task_t *task)
+{
+	assert(task);
+	
+	return (task->task_class);
+}
+
+
+/******************************************************************************
+*								TaskSetGroup
+*******************************************************************************/
+void TaskSetGroup(task_t *task, void *group)
+{
+	assert(task);
+	
+	task->group = group;
+}
+
+
+/******************************************************************************
+*								TaskGetGroup
+*******************************************************************************/
+void *TaskGetGroup(task_t *task)
+{
+	assert(task);
+	
+	return (task->group);
+}
+
+
+/******************************************************************************
+*								TaskGetFunc
+*******************************************************************************/
+task_func_t TaskGetFunc(task_t *task)
+{
+	assert(task);
+	
+	return (task->task_func);
+}
+
+
+/******************************************************************************
+*								TaskGetData
+*******************************************************************************/
+void *TaskGetData(task_t *task)
+{
+	assert(task);
+	
+	return (task->data);
+}
+
+
 /******************************************************************************
 *								TaskRun
 *******************************************************************************/
-int TaskRun(task_t *task)
+int TaskRun(task_t *task, long now_ms)
 {
+#ifdef WD_TASK_STATS
+	struct timespec start = {0};
+	int ret_status = 0;
+	
 	assert(task);
 	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	ret_status = task->task_func(task->data);
+	
+	UpdateStats(task, &start, now_ms);
+	
+	return (ret_status);
+#else
+	assert(task);
+	UNUSED(now_ms);
+	
 	return (task->task_func(task->data));
+#endif
+}
+
+
+/******************************************************************************
+*								TaskGetStats
+*******************************************************************************/
+void TaskGetStats(task_t *task, task_stats_t *stats)
+{
+	assert(task);
+	assert(stats);
+
+#ifdef WD_TASK_STATS
+	*stats = task->stats;
+#else
+	UNUSED(task);
+	memset(stats, 0, sizeof(task_stats_t));
+#endif
+}
+
+
+/******************************************************************************
+*								TaskSetBudget
+*******************************************************************************/
+void TaskSetBudget(task_t *task, unsigned long budget_ns)
+{
+	assert(task);
+
+#ifdef WD_TASK_STATS
+	task->stats.budget_ns = budget_ns;
+#else
+	UNUSED(task);
+	UNUSED(budget_ns);
+#endif
+}
+
+
+/******************************************************************************
+*								TaskIsOverrun
+*******************************************************************************/
+int TaskIsOverrun(task_t *task)
+{
+	assert(task);
+
+#ifdef WD_TASK_STATS
+	return (0 != task->stats.budget_ns &&
+			task->stats.last_ns > task->stats.budget_ns);
+#else
+	UNUSED(task);
+	
+	return (0);
+#endif
+}
+
+
+#ifdef WD_TASK_STATS
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/******************************** UpdateStats *********************************/
+static void UpdateStats(task_t *task, const struct timespec *start,
+						long start_ms)
+{
+	struct timespec end = {0};
+	task_stats_t *stats = NULL;
+	unsigned long duration = 0;
+	long lateness = 0;
+	
+	assert(task);
+	
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	stats = &task->stats;
+	
+	duration = (unsigned long)(end.tv_sec - start->tv_sec) * NS_IN_SEC +
+			   (unsigned long)end.tv_nsec - (unsigned long)start->tv_nsec;
+	lateness = start_ms - (long)task->run_time * MS_IN_SEC;
+	
+	++stats->runs;
+	stats->total_ns += duration;
+	stats->last_ns = duration;
+	stats->max_ns = (duration > stats->max_ns) ? duration : stats->max_ns;
+	stats->last_lateness_ms = lateness;
+	stats->max_lateness_ms = (lateness > stats->max_lateness_ms) ?
+							 lateness : stats->max_lateness_ms;
+	
+	if (0 != stats->budget_ns && duration > stats->budget_ns)
+	{
+		++stats->overruns;
+	}
 }
+#endif
 
 
 
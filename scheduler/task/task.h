@@ -59,6 +59,18 @@ void TaskDestroy(task_t *task);
  */
 unique_id_t TaskGetId(task_t *task);
 
+/******************************** TaskSetId ************************************
+ *	Description:   Replaces the id of a task by an id created by the caller.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   id		  - the new id (by UIDCreate).
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetId(task_t *task, unique_id_t id);
+
 /****************************** TaskGetRunTime *********************************
  *	Description:   Returns a task start time.
  *
@@ -83,10 +95,146 @@ time_t TaskGetRunTime(task_t *task);
  */
 void TaskUpdateRunTime(task_t *task);
 
+/***************************** TaskSetRunTime **********************************
+ *	Description:   Sets the task run time to a given time (the interval is
+ *				   kept for the next TaskUpdateRunTime).
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   run_time	  - the new run time (absolute).
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetRunTime(task_t *task, time_t run_time);
+
+/****************************** TaskGetInterval ********************************
+ *	Description:   Returns the interval of a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the interval of the task, in seconds.
+ *
+ *	Complexity:	   O(1)
+ */
+time_t TaskGetInterval(task_t *task);
+
+/****************************** TaskSetInterval ********************************
+ *	Description:   Sets the interval of a task - the time between its runs
+ *				   from its next run on.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   interval	  - in seconds.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetInterval(task_t *task, time_t interval);
+
+/******************************* TaskSetSlack **********************************
+ *	Description:   Sets how late a task may run - the scheduler may delay it
+ *				   up to run time + slack, to run it with other tasks.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   slack	  - in seconds. 0 (the default) - on time.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetSlack(task_t *task, time_t slack);
+
+/******************************* TaskGetSlack **********************************
+ *	Description:   Returns the slack of a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the slack of the task, in seconds.
+ *
+ *	Complexity:	   O(1)
+ */
+time_t TaskGetSlack(task_t *task);
+
+/******************************* TaskSetClass **********************************
+ *	Description:   Sets the priority class of a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   task_class - TASK_CRITICAL, TASK_NORMAL (the default) or
+ *								TASK_BACKGROUND.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetClass(task_t *task, task_class_t task_class);
+
+/******************************* TaskGetClass **********************************
+ *	Description:   Returns the priority class of a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the class of the task.
+ *
+ *	Complexity:	   O(1)
+ */
+task_class_t TaskGetClass(task_t *task);
+
+/******************************* TaskSetGroup **********************************
+ *	Description:   Keeps the interval group a task was last re-armed into, so
+ *				   the scheduler finds it again in O(1). the group belongs to
+ *				   the scheduler - the task only points at it.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   group	  - pointer to the group, or NULL (the default).
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetGroup(task_t *task, void *group);
+
+/******************************* TaskGetGroup **********************************
+ *	Description:   Returns the group kept by TaskSetGroup.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the group, or NULL.
+ *
+ *	Complexity:	   O(1)
+ */
+void *TaskGetGroup(task_t *task);
+
+/****************************** TaskGetFunc ************************************
+ *	Description:   Returns the function executed by a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the task_func of the task.
+ *
+ *	Complexity:	   O(1)
+ */
+task_func_t TaskGetFunc(task_t *task);
+
+/****************************** TaskGetData ************************************
+ *	Description:   Returns the data passed to the function of a task.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: Returns the data of the task.
+ *
+ *	Complexity:	   O(1)
+ */
+void *TaskGetData(task_t *task);
+
 /******************************** TaskRun **************************************
  *	Description:   Runs task by executing task_func.
  *
  *	Input:		   task_t *   - pointer to task.
+ *				   now_ms	  - the current time, in milliseconds, by the
+ *								clock its run time is of (the clock of the
+ *								scheduler). the lateness of the run is of it
+ *								(WD_TASK_STATS).
  *
  *  Return values: FAIL   (-1): task has failed.
  *       		   DONE   (0) : task is done and doesn't require any more calls.
@@ -95,6 +243,45 @@ void TaskUpdateRunTime(task_t *task);
  *
  *	Complexity:	   O(1)
  */
-int TaskRun(task_t *task);
+int TaskRun(task_t *task, long now_ms);
+
+/******************************** TaskGetStats *********************************
+ *	Description:   Copies the run-time statistics of a task.
+ *				   all are 0 unless compiled with WD_TASK_STATS.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   stats	  - pointer to fill.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskGetStats(task_t *task, task_stats_t *stats);
+
+/******************************** TaskSetBudget ********************************
+ *	Description:   Sets the max duration of a single run of the task.
+ *				   a longer run is counted in stats.overruns.
+ *				   has no effect unless compiled with WD_TASK_STATS.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *				   budget_ns  - max duration in nanoseconds. 0 - no budget.
+ *
+ *	Return Values: None.
+ *
+ *	Complexity:	   O(1)
+ */
+void TaskSetBudget(task_t *task, unsigned long budget_ns);
+
+/******************************** TaskIsOverrun ********************************
+ *	Description:   Checks whether the last run of the task exceeded its budget.
+ *
+ *	Input:		   task_t *   - pointer to task.
+ *
+ *	Return Values: 1 - the last run exceeded the budget. 0 - otherwise
+ *				   (always 0 unless compiled with WD_TASK_STATS).
+ *
+ *	Complexity:	   O(1)
+ */
+int TaskIsOverrun(task_t *task);
 
 #endif     /* _TASK_H_ */
@@ -80,9 +80,9 @@ void TaskIntegratedTest(void)
 	
 	/* run checking */
 	printf("TaskRun: returned values + excecutions of all 3 functions\n\n");
-	(DONE 	== TaskRun(task_1)) &&
-	(REPEAT	== TaskRun(task_2)) &&
-	(FAIL 	== TaskRun(task_3))
+	(DONE 	== TaskRun(task_1, 0)) &&
+	(REPEAT	== TaskRun(task_2, 0)) &&
+	(FAIL 	== TaskRun(task_3, 0))
 	?
 	printf("\nret values:\t\t\tSUCCESS") : printf("ret values:\t\t\tFAIL");
 	printf("\n\n--------------------------------------------------------\n\n");
@@ -8,6 +8,8 @@
 #ifndef _TYPES_H_
 #define _TYPES_H_
 
+#include <stddef.h> /* size_t */
+
 enum
 {
 	FAIL   = -1,
@@ -26,4 +28,54 @@ enum
  */
 typedef int (*task_func_t)(void *data);
 
+/*******************************************************************************
+ *  Description:   the priority class of a task. among the tasks which are due,
+ *				   the critical ones run first and the background ones last.
+ *
+ *				   TASK_CRITICAL   - must run on time (e.g. heartbeats).
+ *				   TASK_NORMAL	   - the default.
+ *				   TASK_BACKGROUND - maintenance. may be deferred while the
+ *									 scheduler is behind schedule.
+ */
+typedef enum task_class
+{
+	TASK_CRITICAL,
+	TASK_NORMAL,
+	TASK_BACKGROUND,
+	TASK_CLASSES			/* the number of classes */
+} task_class_t;
+
+/*******************************************************************************
+ *  Description:   fd_func_t is a pointer to a function which handles a file
+ *				   descriptor that became ready while the scheduler waited.
+ *
+ *  Input:         fd      - the ready file descriptor.
+ *				   revents - the events returned by poll for fd.
+ *				   param   - pointer to user data.
+ *
+ *  Return values: FAIL   (-1): handling has failed. fd won't be watched anymore.
+ *       		   DONE   (0) : fd doesn't have to be watched anymore.
+ *			       REPEAT (1) : keep watching fd.
+ */
+typedef int (*fd_func_t)(int fd, short revents, void *param);
+
+/*******************************************************************************
+ *  Description:   run-time statistics of a task. collected only when compiled
+ *				   with WD_TASK_STATS (make STATS=1) - otherwise all are 0.
+ *				   durations are measured with CLOCK_MONOTONIC.
+ *				   lateness is how long after its run_time the task started,
+ *				   by the clock of the scheduler.
+ */
+typedef struct task_stats
+{
+	size_t runs;				/* number of invocations */
+	unsigned long total_ns;		/* total run duration */
+	unsigned long max_ns;		/* longest run duration */
+	unsigned long last_ns;		/* last run duration */
+	long last_lateness_ms;		/* lateness of the last run */
+	long max_lateness_ms;		/* biggest lateness */
+	unsigned long budget_ns;	/* max duration of a run. 0 - no budget */
+	size_t overruns;			/* number of runs longer than budget_ns */
+} task_stats_t;
+
 #endif     /* _TYPES_H_ */
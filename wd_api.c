@@ -10,6 +10,9 @@
 #include <stdlib.h>		/* setenv */
 #include <assert.h> 	/* assert */
 #include <pthread.h>	/* pthread_create, pthread_join */
+#include <semaphore.h>	/* sem_t, sem_timedwait */
+#include <errno.h>		/* errno, EINTR */
+#include <stdatomic.h>	/* atomic_int */
 
 #ifndef NDEBUG
 #include <stdio.h> 		/* printf */
@@ -18,10 +21,12 @@
 #include "./scheduler/scheduler.h"
 #include "wd_api.h"
 #include "wd_shared.h"
+#include "wd_flight.h"
+#include "wd_state.h"
 
 /******************************* MACROS ***************************************/
 #define UNUSED(x) ((void) x)
-#define SECONDS_TO_WAIT_FOR_SIGNAL (5)
+#define SECONDS_TO_WAIT_FOR_WD (REVIVE_READY_TIMEOUT + 1)
 
 /************************* internal functions *********************************/
 /*  creates the WD proc, informs 'WDKeepMeAlive' func whether it succeeded,
@@ -34,7 +39,10 @@ static void InitCom(com_pack_t *com_pack);
 
 /************************* global variable ************************************/
 /*  holds the value of the returned status from WDKeepMeAlive */
-static status_t g_keep_me_alive_status = FAILURE;
+static atomic_int g_keep_me_alive_status = FAILURE;
+
+/*	posted by ComThread once the WD is ready (or has failed to start) */
+static sem_t g_init_done;
 
 /******************************************************************************
 *							WDKeepMeAlive
@@ -43,30 +51,37 @@ status_t WDKeepMeAlive(int argc, char *const argv[])
 {
 	pthread_t com_thread_id = 0;
 	sigset_t mask;
-	sigset_t oldmask;
-	/* set the maximal time to wait for a signal from WD */
-	struct timespec timeout = {SECONDS_TO_WAIT_FOR_SIGNAL, 0};
+	/* set the maximal time to wait for the WD */
+	struct timespec deadline = {0};
 	
 	UNUSED(argc);
 	
+	/*	block SIGUSR1, so the beats don't interrupt the calls of this thread.
+		ComThread inherits the mask and receives SIGUSR1 through its
+		signalfd */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	
+	sem_init(&g_init_done, 0, 0);
+	
 	/* create a detatched communication_thread + checks */
 	if (0 == pthread_create(&com_thread_id, NULL, ComThread, (char **)argv))
 	{
 		/* make ComThread independent */
 		pthread_detach(com_thread_id);
 		
-		/*  creating a mask with SIGUSR1 */
-		sigemptyset(&mask);
-		sigaddset(&mask, SIGUSR1);
-		
-		/* block SIGUSR1 from to the whole app except ComThread */
-		pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
-		
-		/* wait till SIGUSR1 is received or till timeout is expired */
-		sigtimedwait(&mask, NULL, &timeout);
+		/*	wait till the WD has answered the handshake, or till timeout is
+			expired */
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += SECONDS_TO_WAIT_FOR_WD;
+		while (0 != sem_timedwait(&g_init_done, &deadline) && EINTR == errno)
+		{
+			/* interrupted by a signal handler - keep waiting */
+		}
 	}
 	
-	return (g_keep_me_alive_status);
+	return (atomic_load(&g_keep_me_alive_status));
 }
 
 
@@ -85,20 +100,23 @@ static void *ComThread(void *argv)
 	
 	/* init the communication to WD */
 	InitCom(&com_pack);
+	sem_post(&g_init_done);
 	
 	/* check if initiated successfully */
-	if (SUCCESS == g_keep_me_alive_status)
+	if (SUCCESS == atomic_load(&g_keep_me_alive_status))
 	{
 		/* communicates with WD */
 		MainLoop(&com_pack);
 		
-		/* stop WD by sending signal SIGUSR2 */
-		kill(com_pack.other_proc_pid, SIGUSR2);
+		/* stop WD - SIGUSR2, then SIGTERM & SIGKILL if it doesn't end */
+		TerminatePeer(&com_pack);
 		
 		/* free resources */
 		SchedulerDestroyWrapper();
 	}
 	
+	FlightClose();
+	
 	#ifndef NDEBUG
 	printf("\n***ComThread is dead***\n\n");
 	#endif
@@ -112,72 +130,67 @@ static void *ComThread(void *argv)
 	routine with WD. */
 static void InitCom(com_pack_t *com_pack)
 {
-	pid_t *wd_pid = NULL;
+	int spawned_by_wd = FALSE;
 	
 	assert(com_pack);
 	
-	/* set local vairable */
-	wd_pid = &(com_pack->other_proc_pid);
-	
-	/*  define the behaviour when SIGUSR1 is received (call SigHandZeroCounter when
-		received) */
-	com_pack->sig_1.sa_handler = SigHandZeroCounter;
-	sigaction(SIGUSR1, &(com_pack->sig_1), NULL);
-	
-	/* set mask (used later by sigsuspend) */
+	/* set mask - SIGUSR1 is received through a signalfd */
 	sigemptyset(&(com_pack->mask));
 	sigaddset(&(com_pack->mask), SIGUSR1);
 	
 	/* saves the path to WD */
 	com_pack->who_to_revive = "wd_outer.out";
 	
+	/*	checks whether this proc was revived by a WD - then its pid & config
+		come with its hello */
+	com_pack->role = ROLE_APP;
+	InitConfig(&(com_pack->config));
+	spawned_by_wd = (SUCCESS == AcceptHandshake(com_pack));
+	
+	/* the flight log is optional - failing to open it only disables it */
+	FlightOpen(NULL);
+	FlightLog(FL_START, spawned_by_wd ? com_pack->other_proc_pid : 0, 0,
+			  "app");
+	
+	/*	real-time mode (opt-in) for this thread only - the rest of the app
+		keeps its scheduling. locked memory is for the whole app */
+	RTApply(&(com_pack->config.rt), "app");
+	
 	/* create a scheduler & load it with tasks + check */
-	if (SUCCESS == InitScheduler(com_pack))
+	if (SUCCESS == InitSignals(com_pack) &&
+		SUCCESS == InitScheduler(com_pack))
 	{
-		g_keep_me_alive_status = SUCCESS;
-									  
-		/* checks whether WD is allready alive */
-		if (NULL == getenv("WD_ALIVE"))
+		if (!spawned_by_wd)
 		/* wd is not alive yet */
 		{
-			/*	marking that now there is a watchdog alive by setting a new
-				enviroment variable.
-				in case fork will fail - the env will be deleted */
-			setenv("WD_ALIVE", "1", 0);
-			
 			#ifndef NDEBUG
 			printf("APP: create WD\n");
 			#endif
 			
 			/*  create watchdog & saves the new pid into 
-				com_pack->other_proc_pid via the pointer. */
-			*wd_pid = fork();
-			if (*wd_pid == 0)
-			/* child */
-			{
-				execv(com_pack->who_to_revive, com_pack->argv);
-			}
-			else if (*wd_pid < 0)
+				com_pack->other_proc_pid */
+			if (SUCCESS != SpawnOtherProc(com_pack))
 			/* if fork failed */
 			{
-				unsetenv("WD_ALIVE");
-				g_keep_me_alive_status = FAILURE;
 				return;
 			}
 			
-			/* waits untill WD sends a signal */
-			WaitForSignal(com_pack);
+			/*	waits for the hello of the WD. if it doesn't come in time,
+				MainLoop revives the WD */
+			AwaitPeerReady(com_pack, REVIVE_READY_TIMEOUT);
 		}
 		else
 		/* WD allready alive */
 		{
-			/* WD is the parent right now */
-			*wd_pid = getppid();
-			
 			#ifndef NDEBUG
 			printf("WD is allready alive. pid: %d\n", com_pack->other_proc_pid);
 			#endif
+			
+			WatchPeer(com_pack);
+			SendReady(com_pack);
 		}
+		
+		atomic_store(&g_keep_me_alive_status, SUCCESS);
 	}
 }
 
@@ -187,11 +200,25 @@ static void InitCom(com_pack_t *com_pack)
 *******************************************************************************/
 void WDLetMeDie(void)
 {
+	/* the next instance will know the state was left consistent */
+	StateDetach();
+	
 	/* stop the main loop */
 	StopMainLoop();
 }
 
 
+/******************************************************************************
+*							WDAttachState
+*******************************************************************************/
+wd_state_header_t *WDAttachState(const char *name, size_t size)
+{
+	assert(name);
+	
+	return (StateAttach(name, size));
+}
+
+
 
 
 
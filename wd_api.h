@@ -8,7 +8,10 @@
 #ifndef _WATCHDOG_H_
 #define _WATCHDOG_H_
 
+#include <stddef.h>		/* size_t */
+
 #include "./utils/general_types.h"  
+#include "wd_state.h"
 
 /***************************** WDKeepMeAlive **********************************/
 /*
@@ -28,7 +31,28 @@ status_t WDKeepMeAlive(int argc, char *const argv[]);
 /******************************* WDLetMeDie ***********************************/
 /*
  * description  :  Terminates WDKeepMeAlive application protection.
+ *				   Marks a clean shutdown in the state region (if attached).
  */
 void WDLetMeDie(void);
 
+/***************************** WDAttachState **********************************/
+/*
+ * description  :  Attaches a shared-memory region which outlives the
+ *				   application - the WD keeps it, and hands it to every
+ *				   revived instance. Lets a revived instance reuse warm
+ *				   state (caches) instead of rebuilding it.
+ *				   Call after WDKeepMeAlive. A new region is zero-filled.
+ *				   A region made by another name or size is replaced.
+ *
+ * input		:  name - identifies the region (up to 31 characters).
+ *				   size - of the data in bytes.
+ *
+ * return value :  on success - the header of the region: its generation
+ *				   (1 in a new region) and whether the previous instance
+ *				   ended cleanly (by WDLetMeDie). the data follows it -
+ *				   STATE_DATA(header).
+ *				   on failure - NULL.
+ */
+wd_state_header_t *WDAttachState(const char *name, size_t size);
+
 #endif /* _WATCHDOG_H_ */
@@ -0,0 +1,347 @@
+/*******************************************************************************
+*	Filename	:	wd_beats.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	heartbeat table source file. the scan is done a word of
+					the bitmap (64 slots) at a time, by the widest kernel
+					the CPU runs.
+*******************************************************************************/
+#define _GNU_SOURCE				/* memfd_create */
+
+#include <assert.h> 		/* assert */
+#include <unistd.h>			/* ftruncate, close */
+#include <sys/mman.h>		/* memfd_create, mmap, munmap */
+#include <sys/stat.h>		/* fstat */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BEATS_X86
+#include <immintrin.h>		/* AVX2 & SSE4.2 intrinsics */
+#endif
+
+#include "wd_beats.h"
+
+/******************************* MACROS ***************************************/
+/*	the times are compared as signed 64-bit (the only compare of the vector
+	units). the beats are before it, so a later deadline means nothing more */
+#define MAX_DEADLINE_US ((uint64_t)INT64_MAX)
+
+#define TIMES(table) ((_Atomic uint64_t *)((char *)(table) + \
+										   sizeof(wd_beats_t)))
+#define SEQS(table) (TIMES(table) + (table)->capacity)
+
+/************************** internal functions ********************************/
+/*	the expired slots among 64 times - bit i for times[i]. times is on a
+	cache line */
+typedef uint64_t (*expired_word_t)(const uint64_t *times, uint64_t deadline_us);
+
+static uint64_t ExpiredWord(const uint64_t *times, uint64_t deadline_us);
+#ifdef BEATS_X86
+static uint64_t ExpiredWordSse42(const uint64_t *times, uint64_t deadline_us);
+static uint64_t ExpiredWordAvx2(const uint64_t *times, uint64_t deadline_us);
+#endif
+
+/*	the widest kernel the CPU runs */
+static expired_word_t ChooseKernel(void);
+
+/*	kernel if the CPU runs it, NULL otherwise */
+static expired_word_t KernelOf(beats_kernel_t kernel);
+
+/*	the size of the region of a table of capacity slots */
+static size_t RegionSize(uint64_t capacity);
+
+/******************************* globals **************************************/
+/*	set by BeatsUseKernel - NULL is the widest */
+static expired_word_t g_kernel = NULL;
+
+/******************************************************************************
+*							BeatsCreate
+*******************************************************************************/
+wd_beats_t *BeatsCreate(size_t slots, int *fd)
+{
+	wd_beats_t *table = NULL;
+	uint64_t capacity = 0;
+	
+	assert(fd);
+	
+	/* whole words - the scan has no tail. a new memfd is all zeros - free */
+	capacity = ((slots + BEATS_PER_WORD - 1) / BEATS_PER_WORD) *
+			   BEATS_PER_WORD;
+	capacity = (0 == capacity) ? BEATS_PER_WORD : capacity;
+	
+	*fd = memfd_create("wd_beats", MFD_CLOEXEC);
+	if (0 > *fd)
+	{
+		return (NULL);
+	}
+	
+	if (0 == ftruncate(*fd, (off_t)RegionSize(capacity)))
+	{
+		table = mmap(NULL, RegionSize(capacity), PROT_READ | PROT_WRITE,
+					 MAP_SHARED, *fd, 0);
+	}
+	if (NULL == table || MAP_FAILED == table)
+	{
+		close(*fd);
+		*fd = -1;
+		
+		return (NULL);
+	}
+	
+	table->magic = BEATS_MAGIC;
+	table->version = BEATS_VERSION;
+	table->capacity = capacity;
+	
+	return (table);
+}
+
+
+/******************************************************************************
+*							BeatsAttach
+*******************************************************************************/
+wd_beats_t *BeatsAttach(int fd)
+{
+	struct stat stat_buf = {0};
+	wd_beats_t *table = NULL;
+	
+	if (0 != fstat(fd, &stat_buf) ||
+		(off_t)sizeof(wd_beats_t) > stat_buf.st_size)
+	{
+		return (NULL);
+	}
+	
+	table = mmap(NULL, (size_t)stat_buf.st_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd, 0);
+	if (MAP_FAILED == table)
+	{
+		return (NULL);
+	}
+	
+	if (BEATS_MAGIC != table->magic || BEATS_VERSION != table->version ||
+		0 != table->capacity % BEATS_PER_WORD ||
+		(off_t)RegionSize(table->capacity) != stat_buf.st_size)
+	{
+		munmap(table, (size_t)stat_buf.st_size);
+		
+		return (NULL);
+	}
+	
+	return (table);
+}
+
+
+/******************************************************************************
+*							BeatsDetach
+*******************************************************************************/
+void BeatsDetach(wd_beats_t *table)
+{
+	assert(table);
+	
+	munmap(table, RegionSize(table->capacity));
+}
+
+
+/******************************************************************************
+*							BeatsBeat
+*******************************************************************************/
+void BeatsBeat(wd_beats_t *table, size_t slot, uint64_t now_us)
+{
+	assert(table);
+	assert(slot < table->capacity);
+	assert(0 != now_us);
+	assert(MAX_DEADLINE_US > now_us);
+	
+	atomic_fetch_add_explicit(&SEQS(table)[slot], 1, memory_order_relaxed);
+	atomic_store_explicit(&TIMES(table)[slot], now_us, memory_order_release);
+}
+
+
+/******************************************************************************
+*							BeatsFree
+*******************************************************************************/
+void BeatsFree(wd_beats_t *table, size_t slot)
+{
+	assert(table);
+	assert(slot < table->capacity);
+	
+	atomic_store_explicit(&TIMES(table)[slot], 0, memory_order_release);
+}
+
+
+/******************************************************************************
+*							BeatsSeq
+*******************************************************************************/
+uint64_t BeatsSeq(const wd_beats_t *table, size_t slot)
+{
+	assert(table);
+	assert(slot < table->capacity);
+	
+	return (atomic_load_explicit(&SEQS(table)[slot], memory_order_relaxed));
+}
+
+
+/******************************************************************************
+*							BeatsScan
+*******************************************************************************/
+size_t BeatsScan(const wd_beats_t *table, uint64_t deadline_us,
+				 uint64_t *expired)
+{
+	expired_word_t expired_word = (NULL != g_kernel) ? g_kernel :
+								  ChooseKernel();
+	const uint64_t *times = NULL;
+	size_t count = 0;
+	size_t i = 0;
+	
+	assert(table);
+	assert(expired);
+	
+	/*	the times are read as plain words - each is an aligned 8-byte load,
+		so a beat written meanwhile is seen whole or not at all */
+	times = (const uint64_t *)TIMES(table);
+	deadline_us = (MAX_DEADLINE_US < deadline_us) ? MAX_DEADLINE_US :
+				  deadline_us;
+	
+	for (i = 0; i < BEATS_WORDS(table); ++i)
+	{
+		expired[i] = expired_word(times + i * BEATS_PER_WORD, deadline_us);
+		count += (size_t)__builtin_popcountll(expired[i]);
+	}
+	
+	return (count);
+}
+
+
+/******************************************************************************
+*							BeatsUseKernel
+*******************************************************************************/
+int BeatsUseKernel(beats_kernel_t kernel)
+{
+	expired_word_t expired_word = KernelOf(kernel);
+	
+	if (NULL == expired_word)
+	{
+		return (FAILURE);
+	}
+	
+	g_kernel = (BEATS_KERNEL_AUTO == kernel) ? NULL : expired_word;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** ExpiredWord **************************************/
+static uint64_t ExpiredWord(const uint64_t *times, uint64_t deadline_us)
+{
+	uint64_t word = 0;
+	size_t i = 0;
+	
+	/* no branches - the compiler may still vectorize it */
+	for (i = 0; i < BEATS_PER_WORD; ++i)
+	{
+		word |= (uint64_t)((0 != times[i]) & (times[i] < deadline_us)) << i;
+	}
+	
+	return (word);
+}
+
+
+#ifdef BEATS_X86
+/*************************** ExpiredWordSse42 *********************************/
+__attribute__((target("sse4.2")))
+static uint64_t ExpiredWordSse42(const uint64_t *times, uint64_t deadline_us)
+{
+	__m128i deadline = _mm_set1_epi64x((long long)deadline_us);
+	__m128i zero = _mm_setzero_si128();
+	__m128i lanes = zero;
+	__m128i is_expired = zero;
+	uint64_t word = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < BEATS_PER_WORD; i += 2)
+	{
+		lanes = _mm_load_si128((const __m128i *)(times + i));
+		is_expired = _mm_andnot_si128(_mm_cmpeq_epi64(lanes, zero),
+									  _mm_cmpgt_epi64(deadline, lanes));
+		word |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(is_expired)) << i;
+	}
+	
+	return (word);
+}
+
+
+/*************************** ExpiredWordAvx2 **********************************/
+__attribute__((target("avx2")))
+static uint64_t ExpiredWordAvx2(const uint64_t *times, uint64_t deadline_us)
+{
+	__m256i deadline = _mm256_set1_epi64x((long long)deadline_us);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i lanes = zero;
+	__m256i is_expired = zero;
+	uint64_t word = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < BEATS_PER_WORD; i += 4)
+	{
+		lanes = _mm256_load_si256((const __m256i *)(times + i));
+		is_expired = _mm256_andnot_si256(_mm256_cmpeq_epi64(lanes, zero),
+										 _mm256_cmpgt_epi64(deadline, lanes));
+		word |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(is_expired))
+				<< i;
+	}
+	
+	return (word);
+}
+#endif
+
+
+/*************************** ChooseKernel *************************************/
+static expired_word_t ChooseKernel(void)
+{
+#ifdef BEATS_X86
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return (ExpiredWordAvx2);
+	}
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		return (ExpiredWordSse42);
+	}
+#endif
+	
+	return (ExpiredWord);
+}
+
+
+/*************************** KernelOf *****************************************/
+static expired_word_t KernelOf(beats_kernel_t kernel)
+{
+	switch (kernel)
+	{
+		case BEATS_KERNEL_AUTO:
+			return (ChooseKernel());
+		
+		case BEATS_KERNEL_SCALAR:
+			return (ExpiredWord);
+		
+#ifdef BEATS_X86
+		case BEATS_KERNEL_SSE42:
+			return (__builtin_cpu_supports("sse4.2") ? ExpiredWordSse42 : NULL);
+		
+		case BEATS_KERNEL_AVX2:
+			return (__builtin_cpu_supports("avx2") ? ExpiredWordAvx2 : NULL);
+#endif
+		
+		default:
+			return (NULL);
+	}
+}
+
+
+/*************************** RegionSize ***************************************/
+static size_t RegionSize(uint64_t capacity)
+{
+	/* times & seqs */
+	return (sizeof(wd_beats_t) + 2 * capacity * sizeof(uint64_t));
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * File name  : wd_beats.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: heartbeat table - shared memory (a memfd) with a slot per
+ *				supervised proc. the slots are kept as arrays (the beat
+ *				times, then the beat counts), so checking them all is one
+ *				pass over contiguous memory - by AVX2 / SSE4.2 when the CPU
+ *				has them, and by plain code otherwise.
+ ******************************************************************************/
+#ifndef _WD_BEATS_H_
+#define _WD_BEATS_H_
+
+#include <stddef.h>			/* size_t */
+#include <stdint.h>			/* uint32_t, uint64_t */
+#include <stdatomic.h>		/* _Atomic */
+
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+#define BEATS_MAGIC (0x57444231)	/* "WDB1" */
+#define BEATS_VERSION (1)			/* of the layout below */
+#define BEATS_PER_WORD (64)			/* slots per word of a bitmap */
+
+/*	the words of a bitmap of all the slots of a table */
+#define BEATS_WORDS(table) ((table)->capacity / BEATS_PER_WORD)
+
+/*** structures ***/
+/*	the kernels of the scan - all give the same bits */
+typedef enum beats_kernel
+{
+	BEATS_KERNEL_AUTO,		/* the widest the CPU runs - the default */
+	BEATS_KERNEL_SCALAR,
+	BEATS_KERNEL_SSE42,
+	BEATS_KERNEL_AVX2
+} beats_kernel_t;
+
+/*	the head of the region. the arrays follow it - times[capacity], then
+	seqs[capacity] - each on a cache line of its own. a time of 0 is a free
+	slot */
+typedef struct wd_beats_s
+{
+	uint32_t	magic;			/* BEATS_MAGIC */
+	uint32_t	version;		/* BEATS_VERSION */
+	uint64_t	capacity;		/* slots - a multiple of BEATS_PER_WORD */
+	char		reserved[48];
+} wd_beats_t;
+
+/* the arrays start on a cache line */
+typedef char beats_header_size_check[(64 == sizeof(wd_beats_t)) ? 1 : -1];
+
+/******************************* BeatsCreate **********************************/
+/*
+ * description  :  creates a table of (at least) slots free slots, and
+ *				   returns the fd of its region in *fd - to be handed to
+ *				   the procs (BeatsAttach) & closed.
+ *
+ * return value :  the table. NULL on failure.
+ */
+wd_beats_t *BeatsCreate(size_t slots, int *fd);
+
+/******************************* BeatsAttach **********************************/
+/*
+ * description  :  maps the table of fd (made by BeatsCreate, maybe by another
+ *				   proc). the fd may be closed afterwards.
+ *
+ * return value :  the table. NULL if fd isn't a table.
+ */
+wd_beats_t *BeatsAttach(int fd);
+
+/******************************* BeatsDetach **********************************/
+/*
+ * description  :  unmaps the table from this proc.
+ */
+void BeatsDetach(wd_beats_t *table);
+
+/******************************** BeatsBeat ***********************************/
+/*
+ * description  :  records a beat of slot at now_us (not 0, below INT64_MAX)
+ *				   & counts it.
+ *				   each slot has one writer - its proc.
+ */
+void BeatsBeat(wd_beats_t *table, size_t slot, uint64_t now_us);
+
+/******************************** BeatsFree ***********************************/
+/*
+ * description  :  frees slot - it isn't expired by any deadline.
+ */
+void BeatsFree(wd_beats_t *table, size_t slot);
+
+/******************************** BeatsSeq ************************************/
+/*
+ * description  :  returns the beats counted in slot, so a stuck proc which
+ *				   keeps an old time can be told from a live one.
+ */
+uint64_t BeatsSeq(const wd_beats_t *table, size_t slot);
+
+/******************************** BeatsScan ***********************************/
+/*
+ * description  :  sets bit i % 64 of expired[i / 64] for every slot i in
+ *				   use whose last beat is before deadline_us (e.g. now minus
+ *				   the timeout), and clears the bits of the others. one pass
+ *				   over the times - under 1 ns per slot by AVX2.
+ *
+ * input		:  expired - BEATS_WORDS(table) words.
+ *
+ * return value :  the number of expired slots.
+ */
+size_t BeatsScan(const wd_beats_t *table, uint64_t deadline_us,
+				 uint64_t *expired);
+
+/****************************** BeatsUseKernel ********************************/
+/*
+ * description  :  the kernel of the next scans of this proc - for the tests
+ *				   & the benchmark. not thread-safe - set it before scanning.
+ *
+ * return value :  SUCCESS, or FAILURE if the CPU doesn't run kernel (the
+ *				   kernel is unchanged).
+ */
+int BeatsUseKernel(beats_kernel_t kernel);
+
+#endif /* _WD_BEATS_H_ */
@@ -0,0 +1,174 @@
+/*******************************************************************************
+*	Filename :		wd_beats_bench.c
+*	Developer :		Eyal Weizman
+*	Last Update :	2020-03-08
+*	Description :	heartbeat table benchmark - a scan of 10k slots by every
+*					kernel the CPU runs, head to head. the slots beat at
+*					random times & a quarter of them are free, so every
+*					kernel must find the same expired ones.
+*					usage: beats_bench.out [scans]
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* clock_gettime */
+
+#include <stdio.h> 		/* printf */
+#include <stdlib.h>		/* strtoul */
+#include <stdint.h>		/* uint64_t */
+#include <time.h>		/* clock_gettime */
+#include <unistd.h>		/* close */
+
+#include "wd_beats.h"
+
+
+/*** MACROS ***/
+#define SLOTS (10000)
+#define DEFAULT_SCANS (100000)
+#define NS_IN_SEC (1000000000.0)
+#define SEED (0x2545F4914F6CDD1DULL)
+#define SPAN_US (1000000)			/* the beats are within a second */
+
+/*** structures ***/
+typedef struct kernel
+{
+	const char *name;
+	beats_kernel_t kernel;
+} kernel_t;
+
+/*** benchmark functions ***/
+/*	runs scans scans of table, each to another deadline. returns the ns of one
+	scan, or a negative value if the CPU doesn't run the kernel */
+static double RunKernel(const wd_beats_t *table, beats_kernel_t kernel,
+						size_t scans, uint64_t *checksum);
+
+/*** internal functions ***/
+static uint64_t NextRandom(uint64_t *state);
+static double Now(void);
+
+
+/*****************************************************************************
+*								main
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+	kernel_t kernels[] =
+	{
+		{"scalar",	BEATS_KERNEL_SCALAR},
+		{"sse4.2",	BEATS_KERNEL_SSE42},
+		{"avx2",	BEATS_KERNEL_AVX2}
+	};
+	wd_beats_t *table = NULL;
+	size_t scans = DEFAULT_SCANS;
+	uint64_t state = SEED;
+	uint64_t scalar_checksum = 0;
+	uint64_t checksum = 0;
+	double scalar_ns = 0;
+	double ns = 0;
+	int fd = -1;
+	size_t i = 0;
+	
+	if (1 < argc)
+	{
+		scans = strtoul(argv[1], NULL, 10);
+	}
+	
+	table = BeatsCreate(SLOTS, &fd);
+	if (NULL == table)
+	{
+		printf("no table\n");
+		
+		return (1);
+	}
+	
+	for (i = 0; i < table->capacity; ++i)
+	{
+		BeatsBeat(table, i, SPAN_US + NextRandom(&state) % SPAN_US);
+		if (0 == NextRandom(&state) % 4)
+		{
+			BeatsFree(table, i);
+		}
+	}
+	
+	printf("\n***** BEATS BENCHMARK: THE SCAN KERNELS *****\n\n");
+	printf("%lu slots, %lu scans per kernel\n\n",
+		   (unsigned long)table->capacity, (unsigned long)scans);
+	printf("%-10s %12s %12s %8s\n", "kernel", "ns/scan", "ns/slot",
+		   "speedup");
+	
+	scalar_ns = RunKernel(table, BEATS_KERNEL_SCALAR, scans, &scalar_checksum);
+	for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+	{
+		ns = RunKernel(table, kernels[i].kernel, scans, &checksum);
+		if (0 > ns)
+		{
+			printf("%-10s %12s\n", kernels[i].name, "(no CPU)");
+			continue;
+		}
+		
+		printf("%-10s %12.1f %12.3f %7.2fx%s\n", kernels[i].name, ns,
+			   ns / (double)table->capacity, scalar_ns / ns,
+			   (checksum == scalar_checksum) ? "" : "  FAIL");
+	}
+	
+	BeatsUseKernel(BEATS_KERNEL_AUTO);
+	BeatsDetach(table);
+	close(fd);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								benchmark
+*******************************************************************************/
+
+/***************************** RunKernel **************************************/
+static double RunKernel(const wd_beats_t *table, beats_kernel_t kernel,
+						size_t scans, uint64_t *checksum)
+{
+	uint64_t expired[(SLOTS + BEATS_PER_WORD - 1) / BEATS_PER_WORD] = {0};
+	double start = 0;
+	size_t i = 0;
+	
+	if (SUCCESS != BeatsUseKernel(kernel))
+	{
+		return (-1);
+	}
+	
+	/*	the counts & a bit of the bitmaps are summed - every kernel must
+		find the same slots (the same deadlines are scanned in order) */
+	*checksum = 0;
+	start = Now();
+	for (i = 0; i < scans; ++i)
+	{
+		*checksum += BeatsScan(table, SPAN_US + i % SPAN_US, expired);
+		*checksum += expired[i % BEATS_WORDS(table)] & 1;
+	}
+	
+	return ((Now() - start) * NS_IN_SEC / (double)scans);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+
+/*************************** NextRandom ***************************************/
+static uint64_t NextRandom(uint64_t *state)
+{
+	/* xorshift64 - the same table on every run */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	
+	return (*state);
+}
+
+
+/*************************** Now **********************************************/
+static double Now(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return ((double)now.tv_sec + (double)now.tv_nsec / NS_IN_SEC);
+}
@@ -0,0 +1,296 @@
+/******************************************************************************
+*	Filename	:	wd_beats_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	heartbeat table test file - every kernel of the scan
+*					against the plain compare, on random tables
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+#include <stdint.h>		/* uint64_t, uintptr_t, INT64_MAX, UINT64_MAX */
+#include <unistd.h>		/* close */
+
+#include "wd_beats.h"
+#include "./utils/general_types.h"
+
+/******************************* MACROS ***************************************/
+#define SLOTS (10 * BEATS_PER_WORD)
+#define TABLES (50)
+#define SEED (0x2545F4914F6CDD1DULL)
+#define AVX2_ALIGN (32)				/* of _mm256_load_si256 */
+#define TIME_BITS (40)				/* of the random times - 12 days of us */
+#define WIDE_BIT (1ULL << TIME_BITS)
+
+/************************** unit-test functions *******************************/
+void BeatsAlignTest(void);
+void BeatsFreeSlotsTest(void);
+void BeatsKernelsTest(void);
+
+/*************************** helper functions *********************************/
+/*	beats a random time in every slot, and frees about a quarter of them.
+	some times are just below INT64_MAX - the latest a beat may be */
+static void FillRandom(wd_beats_t *table, uint64_t *state);
+
+/*	the bits & count BeatsScan should give - by the plain compare */
+static size_t Expected(const uint64_t *times, size_t capacity,
+					   uint64_t deadline_us, uint64_t *expired);
+
+/*	scans table by kernel & compares it with Expected. TRUE if all agree */
+static int IsScanLikeExpected(const wd_beats_t *table, beats_kernel_t kernel,
+							  const uint64_t *times, uint64_t *state);
+
+static uint64_t NextRandom(uint64_t *state);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR BEATS'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	BeatsAlignTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	BeatsFreeSlotsTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	BeatsKernelsTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* BeatsAlignTest *************************************/
+void BeatsAlignTest(void)
+{
+	wd_beats_t *table = NULL;
+	wd_beats_t *attached = NULL;
+	int fd = -1;
+	
+	printf("Create + Attach (aligned times):\t");
+	
+	table = BeatsCreate(SLOTS + 1, &fd);
+	attached = (NULL != table) ? BeatsAttach(fd) : NULL;
+	
+	/*	the times follow the header - both mappings must keep them on the
+		alignment of the widest load */
+	(NULL != table)												&&
+	(NULL != attached)											&&
+	(SLOTS + BEATS_PER_WORD == table->capacity)					&&
+	(table->capacity == attached->capacity)						&&
+	(0 == (uintptr_t)(table + 1) % AVX2_ALIGN)					&&
+	(0 == (uintptr_t)(attached + 1) % AVX2_ALIGN)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	if (NULL != attached)
+	{
+		BeatsDetach(attached);
+	}
+	if (NULL != table)
+	{
+		BeatsDetach(table);
+		close(fd);
+	}
+}
+
+
+/************************* BeatsFreeSlotsTest *********************************/
+void BeatsFreeSlotsTest(void)
+{
+	uint64_t expired[SLOTS / BEATS_PER_WORD] = {0};
+	wd_beats_t *table = NULL;
+	size_t all_free = 1;
+	size_t two_beats = 0;
+	size_t freed = 0;
+	int fd = -1;
+	
+	printf("Free slots (never expired):\t\t");
+	
+	table = BeatsCreate(SLOTS, &fd);
+	if (NULL == table)
+	{
+		printf("FAIL");
+		
+		return;
+	}
+	
+	/*	a new table is all free - not even the latest deadline expires it */
+	all_free = BeatsScan(table, UINT64_MAX, expired);
+	
+	BeatsBeat(table, 0, 1);
+	BeatsBeat(table, SLOTS - 1, INT64_MAX - 1);
+	two_beats = BeatsScan(table, UINT64_MAX, expired);
+	
+	BeatsFree(table, 0);
+	freed = BeatsScan(table, UINT64_MAX, expired);
+	
+	(0 == all_free)						&&
+	(2 == two_beats)					&&
+	(1 == freed)						&&
+	(0 == (expired[0] & 1))				&&
+	(1 == BeatsSeq(table, 0))			&&
+	(1 == BeatsSeq(table, SLOTS - 1))	&&
+	(0 == BeatsSeq(table, 1))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	BeatsDetach(table);
+	close(fd);
+}
+
+
+/************************* BeatsKernelsTest ***********************************/
+void BeatsKernelsTest(void)
+{
+	beats_kernel_t kernels[] = {BEATS_KERNEL_SCALAR, BEATS_KERNEL_SSE42,
+								BEATS_KERNEL_AVX2, BEATS_KERNEL_AUTO};
+	const char *names[] = {"scalar", "sse4.2", "avx2", "auto"};
+	wd_beats_t *table = NULL;
+	uint64_t state = SEED;
+	int is_like_expected = TRUE;
+	int fd = -1;
+	size_t t = 0;
+	size_t k = 0;
+	
+	printf("Scan (every kernel as plain code):\t");
+	
+	table = BeatsCreate(SLOTS, &fd);
+	if (NULL == table)
+	{
+		printf("FAIL");
+		
+		return;
+	}
+	
+	for (t = 0; t < TABLES; ++t)
+	{
+		FillRandom(table, &state);
+		for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+		{
+			is_like_expected &= IsScanLikeExpected(table, kernels[k],
+							(const uint64_t *)(table + 1), &state);
+		}
+	}
+	BeatsUseKernel(BEATS_KERNEL_AUTO);
+	
+	(TRUE == is_like_expected)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	/* a kernel the CPU lacks is skipped - say so */
+	for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+	{
+		if (SUCCESS != BeatsUseKernel(kernels[k]))
+		{
+			printf(" (no %s)", names[k]);
+		}
+	}
+	BeatsUseKernel(BEATS_KERNEL_AUTO);
+	
+	BeatsDetach(table);
+	close(fd);
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* FillRandom *****************************************/
+static void FillRandom(wd_beats_t *table, uint64_t *state)
+{
+	uint64_t now_us = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < table->capacity; ++i)
+	{
+		now_us = 1 + NextRandom(state) % WIDE_BIT;
+		now_us = (0 == NextRandom(state) % 8) ? INT64_MAX - 1 - now_us % 4 :
+				 now_us;
+		BeatsBeat(table, i, now_us);
+		if (0 == NextRandom(state) % 4)
+		{
+			BeatsFree(table, i);
+		}
+	}
+}
+
+
+/************************* Expected *******************************************/
+static size_t Expected(const uint64_t *times, size_t capacity,
+					   uint64_t deadline_us, uint64_t *expired)
+{
+	size_t count = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < capacity; ++i)
+	{
+		if (0 == i % BEATS_PER_WORD)
+		{
+			expired[i / BEATS_PER_WORD] = 0;
+		}
+		if (0 != times[i] && times[i] < deadline_us)
+		{
+			expired[i / BEATS_PER_WORD] |= 1ULL << (i % BEATS_PER_WORD);
+			++count;
+		}
+	}
+	
+	return (count);
+}
+
+
+/************************* IsScanLikeExpected *********************************/
+static int IsScanLikeExpected(const wd_beats_t *table, beats_kernel_t kernel,
+							  const uint64_t *times, uint64_t *state)
+{
+	/*	past the latest beats - deadlines above INT64_MAX must not wrap into
+		the past of the signed compare */
+	uint64_t deadlines[] = {0, 1, 0, 0, WIDE_BIT, INT64_MAX - 3, INT64_MAX,
+							(uint64_t)INT64_MAX + 1, UINT64_MAX - 1,
+							UINT64_MAX};
+	uint64_t expired[SLOTS / BEATS_PER_WORD] = {0};
+	uint64_t expected[SLOTS / BEATS_PER_WORD] = {0};
+	size_t count = 0;
+	int is_same = TRUE;
+	size_t d = 0;
+	size_t i = 0;
+	
+	if (SUCCESS != BeatsUseKernel(kernel))
+	{
+		return (TRUE);
+	}
+	
+	deadlines[2] = 1 + NextRandom(state) % WIDE_BIT;
+	deadlines[3] = 1 + NextRandom(state) % WIDE_BIT;
+	
+	for (d = 0; d < sizeof(deadlines) / sizeof(deadlines[0]); ++d)
+	{
+		count = BeatsScan(table, deadlines[d], expired);
+		is_same &= (count == Expected(times, table->capacity, deadlines[d],
+									  expected));
+		for (i = 0; i < BEATS_WORDS(table); ++i)
+		{
+			is_same &= (expired[i] == expected[i]);
+		}
+	}
+	
+	return (is_same);
+}
+
+
+/************************* NextRandom *****************************************/
+static uint64_t NextRandom(uint64_t *state)
+{
+	/* xorshift64 - the same tables on every run */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	
+	return (*state);
+}
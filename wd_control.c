@@ -0,0 +1,358 @@
+/*******************************************************************************
+*	Filename	:	wd_control.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	control socket source file. the sockets are non-blocking,
+					and a client is read a frame at a time (header, then
+					body), so a frame left unread is still in the socket and
+					poll wakes the scheduler for it after the due critical
+					tasks (the beats & the checks) have run.
+*******************************************************************************/
+#define _GNU_SOURCE				/* accept4, struct ucred */
+
+#include <assert.h> 		/* assert */
+#include <errno.h>			/* errno */
+#include <poll.h>			/* POLLIN, POLLHUP */
+#include <string.h>			/* strlen, memcpy */
+#include <unistd.h>			/* close, unlink, getuid */
+#include <sys/socket.h>		/* socket, bind, listen, accept4 */
+#include <sys/stat.h>		/* chmod, S_IRUSR */
+#include <sys/un.h>			/* struct sockaddr_un */
+
+#include "wd_control.h"
+#include "wd_sock.h"
+
+/******************************* MACROS ***************************************/
+#define FRAME_SIZE (sizeof(ctl_header_t) + CTL_MAX_BODY)
+#define BACKLOG (CTL_MAX_CLIENTS)
+#define UNUSED(x) ((void) x)
+
+/***************************** structures *************************************/
+/*	a connected client. fd -1 - a free slot */
+typedef struct client_s
+{
+	int			fd;
+	uint32_t	received;		/* bytes of the frame in frame */
+	unsigned char frame[FRAME_SIZE];
+} client_t;
+
+/************************* global variable ************************************/
+static int g_listen_fd = -1;
+static struct sockaddr_un g_addr;
+static scheduler_t *g_sched = NULL;
+static ctl_request_t g_request = NULL;
+static void *g_request_arg = NULL;
+static client_t g_clients[CTL_MAX_CLIENTS];
+
+/************************** internal functions ********************************/
+/*	fd handler of the listening socket - accepts the pending clients */
+static int ListenHandler(int fd, short revents, void *arg);
+
+/*	fd handler of a client - serves up to CTL_BATCH of its requests. DONE
+	once it's disconnected */
+static int ClientHandler(int fd, short revents, void *arg);
+
+/*	reads the rest of the frame of client. returns 1 - a whole frame, 0 -
+	not yet, -1 - disconnected or not a frame */
+static int ReadFrame(client_t *client);
+
+/*	serves the frame of client and sends the reply. FAILURE - disconnect */
+static status_t Serve(client_t *client);
+static status_t Reply(int fd, uint8_t op, uint8_t status,
+					  const void *body, uint32_t size);
+
+static int IsSameUser(int fd);
+static void Disconnect(client_t *client);
+
+
+/******************************************************************************
+*							ControlOpen
+*******************************************************************************/
+status_t ControlOpen(scheduler_t *sched, const char *path,
+					 ctl_request_t request, void *arg)
+{
+	int error = 0;
+	int i = 0;
+	
+	assert(sched);
+	assert(path);
+	assert(request);
+	
+	if (0 <= g_listen_fd)
+	{
+		errno = EALREADY;
+		
+		return (FAILURE);
+	}
+	if (strlen(path) >= sizeof(g_addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		
+		return (FAILURE);
+	}
+	
+	for (i = 0; i < CTL_MAX_CLIENTS; ++i)
+	{
+		g_clients[i].fd = -1;
+	}
+	
+	memset(&g_addr, 0, sizeof(g_addr));
+	g_addr.sun_family = AF_UNIX;
+	memcpy(g_addr.sun_path, path, strlen(path));
+	
+	/* the socket of a live WD (EADDRINUSE), and anything else, is kept */
+	if (SUCCESS != SockRemoveStale(&g_addr))
+	{
+		return (FAILURE);
+	}
+	
+	g_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+						 0);
+	if (0 > g_listen_fd)
+	{
+		return (FAILURE);
+	}
+	
+	/* the path isn't ours until bound - it isn't removed */
+	if (0 != bind(g_listen_fd, (struct sockaddr *)&g_addr, sizeof(g_addr)))
+	{
+		close(g_listen_fd);
+		g_listen_fd = -1;
+		
+		return (FAILURE);
+	}
+	
+	if (0 != chmod(path, S_IRUSR | S_IWUSR) ||
+		0 != listen(g_listen_fd, BACKLOG) ||
+		SUCCESS != SchedulerAddFd(sched, g_listen_fd, POLLIN, ListenHandler,
+								  NULL))
+	{
+		error = errno;
+		ControlClose();
+		errno = error;
+		
+		return (FAILURE);
+	}
+	
+	g_sched = sched;
+	g_request = request;
+	g_request_arg = arg;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							ControlClose
+*******************************************************************************/
+void ControlClose(void)
+{
+	int i = 0;
+	
+	if (0 > g_listen_fd)
+	{
+		return;
+	}
+	
+	for (i = 0; i < CTL_MAX_CLIENTS; ++i)
+	{
+		if (0 <= g_clients[i].fd)
+		{
+			close(g_clients[i].fd);
+			g_clients[i].fd = -1;
+		}
+	}
+	
+	close(g_listen_fd);
+	g_listen_fd = -1;
+	unlink(g_addr.sun_path);
+	g_sched = NULL;
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** ListenHandler ************************************/
+/* this func is of type fd_func_t */
+static int ListenHandler(int fd, short revents, void *arg)
+{
+	client_t *client = NULL;
+	int client_fd = -1;
+	int i = 0;
+	
+	UNUSED(revents);
+	UNUSED(arg);
+	
+	while (0 <= (client_fd = accept4(fd, NULL, NULL,
+									 SOCK_NONBLOCK | SOCK_CLOEXEC)))
+	{
+		client = NULL;
+		for (i = 0; i < CTL_MAX_CLIENTS && NULL == client; ++i)
+		{
+			client = (0 > g_clients[i].fd) ? &g_clients[i] : NULL;
+		}
+		
+		/*	too many clients, or someone else's */
+		if (NULL == client || !IsSameUser(client_fd) ||
+			SUCCESS != SchedulerAddFd(g_sched, client_fd, POLLIN,
+									  ClientHandler, client))
+		{
+			close(client_fd);
+			continue;
+		}
+		
+		client->fd = client_fd;
+		client->received = 0;
+	}
+	
+	return (REPEAT);
+}
+
+
+/*************************** ClientHandler ************************************/
+/* this func is of type fd_func_t */
+static int ClientHandler(int fd, short revents, void *arg)
+{
+	client_t *client = (client_t *)arg;
+	int served = 0;
+	int status = 0;
+	
+	assert(arg);
+	UNUSED(fd);
+	UNUSED(revents);
+	
+	/*	a frame at a time - what's left waits in the socket until the fds
+		are collected again, after the critical tasks which are due */
+	for (served = 0; served < CTL_BATCH; ++served)
+	{
+		status = ReadFrame(client);
+		if (0 == status)
+		{
+			return (REPEAT);
+		}
+		if (0 > status || SUCCESS != Serve(client))
+		{
+			Disconnect(client);
+			
+			return (DONE);
+		}
+	}
+	
+	return (REPEAT);
+}
+
+
+/*************************** ReadFrame ****************************************/
+static int ReadFrame(client_t *client)
+{
+	const ctl_header_t *header = (const ctl_header_t *)client->frame;
+	uint32_t wanted = 0;
+	ssize_t got = 0;
+	
+	/*	the header, then its body - two reads at the most */
+	while (TRUE)
+	{
+		wanted = sizeof(ctl_header_t);
+		if (client->received >= wanted)
+		{
+			if (CTL_MAGIC != header->magic || CTL_MAX_BODY < header->length)
+			{
+				Reply(client->fd, header->op, CTL_BAD_REQUEST, NULL, 0);
+				
+				return (-1);
+			}
+			
+			wanted += header->length;
+			if (client->received == wanted)
+			{
+				return (1);
+			}
+		}
+		
+		got = recv(client->fd, client->frame + client->received,
+				   wanted - client->received, 0);
+		if (0 > got)
+		{
+			return ((EAGAIN == errno || EINTR == errno) ? 0 : -1);
+		}
+		if (0 == got)
+		{
+			return (-1);
+		}
+		
+		client->received += (uint32_t)got;
+	}
+}
+
+
+/*************************** Serve ********************************************/
+static status_t Serve(client_t *client)
+{
+	const ctl_header_t *header = (const ctl_header_t *)client->frame;
+	unsigned char reply[CTL_MAX_BODY] = {0};
+	uint32_t reply_size = 0;
+	int status = CTL_UNKNOWN_OP;
+	
+	if (0 < header->op && CTL_OPS_COUNT > header->op)
+	{
+		status = g_request((ctl_op_t)header->op,
+						   client->frame + sizeof(ctl_header_t),
+						   header->length, reply, &reply_size,
+						   g_request_arg);
+	}
+	client->received = 0;
+	
+	return (Reply(client->fd, header->op, (uint8_t)status, reply,
+				  (CTL_MAX_BODY < reply_size) ? 0 : reply_size));
+}
+
+
+/*************************** Reply ********************************************/
+static status_t Reply(int fd, uint8_t op, uint8_t status,
+					  const void *body, uint32_t size)
+{
+	unsigned char frame[FRAME_SIZE] = {0};
+	ctl_header_t header = {0};
+	size_t frame_size = sizeof(ctl_header_t) + size;
+	
+	header.magic = CTL_MAGIC;
+	header.op = op;
+	header.status = status;
+	header.length = size;
+	memcpy(frame, &header, sizeof(header));
+	if (0 < size)
+	{
+		memcpy(frame + sizeof(header), body, size);
+	}
+	
+	/*	in one piece or not at all - a client whose socket is full doesn't
+		read its replies, and isn't waited for */
+	return ((ssize_t)frame_size == send(fd, frame, frame_size,
+										MSG_NOSIGNAL | MSG_DONTWAIT) ?
+			SUCCESS : FAILURE);
+}
+
+
+/*************************** IsSameUser ***************************************/
+static int IsSameUser(int fd)
+{
+	struct ucred cred = {0};
+	socklen_t size = sizeof(cred);
+	
+	if (0 != getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size))
+	{
+		return (FALSE);
+	}
+	
+	return (0 == cred.uid || getuid() == cred.uid);
+}
+
+
+/*************************** Disconnect ***************************************/
+static void Disconnect(client_t *client)
+{
+	close(client->fd);
+	client->fd = -1;
+	client->received = 0;
+}
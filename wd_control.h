@@ -0,0 +1,126 @@
+/******************************************************************************
+ * File name  : wd_control.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: control socket - a local (unix-domain) stream socket of the
+ *				WD, served by its scheduler between the tasks. a message is
+ *				a ctl_header_t followed by length bytes of body, in the byte
+ *				order of the host. every request gets a reply of the same op.
+ ******************************************************************************/
+#ifndef _WD_CONTROL_H_
+#define _WD_CONTROL_H_
+
+#include <stdint.h>			/* uint16_t, uint32_t, uint64_t */
+
+#include "./scheduler/scheduler.h"
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+/*	environment variable of the app (passed on to the WD) - the path of the
+	socket. unset - no control socket */
+#define CTL_PATH_ENV "WD_CONTROL_SOCKET"
+
+#define CTL_MAGIC (0x5743)			/* "WC" */
+#define CTL_MAX_BODY (512)			/* of a request or a reply */
+#define CTL_MAX_CLIENTS (16)		/* connected at once */
+#define CTL_BATCH (32)				/* requests served per wakeup of a
+									   client - then the tasks run */
+
+/*** enums ***/
+typedef enum ctl_op
+{
+	CTL_LIST = 1,			/* reply: ctl_proc_t per supervised proc */
+	CTL_STATS,				/* reply: ctl_stats_t */
+	CTL_RESTART,			/* restarts the app (terminate, then spawn) */
+	CTL_PAUSE,				/* no verdicts (missed beats, resource limits)
+							   until CTL_RESUME. beats are still sent, and
+							   an app which has ended is still revived */
+	CTL_RESUME,
+	CTL_SET_INTERVALS,		/* body & reply: ctl_intervals_t */
+	CTL_OPS_COUNT
+} ctl_op_t;
+
+typedef enum ctl_status
+{
+	CTL_OK = 0,
+	CTL_BAD_REQUEST,		/* a body of the wrong size or values */
+	CTL_UNKNOWN_OP,
+	CTL_BUSY,				/* a revive or a restart is going on */
+	CTL_FAILED
+} ctl_status_t;
+
+/*** structures ***/
+typedef struct ctl_header_s
+{
+	uint16_t	magic;			/* CTL_MAGIC */
+	uint8_t		op;				/* ctl_op_t */
+	uint8_t		status;			/* ctl_status_t of a reply. 0 in a request */
+	uint32_t	length;			/* of the body - up to CTL_MAX_BODY */
+} ctl_header_t;
+
+/*	a supervised proc */
+typedef struct ctl_proc_s
+{
+	int32_t		pid;
+	uint32_t	state;			/* revive_state_t of the WD */
+	uint32_t	flags;			/* CTL_PROC_* */
+	uint32_t	reserved;
+	int64_t		beat_age_ms;	/* since its last beat. -1 - none yet */
+} ctl_proc_t;
+
+#define CTL_PROC_RETIRING (1 << 0)	/* replaced by a planned restart */
+#define CTL_PROC_PAUSED (1 << 1)	/* no verdicts on it */
+
+typedef struct ctl_stats_s
+{
+	uint64_t	uptime_ms;			/* of the WD */
+	uint64_t	beats_sent;
+	uint64_t	beats_received;
+	uint64_t	deadline_misses;
+	uint64_t	deadline_extensions;	/* excused by overload */
+	uint64_t	revives;			/* started */
+	uint64_t	revive_failures;
+	uint64_t	planned_restarts;
+	uint64_t	exits;				/* of the app, as reaped */
+	uint64_t	crashes;			/* killed by a signal */
+	uint64_t	wakeups;			/* of the scheduler */
+	uint64_t	requests;			/* served on the control socket */
+} ctl_stats_t;
+
+/*	the timing of the beats, in seconds. 0 in a request - unchanged */
+typedef struct ctl_intervals_s
+{
+	int32_t		send_interval;
+	int32_t		check_interval;
+	int32_t		max_seconds_waiting;
+	int32_t		reserved;
+} ctl_intervals_t;
+
+/*	serves a request of op with size bytes of body. writes up to
+	CTL_MAX_BODY bytes of reply into reply & their number into *reply_size.
+	returns a ctl_status_t */
+typedef int (*ctl_request_t)(ctl_op_t op, const void *body, uint32_t size,
+							 void *reply, uint32_t *reply_size, void *arg);
+
+/******************************* ControlOpen **********************************/
+/*
+ * description  :  listens on path (replacing a stale socket there), and
+ *				   serves its clients by sched - each request by request
+ *				   with arg. only clients of the same user (or root) are
+ *				   served. a client which doesn't read its replies is
+ *				   disconnected, so it can't hold up the scheduler.
+ *
+ * return value :  SUCCESS / FAILURE, with errno - EADDRINUSE if a live WD
+ *				   listens on path, ENAMETOOLONG, or why it can't listen.
+ */
+status_t ControlOpen(scheduler_t *sched, const char *path,
+					 ctl_request_t request, void *arg);
+
+/******************************* ControlClose *********************************/
+/*
+ * description  :  disconnects the clients and removes the socket. the
+ *				   scheduler isn't used - it may be destroyed.
+ */
+void ControlClose(void);
+
+#endif /* _WD_CONTROL_H_ */
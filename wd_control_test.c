@@ -0,0 +1,392 @@
+/******************************************************************************
+*	Filename	:	wd_control_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	control socket test file. the clients write their frames
+*					to the socket, and the scheduler serves them for a second
+*******************************************************************************/
+#define _GNU_SOURCE				/* struct ucred of wd_control */
+
+#include <stdio.h> 		/* printf, snprintf */
+#include <string.h>		/* memset, memcpy, memcmp, strlen */
+#include <errno.h>		/* errno, EADDRINUSE, ECONNRESET */
+#include <time.h>		/* time */
+#include <unistd.h>		/* close, unlink, getpid */
+#include <sys/socket.h>	/* socket, bind, listen, connect, send, recv */
+#include <sys/un.h>		/* struct sockaddr_un */
+
+#include "wd_control.h"
+
+/******************************* MACROS ***************************************/
+#define PATH_SIZE (64)
+#define OTHER_PATH_SIZE (PATH_SIZE + 8)	/* with a suffix */
+#define BODY ("ping")
+#define SPLIT (3)				/* bytes of the header sent first */
+
+/************************** unit-test functions *******************************/
+void ControlLiveSocketTest(void);
+void ControlSplitHeaderTest(void);
+void ControlBadMagicTest(void);
+void ControlTooLongTest(void);
+void ControlUnknownOpTest(void);
+
+/*************************** helper functions *********************************/
+/*	a ctl_request_t - echoes the body of CTL_STATS, counts its calls */
+static int EchoRequest(ctl_op_t op, const void *body, uint32_t size,
+					   void *reply, uint32_t *reply_size, void *arg);
+
+/*	serves the clients for a second */
+static void Serve(void);
+static int StopTask(void *param);
+
+/*	a client connected to path. -1 on failure */
+static int Connect(const char *path);
+
+/*	a socket bound to path - listening if is_listening. -1 on failure */
+static int Listen(const char *path, int is_listening);
+
+static void SetAddr(struct sockaddr_un *addr, const char *path);
+
+/*	sends a header of op, magic & length, then size bytes of body */
+static void SendFrame(int fd, uint16_t magic, uint8_t op, uint32_t length,
+					  const void *body, size_t size);
+
+/*	whether fd has a reply of op & status, with a body of BODY if CTL_OK */
+static int IsReply(int fd, uint8_t op, uint8_t status);
+
+/*	whether the server has closed fd - nothing more to read. a frame left
+	unread by it makes the close a reset */
+static int IsClosed(int fd);
+
+/************************* global variable ************************************/
+static scheduler_t *g_sched = NULL;
+static char g_path[PATH_SIZE] = {0};
+static int g_requests = 0;
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR CONTROL'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	snprintf(g_path, sizeof(g_path), "/tmp/wd_control_test.%d", getpid());
+	g_sched = SchedulerCreate();
+	if (NULL == g_sched)
+	{
+		return (1);
+	}
+	
+	ControlLiveSocketTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	/* the socket of the frame tests */
+	if (SUCCESS != ControlOpen(g_sched, g_path, EchoRequest, &g_requests))
+	{
+		printf("ControlOpen:\t\t\t\tFAIL\n");
+		SchedulerDestroy(g_sched);
+		
+		return (1);
+	}
+	
+	ControlSplitHeaderTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ControlBadMagicTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ControlTooLongTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ControlUnknownOpTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ControlClose();
+	SchedulerDestroy(g_sched);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* ControlLiveSocketTest ******************************/
+void ControlLiveSocketTest(void)
+{
+	char live_path[OTHER_PATH_SIZE] = {0};
+	char stale_path[OTHER_PATH_SIZE] = {0};
+	int live_fd = -1;
+	int stale_fd = -1;
+	int client_fd = -1;
+	status_t live_status = SUCCESS;
+	status_t stale_status = FAILURE;
+	int live_errno = 0;
+	
+	printf("ControlOpen (live / stale socket):\t");
+	
+	/*	another WD listens on it - it's kept, and still accepts */
+	snprintf(live_path, sizeof(live_path), "%s.live", g_path);
+	live_fd = Listen(live_path, TRUE);
+	live_status = ControlOpen(g_sched, live_path, EchoRequest, &g_requests);
+	live_errno = errno;
+	client_fd = Connect(live_path);
+	
+	/*	nobody listens on it - left by a WD which has been killed */
+	snprintf(stale_path, sizeof(stale_path), "%s.stale", g_path);
+	stale_fd = Listen(stale_path, FALSE);
+	close(stale_fd);
+	stale_status = ControlOpen(g_sched, stale_path, EchoRequest, &g_requests);
+	ControlClose();
+	
+	(0 <= live_fd)						&&
+	(FAILURE == live_status)			&&
+	(EADDRINUSE == live_errno)			&&
+	(0 <= client_fd)					&&
+	(0 <= stale_fd)						&&
+	(SUCCESS == stale_status)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(client_fd);
+	close(live_fd);
+	unlink(live_path);
+	unlink(stale_path);
+}
+
+
+/************************* ControlSplitHeaderTest *****************************/
+void ControlSplitHeaderTest(void)
+{
+	ctl_header_t header = {0};
+	int is_waiting = FALSE;
+	int fd = Connect(g_path);
+	
+	printf("ReadFrame (split header):\t\t");
+	
+	/*	a part of the header is kept until the rest arrives */
+	header.magic = CTL_MAGIC;
+	header.op = CTL_STATS;
+	header.length = sizeof(BODY);
+	send(fd, &header, SPLIT, 0);
+	Serve();
+	is_waiting = (0 == g_requests && !IsReply(fd, CTL_STATS, CTL_OK));
+	
+	send(fd, (char *)&header + SPLIT, sizeof(header) - SPLIT, 0);
+	send(fd, BODY, sizeof(BODY), 0);
+	Serve();
+	
+	(0 <= fd)							&&
+	(TRUE == is_waiting)				&&
+	(TRUE == IsReply(fd, CTL_STATS, CTL_OK))	&&
+	(1 == g_requests)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(fd);
+}
+
+
+/************************* ControlBadMagicTest ********************************/
+void ControlBadMagicTest(void)
+{
+	int fd = Connect(g_path);
+	
+	printf("ReadFrame (bad magic):\t\t\t");
+	
+	g_requests = 0;
+	SendFrame(fd, CTL_MAGIC + 1, CTL_STATS, sizeof(BODY), BODY, sizeof(BODY));
+	Serve();
+	
+	(0 <= fd)							&&
+	(TRUE == IsReply(fd, CTL_STATS, CTL_BAD_REQUEST))	&&
+	(TRUE == IsClosed(fd))				&&
+	(0 == g_requests)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(fd);
+}
+
+
+/************************* ControlTooLongTest *********************************/
+void ControlTooLongTest(void)
+{
+	char body[CTL_MAX_BODY + 1] = {0};
+	int fd = Connect(g_path);
+	
+	printf("ReadFrame (length > CTL_MAX_BODY):\t");
+	
+	/* refused by the header - the body isn't read */
+	g_requests = 0;
+	SendFrame(fd, CTL_MAGIC, CTL_STATS, sizeof(body), body, sizeof(body));
+	Serve();
+	
+	(0 <= fd)							&&
+	(TRUE == IsReply(fd, CTL_STATS, CTL_BAD_REQUEST))	&&
+	(TRUE == IsClosed(fd))				&&
+	(0 == g_requests)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(fd);
+}
+
+
+/************************* ControlUnknownOpTest *******************************/
+void ControlUnknownOpTest(void)
+{
+	int fd = Connect(g_path);
+	
+	printf("Serve (unknown op):\t\t\t");
+	
+	/*	answered, not disconnected - the next request is served */
+	g_requests = 0;
+	SendFrame(fd, CTL_MAGIC, CTL_OPS_COUNT, 0, NULL, 0);
+	SendFrame(fd, CTL_MAGIC, 0, 0, NULL, 0);
+	SendFrame(fd, CTL_MAGIC, CTL_STATS, sizeof(BODY), BODY, sizeof(BODY));
+	Serve();
+	
+	(0 <= fd)							&&
+	(TRUE == IsReply(fd, CTL_OPS_COUNT, CTL_UNKNOWN_OP))	&&
+	(TRUE == IsReply(fd, 0, CTL_UNKNOWN_OP))	&&
+	(TRUE == IsReply(fd, CTL_STATS, CTL_OK))	&&
+	(1 == g_requests)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(fd);
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* EchoRequest ****************************************/
+/* this func is of type ctl_request_t */
+static int EchoRequest(ctl_op_t op, const void *body, uint32_t size,
+					   void *reply, uint32_t *reply_size, void *arg)
+{
+	if (CTL_STATS != op)
+	{
+		return (CTL_FAILED);
+	}
+	
+	++*(int *)arg;
+	memcpy(reply, body, size);
+	*reply_size = size;
+	
+	return (CTL_OK);
+}
+
+
+/************************* Serve **********************************************/
+static void Serve(void)
+{
+	SchedulerAddTask(g_sched, StopTask, g_sched, time(NULL) + 1, 1);
+	SchedulerRun(g_sched);
+}
+
+
+/************************* StopTask *******************************************/
+static int StopTask(void *param)
+{
+	SchedulerStop((scheduler_t *)param);
+	
+	return (DONE);
+}
+
+
+/************************* Connect ********************************************/
+static int Connect(const char *path)
+{
+	struct sockaddr_un addr = {0};
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	
+	SetAddr(&addr, path);
+	if (0 <= fd && 0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+	{
+		close(fd);
+		fd = -1;
+	}
+	
+	return (fd);
+}
+
+
+/************************* Listen *********************************************/
+static int Listen(const char *path, int is_listening)
+{
+	struct sockaddr_un addr = {0};
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	
+	SetAddr(&addr, path);
+	unlink(path);
+	if (0 <= fd &&
+		(0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+		 (is_listening && 0 != listen(fd, 1))))
+	{
+		close(fd);
+		fd = -1;
+	}
+	
+	return (fd);
+}
+
+
+/************************* SetAddr ********************************************/
+static void SetAddr(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	memcpy(addr->sun_path, path, strlen(path));
+}
+
+
+/************************* SendFrame ******************************************/
+static void SendFrame(int fd, uint16_t magic, uint8_t op, uint32_t length,
+					  const void *body, size_t size)
+{
+	ctl_header_t header = {0};
+	
+	header.magic = magic;
+	header.op = op;
+	header.length = length;
+	send(fd, &header, sizeof(header), MSG_NOSIGNAL);
+	if (0 < size)
+	{
+		send(fd, body, size, MSG_NOSIGNAL);
+	}
+}
+
+
+/************************* IsReply ********************************************/
+static int IsReply(int fd, uint8_t op, uint8_t status)
+{
+	ctl_header_t header = {0};
+	char body[CTL_MAX_BODY] = {0};
+	uint32_t length = (CTL_OK == status) ? sizeof(BODY) : 0;
+	
+	if ((ssize_t)sizeof(header) != recv(fd, &header, sizeof(header),
+										MSG_DONTWAIT) ||
+		(0 < length && (ssize_t)length != recv(fd, body, length, MSG_DONTWAIT)))
+	{
+		return (FALSE);
+	}
+	
+	return (CTL_MAGIC == header.magic && op == header.op &&
+			status == header.status && length == header.length &&
+			0 == memcmp(body, BODY, length));
+}
+
+
+/************************* IsClosed *******************************************/
+static int IsClosed(int fd)
+{
+	char byte = 0;
+	ssize_t got = recv(fd, &byte, 1, MSG_DONTWAIT);
+	
+	return (0 == got || (0 > got && ECONNRESET == errno));
+}
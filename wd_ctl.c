@@ -0,0 +1,372 @@
+/******************************************************************************
+*	Filename	:	wd_ctl.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	asks & commands a running WD through its control socket.
+					usage: wd_ctl.out [-s path] <command>
+					(default path: $WD_CONTROL_SOCKET)
+					commands: list, stats, restart, pause, resume,
+					intervals <send> <check> <max> (0 - unchanged),
+					bench [requests] (round trips of stats per second)
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* clock_gettime */
+
+#include <stdio.h> 		/* printf, fprintf */
+#include <stdlib.h>		/* getenv, strtol */
+#include <string.h>		/* strcmp, strlen, memcpy */
+#include <errno.h>		/* errno, EINTR */
+#include <time.h>		/* clock_gettime */
+#include <unistd.h>		/* close, read, write */
+#include <sys/socket.h>	/* socket, connect */
+#include <sys/un.h>		/* struct sockaddr_un */
+
+#include "wd_control.h"
+
+/******************************* MACROS ***************************************/
+#define BENCH_REQUESTS (10000)
+#define NSEC_IN_SEC (1000000000L)
+
+/************************** internal functions ********************************/
+/*	connects to the WD. returns the socket, or -1 */
+static int Connect(const char *path);
+
+/*	sends a request of op and reads its reply into reply (CTL_MAX_BODY
+	bytes). returns its ctl_status_t, or -1 if the WD can't be reached */
+static int Request(int sock, ctl_op_t op, const void *body, uint32_t size,
+				   void *reply, uint32_t *reply_size);
+
+static int ReadAll(int fd, void *buffer, size_t size);
+static int WriteAll(int fd, const void *buffer, size_t size);
+
+static void PrintList(const void *reply, uint32_t size);
+static void PrintStats(const void *reply, uint32_t size);
+static int Bench(int sock, long requests);
+static const char *StatusName(int status);
+static double ClockSec(void);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+	static const char *const commands[CTL_OPS_COUNT] =
+	{
+		"", "list", "stats", "restart", "pause", "resume", "intervals"
+	};
+	const char *path = getenv(CTL_PATH_ENV);
+	unsigned char reply[CTL_MAX_BODY] = {0};
+	ctl_intervals_t intervals = {0};
+	uint32_t reply_size = 0;
+	const void *body = NULL;
+	uint32_t size = 0;
+	int op = 0;
+	int sock = -1;
+	int status = 0;
+	
+	if (3 <= argc && 0 == strcmp("-s", argv[1]))
+	{
+		path = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+	
+	if (2 > argc || NULL == path)
+	{
+		fprintf(stderr, "usage: wd_ctl.out [-s path] list | stats | restart "
+				"| pause | resume | intervals <send> <check> <max> | "
+				"bench [requests]\n");
+		return (1);
+	}
+	
+	for (op = CTL_LIST; op < CTL_OPS_COUNT &&
+		 0 != strcmp(commands[op], argv[1]); ++op)
+	{
+	}
+	
+	if (CTL_OPS_COUNT == op && 0 != strcmp("bench", argv[1]))
+	{
+		fprintf(stderr, "%s: unknown command\n", argv[1]);
+		return (1);
+	}
+	
+	if (CTL_SET_INTERVALS == op)
+	{
+		if (5 > argc)
+		{
+			fprintf(stderr, "intervals: <send> <check> <max> in seconds\n");
+			return (1);
+		}
+		intervals.send_interval = (int32_t)strtol(argv[2], NULL, 10);
+		intervals.check_interval = (int32_t)strtol(argv[3], NULL, 10);
+		intervals.max_seconds_waiting = (int32_t)strtol(argv[4], NULL, 10);
+		body = &intervals;
+		size = sizeof(intervals);
+	}
+	
+	sock = Connect(path);
+	if (0 > sock)
+	{
+		fprintf(stderr, "%s: can't connect to the WD\n", path);
+		return (1);
+	}
+	
+	if (CTL_OPS_COUNT == op)
+	{
+		status = Bench(sock, (2 < argc) ? strtol(argv[2], NULL, 10) :
+										  BENCH_REQUESTS);
+		close(sock);
+		
+		return (status);
+	}
+	
+	status = Request(sock, (ctl_op_t)op, body, size, reply, &reply_size);
+	close(sock);
+	if (CTL_OK != status)
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], StatusName(status));
+		return (1);
+	}
+	
+	switch (op)
+	{
+		case CTL_LIST:
+			PrintList(reply, reply_size);
+			break;
+		
+		case CTL_STATS:
+			PrintStats(reply, reply_size);
+			break;
+		
+		case CTL_SET_INTERVALS:
+			memcpy(&intervals, reply, sizeof(intervals));
+			printf("send %d, check %d, max %d seconds\n",
+				   intervals.send_interval, intervals.check_interval,
+				   intervals.max_seconds_waiting);
+			break;
+		
+		default:
+			printf("%s: ok\n", argv[1]);
+			break;
+	}
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** Connect ******************************************/
+static int Connect(const char *path)
+{
+	struct sockaddr_un addr = {0};
+	int sock = -1;
+	
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		return (-1);
+	}
+	
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, strlen(path));
+	
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (0 <= sock && 0 != connect(sock, (struct sockaddr *)&addr,
+								  sizeof(addr)))
+	{
+		close(sock);
+		sock = -1;
+	}
+	
+	return (sock);
+}
+
+
+/*************************** Request ******************************************/
+static int Request(int sock, ctl_op_t op, const void *body, uint32_t size,
+				   void *reply, uint32_t *reply_size)
+{
+	unsigned char frame[sizeof(ctl_header_t) + CTL_MAX_BODY] = {0};
+	ctl_header_t header = {0};
+	
+	header.magic = CTL_MAGIC;
+	header.op = (uint8_t)op;
+	header.length = size;
+	memcpy(frame, &header, sizeof(header));
+	if (0 < size)
+	{
+		memcpy(frame + sizeof(header), body, size);
+	}
+	
+	if (0 != WriteAll(sock, frame, sizeof(header) + size) ||
+		0 != ReadAll(sock, &header, sizeof(header)) ||
+		CTL_MAGIC != header.magic || CTL_MAX_BODY < header.length ||
+		0 != ReadAll(sock, reply, header.length))
+	{
+		return (-1);
+	}
+	
+	*reply_size = header.length;
+	
+	return (header.status);
+}
+
+
+/*************************** ReadAll ******************************************/
+static int ReadAll(int fd, void *buffer, size_t size)
+{
+	ssize_t got = 0;
+	
+	while (0 < size)
+	{
+		got = read(fd, buffer, size);
+		if (0 >= got && !(0 > got && EINTR == errno))
+		{
+			return (-1);
+		}
+		
+		got = (0 > got) ? 0 : got;
+		buffer = (char *)buffer + got;
+		size -= (size_t)got;
+	}
+	
+	return (0);
+}
+
+
+/*************************** WriteAll *****************************************/
+static int WriteAll(int fd, const void *buffer, size_t size)
+{
+	ssize_t written = 0;
+	
+	while (0 < size)
+	{
+		written = write(fd, buffer, size);
+		if (0 > written && EINTR != errno)
+		{
+			return (-1);
+		}
+		
+		written = (0 > written) ? 0 : written;
+		buffer = (const char *)buffer + written;
+		size -= (size_t)written;
+	}
+	
+	return (0);
+}
+
+
+/*************************** PrintList ****************************************/
+static void PrintList(const void *reply, uint32_t size)
+{
+	static const char *const states[] =
+	{
+		"up", "spawning", "starting", "failed", "terminating"
+	};
+	ctl_proc_t proc = {0};
+	uint32_t i = 0;
+	
+	printf("%8s  %-12s %10s  %s\n", "PID", "STATE", "BEAT AGE", "FLAGS");
+	for (i = 0; i + sizeof(proc) <= size; i += sizeof(proc))
+	{
+		memcpy(&proc, (const char *)reply + i, sizeof(proc));
+		printf("%8d  %-12s ", proc.pid,
+			   (sizeof(states) / sizeof(states[0]) > proc.state) ?
+			   states[proc.state] : "?");
+		(0 > proc.beat_age_ms) ? printf("%10s  ", "-") :
+								 printf("%8ldms  ", (long)proc.beat_age_ms);
+		printf("%s%s\n", (proc.flags & CTL_PROC_RETIRING) ? "retiring " : "",
+			   (proc.flags & CTL_PROC_PAUSED) ? "paused" : "");
+	}
+}
+
+
+/*************************** PrintStats ***************************************/
+static void PrintStats(const void *reply, uint32_t size)
+{
+	ctl_stats_t stats = {0};
+	
+	memcpy(&stats, reply, (sizeof(stats) < size) ? sizeof(stats) : size);
+	
+	printf("uptime_ms           %llu\n", (unsigned long long)stats.uptime_ms);
+	printf("beats_sent          %llu\n", (unsigned long long)stats.beats_sent);
+	printf("beats_received      %llu\n",
+		   (unsigned long long)stats.beats_received);
+	printf("deadline_misses     %llu\n",
+		   (unsigned long long)stats.deadline_misses);
+	printf("deadline_extensions %llu\n",
+		   (unsigned long long)stats.deadline_extensions);
+	printf("revives             %llu\n", (unsigned long long)stats.revives);
+	printf("revive_failures     %llu\n",
+		   (unsigned long long)stats.revive_failures);
+	printf("planned_restarts    %llu\n",
+		   (unsigned long long)stats.planned_restarts);
+	printf("exits               %llu\n", (unsigned long long)stats.exits);
+	printf("crashes             %llu\n", (unsigned long long)stats.crashes);
+	printf("wakeups             %llu\n", (unsigned long long)stats.wakeups);
+	printf("requests            %llu\n", (unsigned long long)stats.requests);
+}
+
+
+/*************************** Bench ********************************************/
+static int Bench(int sock, long requests)
+{
+	unsigned char reply[CTL_MAX_BODY] = {0};
+	uint32_t reply_size = 0;
+	double start = ClockSec();
+	double seconds = 0;
+	long i = 0;
+	
+	for (i = 0; i < requests; ++i)
+	{
+		if (CTL_OK != Request(sock, CTL_STATS, NULL, 0, reply, &reply_size))
+		{
+			fprintf(stderr, "bench: failed after %ld requests\n", i);
+			return (1);
+		}
+	}
+	
+	seconds = ClockSec() - start;
+	printf("%ld requests in %.3f s: %.0f/s, %.1f us each\n", requests,
+		   seconds, (0 < seconds) ? requests / seconds : 0,
+		   (0 < requests) ? seconds * 1e6 / requests : 0);
+	
+	return (0);
+}
+
+
+/*************************** StatusName ***************************************/
+static const char *StatusName(int status)
+{
+	switch (status)
+	{
+		case CTL_BAD_REQUEST:
+			return ("bad request");
+		
+		case CTL_UNKNOWN_OP:
+			return ("unknown command");
+		
+		case CTL_BUSY:
+			return ("busy - a revive or a restart is going on");
+		
+		case CTL_FAILED:
+			return ("failed");
+		
+		case -1:
+			return ("no reply from the WD");
+		
+		default:
+			return ("ok");
+	}
+}
+
+
+/*************************** ClockSec *****************************************/
+static double ClockSec(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (now.tv_sec + (double)now.tv_nsec / NSEC_IN_SEC);
+}
@@ -0,0 +1,31 @@
+/*******************************************************************************
+*	Filename	:	wd_env.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	environment variables source file
+*******************************************************************************/
+#include <errno.h>			/* errno, ERANGE */
+#include <stdlib.h>			/* getenv, strtol */
+
+#include "wd_env.h"
+
+/******************************************************************************
+*							EnvToLong
+*******************************************************************************/
+long EnvToLong(const char *name, long default_value, long min, long max)
+{
+	const char *str = getenv(name);
+	char *end = NULL;
+	long value = 0;
+	
+	if (NULL == str)
+	{
+		return (default_value);
+	}
+	
+	errno = 0;
+	value = strtol(str, &end, 10);
+	
+	return ((end == str || '\0' != *end || ERANGE == errno ||
+			 min > value || max < value) ? default_value : value);
+}
@@ -0,0 +1,23 @@
+/******************************************************************************
+ * File name  : wd_env.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: the numeric environment variables of the WD. a value is
+ *				taken only if it's a whole number in its range - anything
+ *				else (garbage, a trailing "x", a huge value) is the default.
+ ******************************************************************************/
+#ifndef _WD_ENV_H_
+#define _WD_ENV_H_
+
+/******************************** EnvToLong ***********************************/
+/*
+ * description  :  parses the environment variable name as a decimal number.
+ *
+ * input		:  default_value - if name is unset, empty, not a number, has
+ *				   anything after the number, or is out of [min, max].
+ *
+ * return value :  the number, or default_value.
+ */
+long EnvToLong(const char *name, long default_value, long min, long max);
+
+#endif /* _WD_ENV_H_ */
@@ -0,0 +1,125 @@
+/******************************************************************************
+*	Filename	:	wd_env_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	environment variables test file
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* setenv, unsetenv */
+
+#include <stdio.h> 		/* printf */
+#include <stdlib.h>		/* setenv, unsetenv */
+#include <limits.h>		/* LONG_MIN, LONG_MAX */
+
+#include "wd_env.h"
+
+/******************************* MACROS ***************************************/
+#define NAME "WD_ENV_TEST"
+#define DEFAULT (42)
+#define MIN (-10)
+#define MAX (100)
+
+/************************** unit-test functions *******************************/
+void EnvNumberTest(void);
+void EnvGarbageTest(void);
+void EnvRangeTest(void);
+
+/*************************** helper functions *********************************/
+/* EnvToLong of NAME set to value (NULL - unset) in [MIN, MAX] */
+static long Parse(const char *value);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR ENV'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	EnvNumberTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	EnvGarbageTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	EnvRangeTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	unsetenv(NAME);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* EnvNumberTest **************************************/
+void EnvNumberTest(void)
+{
+	printf("EnvToLong (numbers):\t\t\t");
+	
+	(12 == Parse("12"))			&&
+	(-5 == Parse("-5"))			&&
+	(3 == Parse("+3"))			&&
+	(0 == Parse("0"))			&&
+	(MAX == Parse("100"))		&&
+	(MIN == Parse("-10"))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* EnvGarbageTest *************************************/
+void EnvGarbageTest(void)
+{
+	printf("EnvToLong (garbage - default):\t\t");
+	
+	(DEFAULT == Parse(NULL))	&&
+	(DEFAULT == Parse(""))		&&
+	(DEFAULT == Parse("abc"))	&&
+	(DEFAULT == Parse("1x"))	&&
+	(DEFAULT == Parse("7 "))	&&
+	(DEFAULT == Parse("-"))		&&
+	(DEFAULT == Parse("0x10"))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* EnvRangeTest ***************************************/
+void EnvRangeTest(void)
+{
+	long huge = 0;
+	
+	printf("EnvToLong (out of range - default):\t");
+	
+	/* beyond a long - strtol clamps it */
+	setenv(NAME, "99999999999999999999999", 1);
+	huge = EnvToLong(NAME, DEFAULT, LONG_MIN, LONG_MAX);
+	
+	(DEFAULT == huge)			&&
+	(DEFAULT == Parse("101"))	&&
+	(DEFAULT == Parse("-11"))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* Parse **********************************************/
+static long Parse(const char *value)
+{
+	if (NULL == value)
+	{
+		unsetenv(NAME);
+	}
+	else
+	{
+		setenv(NAME, value, 1);
+	}
+	
+	return (EnvToLong(NAME, DEFAULT, MIN, MAX));
+}
@@ -0,0 +1,279 @@
+/*******************************************************************************
+*	Filename	:	wd_flight.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	flight recorder source file. a lock-free ring of events
+					in a file-backed shared mapping - the events are in the
+					page cache as soon as they are written, so they survive
+					a crash of the app or of the WD.
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* O_CLOEXEC, clock_gettime */
+
+#include <string.h>			/* strnlen, memcmp, memcpy */
+#include <stdlib.h>			/* getenv */
+#include <time.h>			/* clock_gettime */
+#include <fcntl.h>			/* open, fcntl */
+#include <unistd.h>			/* ftruncate, close, getpid */
+#include <sys/mman.h>		/* mmap, munmap */
+#include <sys/stat.h>		/* fstat */
+
+#include "wd_flight.h"
+
+/******************************* MACROS ***************************************/
+#define NSEC_IN_SEC (1000000000L)
+#define FLIGHT_FILE_SIZE (sizeof(flight_header_t) + \
+						  FLIGHT_CAPACITY * sizeof(flight_record_t))
+
+/************************* global variable ************************************/
+/* NOTE: the mapping is per process, and is inherited by a forked child */
+static flight_header_t *g_flight = NULL;
+static flight_record_t *g_records = NULL;
+
+static const char *g_event_names[FL_EVENTS_COUNT] =
+{
+	"UNKNOWN",
+	"START",
+	"STOP",
+	"BEAT_SENT",
+	"BEAT_RECEIVED",
+	"DEADLINE_MISS",
+	"REVIVE_START",
+	"REVIVE_END",
+	"FORK",
+	"EXEC_FAILED",
+	"PEER_EXIT",
+	"PEER_USAGE",
+	"REVIVE_FAILED",
+	"RT_MODE",
+	"DEADLINE_EXT",
+	"RESTART_PLAN",
+	"RETIRED",
+	"RESTART_ABORT",
+	"TERMINATE",
+	"TERMINATED",
+	"STATE_ATTACH",
+	"SNAPSHOT",
+	"SNAP_THREAD",
+	"SNAP_KSTACK",
+	"SNAP_USTACK",
+	"CONTROL",
+	"LISTEN_FAILED"
+};
+
+/************************** internal functions ********************************/
+/*	checks whether the file already holds a valid flight log */
+static int IsValidLog(int fd);
+
+/*	resets the file to an empty flight log and maps it */
+static flight_header_t *CreateLog(int fd);
+
+/*	locks/unlocks the whole file - the app & the WD may open it together */
+static void LockFile(int fd, short type);
+
+static int64_t ClockNs(clockid_t clock);
+
+/******************************************************************************
+*							FlightOpen
+*******************************************************************************/
+status_t FlightOpen(const char *path)
+{
+	int fd = -1;
+	void *map = MAP_FAILED;
+	
+	/* already open */
+	if (NULL != g_flight)
+	{
+		return (SUCCESS);
+	}
+	
+	if (NULL == path)
+	{
+		path = getenv(FLIGHT_PATH_ENV);
+	}
+	if (NULL == path)
+	{
+		path = FLIGHT_DEFAULT_PATH;
+	}
+	
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (0 > fd)
+	{
+		return (FAILURE);
+	}
+	
+	LockFile(fd, F_WRLCK);
+	if (IsValidLog(fd))
+	/* keeps the events of the previous runs */
+	{
+		map = mmap(NULL, FLIGHT_FILE_SIZE, PROT_READ | PROT_WRITE,
+				   MAP_SHARED, fd, 0);
+		if (MAP_FAILED != map)
+		{
+			g_flight = map;
+		}
+	}
+	else
+	{
+		g_flight = CreateLog(fd);
+	}
+	LockFile(fd, F_UNLCK);
+	
+	/* the mapping stays valid after the fd is closed */
+	close(fd);
+	
+	if (NULL == g_flight)
+	{
+		return (FAILURE);
+	}
+	
+	g_records = (flight_record_t *)(g_flight + 1);
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							FlightLog
+*******************************************************************************/
+void FlightLog(flight_event_t event, int64_t arg1, int64_t arg2,
+			   const char *text)
+{
+	flight_record_t *record = NULL;
+	uint64_t index = 0;
+	
+	if (NULL == g_flight)
+	{
+		return;
+	}
+	
+	/* claim a slot - the only shared write besides the record itself */
+	index = atomic_fetch_add_explicit(&(g_flight->head), 1,
+									  memory_order_relaxed);
+	record = &g_records[index & (FLIGHT_CAPACITY - 1)];
+	
+	/* invalidate the slot while it is written */
+	atomic_store_explicit(&(record->seq), 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	
+	record->time_ns = ClockNs(CLOCK_MONOTONIC);
+	record->pid = getpid();
+	record->event = (uint16_t)event;
+	record->reserved = 0;
+	record->arg1 = arg1;
+	record->arg2 = arg2;
+	memset(record->text, 0, FLIGHT_TEXT_SIZE);
+	if (NULL != text)
+	{
+		/* cut to leave the terminating null */
+		memcpy(record->text, text, strnlen(text, FLIGHT_TEXT_SIZE - 1));
+	}
+	
+	/* publish */
+	atomic_store_explicit(&(record->seq), index + 1, memory_order_release);
+}
+
+
+/******************************************************************************
+*							FlightClose
+*******************************************************************************/
+void FlightClose(void)
+{
+	if (NULL != g_flight)
+	{
+		munmap(g_flight, FLIGHT_FILE_SIZE);
+		g_flight = NULL;
+		g_records = NULL;
+	}
+}
+
+
+/******************************************************************************
+*							FlightEventName
+*******************************************************************************/
+const char *FlightEventName(uint16_t event)
+{
+	return ((FL_EVENTS_COUNT > event) ? g_event_names[event] :
+										g_event_names[0]);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** IsValidLog ***************************************/
+static int IsValidLog(int fd)
+{
+	struct stat file_stat = {0};
+	flight_header_t header = {0};
+	
+	if (0 != fstat(fd, &file_stat) ||
+		(off_t)FLIGHT_FILE_SIZE != file_stat.st_size ||
+		(ssize_t)sizeof(header) != pread(fd, &header, sizeof(header), 0))
+	{
+		return (FALSE);
+	}
+	
+	return (0 == memcmp(header.magic, FLIGHT_MAGIC, sizeof(header.magic)) &&
+			FLIGHT_VERSION == header.version &&
+			FLIGHT_CAPACITY == header.capacity);
+}
+
+
+/*************************** CreateLog ****************************************/
+static flight_header_t *CreateLog(int fd)
+{
+	flight_header_t *header = NULL;
+	void *map = MAP_FAILED;
+	
+	/* truncating to 0 first zeroes all the records */
+	if (0 != ftruncate(fd, 0) || 0 != ftruncate(fd, FLIGHT_FILE_SIZE))
+	{
+		return (NULL);
+	}
+	
+	map = mmap(NULL, FLIGHT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+			   fd, 0);
+	if (MAP_FAILED == map)
+	{
+		return (NULL);
+	}
+	
+	header = map;
+	header->version = FLIGHT_VERSION;
+	header->capacity = FLIGHT_CAPACITY;
+	atomic_store(&(header->head), 0);
+	header->realtime_offset_ns = ClockNs(CLOCK_REALTIME) -
+								 ClockNs(CLOCK_MONOTONIC);
+	
+	/* the magic is written last - marks a complete header */
+	atomic_thread_fence(memory_order_release);
+	memcpy(header->magic, FLIGHT_MAGIC, sizeof(header->magic));
+	
+	return (header);
+}
+
+
+/*************************** LockFile *****************************************/
+static void LockFile(int fd, short type)
+{
+	struct flock lock = {0};
+	
+	lock.l_type = type;
+	lock.l_whence = SEEK_SET;
+	lock.l_start = 0;
+	lock.l_len = 0;
+	
+	/* best effort - without the lock, a race only resets the log */
+	fcntl(fd, F_SETLKW, &lock);
+}
+
+
+/*************************** ClockNs ******************************************/
+static int64_t ClockNs(clockid_t clock)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(clock, &now);
+	
+	return ((int64_t)now.tv_sec * NSEC_IN_SEC + now.tv_nsec);
+}
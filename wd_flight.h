@@ -0,0 +1,137 @@
+/******************************************************************************
+ * File name  : wd_flight.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: flight recorder - a crash-surviving ring of supervision
+ *				events, in a file mapped by both the app and the WD.
+ ******************************************************************************/
+#ifndef _WD_FLIGHT_H_
+#define _WD_FLIGHT_H_
+
+#include <stdint.h>		/* uint64_t, uint32_t, int64_t */
+#include <stdatomic.h>	/* _Atomic */
+
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+#define FLIGHT_MAGIC "WDFLIGHT"
+#define FLIGHT_VERSION (1)
+#define FLIGHT_CAPACITY (4096)	/* records in the ring - a power of 2 */
+#define FLIGHT_TEXT_SIZE (24)
+#define FLIGHT_PATH_ENV "WD_FLIGHT_LOG"
+#define FLIGHT_DEFAULT_PATH "wd_flight.log"
+
+/*** enums ***/
+typedef enum flight_event
+{
+	FL_START = 1,		/* arg1: pid of the peer or 0, text: "app"/"wd" */
+	FL_STOP,			/* the main loop was asked to stop */
+	FL_BEAT_SENT,		/* arg1: pid of the peer */
+	FL_BEAT_RECEIVED,	/* arg1: pid of the sender */
+	FL_DEADLINE_MISS,	/* arg1: pid of the peer, arg2: seconds w/o a beat,
+						   text: the phi level (phi mode) */
+	FL_REVIVE_START,	/* arg1: pid of the dead peer, arg2: delay in sec */
+	FL_REVIVE_END,		/* arg1: pid of the revived peer, arg2: failures */
+	FL_FORK,			/* arg1: pid of the child, arg2: errno on failure */
+	FL_EXEC_FAILED,		/* arg2: errno, text: the path */
+	FL_PEER_EXIT,		/* arg1: pid, arg2: exit code/signal, text: how */
+	FL_PEER_USAGE,		/* arg1: cpu time in us, arg2: max rss in kB */
+	FL_REVIVE_FAILED,	/* arg1: pid, arg2: failures, text: reason */
+	FL_RT_MODE,			/* arg1: requested mask, arg2: active mask (RT_*) */
+	FL_DEADLINE_EXTENDED,	/* arg1: pid of the peer, arg2: seconds excused
+							   so far, text: the overload cause */
+	FL_RESTART_PLAN,	/* arg1: pid to replace, arg2: the measured value,
+						   text: the limit crossed */
+	FL_RETIRED,			/* arg1: pid of the replaced proc, arg2: ms from
+						   SIGTERM, text: drained/killed/ended */
+	FL_RESTART_ABORTED,	/* arg1: pid kept, arg2: pid of the failed proc */
+	FL_TERMINATE,		/* arg1: pid, arg2: term_step_t, text: the step */
+	FL_TERMINATED,		/* arg1: pid, arg2: ms since the notify */
+	FL_STATE_ATTACHED,	/* arg1: generation, arg2: clean_shutdown of the
+						   previous instance, text: the name */
+	FL_SNAPSHOT,		/* arg1: pid of the hung peer, arg2: ms taken,
+						   text: threads written/all */
+	FL_SNAP_THREAD,		/* arg1: tid, arg2: cpu time in clock ticks,
+						   text: "<state> <wchan> <name>" */
+	FL_SNAP_KSTACK,		/* arg1: tid, arg2: depth, text: the function */
+	FL_SNAP_USTACK,		/* arg1: tid, arg2: the address, text: the file
+						   & the offset in it */
+	FL_CONTROL,			/* arg1: ctl_op_t, arg2: ctl_status_t of the reply,
+						   text: the command (queries aren't logged) */
+	FL_LISTEN_FAILED,	/* arg2: errno, text: the socket ("control" or
+						   "metrics") */
+	FL_EVENTS_COUNT
+} flight_event_t;
+
+/*** structures ***/
+/*	a single event - exactly one cache line. seq is written last, so a
+	reader which sees seq == index + 1 sees a whole record */
+typedef struct flight_record
+{
+	_Atomic uint64_t seq;			/* index of the record + 1. 0 - empty */
+	uint64_t time_ns;				/* CLOCK_MONOTONIC - shared by all procs */
+	int32_t pid;					/* the writer */
+	uint16_t event;					/* flight_event_t */
+	uint16_t reserved;
+	int64_t arg1;
+	int64_t arg2;
+	char text[FLIGHT_TEXT_SIZE];	/* null-terminated */
+} flight_record_t;
+
+/*	the head of the file, followed by FLIGHT_CAPACITY records */
+typedef struct flight_header
+{
+	char magic[8];					/* FLIGHT_MAGIC (no null) */
+	uint32_t version;
+	uint32_t capacity;
+	_Atomic uint64_t head;			/* index of the next record to write */
+	int64_t realtime_offset_ns;		/* realtime - monotonic, at creation */
+	char reserved[32];
+} flight_header_t;
+
+/* both structures must fill exactly one cache line */
+typedef char flight_record_size_check[(64 == sizeof(flight_record_t)) ? 1 : -1];
+typedef char flight_header_size_check[(64 == sizeof(flight_header_t)) ? 1 : -1];
+
+/******************************* FlightOpen ***********************************/
+/*
+ * description  :  maps the flight log of this process. creates/initializes
+ *				   the file if needed. a process has a single flight log -
+ *				   opening again is a no-op. the mapping is inherited by
+ *				   fork, so a child logs into the same file.
+ *
+ * input		:  path - the file. NULL - from WD_FLIGHT_LOG, or
+ *						  "wd_flight.log" in the working directory.
+ *
+ * return value :  SUCCESS(0) / FAILURE(-1). while not open - FlightLog does
+ *				   nothing.
+ */
+status_t FlightOpen(const char *path);
+
+/******************************* FlightLog ************************************/
+/*
+ * description  :  appends an event to the flight log. lock-free, safe from
+ *				   any thread & process sharing the file. costs a single
+ *				   cache-line write.
+ *
+ * input		:  event - the event type.
+ *				   arg1, arg2 - event arguments (see flight_event_t).
+ *				   text - optional short text (NULL - none). truncated to
+ *						  FLIGHT_TEXT_SIZE - 1 chars.
+ */
+void FlightLog(flight_event_t event, int64_t arg1, int64_t arg2,
+			   const char *text);
+
+/******************************* FlightClose **********************************/
+/*
+ * description  :  unmaps the flight log of this process. the file stays.
+ */
+void FlightClose(void);
+
+/***************************** FlightEventName ********************************/
+/*
+ * description  :  returns a printable name of an event type.
+ */
+const char *FlightEventName(uint16_t event);
+
+#endif /* _WD_FLIGHT_H_ */
@@ -0,0 +1,182 @@
+/******************************************************************************
+*	Filename	:	wd_flight_reader.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	decodes a flight log, oldest event first.
+					usage: wd_flight_reader.out [path]
+					(default: $WD_FLIGHT_LOG, or wd_flight.log)
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* localtime_r */
+
+#include <stdio.h> 		/* printf, fprintf */
+#include <stdlib.h>		/* getenv */
+#include <string.h>		/* memcmp, memcpy */
+#include <time.h>		/* localtime_r, strftime */
+#include <fcntl.h>		/* open */
+#include <unistd.h>		/* close */
+#include <sys/mman.h>	/* mmap, munmap */
+#include <sys/stat.h>	/* fstat */
+
+#include "wd_flight.h"
+
+/******************************* MACROS ***************************************/
+#define NSEC_IN_SEC (1000000000L)
+#define NSEC_IN_MSEC (1000000L)
+
+/************************** internal functions ********************************/
+/*	prints the valid records of the ring. returns how many were skipped */
+static size_t PrintRecords(const flight_header_t *header);
+
+/*	copies a record if it is the one written at index. returns TRUE if the
+	copy is whole */
+static int ReadRecord(const flight_record_t *slot, uint64_t index,
+					  flight_record_t *copy);
+
+static void PrintRecord(const flight_record_t *record, int64_t offset_ns,
+						uint64_t first_ns);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+	const char *path = FLIGHT_DEFAULT_PATH;
+	struct stat file_stat = {0};
+	const flight_header_t *header = NULL;
+	void *map = MAP_FAILED;
+	size_t skipped = 0;
+	int fd = -1;
+	
+	if (1 < argc)
+	{
+		path = argv[1];
+	}
+	else if (NULL != getenv(FLIGHT_PATH_ENV))
+	{
+		path = getenv(FLIGHT_PATH_ENV);
+	}
+	
+	fd = open(path, O_RDONLY);
+	if (0 > fd || 0 != fstat(fd, &file_stat) ||
+		(off_t)sizeof(flight_header_t) > file_stat.st_size)
+	{
+		fprintf(stderr, "%s: can't read a flight log\n", path);
+		return (1);
+	}
+	
+	map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == map)
+	{
+		fprintf(stderr, "%s: mmap failed\n", path);
+		return (1);
+	}
+	
+	header = map;
+	if (0 != memcmp(header->magic, FLIGHT_MAGIC, sizeof(header->magic)) ||
+		FLIGHT_VERSION != header->version ||
+		(off_t)(sizeof(flight_header_t) + header->capacity *
+				sizeof(flight_record_t)) > file_stat.st_size)
+	{
+		fprintf(stderr, "%s: not a flight log (version %d)\n", path,
+				FLIGHT_VERSION);
+		munmap(map, file_stat.st_size);
+		return (1);
+	}
+	
+	skipped = PrintRecords(header);
+	if (0 < skipped)
+	{
+		printf("(%lu records skipped - being written or overwritten)\n",
+			   (unsigned long)skipped);
+	}
+	
+	munmap(map, file_stat.st_size);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** PrintRecords *************************************/
+static size_t PrintRecords(const flight_header_t *header)
+{
+	const flight_record_t *slots = (const flight_record_t *)(header + 1);
+	flight_record_t record;
+	uint64_t head = atomic_load((_Atomic uint64_t *)&(header->head));
+	uint64_t first_ns = 0;
+	uint64_t index = 0;
+	size_t skipped = 0;
+	
+	/* the ring holds only the last capacity events */
+	index = (head > header->capacity) ? head - header->capacity : 0;
+	
+	printf("%-8s %-15s %12s %8s  %-14s %10s %10s  %s\n",
+		   "seq", "time", "+ms", "pid", "event", "arg1", "arg2", "text");
+	
+	for (; index < head; ++index)
+	{
+		if (!ReadRecord(&slots[index % header->capacity], index, &record))
+		{
+			++skipped;
+			continue;
+		}
+		
+		if (0 == first_ns)
+		{
+			first_ns = record.time_ns;
+		}
+		PrintRecord(&record, header->realtime_offset_ns, first_ns);
+	}
+	
+	return (skipped);
+}
+
+
+/*************************** ReadRecord ***************************************/
+static int ReadRecord(const flight_record_t *slot, uint64_t index,
+					  flight_record_t *copy)
+{
+	_Atomic uint64_t *seq = (_Atomic uint64_t *)&(slot->seq);
+	uint64_t seq_before = 0;
+	
+	seq_before = atomic_load_explicit(seq, memory_order_acquire);
+	if (index + 1 != seq_before)
+	{
+		return (FALSE);
+	}
+	
+	memcpy(copy, slot, sizeof(*copy));
+	
+	/* the record was not rewritten while copied */
+	atomic_thread_fence(memory_order_acquire);
+	
+	return (seq_before == atomic_load_explicit(seq, memory_order_relaxed));
+}
+
+
+/*************************** PrintRecord **************************************/
+static void PrintRecord(const flight_record_t *record, int64_t offset_ns,
+						uint64_t first_ns)
+{
+	int64_t real_ns = (int64_t)record->time_ns + offset_ns;
+	time_t real_sec = real_ns / NSEC_IN_SEC;
+	struct tm local = {0};
+	char clock_str[16] = {0};
+	
+	localtime_r(&real_sec, &local);
+	strftime(clock_str, sizeof(clock_str), "%H:%M:%S", &local);
+	
+	printf("%-8lu %s.%03ld %12.3f %8d  %-14s %10ld %10ld  %.*s\n",
+		   (unsigned long)atomic_load((_Atomic uint64_t *)&(record->seq)),
+		   clock_str,
+		   (long)((real_ns % NSEC_IN_SEC) / NSEC_IN_MSEC),
+		   (double)(record->time_ns - first_ns) / NSEC_IN_MSEC,
+		   (int)record->pid,
+		   FlightEventName(record->event),
+		   (long)record->arg1,
+		   (long)record->arg2,
+		   FLIGHT_TEXT_SIZE, record->text);
+}
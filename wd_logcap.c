@@ -0,0 +1,693 @@
+/*******************************************************************************
+*	Filename	:	wd_logcap.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	log capture source file. the data of a pipe is moved to
+					the log by splice (page references, not bytes) - only the
+					header lines are written by the WD. a file system which
+					can't take a splice is written by read & write instead.
+*******************************************************************************/
+#define _GNU_SOURCE				/* splice, tee, pipe2 */
+
+#include <assert.h> 		/* assert */
+#include <errno.h>			/* errno */
+#include <fcntl.h>			/* open, fcntl, splice, tee, pipe2 */
+#include <limits.h>			/* PATH_MAX, LONG_MAX */
+#include <poll.h>			/* POLLIN, POLLHUP */
+#include <signal.h>			/* signal, SIGPIPE */
+#include <stdio.h>			/* snprintf, sscanf, rename */
+#include <stdlib.h>			/* getenv, unsetenv */
+#include <string.h>			/* strncpy, memcpy */
+#include <time.h>			/* time, localtime_r, strftime */
+#include <unistd.h>			/* close, dup2, read, write, pread, lseek */
+#include <sys/ioctl.h>		/* ioctl, FIONREAD */
+#include <sys/stat.h>		/* fstat, S_ISFIFO */
+
+#include "wd_logcap.h"
+#include "wd_env.h"
+
+/******************************* MACROS ***************************************/
+#define STREAMS (2)						/* stdout & stderr */
+#define HEADER_SIZE (128)
+#define ROTATED_PATH_SIZE (PATH_MAX + 16)
+#define COPY_BUFFER_SIZE (4096)			/* when splice can't be used */
+#define BYTES_IN_KB (1024)
+
+/***************************** structures *************************************/
+/*	a stream of an instance, read by the scheduler. fd -1 - a free slot */
+typedef struct capture_s
+{
+	int			fd;				/* the read end of its pipe */
+	int			tee_fd;			/* the stream of the WD it's copied to. -1 -
+								   none */
+	int			stream;			/* 0 - stdout, 1 - stderr */
+	pid_t		pid;			/* of the instance */
+	uint64_t	generation;
+	uint64_t	id;				/* tells the records of the slot apart from
+								   those of its previous captures */
+} capture_t;
+
+/************************* global variable ************************************/
+/*	the log of the WD. -1 - not capturing */
+static int g_log_fd = -1;
+static char g_path[PATH_MAX] = {0};
+static off_t g_log_size = 0;
+static off_t g_max_bytes = (off_t)LOGCAP_MAX_KB * BYTES_IN_KB;
+static int g_keep = LOGCAP_KEEP;
+static int g_no_splice = FALSE;
+
+/*	the streams of the WD which are pipes, if LOGCAP_TEE_ENV */
+static int g_tee_fds[STREAMS] = {-1, -1};
+
+static capture_t g_captures[LOGCAP_MAX_CAPTURES];
+static int g_captures_init = FALSE;
+static uint64_t g_last_id = 0;			/* the source of the last record */
+static uint64_t g_next_id = 0;
+
+/*	the generation of the instance spawned last (1 - the app which has
+	created the WD) */
+static uint64_t g_generation = 1;
+
+/*	the pipes held by the app, and their variable for the WD */
+static int g_held_fds[STREAMS] = {-1, -1};
+static char g_held_var[LOGCAP_VAR_SIZE] = {0};
+
+static const char *const g_stream_names[STREAMS] = {"stdout", "stderr"};
+
+/************************** internal functions ********************************/
+/*	fd handler of a capture - moves what the pipe has to the log. DONE once
+	every writer has closed it */
+static int CaptureHandler(int fd, short revents, void *arg);
+
+/*	captures fd by sched into a free slot. closes fd if it can't */
+static void StartCapture(scheduler_t *sched, int fd, int stream,
+						 uint64_t generation, pid_t pid);
+static void EndCapture(capture_t *capture);
+static int FreeSlots(void);
+
+/*	appends size bytes of capture to the log - rotated first if it would
+	grow beyond its limit, and after a header if the last record was of
+	another source. bytes which can't be written are dropped, so the app
+	never blocks on a full pipe */
+static void Record(capture_t *capture, size_t size);
+static void WriteHeader(const capture_t *capture);
+static ssize_t MoveToLog(int fd, size_t size);
+static void Discard(int fd, size_t size);
+
+/*	<path> -> <path>.1 -> ... -> <path>.<keep>, and a new <path> */
+static void Rotate(void);
+static status_t OpenLog(void);
+
+/*	reads & removes LOGCAP_PIPES_ENV. FALSE if it doesn't name two pipes */
+static int TakePipes(uint64_t *generation, int fds[STREAMS]);
+
+/*	points the stdout & stderr of this proc which are ends of the pipes of
+	fds to path (NULL - /dev/null) */
+static void MoveStdio(const int fds[STREAMS], const char *path);
+
+static int IsPipe(int fd);
+static int IsSameFile(int fd1, int fd2);
+static void CloseFd(int *fd);
+
+
+/******************************************************************************
+*							LogCapAdopt
+*******************************************************************************/
+status_t LogCapAdopt(scheduler_t *sched, pid_t app_pid)
+{
+	const char *path = getenv(LOGCAP_PATH_ENV);
+	uint64_t generation = 0;
+	int fds[STREAMS] = {-1, -1};
+	int has_pipes = FALSE;
+	int i = 0;
+	
+	assert(sched);
+	
+	has_pipes = TakePipes(&generation, fds);
+	
+	if (NULL != path && '\0' != *path)
+	{
+		strncpy(g_path, path, sizeof(g_path) - 1);
+		g_max_bytes = (off_t)EnvToLong(LOGCAP_MAX_KB_ENV, LOGCAP_MAX_KB, 1,
+									   LONG_MAX / BYTES_IN_KB) * BYTES_IN_KB;
+		g_keep = (int)EnvToLong(LOGCAP_KEEP_ENV, LOGCAP_KEEP, 0,
+								LOGCAP_MAX_KEEP);
+		OpenLog();
+	}
+	
+	/*	the pipes are drained even if the log can't be written - the app
+		would block on them otherwise */
+	if (has_pipes && 0 > g_log_fd)
+	{
+		g_log_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	}
+	if (0 > g_log_fd)
+	{
+		CloseFd(&fds[0]);
+		CloseFd(&fds[1]);
+		
+		return (FAILURE);
+	}
+	
+	/*	a reader of a teed stream may go away - the WD mustn't end by it
+		(an instance gets the default back in LogCapChild) */
+	if (1 == EnvToLong(LOGCAP_TEE_ENV, 0, 0, 1))
+	{
+		for (i = 0; i < STREAMS; ++i)
+		{
+			g_tee_fds[i] = IsPipe(STDOUT_FILENO + i) ? STDOUT_FILENO + i : -1;
+		}
+		signal(SIGPIPE, SIG_IGN);
+	}
+	
+	if (has_pipes)
+	{
+		g_generation = generation;
+		for (i = 0; i < STREAMS; ++i)
+		{
+			StartCapture(sched, fds[i], i, generation, app_pid);
+		}
+	}
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							LogCapHold
+*******************************************************************************/
+void LogCapHold(void)
+{
+	uint64_t generation = 0;
+	
+	if (0 <= g_held_fds[0] || !TakePipes(&generation, g_held_fds))
+	{
+		return;
+	}
+	
+	snprintf(g_held_var, sizeof(g_held_var), "%s=%llu,%d,%d",
+			 LOGCAP_PIPES_ENV, (unsigned long long)generation, g_held_fds[0],
+			 g_held_fds[1]);
+}
+
+
+/******************************************************************************
+*							LogCapPrepare
+*******************************************************************************/
+void LogCapPrepare(logcap_spawn_t *spawn)
+{
+	assert(spawn);
+	
+	spawn->out[0] = spawn->out[1] = -1;
+	spawn->err[0] = spawn->err[1] = -1;
+	spawn->generation = g_generation + 1;
+	spawn->env_var[0] = '\0';
+	
+	/* a WD spawned by the app takes over the pipes of the app */
+	if (0 <= g_held_fds[0])
+	{
+		memcpy(spawn->env_var, g_held_var, sizeof(spawn->env_var));
+		
+		return;
+	}
+	
+	/* without a free slot, the instance gets the streams of this proc */
+	if (0 > g_log_fd || STREAMS > FreeSlots())
+	{
+		return;
+	}
+	
+	if (0 != pipe2(spawn->out, O_CLOEXEC))
+	{
+		spawn->out[0] = spawn->out[1] = -1;
+		
+		return;
+	}
+	if (0 != pipe2(spawn->err, O_CLOEXEC))
+	{
+		CloseFd(&spawn->out[0]);
+		CloseFd(&spawn->out[1]);
+		spawn->err[0] = spawn->err[1] = -1;
+		
+		return;
+	}
+	
+	snprintf(spawn->env_var, sizeof(spawn->env_var), "%s=%llu,%d,%d",
+			 LOGCAP_PIPES_ENV, (unsigned long long)spawn->generation,
+			 spawn->out[0], spawn->err[0]);
+}
+
+
+/******************************************************************************
+*							LogCapChild
+*******************************************************************************/
+void LogCapChild(const logcap_spawn_t *spawn)
+{
+	assert(spawn);
+	
+	/*	the write ends are closed by exec. the read ends are held by the new
+		instance - its pipes outlive this WD */
+	if (0 <= spawn->out[1])
+	{
+		dup2(spawn->out[1], STDOUT_FILENO);
+		dup2(spawn->err[1], STDERR_FILENO);
+		fcntl(spawn->out[0], F_SETFD, 0);
+		fcntl(spawn->err[0], F_SETFD, 0);
+	}
+	else if (0 <= g_held_fds[0])
+	/* the WD writes to streams of its own, not to the log of the app */
+	{
+		MoveStdio(g_held_fds, NULL);
+		fcntl(g_held_fds[0], F_SETFD, 0);
+		fcntl(g_held_fds[1], F_SETFD, 0);
+	}
+	
+	if (0 <= g_tee_fds[0] || 0 <= g_tee_fds[1])
+	{
+		signal(SIGPIPE, SIG_DFL);
+	}
+}
+
+
+/******************************************************************************
+*							LogCapSpawned
+*******************************************************************************/
+void LogCapSpawned(logcap_spawn_t *spawn, pid_t pid, scheduler_t *sched)
+{
+	assert(spawn);
+	
+	CloseFd(&spawn->out[1]);
+	CloseFd(&spawn->err[1]);
+	
+	if (0 > spawn->out[0])
+	{
+		return;
+	}
+	
+	if (0 > pid || NULL == sched)
+	{
+		CloseFd(&spawn->out[0]);
+		CloseFd(&spawn->err[0]);
+		
+		return;
+	}
+	
+	g_generation = spawn->generation;
+	StartCapture(sched, spawn->out[0], 0, spawn->generation, pid);
+	StartCapture(sched, spawn->err[0], 1, spawn->generation, pid);
+	spawn->out[0] = spawn->err[0] = -1;
+}
+
+
+/******************************************************************************
+*							LogCapClose
+*******************************************************************************/
+void LogCapClose(void)
+{
+	int pending = 0;
+	int i = 0;
+	
+	for (i = 0; g_captures_init && i < LOGCAP_MAX_CAPTURES; ++i)
+	{
+		if (0 <= g_captures[i].fd &&
+			0 == ioctl(g_captures[i].fd, FIONREAD, &pending) && 0 < pending)
+		{
+			Record(&g_captures[i], (size_t)pending);
+		}
+		EndCapture(&g_captures[i]);
+	}
+	CloseFd(&g_log_fd);
+	
+	/*	the app goes on without a WD - its streams mustn't be left on pipes
+		which nobody reads */
+	if (0 <= g_held_fds[0])
+	{
+		MoveStdio(g_held_fds, getenv(LOGCAP_PATH_ENV));
+		CloseFd(&g_held_fds[0]);
+		CloseFd(&g_held_fds[1]);
+	}
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** CaptureHandler ***********************************/
+/* this func is of type fd_func_t */
+static int CaptureHandler(int fd, short revents, void *arg)
+{
+	capture_t *capture = (capture_t *)arg;
+	int pending = 0;
+	
+	assert(arg);
+	
+	if (0 != ioctl(fd, FIONREAD, &pending))
+	{
+		pending = 0;
+	}
+	
+	if (0 < pending)
+	{
+		Record(capture, (size_t)pending);
+		
+		return (REPEAT);
+	}
+	
+	/*	empty & hung up - every instance which had the pipe has ended. the fd
+		is removed from the scheduler by returning DONE */
+	if (revents & (POLLHUP | POLLERR))
+	{
+		EndCapture(capture);
+		
+		return (DONE);
+	}
+	
+	return (REPEAT);
+}
+
+
+/*************************** StartCapture *************************************/
+static void StartCapture(scheduler_t *sched, int fd, int stream,
+						 uint64_t generation, pid_t pid)
+{
+	capture_t *capture = NULL;
+	int i = 0;
+	
+	FreeSlots();
+	for (i = 0; i < LOGCAP_MAX_CAPTURES && NULL == capture; ++i)
+	{
+		capture = (0 > g_captures[i].fd) ? &g_captures[i] : NULL;
+	}
+	
+	if (NULL == capture ||
+		SUCCESS != SchedulerAddFd(sched, fd, POLLIN, CaptureHandler, capture))
+	{
+		close(fd);
+		
+		return;
+	}
+	
+	capture->fd = fd;
+	capture->tee_fd = g_tee_fds[stream];
+	capture->stream = stream;
+	capture->pid = pid;
+	capture->generation = generation;
+	capture->id = ++g_next_id;
+}
+
+
+/*************************** EndCapture ***************************************/
+static void EndCapture(capture_t *capture)
+{
+	CloseFd(&capture->fd);
+}
+
+
+/*************************** FreeSlots ****************************************/
+static int FreeSlots(void)
+{
+	int count = 0;
+	int i = 0;
+	
+	if (!g_captures_init)
+	{
+		for (i = 0; i < LOGCAP_MAX_CAPTURES; ++i)
+		{
+			g_captures[i].fd = -1;
+		}
+		g_captures_init = TRUE;
+	}
+	
+	for (i = 0; i < LOGCAP_MAX_CAPTURES; ++i)
+	{
+		count += (0 > g_captures[i].fd);
+	}
+	
+	return (count);
+}
+
+
+/*************************** Record *******************************************/
+static void Record(capture_t *capture, size_t size)
+{
+	ssize_t moved = 0;
+	
+	if (0 < g_log_size && g_max_bytes < g_log_size + (off_t)size)
+	{
+		Rotate();
+	}
+	if (capture->id != g_last_id)
+	{
+		WriteHeader(capture);
+	}
+	
+	/*	tee only references the pages - they stay in the pipe for splice. a
+		full pipe of the WD misses the copy, the log doesn't */
+	if (0 <= capture->tee_fd)
+	{
+		tee(capture->fd, capture->tee_fd, size, SPLICE_F_NONBLOCK);
+	}
+	
+	moved = MoveToLog(capture->fd, size);
+	if (0 < moved)
+	{
+		g_log_size += moved;
+	}
+	else if (0 > moved && EAGAIN != errno)
+	{
+		Discard(capture->fd, size);
+	}
+}
+
+
+/*************************** WriteHeader **************************************/
+static void WriteHeader(const capture_t *capture)
+{
+	char header[HEADER_SIZE] = {0};
+	char stamp[32] = {0};
+	char last = '\n';
+	time_t now = time(NULL);
+	struct tm now_tm = {0};
+	int size = 0;
+	
+	localtime_r(&now, &now_tm);
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &now_tm);
+	
+	/* the previous record may have ended in the middle of a line */
+	if (0 < g_log_size && 1 == pread(g_log_fd, &last, 1, g_log_size - 1) &&
+		'\n' != last)
+	{
+		header[size] = '\n';
+		++size;
+	}
+	
+	size += snprintf(header + size, sizeof(header) - (size_t)size,
+					 "=== generation %llu, pid %d, %s, %s ===\n",
+					 (unsigned long long)capture->generation, capture->pid,
+					 g_stream_names[capture->stream], stamp);
+	size = (size < (int)sizeof(header)) ? size : (int)sizeof(header) - 1;
+	
+	if (size == write(g_log_fd, header, (size_t)size))
+	{
+		g_log_size += size;
+		g_last_id = capture->id;
+	}
+}
+
+
+/*************************** MoveToLog ****************************************/
+static ssize_t MoveToLog(int fd, size_t size)
+{
+	char buffer[COPY_BUFFER_SIZE];
+	ssize_t moved = -1;
+	
+	if (!g_no_splice)
+	{
+		moved = splice(fd, NULL, g_log_fd, NULL, size,
+					   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (0 <= moved || EINVAL != errno)
+		{
+			return (moved);
+		}
+		g_no_splice = TRUE;
+	}
+	
+	size = (size < sizeof(buffer)) ? size : sizeof(buffer);
+	moved = read(fd, buffer, size);
+	if (0 < moved && moved != write(g_log_fd, buffer, (size_t)moved))
+	{
+		/* the bytes are gone from the pipe anyway */
+		errno = EIO;
+		
+		return (-1);
+	}
+	
+	return (moved);
+}
+
+
+/*************************** Discard ******************************************/
+static void Discard(int fd, size_t size)
+{
+	char buffer[COPY_BUFFER_SIZE];
+	ssize_t size_read = 0;
+	
+	while (0 < size &&
+		   0 < (size_read = read(fd, buffer, (size < sizeof(buffer)) ?
+											 size : sizeof(buffer))))
+	{
+		size -= (size_t)size_read;
+	}
+}
+
+
+/*************************** Rotate *******************************************/
+static void Rotate(void)
+{
+	char from[ROTATED_PATH_SIZE] = {0};
+	char to[ROTATED_PATH_SIZE] = {0};
+	int i = 0;
+	
+	/* the oldest is overwritten by the rename */
+	for (i = g_keep; 1 < i; --i)
+	{
+		snprintf(from, sizeof(from), "%s.%d", g_path, i - 1);
+		snprintf(to, sizeof(to), "%s.%d", g_path, i);
+		rename(from, to);
+	}
+	if (0 < g_keep)
+	{
+		snprintf(to, sizeof(to), "%s.1", g_path);
+		rename(g_path, to);
+	}
+	else
+	{
+		unlink(g_path);
+	}
+	
+	CloseFd(&g_log_fd);
+	if (SUCCESS != OpenLog())
+	{
+		g_log_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	}
+	
+	/* a new file starts with a header */
+	g_last_id = 0;
+}
+
+
+/*************************** OpenLog ******************************************/
+static status_t OpenLog(void)
+{
+	/*	not O_APPEND - a splice into it fails on older kernels. the WD is
+		the only writer while it runs. readable - WriteHeader checks the
+		last byte */
+	g_log_fd = open(g_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (0 > g_log_fd)
+	{
+		return (FAILURE);
+	}
+	
+	g_log_size = lseek(g_log_fd, 0, SEEK_END);
+	g_log_size = (0 > g_log_size) ? 0 : g_log_size;
+	
+	return (SUCCESS);
+}
+
+
+/*************************** TakePipes ****************************************/
+static int TakePipes(uint64_t *generation, int fds[STREAMS])
+{
+	const char *var = getenv(LOGCAP_PIPES_ENV);
+	unsigned long long number = 0;
+	int is_valid = FALSE;
+	
+	if (NULL == var)
+	{
+		return (FALSE);
+	}
+	
+	is_valid = (3 == sscanf(var, "%llu,%d,%d", &number, &fds[0], &fds[1]) &&
+				fds[0] != fds[1] && IsPipe(fds[0]) && IsPipe(fds[1]) &&
+				O_RDONLY == (fcntl(fds[0], F_GETFL) & O_ACCMODE) &&
+				O_RDONLY == (fcntl(fds[1], F_GETFL) & O_ACCMODE));
+	
+	/* the procs created by this one (not by SpawnOtherProc) won't see it */
+	unsetenv(LOGCAP_PIPES_ENV);
+	
+	if (!is_valid)
+	{
+		fds[0] = fds[1] = -1;
+		
+		return (FALSE);
+	}
+	
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	*generation = number;
+	
+	return (TRUE);
+}
+
+
+/*************************** MoveStdio ****************************************/
+static void MoveStdio(const int fds[STREAMS], const char *path)
+{
+	int fd = -1;
+	int i = 0;
+	int j = 0;
+	
+	if (NULL != path && '\0' != *path)
+	{
+		fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	}
+	if (0 > fd)
+	{
+		fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	}
+	
+	for (i = STDOUT_FILENO; i <= STDERR_FILENO; ++i)
+	{
+		for (j = 0; j < STREAMS; ++j)
+		{
+			if (0 <= fd && IsSameFile(i, fds[j]))
+			{
+				dup2(fd, i);
+			}
+		}
+	}
+	
+	CloseFd(&fd);
+}
+
+
+/*************************** IsPipe *******************************************/
+static int IsPipe(int fd)
+{
+	struct stat stat_buf = {0};
+	
+	return (0 == fstat(fd, &stat_buf) && S_ISFIFO(stat_buf.st_mode));
+}
+
+
+/*************************** IsSameFile ***************************************/
+static int IsSameFile(int fd1, int fd2)
+{
+	struct stat stat1 = {0};
+	struct stat stat2 = {0};
+	
+	/* the two ends of a pipe are the same inode */
+	return (0 == fstat(fd1, &stat1) && 0 == fstat(fd2, &stat2) &&
+			stat1.st_dev == stat2.st_dev && stat1.st_ino == stat2.st_ino);
+}
+
+
+/*************************** CloseFd ******************************************/
+static void CloseFd(int *fd)
+{
+	if (0 <= *fd)
+	{
+		close(*fd);
+		*fd = -1;
+	}
+}
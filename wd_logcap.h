@@ -0,0 +1,105 @@
+/******************************************************************************
+ * File name  : wd_logcap.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: log capture - the stdout & stderr of every app instance
+ *				revived by the WD are pipes of the WD, moved by splice into
+ *				a size-rotated log file (the bytes aren't copied through the
+ *				WD). a record - the bytes of one stream of one instance in a
+ *				row - starts with a header line: its generation, pid & stream.
+ *				the app holds its pipes open, so a revived WD adopts them.
+ ******************************************************************************/
+#ifndef _WD_LOGCAP_H_
+#define _WD_LOGCAP_H_
+
+#include <stdint.h>			/* uint64_t */
+#include <sys/types.h>		/* pid_t */
+
+#include "./scheduler/scheduler.h"
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+/*	environment variables of the app (passed on to the WD). no path - the
+	instances inherit the stdout & stderr of the WD */
+#define LOGCAP_PATH_ENV "WD_APP_LOG"			/* the log file */
+#define LOGCAP_MAX_KB_ENV "WD_APP_LOG_MAX_KB"	/* rotated beyond it */
+#define LOGCAP_KEEP_ENV "WD_APP_LOG_KEEP"		/* <path>.1 ... .<keep> */
+#define LOGCAP_TEE_ENV "WD_APP_LOG_TEE"			/* 1 - copied by tee to the
+												   stdout/stderr of the WD
+												   as well, if they're pipes */
+#define LOGCAP_MAX_KB (10240)					/* the defaults */
+#define LOGCAP_KEEP (3)
+#define LOGCAP_MAX_KEEP (100)					/* a larger keep - the
+												   default */
+
+/*	internal - "<generation>,<stdout fd>,<stderr fd>" of the read ends of the
+	pipes of an instance, inherited from its spawner */
+#define LOGCAP_PIPES_ENV "WD_LOG_PIPES"
+#define LOGCAP_VAR_SIZE (sizeof(LOGCAP_PIPES_ENV) + 48)
+
+#define LOGCAP_MAX_CAPTURES (8)			/* streams read at once - 2 per
+										   instance which still writes */
+
+/*** structures ***/
+/*	the pipes of a proc being spawned, from LogCapPrepare to LogCapSpawned */
+typedef struct logcap_spawn_s
+{
+	int			out[2];			/* pipe(2) ends. -1 - none */
+	int			err[2];
+	uint64_t	generation;		/* of the new instance */
+	char		env_var[LOGCAP_VAR_SIZE];	/* for its environment. empty -
+											   nothing to pass */
+} logcap_spawn_t;
+
+/******************************* LogCapAdopt **********************************/
+/*
+ * description  :  for the WD - opens the log file (LOGCAP_PATH_ENV), and
+ *				   captures the pipes of app_pid if it was revived by a
+ *				   previous WD (LOGCAP_PIPES_ENV). call after the scheduler
+ *				   is created.
+ *
+ * return value :  SUCCESS if capturing - otherwise nothing is captured.
+ */
+status_t LogCapAdopt(scheduler_t *sched, pid_t app_pid);
+
+/******************************* LogCapHold ***********************************/
+/*
+ * description  :  for the app - keeps the read ends of its pipes (if it was
+ *				   revived by a capturing WD), for the WD it spawns.
+ */
+void LogCapHold(void);
+
+/****************************** LogCapPrepare *********************************/
+/*
+ * description  :  before fork - new pipes for an instance of the app, if
+ *				   this proc captures, or the held pipes for a WD.
+ *				   spawn->env_var is set for the environment of the child.
+ */
+void LogCapPrepare(logcap_spawn_t *spawn);
+
+/******************************* LogCapChild **********************************/
+/*
+ * description  :  in the child, before exec - makes the pipes of spawn its
+ *				   stdout & stderr, and keeps the read ends open. a WD
+ *				   spawned by the app keeps the held pipes open instead, and
+ *				   gets /dev/null for the streams which were on them.
+ */
+void LogCapChild(const logcap_spawn_t *spawn);
+
+/****************************** LogCapSpawned *********************************/
+/*
+ * description  :  in the parent, after fork (pid - its result. negative -
+ *				   failed, or not forked) - starts capturing the pipes of the
+ *				   new instance by sched, and closes the ends it doesn't use.
+ */
+void LogCapSpawned(logcap_spawn_t *spawn, pid_t pid, scheduler_t *sched);
+
+/******************************* LogCapClose **********************************/
+/*
+ * description  :  moves what's left in the pipes to the log and closes them.
+ *				   an app which holds its pipes writes to the log file from
+ *				   now on. the scheduler isn't used - it may be destroyed.
+ */
+void LogCapClose(void);
+
+#endif /* _WD_LOGCAP_H_ */
@@ -0,0 +1,334 @@
+/******************************************************************************
+*	Filename	:	wd_logcap_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	log capture test file. every capture is of a pair of
+*					pipes passed as by a previous WD (LOGCAP_PIPES_ENV), and
+*					drained into the log by LogCapClose
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L	/* setenv, unsetenv */
+
+#include <stdio.h> 		/* printf, snprintf */
+#include <stdlib.h>		/* setenv, unsetenv */
+#include <string.h>		/* memset, strlen, strncmp, strstr */
+#include <fcntl.h>		/* open */
+#include <unistd.h>		/* pipe, write, read, close, unlink, getpid */
+
+#include "wd_logcap.h"
+#include "./utils/general_types.h"
+
+/******************************* MACROS ***************************************/
+#define PATH_SIZE (128)
+#define LOG_SIZE (4096)
+#define HEADER_SIZE (128)
+#define RECORD_BYTES (700)		/* two don't fit in a log of 1 KB */
+#define ROUNDS (5)
+#define MAX_ROTATED (4)
+
+/************************** unit-test functions *******************************/
+void LogCapHeaderTest(void);
+void LogCapRotateTest(void);
+void LogCapBadEnvTest(void);
+
+/*************************** helper functions *********************************/
+/*	captures out to the stdout & err to the stderr of an instance of
+	generation, until LogCapClose. SUCCESS if all was written to the pipes */
+static status_t Capture(uint64_t generation, const char *out, size_t out_size,
+						const char *err, size_t err_size);
+
+/*	ROUNDS captures of RECORD_BYTES to stdout - generation i is all 'a' + i */
+static status_t CaptureRounds(void);
+
+/*	whether text starts with a record of stream of generation - a header and
+	then data. returns the data, NULL if it isn't so */
+static const char *SkipHeader(const char *text, uint64_t generation,
+							  const char *stream);
+
+/*	whether the log (rotated - its number, 0 - the log itself) is one
+	record of CaptureRounds of generation */
+static int IsRoundLog(int rotated, uint64_t generation);
+
+/*	reads the log (rotated as in IsRoundLog) into text, null-terminated.
+	returns its size - -1 if there's no such file */
+static ssize_t ReadLog(int rotated, char *text, size_t size);
+
+/*	a new log - its rotated ones are removed */
+static void RemoveLogs(void);
+
+static void LogPath(int rotated, char *path, size_t size);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	char path[PATH_SIZE] = {0};
+	
+	printf("\n***** UNIT-TEST FOR LOGCAP'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	LogPath(0, path, sizeof(path));
+	setenv(LOGCAP_PATH_ENV, path, 1);
+	
+	LogCapHeaderTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	LogCapRotateTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	LogCapBadEnvTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	RemoveLogs();
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* LogCapHeaderTest ***********************************/
+void LogCapHeaderTest(void)
+{
+	char text[LOG_SIZE] = {0};
+	const char *data = text;
+	status_t status = SUCCESS;
+	
+	printf("Record (generation headers):\t\t");
+	
+	RemoveLogs();
+	unsetenv(LOGCAP_MAX_KB_ENV);
+	unsetenv(LOGCAP_KEEP_ENV);
+	
+	/*	the stderr record ends in the middle of a line - the next header
+		must start on a line of its own */
+	status |= Capture(7, "out\n", 4, "err", 3);
+	status |= Capture(8, "next", 4, "", 0);
+	ReadLog(0, text, sizeof(text));
+	
+	data = SkipHeader(data, 7, "stdout");
+	data = (NULL != data && 0 == strncmp(data, "out\n", 4)) ? data + 4 : NULL;
+	data = (NULL != data) ? SkipHeader(data, 7, "stderr") : NULL;
+	data = (NULL != data && 0 == strncmp(data, "err\n", 4)) ? data + 4 : NULL;
+	data = (NULL != data) ? SkipHeader(data, 8, "stdout") : NULL;
+	
+	(SUCCESS == status)					&&
+	(NULL != data)						&&
+	(0 == strcmp(data, "next"))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* LogCapRotateTest ***********************************/
+void LogCapRotateTest(void)
+{
+	char text[LOG_SIZE] = {0};
+	status_t status = SUCCESS;
+	
+	printf("Rotate (<path>.N shifted):\t\t");
+	
+	RemoveLogs();
+	setenv(LOGCAP_MAX_KB_ENV, "1", 1);
+	setenv(LOGCAP_KEEP_ENV, "2", 1);
+	
+	/*	every record but the first rotates the log - the oldest ones are
+		gone, the rest are shifted by one */
+	status = CaptureRounds();
+	
+	(SUCCESS == status)					&&
+	(TRUE == IsRoundLog(0, ROUNDS))		&&
+	(TRUE == IsRoundLog(1, ROUNDS - 1))	&&
+	(TRUE == IsRoundLog(2, ROUNDS - 2))	&&
+	(0 > ReadLog(3, text, sizeof(text)))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* LogCapBadEnvTest ***********************************/
+void LogCapBadEnvTest(void)
+{
+	char text[LOG_SIZE] = {0};
+	status_t status = SUCCESS;
+	
+	printf("Rotate (garbage keep - default):\t");
+	
+	/*	"abc" isn't 0 - the default keep (3) rotates, instead of removing
+		the log */
+	RemoveLogs();
+	setenv(LOGCAP_MAX_KB_ENV, "1", 1);
+	setenv(LOGCAP_KEEP_ENV, "abc", 1);
+	
+	status = CaptureRounds();
+	
+	(SUCCESS == status)					&&
+	(TRUE == IsRoundLog(0, ROUNDS))		&&
+	(TRUE == IsRoundLog(1, ROUNDS - 1))	&&
+	(TRUE == IsRoundLog(LOGCAP_KEEP, ROUNDS - LOGCAP_KEEP)) &&
+	(0 > ReadLog(LOGCAP_KEEP + 1, text, sizeof(text)))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* Capture ********************************************/
+static status_t Capture(uint64_t generation, const char *out, size_t out_size,
+						const char *err, size_t err_size)
+{
+	char var[HEADER_SIZE] = {0};
+	scheduler_t *sched = NULL;
+	int out_pipe[2] = {-1, -1};
+	int err_pipe[2] = {-1, -1};
+	status_t status = FAILURE;
+	
+	sched = SchedulerCreate();
+	if (NULL == sched || 0 != pipe(out_pipe) || 0 != pipe(err_pipe))
+	{
+		return (FAILURE);
+	}
+	
+	snprintf(var, sizeof(var), "%llu,%d,%d", (unsigned long long)generation,
+			 out_pipe[0], err_pipe[0]);
+	setenv(LOGCAP_PIPES_ENV, var, 1);
+	
+	if (SUCCESS == LogCapAdopt(sched, getpid()) &&
+		(ssize_t)out_size == write(out_pipe[1], out, out_size) &&
+		(ssize_t)err_size == write(err_pipe[1], err, err_size))
+	{
+		status = SUCCESS;
+	}
+	
+	/* the read ends are closed by it */
+	LogCapClose();
+	close(out_pipe[1]);
+	close(err_pipe[1]);
+	SchedulerDestroy(sched);
+	
+	return (status);
+}
+
+
+/************************* CaptureRounds **************************************/
+static status_t CaptureRounds(void)
+{
+	char record[RECORD_BYTES] = {0};
+	status_t status = SUCCESS;
+	int i = 0;
+	
+	for (i = 1; i <= ROUNDS; ++i)
+	{
+		memset(record, 'a' + i, sizeof(record));
+		status |= Capture(i, record, sizeof(record), "", 0);
+	}
+	
+	return (status);
+}
+
+
+/************************* SkipHeader *****************************************/
+static const char *SkipHeader(const char *text, uint64_t generation,
+							  const char *stream)
+{
+	char header[HEADER_SIZE] = {0};
+	const char *end = NULL;
+	
+	/* the time stamp follows, up to the end of the line */
+	snprintf(header, sizeof(header), "=== generation %llu, pid %d, %s, ",
+			 (unsigned long long)generation, getpid(), stream);
+	if (0 != strncmp(text, header, strlen(header)))
+	{
+		return (NULL);
+	}
+	
+	end = strstr(text, " ===\n");
+	
+	return ((NULL != end) ? end + strlen(" ===\n") : NULL);
+}
+
+
+/************************* IsRoundLog *****************************************/
+static int IsRoundLog(int rotated, uint64_t generation)
+{
+	char text[LOG_SIZE] = {0};
+	const char *data = NULL;
+	size_t i = 0;
+	
+	if (0 > ReadLog(rotated, text, sizeof(text)))
+	{
+		return (FALSE);
+	}
+	
+	data = SkipHeader(text, generation, "stdout");
+	if (NULL == data || RECORD_BYTES != strlen(data))
+	{
+		return (FALSE);
+	}
+	
+	for (i = 0; i < RECORD_BYTES; ++i)
+	{
+		if ('a' + generation != (uint64_t)data[i])
+		{
+			return (FALSE);
+		}
+	}
+	
+	return (TRUE);
+}
+
+
+/************************* ReadLog ********************************************/
+static ssize_t ReadLog(int rotated, char *text, size_t size)
+{
+	char path[PATH_SIZE] = {0};
+	ssize_t size_read = 0;
+	int fd = -1;
+	
+	LogPath(rotated, path, sizeof(path));
+	memset(text, 0, size);
+	
+	fd = open(path, O_RDONLY);
+	if (0 > fd)
+	{
+		return (-1);
+	}
+	
+	size_read = read(fd, text, size - 1);
+	close(fd);
+	
+	return (size_read);
+}
+
+
+/************************* RemoveLogs *****************************************/
+static void RemoveLogs(void)
+{
+	char path[PATH_SIZE] = {0};
+	int i = 0;
+	
+	for (i = 0; i <= MAX_ROTATED; ++i)
+	{
+		LogPath(i, path, sizeof(path));
+		unlink(path);
+	}
+}
+
+
+/************************* LogPath ********************************************/
+static void LogPath(int rotated, char *path, size_t size)
+{
+	if (0 == rotated)
+	{
+		snprintf(path, size, "/tmp/wd_logcap_test.%d.log", getpid());
+	}
+	else
+	{
+		snprintf(path, size, "/tmp/wd_logcap_test.%d.log.%d", getpid(),
+				 rotated);
+	}
+}
@@ -0,0 +1,622 @@
+/*******************************************************************************
+*	Filename	:	wd_metrics.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	metrics exporter source file. a scrape is a single
+					HTTP/1.0 exchange - the request is read as the scheduler
+					polls it, and the whole response is sent at once into a
+					send buffer which can hold it, so the scheduler never
+					waits for a scraper.
+*******************************************************************************/
+#define _GNU_SOURCE				/* accept4 */
+
+#include <assert.h> 		/* assert */
+#include <errno.h>			/* errno */
+#include <poll.h>			/* POLLIN */
+#include <stdarg.h>			/* va_list */
+#include <stdio.h>			/* vsnprintf, snprintf */
+#include <stdlib.h>			/* strtol */
+#include <string.h>			/* strncmp, strstr, strlen, memcpy */
+#include <unistd.h>			/* close, unlink */
+#include <arpa/inet.h>		/* htons, htonl */
+#include <netinet/in.h>		/* struct sockaddr_in, INADDR_LOOPBACK */
+#include <sys/socket.h>		/* socket, bind, listen, accept4, sendmsg */
+#include <sys/uio.h>		/* struct iovec */
+#include <sys/un.h>			/* struct sockaddr_un */
+
+#include "wd_metrics.h"
+#include "wd_sock.h"
+
+/******************************* MACROS ***************************************/
+#define UNUSED(x) ((void) x)
+#define REQUEST_SIZE (1024)			/* kept of a request - the rest is
+									   ignored */
+#define BODY_SIZE (16384)
+#define HEADER_SIZE (160)
+#define SEND_BUFFER (4 * BODY_SIZE)
+#define LOOPBACK_PREFIX "127.0.0.1:"
+#define MAX_PORT (65535)
+#define USEC_IN_SEC (1000000.0)
+
+/***************************** structures *************************************/
+/*	a connected scraper. fd -1 - a free slot */
+typedef struct client_s
+{
+	int			fd;
+	size_t		received;
+	char		request[REQUEST_SIZE];
+} client_t;
+
+/*	the text being formatted. used - beyond size if it's cut */
+typedef struct output_s
+{
+	char		*buffer;
+	size_t		size;
+	size_t		used;
+} output_t;
+
+/************************* global variable ************************************/
+static int g_listen_fd = -1;
+static char g_unix_path[sizeof(((struct sockaddr_un *)0)->sun_path)] = {0};
+static scheduler_t *g_sched = NULL;
+static metrics_collect_t g_collect = NULL;
+static void *g_collect_arg = NULL;
+static client_t g_clients[METRICS_MAX_CLIENTS];
+static char g_body[BODY_SIZE];
+
+/*	the upper bounds of the buckets of every histogram */
+static const uint64_t g_bounds_us[METRICS_BUCKETS] =
+{
+	100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+	500000, 1000000, 2500000, 5000000, 10000000
+};
+
+static const char *const g_class_names[TASK_CLASSES] =
+{
+	"critical", "normal", "background"
+};
+
+/************************** internal functions ********************************/
+/*	fd handler of the listening socket - accepts the pending scrapers */
+static int ListenHandler(int fd, short revents, void *arg);
+
+/*	fd handler of a scraper - reads its request, and once it's whole
+	responds & disconnects it (DONE) */
+static int ClientHandler(int fd, short revents, void *arg);
+static void Respond(client_t *client);
+static void Disconnect(client_t *client);
+
+/*	a listening socket by the METRICS_LISTEN_ENV format, or -1 */
+static int OpenSocket(const char *listen_on);
+static int OpenUnix(const char *path);
+static int OpenLoopback(long port);
+
+/*	the text format of snapshot. returns its size (beyond the buffer if it
+	was cut) */
+static size_t Format(const metrics_snapshot_t *snapshot, char *buffer,
+					 size_t size);
+static void Append(output_t *output, const char *format, ...);
+static void AppendFamily(output_t *output, const char *name,
+						 const char *type, const char *help);
+static void AppendCounter(output_t *output, const char *name,
+						  const char *help, uint64_t value);
+static void AppendHistogram(output_t *output, const char *name,
+							const char *help,
+							const metrics_histogram_t *histogram);
+
+
+/******************************************************************************
+*							MetricsObserve
+*******************************************************************************/
+void MetricsObserve(metrics_histogram_t *histogram, uint64_t value_us)
+{
+	size_t i = 0;
+	
+	assert(histogram);
+	
+	/* a fixed number of bounds */
+	while (i < METRICS_BUCKETS && value_us > g_bounds_us[i])
+	{
+		++i;
+	}
+	
+	++histogram->counts[i];
+	++histogram->count;
+	histogram->sum_us += value_us;
+}
+
+
+/******************************************************************************
+*							MetricsOpen
+*******************************************************************************/
+status_t MetricsOpen(scheduler_t *sched, const char *listen_on,
+					 metrics_collect_t collect, void *arg)
+{
+	int error = 0;
+	int i = 0;
+	
+	assert(sched);
+	assert(listen_on);
+	assert(collect);
+	
+	if (0 <= g_listen_fd)
+	{
+		errno = EALREADY;
+		
+		return (FAILURE);
+	}
+	
+	for (i = 0; i < METRICS_MAX_CLIENTS; ++i)
+	{
+		g_clients[i].fd = -1;
+	}
+	
+	g_listen_fd = OpenSocket(listen_on);
+	if (0 > g_listen_fd)
+	{
+		return (FAILURE);
+	}
+	
+	if (SUCCESS != SchedulerAddFd(sched, g_listen_fd, POLLIN, ListenHandler,
+								  NULL))
+	{
+		error = errno;
+		MetricsClose();
+		errno = error;
+		
+		return (FAILURE);
+	}
+	
+	g_sched = sched;
+	g_collect = collect;
+	g_collect_arg = arg;
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							MetricsClose
+*******************************************************************************/
+void MetricsClose(void)
+{
+	int i = 0;
+	
+	if (0 > g_listen_fd)
+	{
+		return;
+	}
+	
+	for (i = 0; i < METRICS_MAX_CLIENTS; ++i)
+	{
+		if (0 <= g_clients[i].fd)
+		{
+			Disconnect(&g_clients[i]);
+		}
+	}
+	
+	close(g_listen_fd);
+	g_listen_fd = -1;
+	if ('\0' != *g_unix_path)
+	{
+		unlink(g_unix_path);
+		*g_unix_path = '\0';
+	}
+	g_sched = NULL;
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** ListenHandler ************************************/
+/* this func is of type fd_func_t */
+static int ListenHandler(int fd, short revents, void *arg)
+{
+	client_t *client = NULL;
+	int client_fd = -1;
+	int send_buffer = SEND_BUFFER;
+	int i = 0;
+	
+	UNUSED(revents);
+	UNUSED(arg);
+	
+	while (0 <= (client_fd = accept4(fd, NULL, NULL,
+									 SOCK_NONBLOCK | SOCK_CLOEXEC)))
+	{
+		client = NULL;
+		for (i = 0; i < METRICS_MAX_CLIENTS && NULL == client; ++i)
+		{
+			client = (0 > g_clients[i].fd) ? &g_clients[i] : NULL;
+		}
+		
+		/*	too many scrapers at once - the next scrape will do */
+		if (NULL == client ||
+			SUCCESS != SchedulerAddFd(g_sched, client_fd, POLLIN,
+									  ClientHandler, client))
+		{
+			close(client_fd);
+			continue;
+		}
+		
+		/*	room for the whole response - it's sent without waiting */
+		setsockopt(client_fd, SOL_SOCKET, SO_SNDBUF, &send_buffer,
+				   sizeof(send_buffer));
+		client->fd = client_fd;
+		client->received = 0;
+	}
+	
+	return (REPEAT);
+}
+
+
+/*************************** ClientHandler ************************************/
+/* this func is of type fd_func_t */
+static int ClientHandler(int fd, short revents, void *arg)
+{
+	client_t *client = (client_t *)arg;
+	ssize_t got = 0;
+	
+	assert(arg);
+	UNUSED(revents);
+	
+	got = recv(fd, client->request + client->received,
+			   sizeof(client->request) - 1 - client->received, 0);
+	if (0 > got && (EAGAIN == errno || EINTR == errno))
+	{
+		return (REPEAT);
+	}
+	
+	if (0 < got)
+	{
+		client->received += (size_t)got;
+		client->request[client->received] = '\0';
+		
+		/*	the end of the headers, or all that is kept of them */
+		if (NULL == strstr(client->request, "\r\n\r\n") &&
+			sizeof(client->request) - 1 > client->received)
+		{
+			return (REPEAT);
+		}
+		
+		Respond(client);
+	}
+	
+	/* the fd is removed from the scheduler by returning DONE */
+	Disconnect(client);
+	
+	return (DONE);
+}
+
+
+/*************************** Respond ******************************************/
+static void Respond(client_t *client)
+{
+	static const char not_found[] = "HTTP/1.0 404 Not Found\r\n"
+									"Content-Length: 0\r\n"
+									"Connection: close\r\n\r\n";
+	metrics_snapshot_t snapshot = {0};
+	char header[HEADER_SIZE] = {0};
+	struct iovec iov[2] = {{0}};
+	struct msghdr msg = {0};
+	const char *path = client->request + strlen("GET ");
+	size_t body_size = 0;
+	
+	if (0 != strncmp(client->request, "GET ", strlen("GET ")) ||
+		!((0 == strncmp(path, "/metrics", strlen("/metrics")) &&
+		   strchr(" ?", path[strlen("/metrics")])) ||
+		  0 == strncmp(path, "/ ", strlen("/ "))))
+	{
+		send(client->fd, not_found, sizeof(not_found) - 1,
+			 MSG_NOSIGNAL | MSG_DONTWAIT);
+		
+		return;
+	}
+	
+	g_collect(&snapshot, g_collect_arg);
+	body_size = Format(&snapshot, g_body, sizeof(g_body));
+	body_size = (sizeof(g_body) < body_size) ? sizeof(g_body) : body_size;
+	
+	iov[0].iov_base = header;
+	iov[0].iov_len = snprintf(header, sizeof(header),
+							  "HTTP/1.0 200 OK\r\n"
+							  "Content-Type: text/plain; version=0.0.4\r\n"
+							  "Content-Length: %lu\r\n"
+							  "Connection: close\r\n\r\n",
+							  (unsigned long)body_size);
+	iov[1].iov_base = g_body;
+	iov[1].iov_len = body_size;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	
+	/*	a scraper whose socket can't take it all gets a cut response, and
+		its Content-Length tells it so */
+	sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+
+/*************************** Disconnect ***************************************/
+static void Disconnect(client_t *client)
+{
+	close(client->fd);
+	client->fd = -1;
+	client->received = 0;
+}
+
+
+/*************************** OpenSocket ***************************************/
+static int OpenSocket(const char *listen_on)
+{
+	char *end = NULL;
+	long port = 0;
+	
+	if ('/' == *listen_on)
+	{
+		return (OpenUnix(listen_on));
+	}
+	
+	/*	only the loopback - the metrics aren't for other hosts */
+	if (0 == strncmp(listen_on, LOOPBACK_PREFIX, strlen(LOOPBACK_PREFIX)))
+	{
+		listen_on += strlen(LOOPBACK_PREFIX);
+	}
+	
+	port = strtol(listen_on, &end, 10);
+	if (listen_on == end || '\0' != *end || 0 >= port || MAX_PORT < port)
+	{
+		errno = EINVAL;
+		
+		return (-1);
+	}
+	
+	return (OpenLoopback(port));
+}
+
+
+/*************************** OpenUnix *****************************************/
+static int OpenUnix(const char *path)
+{
+	struct sockaddr_un addr = {0};
+	int error = 0;
+	int fd = -1;
+	
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		
+		return (-1);
+	}
+	
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, strlen(path));
+	
+	/* the socket of a live WD (EADDRINUSE), and anything else, is kept */
+	if (SUCCESS != SockRemoveStale(&addr))
+	{
+		return (-1);
+	}
+	
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (0 > fd)
+	{
+		return (-1);
+	}
+	
+	if (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+	{
+		close(fd);
+		
+		return (-1);
+	}
+	memcpy(g_unix_path, path, strlen(path) + 1);
+	
+	if (0 != listen(fd, METRICS_MAX_CLIENTS))
+	{
+		error = errno;
+		close(fd);
+		unlink(g_unix_path);
+		*g_unix_path = '\0';
+		errno = error;
+		
+		return (-1);
+	}
+	
+	return (fd);
+}
+
+
+/*************************** OpenLoopback *************************************/
+static int OpenLoopback(long port)
+{
+	struct sockaddr_in addr = {0};
+	int reuse = TRUE;
+	int fd = -1;
+	
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (0 > fd)
+	{
+		return (-1);
+	}
+	
+	/*	a revived WD takes the port over from the one it replaces */
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+		0 != listen(fd, METRICS_MAX_CLIENTS))
+	{
+		close(fd);
+		
+		return (-1);
+	}
+	
+	return (fd);
+}
+
+
+/*************************** Format *******************************************/
+static size_t Format(const metrics_snapshot_t *snapshot, char *buffer,
+					 size_t size)
+{
+	const ctl_stats_t *stats = &(snapshot->stats);
+	output_t output = {0};
+	int i = 0;
+	
+	output.buffer = buffer;
+	output.size = size;
+	
+	AppendFamily(&output, "wd_uptime_seconds", "gauge",
+				 "Seconds since the WD has started.");
+	Append(&output, "wd_uptime_seconds %.3f\n", stats->uptime_ms / 1000.0);
+	
+	AppendFamily(&output, "wd_restarts_total", "counter",
+				 "Restarts of the app, by kind.");
+	Append(&output, "wd_restarts_total{kind=\"revive\"} %llu\n",
+		   (unsigned long long)stats->revives);
+	Append(&output, "wd_restarts_total{kind=\"planned\"} %llu\n",
+		   (unsigned long long)stats->planned_restarts);
+	
+	AppendCounter(&output, "wd_revive_failures_total",
+				  "Revive attempts which have failed.",
+				  stats->revive_failures);
+	AppendCounter(&output, "wd_app_exits_total",
+				  "Exits of the app, as reaped.", stats->exits);
+	AppendCounter(&output, "wd_app_crashes_total",
+				  "Exits of the app by a signal.", stats->crashes);
+	AppendCounter(&output, "wd_beats_sent_total",
+				  "Heartbeats sent to the app.", stats->beats_sent);
+	AppendCounter(&output, "wd_beats_received_total",
+				  "Heartbeats received from the app.",
+				  stats->beats_received);
+	AppendCounter(&output, "wd_deadline_misses_total",
+				  "Verdicts of a silent app.", stats->deadline_misses);
+	AppendCounter(&output, "wd_deadline_extensions_total",
+				  "Missed deadlines excused by overload.",
+				  stats->deadline_extensions);
+	AppendCounter(&output, "wd_control_requests_total",
+				  "Requests served on the control socket.",
+				  stats->requests);
+	
+	AppendFamily(&output, "wd_revive_state", "gauge",
+				 "0 - up, 1 - spawning, 2 - starting, 3 - failed, "
+				 "4 - terminating.");
+	Append(&output, "wd_revive_state %u\n", snapshot->revive_state);
+	AppendFamily(&output, "wd_paused", "gauge",
+				 "1 while the verdicts are paused.");
+	Append(&output, "wd_paused %u\n", snapshot->paused);
+	
+	AppendHistogram(&output, "wd_heartbeat_rtt_seconds",
+					"Round trips of a hello through the scheduler of the app.",
+					&(snapshot->rtt));
+	AppendHistogram(&output, "wd_scheduler_lag_seconds",
+					"How late the heartbeats were sent.", &(snapshot->lag));
+	AppendHistogram(&output, "wd_revive_duration_seconds",
+					"From a revive to the first beat of the new instance.",
+					&(snapshot->revive));
+	
+	AppendCounter(&output, "wd_scheduler_wakeups_total",
+				  "Waits of the scheduler.", stats->wakeups);
+	AppendFamily(&output, "wd_scheduler_tasks", "gauge",
+				 "Tasks in the scheduler.");
+	Append(&output, "wd_scheduler_tasks %llu\n",
+		   (unsigned long long)snapshot->tasks);
+	AppendFamily(&output, "wd_scheduler_queue_depth", "gauge",
+				 "Tasks run in a row before the last wait.");
+	Append(&output, "wd_scheduler_queue_depth %llu\n",
+		   (unsigned long long)snapshot->backlog);
+	AppendFamily(&output, "wd_scheduler_queue_depth_max", "gauge",
+				 "The deepest run of tasks so far.");
+	Append(&output, "wd_scheduler_queue_depth_max %llu\n",
+		   (unsigned long long)snapshot->max_backlog);
+	
+	AppendFamily(&output, "wd_scheduler_runs_total", "counter",
+				 "Tasks run, by class.");
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		Append(&output, "wd_scheduler_runs_total{class=\"%s\"} %lu\n",
+			   g_class_names[i], (unsigned long)snapshot->classes[i].runs);
+	}
+	AppendFamily(&output, "wd_scheduler_late_runs_total", "counter",
+				 "Tasks which started after their run time, by class.");
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		Append(&output, "wd_scheduler_late_runs_total{class=\"%s\"} %lu\n",
+			   g_class_names[i],
+			   (unsigned long)snapshot->classes[i].late_runs);
+	}
+	AppendFamily(&output, "wd_scheduler_lateness_seconds_total", "counter",
+				 "Whole seconds the tasks started late, by class.");
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		Append(&output,
+			   "wd_scheduler_lateness_seconds_total{class=\"%s\"} %ld\n",
+			   g_class_names[i],
+			   (long)snapshot->classes[i].total_lateness);
+	}
+	AppendCounter(&output, "wd_scheduler_deferrals_total",
+				  "Background runs put off while behind schedule.",
+				  snapshot->classes[TASK_BACKGROUND].deferrals);
+	
+	return (output.used);
+}
+
+
+/*************************** Append *******************************************/
+static void Append(output_t *output, const char *format, ...)
+{
+	va_list args;
+	int written = 0;
+	
+	/* once it's cut - only counted */
+	va_start(args, format);
+	written = vsnprintf((output->used < output->size) ?
+						output->buffer + output->used : NULL,
+						(output->used < output->size) ?
+						output->size - output->used : 0,
+						format, args);
+	va_end(args);
+	
+	output->used += (0 < written) ? (size_t)written : 0;
+}
+
+
+/*************************** AppendFamily *************************************/
+static void AppendFamily(output_t *output, const char *name,
+						 const char *type, const char *help)
+{
+	Append(output, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+
+/*************************** AppendCounter ************************************/
+static void AppendCounter(output_t *output, const char *name,
+						  const char *help, uint64_t value)
+{
+	AppendFamily(output, name, "counter", help);
+	Append(output, "%s %llu\n", name, (unsigned long long)value);
+}
+
+
+/*************************** AppendHistogram **********************************/
+static void AppendHistogram(output_t *output, const char *name,
+							const char *help,
+							const metrics_histogram_t *histogram)
+{
+	uint64_t cumulative = 0;
+	size_t i = 0;
+	
+	AppendFamily(output, name, "histogram", help);
+	for (i = 0; i < METRICS_BUCKETS; ++i)
+	{
+		cumulative += histogram->counts[i];
+		Append(output, "%s_bucket{le=\"%g\"} %llu\n", name,
+			   g_bounds_us[i] / USEC_IN_SEC, (unsigned long long)cumulative);
+	}
+	Append(output, "%s_bucket{le=\"+Inf\"} %llu\n", name,
+		   (unsigned long long)histogram->count);
+	Append(output, "%s_sum %.6f\n", name, histogram->sum_us / USEC_IN_SEC);
+	Append(output, "%s_count %llu\n", name,
+		   (unsigned long long)histogram->count);
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * File name  : wd_metrics.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: metrics exporter - serves the counters of the WD & of its
+ *				scheduler in the Prometheus text format, over a loopback TCP
+ *				port or a unix-domain socket, from the fd loop of the
+ *				scheduler. a scrape copies a fixed-size snapshot - no locks
+ *				(everything is of the thread of the scheduler) and no walk
+ *				over the tasks.
+ ******************************************************************************/
+#ifndef _WD_METRICS_H_
+#define _WD_METRICS_H_
+
+#include <stdint.h>			/* uint64_t */
+
+#include "./scheduler/scheduler.h"
+#include "./utils/general_types.h"
+#include "wd_control.h"
+
+/*** MACROS ***/
+/*	environment variable of the app (passed on to the WD): "<port>" or
+	"127.0.0.1:<port>" - loopback TCP, "/<path>" - a unix-domain socket.
+	unset - no exporter */
+#define METRICS_LISTEN_ENV "WD_METRICS_LISTEN"
+
+#define METRICS_BUCKETS (16)		/* 100us ... 10s, of every histogram */
+#define METRICS_MAX_CLIENTS (4)		/* scrapes served at once */
+
+/*** structures ***/
+typedef struct metrics_histogram_s
+{
+	uint64_t	counts[METRICS_BUCKETS + 1];	/* per bucket, not cumulative.
+												   the last - above them all */
+	uint64_t	count;
+	uint64_t	sum_us;
+} metrics_histogram_t;
+
+typedef struct metrics_snapshot_s
+{
+	ctl_stats_t			stats;			/* the counters of the control
+										   socket */
+	uint32_t			revive_state;	/* revive_state_t */
+	uint32_t			paused;
+	uint64_t			tasks;			/* in the scheduler */
+	uint64_t			backlog;		/* SchedulerBacklog */
+	uint64_t			max_backlog;
+	sched_class_stats_t	classes[TASK_CLASSES];
+	metrics_histogram_t	rtt;			/* of a hello through the scheduler
+										   of the app & back */
+	metrics_histogram_t	lag;			/* of the beats, behind their time */
+	metrics_histogram_t	revive;			/* from the verdict to the first
+										   beat of the new instance */
+} metrics_snapshot_t;
+
+/*	fills snapshot - called on every scrape, so it must be O(1) */
+typedef void (*metrics_collect_t)(metrics_snapshot_t *snapshot, void *arg);
+
+/****************************** MetricsObserve ********************************/
+/*
+ * description  :  adds a value of value_us microseconds to histogram. O(1).
+ */
+void MetricsObserve(metrics_histogram_t *histogram, uint64_t value_us);
+
+/******************************* MetricsOpen **********************************/
+/*
+ * description  :  listens on listen_on (METRICS_LISTEN_ENV format), and
+ *				   serves every HTTP GET of /metrics (or /) by sched with a
+ *				   snapshot taken by collect with arg.
+ *
+ * return value :  SUCCESS / FAILURE, with errno - EINVAL for a bad address,
+ *				   EADDRINUSE if a live WD listens on a unix path (it's
+ *				   kept), ENAMETOOLONG, or why it can't listen.
+ */
+status_t MetricsOpen(scheduler_t *sched, const char *listen_on,
+					 metrics_collect_t collect, void *arg);
+
+/******************************* MetricsClose *********************************/
+/*
+ * description  :  disconnects the scrapers and closes the socket (a unix
+ *				   one is removed). the scheduler isn't used - it may be
+ *				   destroyed.
+ */
+void MetricsClose(void);
+
+#endif /* _WD_METRICS_H_ */
@@ -0,0 +1,320 @@
+/******************************************************************************
+*	Filename	:	wd_metrics_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	metrics exporter test file. the scrapes are made by hand
+*					on a unix socket, and the scheduler serves them for a
+*					second
+*******************************************************************************/
+#include <stdio.h> 		/* printf, snprintf */
+#include <string.h>		/* memset, memcpy, strlen, strstr */
+#include <stdlib.h>		/* strtoul */
+#include <errno.h>		/* errno, EINVAL, ENAMETOOLONG, EADDRINUSE */
+#include <time.h>		/* time */
+#include <unistd.h>		/* close, unlink, getpid */
+#include <sys/socket.h>	/* socket, bind, listen, connect, send, recv */
+#include <sys/un.h>		/* struct sockaddr_un */
+
+#include "wd_metrics.h"
+
+/******************************* MACROS ***************************************/
+#define PATH_SIZE (64)
+#define RESPONSE_SIZE (32768)
+#define BEATS_SENT (7)
+#define LATE_BEAT_US (1300000)		/* between the buckets of 1 & 2.5 s */
+
+/************************** unit-test functions *******************************/
+void MetricsObserveTest(void);
+void MetricsFormatTest(void);
+void MetricsNotFoundTest(void);
+void MetricsBadAddressTest(void);
+
+/*************************** helper functions *********************************/
+/*	a metrics_collect_t - a snapshot of BEATS_SENT beats, one LATE_BEAT_US
+	late. counts its calls */
+static void Collect(metrics_snapshot_t *snapshot, void *arg);
+
+/*	sends request to g_path, serves it for a second & reads the response
+	into response, null-terminated. returns its size, -1 on failure */
+static long Scrape(const char *request, char *response, size_t size);
+
+static void Serve(void);
+static int StopTask(void *param);
+
+/*	the errno of a MetricsOpen on listen_on which has failed. 0 if it
+	has opened - it's closed */
+static int OpenErrno(const char *listen_on);
+
+/*	the body of response - after the end of its headers. NULL if none */
+static const char *Body(const char *response);
+
+/************************* global variable ************************************/
+static scheduler_t *g_sched = NULL;
+static char g_path[PATH_SIZE] = {0};
+static int g_collects = 0;
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR METRICS'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	snprintf(g_path, sizeof(g_path), "/tmp/wd_metrics_test.%d", getpid());
+	g_sched = SchedulerCreate();
+	if (NULL == g_sched)
+	{
+		return (1);
+	}
+	
+	MetricsObserveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	MetricsBadAddressTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	/* the socket of the scrapes */
+	if (SUCCESS != MetricsOpen(g_sched, g_path, Collect, &g_collects))
+	{
+		printf("MetricsOpen:\t\t\t\tFAIL\n");
+		SchedulerDestroy(g_sched);
+		
+		return (1);
+	}
+	
+	MetricsFormatTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	MetricsNotFoundTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	MetricsClose();
+	SchedulerDestroy(g_sched);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* MetricsObserveTest *********************************/
+void MetricsObserveTest(void)
+{
+	metrics_histogram_t histogram = {0};
+	
+	printf("MetricsObserve (buckets):\t\t");
+	
+	/*	a bound is inclusive - 100 us is of the first bucket, 101 of the
+		next. beyond 10 s is of the last one, above them all */
+	MetricsObserve(&histogram, 0);
+	MetricsObserve(&histogram, 100);
+	MetricsObserve(&histogram, 101);
+	MetricsObserve(&histogram, LATE_BEAT_US);
+	MetricsObserve(&histogram, 10000000);
+	MetricsObserve(&histogram, 10000001);
+	
+	(2 == histogram.counts[0])					&&
+	(1 == histogram.counts[1])					&&
+	(1 == histogram.counts[13])					&&
+	(1 == histogram.counts[METRICS_BUCKETS - 1])	&&
+	(1 == histogram.counts[METRICS_BUCKETS])	&&
+	(6 == histogram.count)						&&
+	(201 + LATE_BEAT_US + 20000001 == histogram.sum_us)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* MetricsFormatTest **********************************/
+void MetricsFormatTest(void)
+{
+	static char response[RESPONSE_SIZE] = {0};
+	const char *body = NULL;
+	const char *length = NULL;
+	long size = 0;
+	
+	printf("Format (a scrape of /metrics):\t\t");
+	
+	g_collects = 0;
+	size = Scrape("GET /metrics HTTP/1.0\r\n\r\n", response,
+				  sizeof(response));
+	body = Body(response);
+	length = strstr(response, "Content-Length: ");
+	
+	/*	the buckets are cumulative - the late beat is in every one from
+		2.5 s up, and in none below it */
+	(0 < size)														&&
+	(1 == g_collects)												&&
+	(0 == strncmp(response, "HTTP/1.0 200 OK\r\n", 17))				&&
+	(NULL != body)													&&
+	(NULL != length)												&&
+	(strlen(body) == strtoul(length + strlen("Content-Length: "),
+							 NULL, 10))								&&
+	(NULL != strstr(body, "\nwd_beats_sent_total 7\n"))				&&
+	(NULL != strstr(body,
+		"\nwd_scheduler_lag_seconds_bucket{le=\"1\"} 0\n"))			&&
+	(NULL != strstr(body,
+		"\nwd_scheduler_lag_seconds_bucket{le=\"2.5\"} 1\n"))		&&
+	(NULL != strstr(body,
+		"\nwd_scheduler_lag_seconds_bucket{le=\"+Inf\"} 1\n"))		&&
+	(NULL != strstr(body, "\nwd_scheduler_lag_seconds_sum 1.300000\n")) &&
+	(NULL != strstr(body, "\nwd_scheduler_lag_seconds_count 1\n"))	&&
+	(NULL != strstr(body,
+		"\nwd_scheduler_runs_total{class=\"critical\"} 3\n"))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* MetricsNotFoundTest ********************************/
+void MetricsNotFoundTest(void)
+{
+	char response[RESPONSE_SIZE] = {0};
+	long size = 0;
+	
+	printf("Respond (another path - 404):\t\t");
+	
+	g_collects = 0;
+	size = Scrape("GET /other HTTP/1.0\r\n\r\n", response,
+				  sizeof(response));
+	
+	(0 < size)														&&
+	(0 == g_collects)												&&
+	(0 == strncmp(response, "HTTP/1.0 404 Not Found\r\n", 24))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* MetricsBadAddressTest ******************************/
+void MetricsBadAddressTest(void)
+{
+	char long_path[sizeof(((struct sockaddr_un *)0)->sun_path) + 1] = {0};
+	struct sockaddr_un addr = {0};
+	int live_fd = -1;
+	int live_errno = 0;
+	int path_errno = 0;
+	
+	printf("MetricsOpen (bad addresses - errno):\t");
+	
+	memset(long_path, 'a', sizeof(long_path) - 1);
+	long_path[0] = '/';
+	path_errno = OpenErrno(long_path);
+	
+	/*	another WD listens on it - it's kept */
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, g_path, strlen(g_path));
+	live_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (0 <= live_fd &&
+		(0 != bind(live_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+		 0 != listen(live_fd, 1)))
+	{
+		close(live_fd);
+		live_fd = -1;
+	}
+	live_errno = OpenErrno(g_path);
+	
+	(EINVAL == OpenErrno("abc"))			&&
+	(EINVAL == OpenErrno("127.0.0.1:0"))	&&
+	(EINVAL == OpenErrno("70000"))			&&
+	(EINVAL == OpenErrno("localhost:80"))	&&
+	(ENAMETOOLONG == path_errno)			&&
+	(0 <= live_fd)							&&
+	(EADDRINUSE == live_errno)
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(live_fd);
+	unlink(g_path);
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* Collect ********************************************/
+static void Collect(metrics_snapshot_t *snapshot, void *arg)
+{
+	++*(int *)arg;
+	
+	snapshot->stats.beats_sent = BEATS_SENT;
+	snapshot->classes[TASK_CRITICAL].runs = 3;
+	MetricsObserve(&snapshot->lag, LATE_BEAT_US);
+}
+
+
+/************************* Scrape *********************************************/
+static long Scrape(const char *request, char *response, size_t size)
+{
+	struct sockaddr_un addr = {0};
+	ssize_t got = 0;
+	size_t received = 0;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, g_path, strlen(g_path));
+	memset(response, 0, size);
+	if (0 > fd || 0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+		(ssize_t)strlen(request) != send(fd, request, strlen(request), 0))
+	{
+		close(fd);
+		
+		return (-1);
+	}
+	
+	Serve();
+	
+	/* the server has closed it - up to its end */
+	while (received < size - 1 &&
+		   0 < (got = recv(fd, response + received, size - 1 - received,
+						   MSG_DONTWAIT)))
+	{
+		received += (size_t)got;
+	}
+	close(fd);
+	
+	return ((long)received);
+}
+
+
+/************************* Serve **********************************************/
+static void Serve(void)
+{
+	SchedulerAddTask(g_sched, StopTask, g_sched, time(NULL) + 1, 1);
+	SchedulerRun(g_sched);
+}
+
+
+/************************* StopTask *******************************************/
+static int StopTask(void *param)
+{
+	SchedulerStop((scheduler_t *)param);
+	
+	return (DONE);
+}
+
+
+/************************* OpenErrno ******************************************/
+static int OpenErrno(const char *listen_on)
+{
+	if (SUCCESS == MetricsOpen(g_sched, listen_on, Collect, &g_collects))
+	{
+		MetricsClose();
+		
+		return (0);
+	}
+	
+	return (errno);
+}
+
+
+/************************* Body ***********************************************/
+static const char *Body(const char *response)
+{
+	const char *end = strstr(response, "\r\n\r\n");
+	
+	return ((NULL != end) ? end + strlen("\r\n\r\n") : NULL);
+}
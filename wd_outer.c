@@ -7,6 +7,7 @@
 #define _POSIX_C_SOURCE 200112L    /* struct sigaction */
 
 #include <assert.h> 	/* assert */
+#include <stdlib.h> 	/* EXIT_FAILURE */
 
 #ifndef NDEBUG
 #include <stdio.h> 		/* printf */
@@ -14,12 +15,15 @@
 
 #include "./scheduler/scheduler.h"
 #include "wd_shared.h"
+#include "wd_flight.h"
 
 /******************************* MACROS ***************************************/
 #define UNUSED(x) ((void) x)
 
 /************************** internal functions ********************************/
-static void InitWD(com_pack_t *wd_pack);
+/*	returns FAILURE if the WD wasn't spawned by an app (no handshake) or
+	couldn't start */
+static status_t InitWD(com_pack_t *wd_pack);
 
 /******************************************************************************
 *								main
@@ -37,13 +41,23 @@ int main(int argc, char *const argv[])
 	#endif
 	
 	com_pack.argv = argv;
-	InitWD(&com_pack);
+	if (SUCCESS != InitWD(&com_pack))
+	{
+		#ifndef NDEBUG
+		printf("WD must be spawned by WDKeepMeAlive\n");
+		#endif
+		
+		SchedulerDestroyWrapper();
+		
+		return (EXIT_FAILURE);
+	}
 	
 	/* main loop - can be stopped by SIGUSR2 */
 	MainLoop(&com_pack);
 	
 	/* free resources */
 	SchedulerDestroyWrapper();
+	FlightClose();
 	
 	#ifndef NDEBUG
 	printf("\n ***WD is dead ***\n\n");
@@ -54,33 +68,45 @@ int main(int argc, char *const argv[])
 
 
 /************************** InitWD ********************************************/
-static void InitWD(com_pack_t *com_pack)
+static status_t InitWD(com_pack_t *com_pack)
 {
 	assert(com_pack);
 	
-	/* at this point, the parent process is necessarily the app */
-	com_pack->other_proc_pid = getppid();
+	/* the app's pid & config come with its hello */
+	com_pack->role = ROLE_WD;
+	InitConfig(&(com_pack->config));
+	if (SUCCESS != AcceptHandshake(com_pack))
+	{
+		return (FAILURE);
+	}
 	
-	/* define the behaviour when SIGUSR1/SIGUSR2 are received */
-	com_pack->sig_1.sa_handler = SigHandZeroCounter;
-	sigaction(SIGUSR1, &(com_pack->sig_1), NULL);
-	com_pack->sig_2.sa_handler = SigHandStopMainLoop;
-	sigaction(SIGUSR2, &(com_pack->sig_2), NULL);
-	
-	/* set mask */
+	/*	set mask - SIGUSR1/SIGUSR2 are received through a signalfd, and
+		handled by the scheduler between its tasks */
 	sigemptyset(&(com_pack->mask));
 	sigaddset(&(com_pack->mask), SIGUSR1);
+	sigaddset(&(com_pack->mask), SIGUSR2);
 	
 	/* set the app name (from argv[0]) in who_to_revive */
 	com_pack->who_to_revive = com_pack->argv[0];
 	
+	/* the flight log is optional - failing to open it only disables it */
+	FlightOpen(NULL);
+	FlightLog(FL_START, com_pack->other_proc_pid, 0, "wd");
+	
+	/* real-time mode, if the app has asked for it */
+	RTApply(&(com_pack->config.rt), "wd");
+	
 	/* create scheduler & load it with tasks */
-	InitScheduler(com_pack);
+	if (SUCCESS != InitSignals(com_pack) ||
+		SUCCESS != InitScheduler(com_pack))
+	{
+		return (FAILURE);
+	}
+	
+	/*	the app can't be reaped by the WD, but its end is noticed at once.
+		then, tell the app the WD is ready */
+	WatchPeer(com_pack);
+	SendReady(com_pack);
+	
+	return (SUCCESS);
 }
-
-
-
-
-
-
-
@@ -0,0 +1,362 @@
+/*******************************************************************************
+*	Filename	:	wd_overload.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	overload-aware hang verdicts source file. compares the
+					throttled & stalled time of the peer with the time it has
+					been silent.
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* O_CLOEXEC */
+
+#include <assert.h> 		/* assert */
+#include <stdio.h> 			/* snprintf, fopen, fgets */
+#include <stdlib.h>			/* strtoull */
+#include <string.h>			/* strncmp, strstr, strchr, strcspn */
+#include <fcntl.h>			/* open */
+#include <unistd.h>			/* pread, close */
+
+#include "wd_overload.h"
+#include "wd_proc.h"
+
+/******************************* MACROS ***************************************/
+#define PATH_SIZE (512)
+#define COUNTERS_BUF_SIZE (1024)
+#define THROTTLED_KEY "throttled_usec "
+#define PSI_KEY "some "
+#define PSI_TOTAL_KEY "total="
+
+/************************* global variable ************************************/
+/* the counters - in the order of the causes */
+enum counter
+{
+	THROTTLED = 0,
+	CPU_STALL,
+	MEM_STALL,
+	COUNTERS_COUNT
+};
+
+typedef struct sample
+{
+	uint64_t time_us;
+	uint64_t counters[COUNTERS_COUNT];
+} sample_t;
+
+/*	where cgroup v2 may be mounted - alone, or beside v1 (hybrid) */
+static const char *g_cgroup_mounts[] =
+{
+	"/sys/fs/cgroup",
+	"/sys/fs/cgroup/unified"
+};
+
+/*	the file of each counter in the cgroup, and the system-wide fallback */
+static const char *g_cgroup_files[COUNTERS_COUNT] =
+{
+	"cpu.stat",
+	"cpu.pressure",
+	"memory.pressure"
+};
+static const char *g_system_files[COUNTERS_COUNT] =
+{
+	NULL,
+	"/proc/pressure/cpu",
+	"/proc/pressure/memory"
+};
+
+static const char *g_cause_names[OVERLOAD_CAUSES_COUNT] =
+{
+	"none",
+	"throttled",
+	"cpu stall",
+	"memory stall"
+};
+
+/* accessed only by the thread running the scheduler (besides the stats) */
+static int g_fds[COUNTERS_COUNT] = {-1, -1, -1};
+static sample_t g_mark = {0};
+static unsigned int g_extensions = 0;
+static overload_stats_t g_stats = {0};
+
+/************************** internal functions ********************************/
+/*	copies the cgroup v2 path of pid (relative to the mount) into path */
+static status_t FindCgroup(pid_t pid, char *path, size_t size);
+
+/*	opens the file of counter in the cgroup of pid. returns -1 if it doesn't
+	exist, or doesn't have the counter */
+static int OpenCounter(enum counter counter, const char *cgroup);
+
+/*	reads the current value of counter. returns FAILURE if it's unavailable */
+static status_t ReadCounter(enum counter counter, uint64_t *value);
+
+/*	reads all the counters. unavailable ones keep their value in the mark */
+static void TakeSample(sample_t *sample);
+
+/******************************************************************************
+*							OverloadWatch
+*******************************************************************************/
+status_t OverloadWatch(pid_t pid)
+{
+	char cgroup[PATH_SIZE] = {0};
+	int has_cgroup = FALSE;
+	int is_available = FALSE;
+	int i = 0;
+	
+	OverloadClose();
+	
+	has_cgroup = (SUCCESS == FindCgroup(pid, cgroup, sizeof(cgroup)));
+	
+	for (i = 0; i < COUNTERS_COUNT; ++i)
+	{
+		if (has_cgroup)
+		{
+			g_fds[i] = OpenCounter(i, cgroup);
+		}
+		
+		/* the root cgroup has no pressure files - use the system ones */
+		if (0 > g_fds[i] && NULL != g_system_files[i])
+		{
+			g_fds[i] = open(g_system_files[i], O_RDONLY | O_CLOEXEC);
+		}
+		
+		is_available |= (0 <= g_fds[i]);
+	}
+	
+	OverloadMark();
+	
+	return (is_available ? SUCCESS : FAILURE);
+}
+
+
+/******************************************************************************
+*							OverloadMark
+*******************************************************************************/
+void OverloadMark(void)
+{
+	TakeSample(&g_mark);
+	g_extensions = 0;
+}
+
+
+/******************************************************************************
+*							OverloadExtend
+*******************************************************************************/
+overload_cause_t OverloadExtend(void)
+{
+	sample_t now = g_mark;
+	uint64_t deltas[COUNTERS_COUNT] = {0};
+	uint64_t max_delta = 0;
+	overload_cause_t cause = OVERLOAD_NONE;
+	int i = 0;
+	
+	TakeSample(&now);
+	
+	for (i = 0; i < COUNTERS_COUNT; ++i)
+	{
+		/* a counter which was reset (new cgroup) explains nothing */
+		deltas[i] = (now.counters[i] > g_mark.counters[i]) ?
+					now.counters[i] - g_mark.counters[i] : 0;
+		
+		/* the cause is the counter with the most time in the window */
+		if (deltas[i] > max_delta)
+		{
+			max_delta = deltas[i];
+			cause = (overload_cause_t)(i + OVERLOAD_THROTTLED);
+		}
+	}
+	
+	g_stats.window_us = now.time_us - g_mark.time_us;
+	g_stats.throttled_us = deltas[THROTTLED];
+	g_stats.cpu_stall_us = deltas[CPU_STALL];
+	g_stats.mem_stall_us = deltas[MEM_STALL];
+	
+	if (max_delta * 100 < g_stats.window_us * OVERLOAD_PERCENT ||
+		OVERLOAD_MAX_EXTENSIONS <= g_extensions)
+	{
+		++g_stats.refused;
+		
+		return (OVERLOAD_NONE);
+	}
+	
+	++g_extensions;
+	++g_stats.extensions;
+	++g_stats.by_cause[cause];
+	
+	return (cause);
+}
+
+
+/******************************************************************************
+*							OverloadGetStats
+*******************************************************************************/
+void OverloadGetStats(overload_stats_t *stats)
+{
+	assert(stats);
+	
+	*stats = g_stats;
+}
+
+
+/******************************************************************************
+*							OverloadCauseName
+*******************************************************************************/
+const char *OverloadCauseName(overload_cause_t cause)
+{
+	return ((OVERLOAD_CAUSES_COUNT > cause) ? g_cause_names[cause] :
+											  g_cause_names[OVERLOAD_NONE]);
+}
+
+
+/******************************************************************************
+*							OverloadClose
+*******************************************************************************/
+void OverloadClose(void)
+{
+	int i = 0;
+	
+	for (i = 0; i < COUNTERS_COUNT; ++i)
+	{
+		if (0 <= g_fds[i])
+		{
+			close(g_fds[i]);
+			g_fds[i] = -1;
+		}
+	}
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** FindCgroup ***************************************/
+static status_t FindCgroup(pid_t pid, char *path, size_t size)
+{
+	char proc_path[64] = {0};
+	char line[PATH_SIZE] = {0};
+	status_t status = FAILURE;
+	FILE *file = NULL;
+	
+	snprintf(proc_path, sizeof(proc_path), "/proc/%d/cgroup", (int)pid);
+	file = fopen(proc_path, "r");
+	if (NULL == file)
+	{
+		return (FAILURE);
+	}
+	
+	/* the v2 hierarchy is the one with id 0 and no controllers */
+	while (NULL != fgets(line, sizeof(line), file))
+	{
+		if (0 == strncmp(line, "0::", 3))
+		{
+			line[strcspn(line, "\n")] = '\0';
+			snprintf(path, size, "%s", line + 3);
+			status = SUCCESS;
+			break;
+		}
+	}
+	
+	fclose(file);
+	
+	return (status);
+}
+
+
+/*************************** OpenCounter **************************************/
+static int OpenCounter(enum counter counter, const char *cgroup)
+{
+	char path[PATH_SIZE * 2] = {0};
+	uint64_t value = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < sizeof(g_cgroup_mounts) / sizeof(g_cgroup_mounts[0]); ++i)
+	{
+		snprintf(path, sizeof(path), "%s%s/%s", g_cgroup_mounts[i], cgroup,
+				 g_cgroup_files[counter]);
+		
+		g_fds[counter] = open(path, O_RDONLY | O_CLOEXEC);
+		if (0 > g_fds[counter])
+		{
+			continue;
+		}
+		
+		/*	throttled_usec is there only when the cpu controller is enabled
+			for the cgroup */
+		if (SUCCESS == ReadCounter(counter, &value))
+		{
+			return (g_fds[counter]);
+		}
+		
+		close(g_fds[counter]);
+		g_fds[counter] = -1;
+	}
+	
+	return (-1);
+}
+
+
+/*************************** ReadCounter **************************************/
+static status_t ReadCounter(enum counter counter, uint64_t *value)
+{
+	char buf[COUNTERS_BUF_SIZE] = {0};
+	const char *key = (THROTTLED == counter) ? THROTTLED_KEY : PSI_KEY;
+	char *line = buf;
+	char *number = NULL;
+	ssize_t size = 0;
+	
+	if (0 > g_fds[counter])
+	{
+		return (FAILURE);
+	}
+	
+	/* these files are generated anew on every read from offset 0 */
+	size = pread(g_fds[counter], buf, sizeof(buf) - 1, 0);
+	if (0 >= size)
+	{
+		return (FAILURE);
+	}
+	buf[size] = '\0';
+	
+	/* find the line of the key */
+	while (0 != strncmp(line, key, strlen(key)))
+	{
+		line = strchr(line, '\n');
+		if (NULL == line)
+		{
+			return (FAILURE);
+		}
+		++line;
+	}
+	
+	number = line + strlen(key);
+	
+	/* "some avg10=0.00 avg60=0.00 avg300=0.00 total=<us>" */
+	if (THROTTLED != counter)
+	{
+		number = strstr(line, PSI_TOTAL_KEY);
+		if (NULL == number)
+		{
+			return (FAILURE);
+		}
+		number += strlen(PSI_TOTAL_KEY);
+	}
+	
+	*value = strtoull(number, NULL, 10);
+	
+	return (SUCCESS);
+}
+
+
+/*************************** TakeSample ***************************************/
+static void TakeSample(sample_t *sample)
+{
+	uint64_t value = 0;
+	int i = 0;
+	
+	sample->time_us = ProcClockUs();
+	
+	for (i = 0; i < COUNTERS_COUNT; ++i)
+	{
+		if (SUCCESS == ReadCounter(i, &value))
+		{
+			sample->counters[i] = value;
+		}
+	}
+}
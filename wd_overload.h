@@ -0,0 +1,89 @@
+/******************************************************************************
+ * File name  : wd_overload.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: overload-aware hang verdicts - tells whether the beats of the
+ *				peer were missed because its cgroup was CPU-throttled or its
+ *				tasks were stalled (PSI), rather than because it hung.
+ ******************************************************************************/
+#ifndef _WD_OVERLOAD_H_
+#define _WD_OVERLOAD_H_
+
+#include <stdint.h>			/* uint64_t */
+#include <sys/types.h>		/* pid_t */
+
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+/*	a silent window is explained by overload if the peer was throttled, or
+	stalled, for at least this share of it */
+#define OVERLOAD_PERCENT (25)
+
+/*	how many times a deadline may be extended before a beat arrives. bounds
+	the delay of the verdict on a proc which hung while overloaded */
+#define OVERLOAD_MAX_EXTENSIONS (3)
+
+/*** structures ***/
+typedef enum overload_cause
+{
+	OVERLOAD_NONE = 0,
+	OVERLOAD_THROTTLED,		/* the cgroup has used up its cpu.max quota */
+	OVERLOAD_CPU_STALL,		/* the tasks waited for a CPU */
+	OVERLOAD_MEM_STALL,		/* the tasks waited for memory (reclaim, swap-in) */
+	OVERLOAD_CAUSES_COUNT
+} overload_cause_t;
+
+typedef struct overload_stats_s
+{
+	uint64_t extensions;	/* deadlines extended */
+	uint64_t by_cause[OVERLOAD_CAUSES_COUNT];	/* of them - per cause */
+	uint64_t refused;		/* misses which weren't explained, or were over
+							   OVERLOAD_MAX_EXTENSIONS */
+	
+	/* the last silent window checked */
+	uint64_t window_us;
+	uint64_t throttled_us;
+	uint64_t cpu_stall_us;
+	uint64_t mem_stall_us;
+} overload_stats_t;
+
+/****************************** OverloadWatch *********************************/
+/*
+ * description  :  finds the cgroup v2 of pid & opens its counters -
+ *				   cpu.stat (throttled_usec), cpu.pressure & memory.pressure.
+ *				   the pressure falls back to the system-wide /proc/pressure.
+ *				   starts a new silent window.
+ *
+ * return value :  FAILURE if no counter is available - then no miss is
+ *				   explained by overload. SUCCESS otherwise.
+ */
+status_t OverloadWatch(pid_t pid);
+
+/****************************** OverloadMark **********************************/
+/*
+ * description  :  starts a new silent window - called when a beat arrives.
+ */
+void OverloadMark(void);
+
+/***************************** OverloadExtend *********************************/
+/*
+ * description  :  called on a missed deadline. checks whether the window
+ *				   since the last mark is explained by overload, and counts
+ *				   the verdict in the stats.
+ *
+ * return value :  the cause if the deadline should be extended. OVERLOAD_NONE
+ *				   if the miss isn't explained, or the extensions of the
+ *				   window are used up.
+ */
+overload_cause_t OverloadExtend(void);
+
+/**************************** OverloadGetStats ********************************/
+void OverloadGetStats(overload_stats_t *stats);
+
+/*************************** OverloadCauseName ********************************/
+const char *OverloadCauseName(overload_cause_t cause);
+
+/****************************** OverloadClose *********************************/
+void OverloadClose(void);
+
+#endif /* _WD_OVERLOAD_H_ */
@@ -0,0 +1,118 @@
+/*******************************************************************************
+*	Filename	:	wd_phi.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	phi-accrual failure detector source file. the intervals
+					are taken as normally distributed.
+*******************************************************************************/
+#include <assert.h> 		/* assert */
+#include <string.h>			/* memset */
+#include <math.h>			/* sqrt, exp, log10 */
+
+#include "wd_phi.h"
+
+/******************************* MACROS ***************************************/
+/*	longer intervals are kept as this - bounds the sum of the squares */
+#define MAX_INTERVAL_US (60 * 1000000ULL)
+
+/*	the minimal deviation is this share of the expected interval. it also
+	spreads the two seeds */
+#define MIN_STDDEV_DIV (4)
+
+/************************** internal functions ********************************/
+static void AddInterval(phi_detector_t *phi, uint64_t interval_us);
+
+/******************************************************************************
+*							PhiInit
+*******************************************************************************/
+void PhiInit(phi_detector_t *phi, uint64_t expected_us, uint64_t now_us)
+{
+	assert(phi);
+	assert(0 < expected_us);
+	
+	memset(phi, 0, sizeof(*phi));
+	phi->min_stddev_us = expected_us / MIN_STDDEV_DIV;
+	phi->last_beat_us = now_us;
+	
+	AddInterval(phi, expected_us - phi->min_stddev_us);
+	AddInterval(phi, expected_us + phi->min_stddev_us);
+}
+
+
+/******************************************************************************
+*							PhiBeat
+*******************************************************************************/
+void PhiBeat(phi_detector_t *phi, uint64_t now_us)
+{
+	assert(phi);
+	
+	if (now_us > phi->last_beat_us)
+	{
+		AddInterval(phi, now_us - phi->last_beat_us);
+	}
+	phi->last_beat_us = now_us;
+}
+
+
+/******************************************************************************
+*							PhiLevel
+*******************************************************************************/
+double PhiLevel(const phi_detector_t *phi, uint64_t now_us)
+{
+	double mean = 0;
+	double stddev = 0;
+	double y = 0;
+	double e = 0;
+	
+	assert(phi);
+	assert(0 < phi->count);
+	
+	if (now_us <= phi->last_beat_us)
+	{
+		return (0);
+	}
+	
+	mean = (double)phi->sum_us / phi->count;
+	stddev = sqrt(fmax((double)phi->sum_sq_us / phi->count - mean * mean, 0));
+	stddev = fmax(stddev, (double)phi->min_stddev_us);
+	
+	/*	a logistic approximation of the normal CDF (Bowling et al. 2009).
+		the two forms keep the precision on both sides of the mean */
+	y = ((double)(now_us - phi->last_beat_us) - mean) / stddev;
+	e = exp(-y * (1.5976 + 0.070566 * y * y));
+	
+	return ((0 < y) ? -log10(e / (1.0 + e)) :
+					  -log10(1.0 - 1.0 / (1.0 + e)));
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** AddInterval **************************************/
+static void AddInterval(phi_detector_t *phi, uint64_t interval_us)
+{
+	uint64_t *slot = &(phi->intervals_us[phi->next]);
+	
+	if (interval_us > MAX_INTERVAL_US)
+	{
+		interval_us = MAX_INTERVAL_US;
+	}
+	
+	/* the oldest interval leaves the window */
+	if (PHI_WINDOW_SIZE == phi->count)
+	{
+		phi->sum_us -= *slot;
+		phi->sum_sq_us -= *slot * *slot;
+	}
+	else
+	{
+		++phi->count;
+	}
+	
+	*slot = interval_us;
+	phi->sum_us += interval_us;
+	phi->sum_sq_us += interval_us * interval_us;
+	
+	phi->next = (phi->next + 1) % PHI_WINDOW_SIZE;
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+ * File name  : wd_phi.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: phi-accrual failure detector. instead of a fixed number of
+ *				seconds, the silence of the peer is weighed against the
+ *				inter-arrival times of its recent beats: phi is -log10 of the
+ *				probability that a beat is still on its way.
+ ******************************************************************************/
+#ifndef _WD_PHI_H_
+#define _WD_PHI_H_
+
+#include <stddef.h>		/* size_t */
+#include <stdint.h>		/* uint64_t */
+
+/*** MACROS ***/
+#define PHI_WINDOW_SIZE (32)		/* inter-arrival times kept */
+
+/*	environment variable of the app - the phi to revive at. 0 - the fixed
+	max_seconds_waiting deadline */
+#define PHI_THRESHOLD_ENV "WD_PHI_THRESHOLD"
+#define PHI_DEFAULT_THRESHOLD (8)	/* ~1 false verdict in 10^8 */
+
+/*** structures ***/
+/*	all of the state is inside - no allocation. the sums are of integers,
+	so removing the oldest interval doesn't accumulate rounding errors */
+typedef struct phi_detector_s
+{
+	uint64_t	intervals_us[PHI_WINDOW_SIZE];	/* a ring */
+	size_t		count;
+	size_t		next;			/* the slot of the next interval */
+	uint64_t	sum_us;
+	uint64_t	sum_sq_us;
+	uint64_t	last_beat_us;
+	uint64_t	min_stddev_us;	/* keeps a steady peer from looking dead
+								   after a single late beat */
+} phi_detector_t;
+
+/********************************** PhiInit ***********************************/
+/*
+ * description  :  resets the detector for a new peer. the window is seeded
+ *				   with the expected interval, so the verdict is sane before
+ *				   the first beats.
+ *
+ * input		:  expected_us - the interval the beats are sent at.
+ *				   now_us - the time the peer is watched from.
+ */
+void PhiInit(phi_detector_t *phi, uint64_t expected_us, uint64_t now_us);
+
+/********************************** PhiBeat ***********************************/
+/*
+ * description  :  adds the interval since the previous beat. O(1).
+ */
+void PhiBeat(phi_detector_t *phi, uint64_t now_us);
+
+/********************************* PhiLevel ***********************************/
+/*
+ * description  :  returns the suspicion level of the peer at now_us. grows
+ *				   with the silence - 0 right after a beat, 1 when a beat
+ *				   would have arrived by now in 90% of the cases, 2 in 99%...
+ */
+double PhiLevel(const phi_detector_t *phi, uint64_t now_us);
+
+#endif /* _WD_PHI_H_ */
@@ -0,0 +1,222 @@
+/******************************************************************************
+*	Filename	:	wd_phi_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	phi-accrual detector test file
+*******************************************************************************/
+#include <stdio.h> 		/* printf */
+#include <math.h> 		/* isfinite, isinf */
+
+#include "wd_phi.h"
+#include "./utils/general_types.h"
+
+/******************************* MACROS ***************************************/
+#define SEC_US (1000000ULL)
+#define START_US (5 * SEC_US)
+#define BEATS (10)
+#define STEPS (100)			/* of the silence, a tenth of a second each */
+#define EVICTED (PHI_WINDOW_SIZE + 7)
+#define TINY_US (4)			/* expected interval - a tiny min deviation */
+#define LONG_US (60 * SEC_US)
+
+/************************** unit-test functions *******************************/
+void PhiAfterBeatTest(void);
+void PhiSilenceTest(void);
+void PhiExtremesTest(void);
+void PhiWindowTest(void);
+
+/*************************** helper functions *********************************/
+/* beats every interval_us count times from *now_us, which is advanced */
+static void Beat(phi_detector_t *phi, uint64_t *now_us, uint64_t interval_us,
+				 int count);
+
+/* whether the sums of phi are of the intervals in its window */
+static int AreSumsOfWindow(const phi_detector_t *phi);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR PHI'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	PhiAfterBeatTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	PhiSilenceTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	PhiExtremesTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	PhiWindowTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* PhiAfterBeatTest ***********************************/
+void PhiAfterBeatTest(void)
+{
+	phi_detector_t phi;
+	uint64_t now_us = START_US;
+	double at_init = 0;
+	double at_beat = 0;
+	double just_after = 0;
+	
+	printf("Init + Beat (phi near 0):\t\t");
+	
+	PhiInit(&phi, SEC_US, now_us);
+	at_init = PhiLevel(&phi, now_us);
+	
+	Beat(&phi, &now_us, SEC_US, BEATS);
+	at_beat = PhiLevel(&phi, now_us);
+	just_after = PhiLevel(&phi, now_us + SEC_US / 10);
+	
+	(0 == at_init)			&&
+	(0 == at_beat)			&&
+	(0 <= just_after)		&&
+	(0.01 > just_after)		&&
+	(2 + BEATS == phi.count)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* PhiSilenceTest *************************************/
+void PhiSilenceTest(void)
+{
+	phi_detector_t phi;
+	uint64_t now_us = START_US;
+	double prev = 0;
+	double level = 0;
+	int is_rising = TRUE;
+	int is_finite = TRUE;
+	int i = 0;
+	
+	printf("Level (rises with the silence):\t\t");
+	
+	PhiInit(&phi, SEC_US, now_us);
+	Beat(&phi, &now_us, SEC_US, BEATS);
+	
+	/*	strictly, until the double saturates - then it may only stay */
+	for (i = 1; i <= STEPS; ++i)
+	{
+		level = PhiLevel(&phi, now_us + i * SEC_US / 10);
+		is_rising &= (level > prev || (isinf(level) && isinf(prev)) ||
+					  (0.01 > level && level >= prev));
+		is_finite &= (i > 20 || isfinite(level));
+		prev = level;
+	}
+	
+	(TRUE == is_rising)		&&
+	(TRUE == is_finite)		&&
+	(PHI_DEFAULT_THRESHOLD <= prev)	&&
+	(1 > PhiLevel(&phi, now_us + SEC_US))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* PhiExtremesTest ************************************/
+void PhiExtremesTest(void)
+{
+	phi_detector_t phi;
+	uint64_t now_us = START_US;
+	double far_before = 0;
+	double far_after = 0;
+	
+	printf("Level (extreme y):\t\t\t");
+	
+	/*	steady beats of a minute, with a deviation of a microsecond - right
+		after a beat y is about -6 * 10^7 */
+	PhiInit(&phi, TINY_US, now_us);
+	Beat(&phi, &now_us, LONG_US, PHI_WINDOW_SIZE);
+	far_before = PhiLevel(&phi, now_us + 1);
+	
+	/* and an hour of silence is as far on the other side */
+	far_after = PhiLevel(&phi, now_us + 60 * LONG_US);
+	
+	(TRUE == isfinite(far_before))	&&
+	(0 <= far_before)				&&
+	(0.01 > far_before)				&&
+	(TRUE == isinf(far_after))		&&
+	(0 < far_after)					&&
+	(far_after >= PHI_DEFAULT_THRESHOLD)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* PhiWindowTest **************************************/
+void PhiWindowTest(void)
+{
+	phi_detector_t phi;
+	uint64_t now_us = START_US;
+	int is_sum_kept = TRUE;
+	int i = 0;
+	
+	printf("Window (evicts + sums):\t\t\t");
+	
+	PhiInit(&phi, SEC_US, now_us);
+	is_sum_kept &= AreSumsOfWindow(&phi);
+	
+	/*	intervals of 1s, 1.001s... - every one differs */
+	for (i = 0; i < EVICTED; ++i)
+	{
+		Beat(&phi, &now_us, SEC_US + i * 1000, 1);
+		is_sum_kept &= AreSumsOfWindow(&phi);
+	}
+	
+	/*	the seeds & the first intervals are gone - the window holds the
+		last PHI_WINDOW_SIZE ones */
+	(TRUE == is_sum_kept)						&&
+	(PHI_WINDOW_SIZE == phi.count)				&&
+	((EVICTED + 2) % PHI_WINDOW_SIZE == phi.next) &&
+	(SEC_US + (EVICTED - 1) * 1000 ==
+	 phi.intervals_us[(phi.next + PHI_WINDOW_SIZE - 1) % PHI_WINDOW_SIZE]) &&
+	(SEC_US + (EVICTED - PHI_WINDOW_SIZE) * 1000 ==
+	 phi.intervals_us[phi.next])
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* Beat ***********************************************/
+static void Beat(phi_detector_t *phi, uint64_t *now_us, uint64_t interval_us,
+				 int count)
+{
+	int i = 0;
+	
+	for (i = 0; i < count; ++i)
+	{
+		*now_us += interval_us;
+		PhiBeat(phi, *now_us);
+	}
+}
+
+
+/************************* AreSumsOfWindow ************************************/
+static int AreSumsOfWindow(const phi_detector_t *phi)
+{
+	uint64_t sum_us = 0;
+	uint64_t sum_sq_us = 0;
+	size_t i = 0;
+	
+	for (i = 0; i < phi->count; ++i)
+	{
+		sum_us += phi->intervals_us[i];
+		sum_sq_us += phi->intervals_us[i] * phi->intervals_us[i];
+	}
+	
+	return (sum_us == phi->sum_us && sum_sq_us == phi->sum_sq_us);
+}
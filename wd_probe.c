@@ -0,0 +1,260 @@
+/*******************************************************************************
+*	Filename	:	wd_probe.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	resource probes source file. everything is read from
+					/proc/<pid> - statm, stat & the fd directory.
+*******************************************************************************/
+#include <assert.h> 		/* assert */
+#include <stdio.h> 			/* snprintf, fopen, fscanf */
+#include <stdint.h>			/* INT32_MAX */
+#include <unistd.h>			/* sysconf */
+#include <dirent.h>			/* opendir, readdir */
+
+#include "wd_probe.h"
+#include "wd_env.h"
+#include "wd_proc.h"
+
+/******************************* MACROS ***************************************/
+#define USEC_IN_SEC (1000000L)
+#define KB (1024)
+#define PROC_PATH_SIZE (64)
+#define STAT_BUF_SIZE (1024)
+
+/************************* global variable ************************************/
+static const char *g_limit_names[PROBE_LIMITS_COUNT] =
+{
+	"none",
+	"rss",
+	"fds",
+	"cpu"
+};
+
+/* the previous probe - the base of the CPU usage & of the strikes */
+static pid_t g_pid = 0;
+static long g_cpu_ticks = -1;
+static long g_cpu_time_us = 0;
+static unsigned int g_strikes[PROBE_LIMITS_COUNT] = {0};
+
+/************************** internal functions ********************************/
+static long ReadRssKb(pid_t pid);
+
+static long CountFds(pid_t pid);
+
+/*	returns the user + system time of pid in clock ticks. -1 on failure */
+static long ReadCpuTicks(pid_t pid);
+
+/******************************************************************************
+*							ProbeConfigFromEnv
+*******************************************************************************/
+void ProbeConfigFromEnv(probe_config_t *config)
+{
+	assert(config);
+	
+	config->max_rss_mb = (int32_t)EnvToLong(PROBE_RSS_ENV, 0, 0, INT32_MAX);
+	config->max_fds = (int32_t)EnvToLong(PROBE_FDS_ENV, 0, 0, INT32_MAX);
+	config->max_cpu_percent = (int32_t)EnvToLong(PROBE_CPU_ENV, 0, 0,
+												 INT32_MAX);
+	config->drain_seconds = (int32_t)EnvToLong(PROBE_DRAIN_ENV, 0, 0,
+											   INT32_MAX);
+	if (0 >= config->drain_seconds)
+	{
+		config->drain_seconds = PROBE_DRAIN_SECONDS;
+	}
+}
+
+
+/******************************************************************************
+*							ProbeIsEnabled
+*******************************************************************************/
+int ProbeIsEnabled(const probe_config_t *config)
+{
+	assert(config);
+	
+	return (0 < config->max_rss_mb || 0 < config->max_fds ||
+			0 < config->max_cpu_percent);
+}
+
+
+/******************************************************************************
+*							ProbeTake
+*******************************************************************************/
+void ProbeTake(pid_t pid, probe_sample_t *sample)
+{
+	long ticks = ReadCpuTicks(pid);
+	long now_us = (long)ProcClockUs();
+	
+	assert(sample);
+	
+	sample->values[PROBE_NONE] = 0;
+	sample->values[PROBE_RSS] = ReadRssKb(pid);
+	sample->values[PROBE_FDS] = CountFds(pid);
+	sample->values[PROBE_CPU] = -1;
+	
+	if (pid == g_pid && 0 <= g_cpu_ticks && 0 <= ticks &&
+		now_us > g_cpu_time_us)
+	{
+		sample->values[PROBE_CPU] = (ticks - g_cpu_ticks) * 100 * USEC_IN_SEC /
+									sysconf(_SC_CLK_TCK) /
+									(now_us - g_cpu_time_us);
+	}
+	
+	g_pid = pid;
+	g_cpu_ticks = ticks;
+	g_cpu_time_us = now_us;
+}
+
+
+/******************************************************************************
+*							ProbeCheck
+*******************************************************************************/
+probe_limit_t ProbeCheck(pid_t pid, const probe_config_t *config,
+						 probe_sample_t *sample)
+{
+	long limits[PROBE_LIMITS_COUNT] = {0};
+	probe_limit_t crossed = PROBE_NONE;
+	int i = 0;
+	
+	assert(config);
+	assert(sample);
+	
+	if (pid != g_pid)
+	{
+		ProbeReset();
+	}
+	
+	ProbeTake(pid, sample);
+	
+	limits[PROBE_RSS] = (long)config->max_rss_mb * KB;
+	limits[PROBE_FDS] = config->max_fds;
+	limits[PROBE_CPU] = config->max_cpu_percent;
+	
+	for (i = PROBE_RSS; i < PROBE_LIMITS_COUNT; ++i)
+	{
+		/* a probe which has failed breaks the strikes */
+		if (0 < limits[i] && sample->values[i] > limits[i])
+		{
+			++g_strikes[i];
+		}
+		else
+		{
+			g_strikes[i] = 0;
+		}
+		
+		if (PROBE_NONE == crossed && PROBE_STRIKES <= g_strikes[i])
+		{
+			crossed = (probe_limit_t)i;
+		}
+	}
+	
+	return (crossed);
+}
+
+
+/******************************************************************************
+*							ProbeReset
+*******************************************************************************/
+void ProbeReset(void)
+{
+	int i = 0;
+	
+	for (i = 0; i < PROBE_LIMITS_COUNT; ++i)
+	{
+		g_strikes[i] = 0;
+	}
+}
+
+
+/******************************************************************************
+*							ProbeLimitName
+*******************************************************************************/
+const char *ProbeLimitName(probe_limit_t limit)
+{
+	return ((PROBE_LIMITS_COUNT > limit) ? g_limit_names[limit] :
+										   g_limit_names[PROBE_NONE]);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** ReadRssKb ****************************************/
+static long ReadRssKb(pid_t pid)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	long size = 0;
+	long resident = -1;
+	FILE *file = NULL;
+	
+	snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+	file = fopen(path, "r");
+	if (NULL == file)
+	{
+		return (-1);
+	}
+	
+	/* in pages: size resident shared text lib data dt */
+	if (2 != fscanf(file, "%ld %ld", &size, &resident))
+	{
+		resident = -1;
+	}
+	fclose(file);
+	
+	return ((0 > resident) ? -1 : resident * (sysconf(_SC_PAGESIZE) / KB));
+}
+
+
+/*************************** CountFds *****************************************/
+static long CountFds(pid_t pid)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	struct dirent *entry = NULL;
+	long count = 0;
+	DIR *dir = NULL;
+	
+	snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+	dir = opendir(path);
+	if (NULL == dir)
+	{
+		return (-1);
+	}
+	
+	while (NULL != (entry = readdir(dir)))
+	{
+		/* besides "." and ".." */
+		if ('.' != entry->d_name[0])
+		{
+			++count;
+		}
+	}
+	closedir(dir);
+	
+	return (count);
+}
+
+
+/*************************** ReadCpuTicks *************************************/
+static long ReadCpuTicks(pid_t pid)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	char buf[STAT_BUF_SIZE] = {0};
+	char *line = NULL;
+	proc_stat_t stat = {0};
+	FILE *file = NULL;
+	
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+	file = fopen(path, "r");
+	if (NULL == file)
+	{
+		return (-1);
+	}
+	line = fgets(buf, sizeof(buf), file);
+	fclose(file);
+	
+	if (NULL == line || SUCCESS != ProcParseStat(line, &stat))
+	{
+		return (-1);
+	}
+	
+	return (stat.cpu_ticks);
+}
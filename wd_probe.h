@@ -0,0 +1,91 @@
+/******************************************************************************
+ * File name  : wd_probe.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: resource probes of the watched proc - RSS, open fds & CPU
+ *				usage, against configurable limits. a proc over a limit is
+ *				replaced by a planned (blue/green) restart.
+ ******************************************************************************/
+#ifndef _WD_PROBE_H_
+#define _WD_PROBE_H_
+
+#include <stdint.h>			/* int32_t */
+#include <sys/types.h>		/* pid_t */
+
+#include "./utils/general_types.h"
+
+/*** MACROS ***/
+/* environment variables read by ProbeConfigFromEnv (in the app) */
+#define PROBE_RSS_ENV "WD_MAX_RSS_MB"
+#define PROBE_FDS_ENV "WD_MAX_FDS"
+#define PROBE_CPU_ENV "WD_MAX_CPU_PERCENT"
+#define PROBE_DRAIN_ENV "WD_DRAIN_SECONDS"
+
+#define PROBE_INTERVAL (5)			/* seconds between probes */
+#define PROBE_STRIKES (3)			/* probes in a row over a limit to act */
+#define PROBE_DRAIN_SECONDS (10)	/* default - SIGTERM to SIGKILL */
+
+/*** structures ***/
+typedef enum probe_limit
+{
+	PROBE_NONE = 0,
+	PROBE_RSS,			/* resident memory, in kB */
+	PROBE_FDS,			/* open file descriptors */
+	PROBE_CPU,			/* % of one CPU since the previous probe */
+	PROBE_LIMITS_COUNT
+} probe_limit_t;
+
+/*	part of the config passed from the app to the WD through the handshake.
+	a limit of 0 isn't checked */
+typedef struct probe_config_s
+{
+	int32_t max_rss_mb;
+	int32_t max_fds;
+	int32_t max_cpu_percent;
+	int32_t drain_seconds;	/* for the replaced proc to exit on SIGTERM */
+} probe_config_t;
+
+/*	indexed by probe_limit_t. -1 - couldn't be measured */
+typedef struct probe_sample_s
+{
+	long values[PROBE_LIMITS_COUNT];
+} probe_sample_t;
+
+/*************************** ProbeConfigFromEnv *******************************/
+/*
+ * description  :  fills config from the WD_MAX_* & WD_DRAIN_SECONDS
+ *				   environment variables. without them - no limits.
+ */
+void ProbeConfigFromEnv(probe_config_t *config);
+
+/**************************** ProbeIsEnabled **********************************/
+int ProbeIsEnabled(const probe_config_t *config);
+
+/******************************* ProbeTake ************************************/
+/*
+ * description  :  measures pid from /proc. the CPU usage is relative to the
+ *				   previous probe of the same pid (-1 on the first one).
+ */
+void ProbeTake(pid_t pid, probe_sample_t *sample);
+
+/****************************** ProbeCheck ************************************/
+/*
+ * description  :  takes a sample of pid into sample, and counts the limits
+ *				   it crosses. the strikes start over with a new pid.
+ *
+ * return value :  a limit crossed by PROBE_STRIKES probes in a row.
+ *				   PROBE_NONE otherwise.
+ */
+probe_limit_t ProbeCheck(pid_t pid, const probe_config_t *config,
+						 probe_sample_t *sample);
+
+/****************************** ProbeReset ************************************/
+/*
+ * description  :  starts the strikes over.
+ */
+void ProbeReset(void);
+
+/***************************** ProbeLimitName *********************************/
+const char *ProbeLimitName(probe_limit_t limit);
+
+#endif /* _WD_PROBE_H_ */
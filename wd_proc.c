@@ -0,0 +1,70 @@
+/*******************************************************************************
+*	Filename	:	wd_proc.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	procs' clock & stat source file
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* clock_gettime */
+
+#include <assert.h> 		/* assert */
+#include <stdio.h> 			/* sscanf */
+#include <string.h>			/* strrchr, strchr */
+#include <time.h>			/* clock_gettime */
+
+#include "wd_proc.h"
+
+/******************************* MACROS ***************************************/
+#define USEC_IN_SEC (1000000L)
+#define NSEC_IN_USEC (1000L)
+#define STAT_UTIME_SPACE (12)	/* spaces after the name, before utime */
+
+
+/******************************************************************************
+*							ProcClockUs
+*******************************************************************************/
+uint64_t ProcClockUs(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return ((uint64_t)now.tv_sec * USEC_IN_SEC + now.tv_nsec / NSEC_IN_USEC);
+}
+
+
+/******************************************************************************
+*							ProcParseStat
+*******************************************************************************/
+status_t ProcParseStat(char *line, proc_stat_t *stat)
+{
+	char *name = NULL;
+	char *field = NULL;
+	long utime = 0;
+	long stime = 0;
+	int i = 0;
+	
+	assert(line);
+	assert(stat);
+	
+	if (NULL == (name = strchr(line, '(')) ||
+		NULL == (field = strrchr(line, ')')) || '\0' == field[1])
+	{
+		return (FAILURE);
+	}
+	
+	*field = '\0';
+	stat->name = name + 1;
+	stat->state = field[2];
+	stat->cpu_ticks = -1;
+	
+	for (i = 0; i < STAT_UTIME_SPACE && NULL != field; ++i)
+	{
+		field = strchr(field + 1, ' ');
+	}
+	if (NULL != field && 2 == sscanf(field, "%ld %ld", &utime, &stime))
+	{
+		stat->cpu_ticks = utime + stime;
+	}
+	
+	return (SUCCESS);
+}
@@ -0,0 +1,44 @@
+/******************************************************************************
+ * File name  : wd_proc.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: what the modules of the WD read of the procs - the monotonic
+ *				clock the durations are measured by, and the line of
+ *				/proc/<pid>/stat (or of a thread, /proc/<pid>/task/<tid>/stat).
+ ******************************************************************************/
+#ifndef _WD_PROC_H_
+#define _WD_PROC_H_
+
+#include <stdint.h>			/* uint64_t */
+
+#include "./utils/general_types.h"
+
+/************************** structures ****************************************/
+typedef struct proc_stat
+{
+	const char *name;		/* within the line parsed, without parentheses */
+	char state;				/* R, S, D, Z, T ... */
+	long cpu_ticks;			/* utime + stime, -1 if not in the line */
+} proc_stat_t;
+
+/******************************* ProcClockUs **********************************/
+/*
+ * description  :  the monotonic clock - not set back or forth with the time
+ *				   of day.
+ *
+ * return value :  microseconds since an arbitrary point.
+ */
+uint64_t ProcClockUs(void);
+
+/******************************* ProcParseStat ********************************/
+/*
+ * description  :  parses line - "pid (name) state ppid ... utime stime ...".
+ *				   the name may hold spaces & parentheses - it ends at the
+ *				   last ')', which is cut in line for stat->name.
+ *
+ * return value :  SUCCESS - stat is filled (cpu_ticks may be -1).
+ *				   FAILURE - line isn't of that form.
+ */
+status_t ProcParseStat(char *line, proc_stat_t *stat);
+
+#endif /* _WD_PROC_H_ */
@@ -0,0 +1,144 @@
+/******************************************************************************
+*	Filename	:	wd_proc_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	procs' clock & stat test file. the stat lines are made
+*					by hand, beside the one of this proc
+*******************************************************************************/
+#include <stdio.h> 		/* printf, snprintf, fopen, fgets */
+#include <string.h>		/* strcmp, strlen */
+#include <unistd.h>		/* getpid */
+#include <poll.h>		/* poll */
+
+#include "wd_proc.h"
+
+/******************************* MACROS ***************************************/
+#define LINE_SIZE (512)
+
+/************************** unit-test functions *******************************/
+void ProcParseNameTest(void);
+void ProcParseShortTest(void);
+void ProcParseSelfTest(void);
+void ProcClockTest(void);
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR PROC'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	ProcParseNameTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ProcParseShortTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ProcParseSelfTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	ProcClockTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* ProcParseNameTest **********************************/
+void ProcParseNameTest(void)
+{
+	char line[] = "17 (a) b (c)) S 1 17 17 0 -1 4194304 10 0 0 0 7 5 0 0";
+	proc_stat_t stat = {0};
+	status_t status = FAILURE;
+	
+	printf("ProcParseStat (spaces & parentheses):\t");
+	
+	/*	the name ends at the last ')' */
+	status = ProcParseStat(line, &stat);
+	
+	(SUCCESS == status)					&&
+	(NULL != stat.name)					&&
+	(0 == strcmp("a) b (c)", stat.name))	&&
+	('S' == stat.state)					&&
+	(12 == stat.cpu_ticks)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* ProcParseShortTest *********************************/
+void ProcParseShortTest(void)
+{
+	char short_line[] = "17 (name) Z 1 17";
+	char no_name[] = "17 name S 1 17";
+	char cut[] = "17 (name)";
+	proc_stat_t stat = {0};
+	status_t status = FAILURE;
+	
+	printf("ProcParseStat (short & bad lines):\t");
+	
+	/*	the state is there, the cpu time isn't */
+	status = ProcParseStat(short_line, &stat);
+	
+	(SUCCESS == status)					&&
+	('Z' == stat.state)					&&
+	(-1 == stat.cpu_ticks)				&&
+	(FAILURE == ProcParseStat(no_name, &stat))	&&
+	(FAILURE == ProcParseStat(cut, &stat))
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* ProcParseSelfTest **********************************/
+void ProcParseSelfTest(void)
+{
+	char path[LINE_SIZE] = {0};
+	char line[LINE_SIZE] = {0};
+	proc_stat_t stat = {0};
+	status_t status = FAILURE;
+	FILE *file = NULL;
+	
+	printf("ProcParseStat (this proc):\t\t");
+	
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)getpid());
+	file = fopen(path, "r");
+	if (NULL != file)
+	{
+		status = (NULL != fgets(line, sizeof(line), file)) ?
+				 ProcParseStat(line, &stat) : FAILURE;
+		fclose(file);
+	}
+	
+	/*	running, as it reads it */
+	(SUCCESS == status)					&&
+	(0 < strlen(stat.name))				&&
+	('R' == stat.state)					&&
+	(0 <= stat.cpu_ticks)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* ProcClockTest **************************************/
+void ProcClockTest(void)
+{
+	uint64_t first = ProcClockUs();
+	uint64_t second = 0;
+	
+	printf("ProcClockUs (monotonic):\t\t");
+	
+	poll(NULL, 0, 2);
+	second = ProcClockUs();
+	
+	(0 < first)							&&
+	(second >= first + 2000)			&&
+	(second < first + 1000000)
+	?
+	printf("SUCCESS") : printf("FAIL");
+}
@@ -0,0 +1,228 @@
+/*******************************************************************************
+*	Filename	:	wd_rt.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	real-time mode source file. keeps the supervision threads
+					running on time under CPU & memory pressure.
+*******************************************************************************/
+#define _GNU_SOURCE		/* cpu_set_t, SCHED_RESET_ON_FORK */
+
+#include <assert.h> 		/* assert */
+#include <stdio.h> 			/* fprintf */
+#include <stdint.h>			/* INT32_MAX */
+#include <stdlib.h>			/* getenv, malloc */
+#include <string.h>			/* strcmp, strerror, memset */
+#include <errno.h>			/* errno */
+#include <unistd.h>			/* getpid */
+#include <sched.h>			/* sched_setscheduler, sched_setaffinity */
+#include <malloc.h>			/* mallopt */
+#include <sys/mman.h>		/* mlockall */
+
+#include "wd_rt.h"
+#include "wd_flight.h"
+#include "wd_env.h"
+
+/******************************* MACROS ***************************************/
+#define PREFAULT_STACK_SIZE (64 * 1024)
+#define PREFAULT_HEAP_SIZE (256 * 1024)
+
+/************************* global variable ************************************/
+static unsigned int g_active = 0;
+
+/*	the affinity before pinning - restored in children */
+static cpu_set_t g_orig_affinity;
+static int g_is_pinned = FALSE;
+
+/************************** internal functions ********************************/
+/*	touches the next PREFAULT_STACK_SIZE bytes of the stack */
+static void PrefaultStack(void);
+
+/*	keeps the freed heap memory in the arena, and touches PREFAULT_HEAP_SIZE
+	of it. returns SUCCESS if succeeded */
+static status_t PrefaultHeap(void);
+
+static void ReportDenied(const char *who, const char *what, int error);
+
+/******************************************************************************
+*							RTConfigFromEnv
+*******************************************************************************/
+void RTConfigFromEnv(rt_config_t *config)
+{
+	const char *policy = getenv(RT_POLICY_ENV);
+	const char *mlock = getenv(RT_MLOCK_ENV);
+	
+	assert(config);
+	
+	config->priority = (int32_t)EnvToLong(RT_PRIORITY_ENV, 0, 0, INT32_MAX);
+	config->policy = (NULL != policy && 0 == strcmp(policy, "rr")) ?
+					 SCHED_RR : SCHED_FIFO;
+	config->cpu = (int32_t)EnvToLong(RT_CPU_ENV, -1, -1, INT32_MAX);
+	config->lock_memory = (NULL != mlock && 0 == strcmp(mlock, "1"));
+}
+
+
+/******************************************************************************
+*							RTApply
+*******************************************************************************/
+unsigned int RTApply(const rt_config_t *config, const char *who)
+{
+	struct sched_param param = {0};
+	cpu_set_t cpus;
+	unsigned int requested = 0;
+	int policy = 0;
+	
+	assert(config);
+	assert(who);
+	
+	if (config->lock_memory)
+	{
+		requested |= RT_MLOCK | RT_PREFAULT;
+		
+		/*	the pages touched from now on are locked as well - so prefault
+			only after locking */
+		if (0 == mlockall(MCL_CURRENT | MCL_FUTURE))
+		{
+			g_active |= RT_MLOCK;
+		}
+		else
+		{
+			ReportDenied(who, "mlockall", errno);
+		}
+		
+		PrefaultStack();
+		if (SUCCESS == PrefaultHeap())
+		{
+			g_active |= RT_PREFAULT;
+		}
+		else
+		{
+			ReportDenied(who, "heap prefault", ENOMEM);
+		}
+	}
+	
+	if (0 < config->priority)
+	{
+		requested |= RT_PRIORITY;
+		
+		policy = (SCHED_RR == config->policy) ? SCHED_RR : SCHED_FIFO;
+		param.sched_priority = config->priority;
+		if (param.sched_priority > sched_get_priority_max(policy))
+		{
+			param.sched_priority = sched_get_priority_max(policy);
+		}
+		
+		/*	on linux, pid 0 is the calling thread. children start with the
+			normal policy */
+		if (0 == sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param))
+		{
+			g_active |= RT_PRIORITY;
+		}
+		else
+		{
+			ReportDenied(who, (SCHED_RR == policy) ? "SCHED_RR" : "SCHED_FIFO",
+						 errno);
+		}
+	}
+	
+	if (0 <= config->cpu && CPU_SETSIZE > config->cpu)
+	{
+		requested |= RT_AFFINITY;
+		
+		CPU_ZERO(&cpus);
+		CPU_SET(config->cpu, &cpus);
+		if (0 == sched_getaffinity(0, sizeof(g_orig_affinity),
+								   &g_orig_affinity) &&
+			0 == sched_setaffinity(0, sizeof(cpus), &cpus))
+		{
+			g_is_pinned = TRUE;
+			g_active |= RT_AFFINITY;
+		}
+		else
+		{
+			ReportDenied(who, "cpu affinity", errno);
+		}
+	}
+	
+	if (0 != requested)
+	{
+		fprintf(stderr, "%s[%d]: real-time mode - mlock: %s, prefault: %s, "
+				"priority: %s, affinity: %s\n", who, getpid(),
+				(g_active & RT_MLOCK) ? "on" : "off",
+				(g_active & RT_PREFAULT) ? "on" : "off",
+				(g_active & RT_PRIORITY) ? "on" : "off",
+				(g_active & RT_AFFINITY) ? "on" : "off");
+		FlightLog(FL_RT_MODE, requested, g_active, who);
+	}
+	
+	return (g_active);
+}
+
+
+/******************************************************************************
+*							RTResetChild
+*******************************************************************************/
+void RTResetChild(void)
+{
+	if (g_is_pinned)
+	{
+		sched_setaffinity(0, sizeof(g_orig_affinity), &g_orig_affinity);
+	}
+}
+
+
+/******************************************************************************
+*							RTGetActive
+*******************************************************************************/
+unsigned int RTGetActive(void)
+{
+	return (g_active);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** PrefaultStack ************************************/
+static void PrefaultStack(void)
+{
+	volatile char stack[PREFAULT_STACK_SIZE];
+	size_t i = 0;
+	
+	/* a write to every page is enough */
+	for (i = 0; i < sizeof(stack); i += 1024)
+	{
+		stack[i] = 0;
+	}
+}
+
+
+/*************************** PrefaultHeap *************************************/
+static status_t PrefaultHeap(void)
+{
+	char *block = NULL;
+	
+	/*	freed memory stays in the arena instead of being returned to the
+		system, and malloc doesn't use separate mmaps */
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+	
+	block = malloc(PREFAULT_HEAP_SIZE);
+	if (NULL == block)
+	{
+		return (FAILURE);
+	}
+	
+	memset(block, 0, PREFAULT_HEAP_SIZE);
+	free(block);
+	block = NULL;
+	
+	return (SUCCESS);
+}
+
+
+/*************************** ReportDenied *************************************/
+static void ReportDenied(const char *who, const char *what, int error)
+{
+	fprintf(stderr, "%s[%d]: real-time mode - %s denied: %s\n", who, getpid(),
+			what, strerror(error));
+}
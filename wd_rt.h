@@ -0,0 +1,70 @@
+/******************************************************************************
+ * File name  : wd_rt.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: opt-in real-time mode for the supervision threads - locked &
+ *				prefaulted memory, SCHED_FIFO/SCHED_RR priority, CPU pinning.
+ ******************************************************************************/
+#ifndef _WD_RT_H_
+#define _WD_RT_H_
+
+#include <stdint.h>		/* int32_t */
+
+/*** MACROS ***/
+/* environment variables read by RTConfigFromEnv (in the app) */
+#define RT_PRIORITY_ENV "WD_RT_PRIORITY"	/* 1-99. unset - no RT priority */
+#define RT_POLICY_ENV "WD_RT_POLICY"		/* "fifo" (default) / "rr" */
+#define RT_CPU_ENV "WD_RT_CPU"				/* cpu to pin to. unset - any */
+#define RT_MLOCK_ENV "WD_RT_MLOCK"			/* "1" - lock & prefault memory */
+
+/* the protections - requested/active masks */
+#define RT_MLOCK (1 << 0)
+#define RT_PREFAULT (1 << 1)
+#define RT_PRIORITY (1 << 2)
+#define RT_AFFINITY (1 << 3)
+
+/*** structures ***/
+/*	part of the config passed from the app to the WD through the handshake */
+typedef struct rt_config_s
+{
+	int32_t priority;		/* 0 - keep the normal scheduling */
+	int32_t policy;			/* SCHED_FIFO / SCHED_RR */
+	int32_t cpu;			/* -1 - no pinning */
+	int32_t lock_memory;	/* TRUE - mlockall & prefault */
+} rt_config_t;
+
+/***************************** RTConfigFromEnv ********************************/
+/*
+ * description  :  fills config from the WD_RT_* environment variables.
+ *				   without them - real-time mode is off.
+ */
+void RTConfigFromEnv(rt_config_t *config);
+
+/******************************** RTApply *************************************/
+/*
+ * description  :  applies config on the calling (supervision) thread. memory
+ *				   locking is for the whole process. every protection which
+ *				   was requested and denied is reported to stderr & to the
+ *				   flight log. the RT priority isn't inherited by children.
+ *
+ * input		:  config - what to apply.
+ *				   who - name of the proc for the report ("app"/"wd").
+ *
+ * return value :  a mask of the active protections (RT_MLOCK...).
+ */
+unsigned int RTApply(const rt_config_t *config, const char *who);
+
+/**************************** RTResetChild ************************************/
+/*
+ * description  :  runs in a child after fork - restores the CPU affinity the
+ *				   process had before RTApply. async-signal-safe.
+ */
+void RTResetChild(void);
+
+/**************************** RTGetActive *************************************/
+/*
+ * description  :  returns the mask of the protections RTApply has activated.
+ */
+unsigned int RTGetActive(void);
+
+#endif /* _WD_RT_H_ */
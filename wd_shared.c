@@ -6,16 +6,33 @@
 					to both wd_outer and wd_api.c.
 *******************************************************************************/
 #define _POSIX_C_SOURCE 200112L   /* pthread_sigmask, setenv */
+#define _DEFAULT_SOURCE			  /* syscall */
 
-#include <assert.h> /* assert */
-#include <time.h>	/* time */
-
-#ifndef NDEBUG
-#include <stdio.h> 	/* printf */
-#endif
+#include <assert.h> 		/* assert */
+#include <time.h>			/* clock_gettime */
+#include <stdlib.h>			/* _exit, malloc, strtol */
+#include <string.h>			/* strncmp, strcspn, memcpy, strerror */
+#include <stdio.h> 			/* snprintf, fprintf */
+#include <errno.h>			/* errno */
+#include <fcntl.h>			/* fcntl */
+#include <pthread.h>		/* pthread_sigmask, pthread_mutex_t */
+#include <stdatomic.h>		/* atomic_int */
+#include <sys/signalfd.h>	/* signalfd, struct signalfd_siginfo */
+#include <sys/syscall.h>	/* SYS_pidfd_open, SYS_waitid */
+#include <sys/resource.h>	/* struct rusage */
+#include <sys/wait.h>		/* WEXITED, WNOHANG, CLD_EXITED */
+#include <sys/socket.h>		/* socketpair, sendmsg, recvmsg */
 
 #include "./scheduler/scheduler.h"
 #include "wd_shared.h"
+#include "wd_flight.h"
+#include "wd_overload.h"
+#include "wd_state.h"
+#include "wd_logcap.h"
+#include "wd_control.h"
+#include "wd_metrics.h"
+#include "wd_env.h"
+#include "wd_proc.h"
 
 /******************************* MACROS ***************************************/
 #define UNUSED(x) ((void) x)
@@ -23,54 +40,458 @@
 #define CHECK_INTERVAL (2)
 #define MAX_SECONDS_WAITING (3)
 #define COUNT_1_SEC_INTERVAL (1)
+#define SIGINFO_BATCH (8)
+#define USEC_IN_SEC (1000000L)
+#define MSEC_IN_SEC (1000)
+#define NSEC_IN_USEC (1000)
+#define HANDSHAKE_VAR_SIZE (sizeof(HANDSHAKE_ENV) + 16)
+
+#ifndef P_PIDFD
+#define P_PIDFD (3)
+#endif
 
 /************************* global variable ************************************/
 /* NOTE: these global static variables are created separatly for each process */
 
+/* the environment of this proc - copied for the spawned proc */
+extern char **environ;
+
 /* 	counts how many seconds have passed since the last time SIGUSR1 was 
-	received */
+	received. accessed only by the thread running the scheduler */
 static int g_time_since_last_sig = 0;
 
-/*  controls whether to stay in the main loop */
-static int g_keep_run = TRUE;
+/*	seconds added to the deadline while the silence of the peer is explained
+	by overload. zeroed by its next beat */
+static int g_deadline_extension = 0;
+
+/*	weighs the silence of the peer by its recent beats (if phi_threshold) */
+static phi_detector_t g_phi;
+
+/*  controls whether to stay in the main loop. cleared by WDLetMeDie from
+	the app's thread */
+static atomic_int g_keep_run = TRUE;
+
+/*	set by the fallback handler, for signals delivered to a thread which
+	doesn't block them (threads of the app created before WDKeepMeAlive) */
+static volatile sig_atomic_t g_pending_beat = FALSE;
+static volatile sig_atomic_t g_pending_stop = FALSE;
+
+/*	receives the signals of com_pack->mask */
+static int g_sig_fd = -1;
 
 /* a pointer to the scheduler */
 static scheduler_t *g_sched = NULL;
 
+/*	the clock of the scheduler. zeroed - the real time */
+static sched_clock_t g_clock = {0};
+
+/*	StopMainLoop may come from the app's thread after the supervision has
+	ended (stopped by the peer) - the scheduler is destroyed under it */
+static pthread_mutex_t g_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*	a pidfd of the watched proc - readable once it has ended */
+static int g_peer_fd = -1;
+
+/*	this proc's end of the socketpair shared with the watched proc */
+static int g_peer_sock = -1;
+
+/*	the details of the last watched proc which has ended */
+static peer_exit_t g_peer_exit = {0};
+
+/*	the state of reviving the other proc. every state but REVIVE_READY has a
+	deadline - a one-shot ReviveTask in the scheduler (g_revive_task_uid) */
+static revive_state_t g_revive_state = REVIVE_READY;
+static unique_id_t g_revive_task_uid = {0};
+static unsigned int g_revive_attempts = 0;
+
+/*	the pid of the last spawned proc - only its beat means it's ready */
+static pid_t g_revive_pid = 0;
+
+/*	the proc replaced by a planned restart. it is still beaten until it
+	exits, but its own beats & stop request are ignored. 0 - none */
+static pid_t g_retiring_pid = 0;
+static int g_retiring_fd = -1;				/* its pidfd */
+static unique_id_t g_drain_task_uid = {0};
+static uint64_t g_term_time_us = 0;			/* when SIGTERM was sent */
+static int g_drain_seconds = PROBE_DRAIN_SECONDS;
+static pid_t g_retiring_pgid = 0;
+static int g_retiring_sock = -1;			/* told to stop once it's retired */
+
+/*	terminating the other proc (REVIVE_TERMINATING). the proc is spawned
+	again after g_respawn_delay seconds, unless it's negative (WDLetMeDie) */
+static term_step_t g_term_step = TERM_NOTIFY;
+static time_t g_respawn_delay = 0;
+static uint64_t g_term_start_us = 0;
+
+/*	the process group led by the other proc - all of it is terminated. 0 -
+	it doesn't lead its own group (the app which has created the WD) */
+static pid_t g_peer_pgid = 0;
+
+/*	TRUE if this proc was spawned by its peer into a group of its own */
+static int g_is_group_leader = FALSE;
+
+/*	the stop request came from the other proc - it ends by itself */
+static int g_stopped_by_peer = FALSE;
+
+/*	counted for the control socket (served by the WD, if it's set) */
+static ctl_stats_t g_stats = {0};
+static uint64_t g_start_us = 0;
+
+/*	no verdicts on the peer - paused through the control socket */
+static int g_paused = FALSE;
+
+/*	of the commands of the control socket, for the flight log */
+static const char *const g_control_names[CTL_OPS_COUNT] =
+{
+	"unknown", "list", "stats", "restart", "pause", "resume", "intervals"
+};
+
+/*	observed for the metrics exporter (served by the WD, if it's set) */
+static int g_metrics_on = FALSE;
+static metrics_histogram_t g_rtt;
+static metrics_histogram_t g_lag;
+static metrics_histogram_t g_revive;
+static uint64_t g_revive_start_us = 0;		/* 0 - no revive is timed */
+
+/************************** internal functions ********************************/
+/*	handles a single signal received from the signalfd or marked by the
+	fallback handler. sender - the pid which sent it (0 - unknown) */
+static void HandleSignal(int signal, pid_t sender, com_pack_t *com_pack);
+
+/*	handles the signals marked by the fallback handler */
+static void HandlePendingSignals(com_pack_t *com_pack);
+
+/*	reads all the signals waiting in the signalfd */
+static void ReadSignalFd(int fd, com_pack_t *com_pack);
+
+/*	fd handler for the pidfd of the watched proc - reaps it, and schedules
+	its revive */
+static int PeerExitHandler(int fd, short revents, void *arg);
+
+/*	collects the exit status & resource usage of the proc of pidfd. returns
+	FALSE if it hasn't ended yet */
+static int ReapPeer(int pidfd, pid_t pid);
+
+/*	fd handler for the socket shared with the watched proc - reads its
+	hello. closes the socket once the other end is closed */
+static int PeerSockHandler(int fd, short revents, void *arg);
+
+/*	checks a message received from the peer (size bytes) */
+static int IsValidHello(const hello_msg_t *hello, ssize_t size,
+						const com_pack_t *com_pack);
+
+/*	sends the hello of this proc with flags (besides HELLO_GROUP_LEADER).
+	HELLO_STATE attaches the fd of the state region, if there is one.
+	stamp_us - echoed by a HELLO_PONG (0 - now) */
+static status_t SendHello(int sock, const com_pack_t *com_pack,
+						  uint32_t flags, uint64_t stamp_us);
+
+/*	receives a message from the peer into hello. an fd attached to it is
+	returned in state_fd (-1 if none) */
+static ssize_t RecvHello(int sock, hello_msg_t *hello, int *state_fd,
+						 int flags);
+
+/*	keeps the state region received with a valid hello, and closes it
+	otherwise */
+static void KeepState(const hello_msg_t *hello, int state_fd, int is_valid);
+
+/*	replaces the socket shared with the watched proc, and watches it */
+static void SetPeerSock(int sock, com_pack_t *com_pack);
+
+/*	returns a copy of environ (the strings are shared) with the "name=value"
+	strings of vars (NULL-terminated) instead of previous ones of the same
+	names. NULL - allocation has failed */
+static char **BuildChildEnv(char *const vars[]);
+
+/*	moves the revive state machine to state, with its deadline. the deadline
+	of the previous state is cancelled */
+static void SetReviveState(revive_state_t state, time_t deadline,
+						   com_pack_t *com_pack);
+
+/*	a one-shot task - the deadline of the current revive state has come */
+static int ReviveTask(void *arg);
+
+/*	an attempt to revive has failed - kills a proc stuck in its start-up, and
+	schedules the next attempt after a backoff */
+static void ReviveFailed(com_pack_t *com_pack, const char *reason);
+
+/*	the spawned proc has sent its first beat */
+static void ReviveReady(com_pack_t *com_pack);
+
+/*	async-signal-safe handler - only marks the signal, so it is handled later
+	by the thread running the scheduler */
+static void SigHandFallback(int signal);
+
+/*	a task - probes the resources of the watched proc, and replaces it by a
+	planned restart once it crosses a limit */
+static int ProbeTask(void *arg);
+
+/*	starts a planned restart - the watched proc is kept up (as the retiring
+	proc) until the new one is ready */
+static void PlannedRestart(com_pack_t *com_pack, probe_limit_t limit,
+						   long value);
+
+/*	the new proc is ready - asks the retiring proc to exit, within the drain
+	deadline */
+static void RetireOld(com_pack_t *com_pack);
+
+/*	the new proc has failed - the retiring proc is watched again, and the
+	failed one is reaped in its place */
+static void AbortPlannedRestart(com_pack_t *com_pack);
+
+/*	a one-shot task - the drain deadline of the retiring proc has come */
+static int DrainTask(void *arg);
+
+/*	fd handler for the pidfd of the retiring proc - reaps it */
+static int RetiringExitHandler(int fd, short revents, void *arg);
+
+/*	moves to the step of terminating the other proc, and waits for it to end
+	until the deadline of the step */
+static void TermStep(com_pack_t *com_pack, term_step_t step);
+
+/*	the other proc has ended - moves on if its process group has ended as
+	well */
+static void TermConfirm(com_pack_t *com_pack);
+
+/*	the other proc & its group have ended - spawns the new one, or stops
+	the scheduler (TerminatePeer) */
+static void TermDone(com_pack_t *com_pack);
+
+/*	reads the environment variable name into value. keeps it if unset or
+	not a number */
+static void EnvToInt32(const char *name, int32_t *value);
+
+/*	checks whether the peer has been silent for too long - by phi, or by
+	max_seconds_waiting. the deadline extension is discounted. phi_text gets
+	the suspicion level in phi mode */
+static int IsPeerSilent(const com_pack_t *com_pack, char *phi_text,
+						size_t size);
+
+/*	ctl_request_t of the control socket. arg - the com_pack */
+static int ControlRequest(ctl_op_t op, const void *body, uint32_t size,
+						  void *reply, uint32_t *reply_size, void *arg);
+
+/*	fills procs (2 at the most) with the supervised procs. returns their
+	number */
+static uint32_t ListProcs(const com_pack_t *com_pack, ctl_proc_t procs[2]);
+static void GetStats(ctl_stats_t *stats);
+
+/*	fills snapshot for a scrape of the metrics. this func is of type
+	metrics_collect_t */
+static void MetricsCollect(metrics_snapshot_t *snapshot, void *arg);
+
+/*	the timing of the beats & the checks. non-positive - unchanged */
+static void SetIntervals(com_pack_t *com_pack, int32_t send_interval,
+						 int32_t check_interval, int32_t max_seconds_waiting);
+
+/*	reports to stderr & to the flight log that the socket what ("control"
+	or "metrics") can't listen on where. by errno */
+static void ReportListenFailed(const char *what, const char *where);
+
+/*	the time of the beats & the verdicts on them, in us - by the clock of the
+	scheduler, if it isn't the real one (then in whole seconds) */
+static uint64_t NowUs(void);
+
 /******************************************************************************
 *						shared functions
 *******************************************************************************/
+/************************* InitSignals ****************************************/
+status_t InitSignals(com_pack_t *com_pack)
+{
+	action_t fallback = {0};
+	
+	assert(com_pack);
+	
+	/*	as long as the signals are blocked they are handled only through the
+		signalfd. the fallback handler catches them in other threads */
+	fallback.sa_handler = SigHandFallback;
+	sigemptyset(&fallback.sa_mask);
+	if (sigismember(&(com_pack->mask), SIGUSR1))
+	{
+		sigaction(SIGUSR1, &fallback, NULL);
+	}
+	if (sigismember(&(com_pack->mask), SIGUSR2))
+	{
+		sigaction(SIGUSR2, &fallback, NULL);
+	}
+	
+	pthread_sigmask(SIG_BLOCK, &(com_pack->mask), NULL);
+	
+	g_sig_fd = signalfd(-1, &(com_pack->mask), SFD_NONBLOCK | SFD_CLOEXEC);
+	
+	return ((0 > g_sig_fd) ? FAILURE : SUCCESS);
+}
+
+
+/************************* ExecOtherProc **************************************/
+void ExecOtherProc(com_pack_t *com_pack, int handshake_fd, char *const env[])
+{
+	assert(com_pack);
+	
+	/* the signal mask survives exec - the revived proc sets its own */
+	pthread_sigmask(SIG_UNBLOCK, &(com_pack->mask), NULL);
+	
+	/* the only fd of this proc which is kept open by exec */
+	fcntl(handshake_fd, F_SETFD, 0);
+	
+	/* the revived proc isn't pinned to the cpu of this thread */
+	RTResetChild();
+	
+	/*	an app spawned by the WD leads a group of its own, so everything it
+		has started can be terminated together. a WD stays in the group of
+		its app */
+	if (ROLE_WD == com_pack->role)
+	{
+		setpgid(0, 0);
+	}
+	
+	execve(com_pack->who_to_revive, com_pack->argv, env);
+	
+	/* exec failed - the child must not go on as a copy of its parent */
+	FlightLog(FL_EXEC_FAILED, getppid(), errno, com_pack->who_to_revive);
+	_exit(EXIT_FAILURE);
+}
+
+
+/************************* InitConfig *****************************************/
+void InitConfig(wd_config_t *config)
+{
+	assert(config);
+	
+	config->send_interval = SEND_INTERVAL;
+	config->check_interval = CHECK_INTERVAL;
+	config->max_seconds_waiting = MAX_SECONDS_WAITING;
+	config->phi_threshold = PHI_DEFAULT_THRESHOLD;
+	config->notify_seconds = TERM_NOTIFY_SECONDS;
+	config->term_seconds = TERM_SIGTERM_SECONDS;
+	config->kill_seconds = TERM_SIGKILL_SECONDS;
+	config->snapshot_ms = 0;
+	config->timer_slack_ms = 0;
+	
+	EnvToInt32(PHI_THRESHOLD_ENV, &(config->phi_threshold));
+	EnvToInt32(TERM_NOTIFY_ENV, &(config->notify_seconds));
+	EnvToInt32(TERM_SIGTERM_ENV, &(config->term_seconds));
+	EnvToInt32(TERM_SIGKILL_ENV, &(config->kill_seconds));
+	EnvToInt32(SNAPSHOT_ENV, &(config->snapshot_ms));
+	EnvToInt32(TIMER_SLACK_ENV, &(config->timer_slack_ms));
+	
+	/*	phi is worth checking as often as a beat may arrive */
+	if (0 < config->phi_threshold)
+	{
+		config->check_interval = config->send_interval;
+	}
+	
+	RTConfigFromEnv(&(config->rt));
+	ProbeConfigFromEnv(&(config->probe));
+}
+
+
+/************************* SetSchedulerClock **********************************/
+void SetSchedulerClock(sched_clock_t clock)
+{
+	g_clock = clock;
+}
+
+
 /************************* InitScheduler **************************************/
 status_t InitScheduler(com_pack_t *com_pack)
 {
+	scheduler_options_t options = {0};
 	status_t ret_status = FAILURE;
+	const char *control_path = getenv(CTL_PATH_ENV);
+	const char *metrics_listen = getenv(METRICS_LISTEN_ENV);
 	
 	assert(com_pack);
 	
+	g_start_us = ProcClockUs();
+	
+	/*	the beats are a second apart - a few ms of slack lets the kernel wake
+		this proc together with the other timers of the system */
+	options.timer_slack_ns = (unsigned long)com_pack->config.timer_slack_ms *
+							 1000000UL;
+	options.clock = g_clock;
+	
 	/* create scheduler + check whether worked */
-	g_sched = SchedulerCreate();
-	if (NULL != g_sched)
+	g_sched = SchedulerCreateWithOptions(&options);
+	if (NULL != g_sched &&
+		SUCCESS == SchedulerAddFd(g_sched, g_sig_fd, POLLIN,
+								  SignalFdHandler, com_pack))
 	{
 		/* laoding scheduler with tasks */
 		com_pack->task1_uid = SchedulerAddTask(g_sched,
 									  SendSignalTask,
 									  &(com_pack->other_proc_pid),
-									  time(NULL),
-									  SEND_INTERVAL);
+									  SchedulerNow(g_sched),
+									  com_pack->config.send_interval);
 									  
 		com_pack->task2_uid = SchedulerAddTask(g_sched,
 									  CheckSignalTask,
-									  g_sched,
-									  time(NULL),
-									  CHECK_INTERVAL);
+									  com_pack,
+									  SchedulerNow(g_sched),
+									  com_pack->config.check_interval);
 									  
 		com_pack->task3_uid = SchedulerAddTask(g_sched,
 									  CounterAddOneTask,
-									  NULL,
-									  time(NULL),
+									  com_pack,
+									  SchedulerNow(g_sched),
 									  COUNT_1_SEC_INTERVAL);
+		
+		/*	the beats & the checks run first among the due tasks, so other
+			work can't delay them past the peer's deadline */
+		SchedulerSetTaskClass(g_sched, com_pack->task1_uid, TASK_CRITICAL);
+		SchedulerSetTaskClass(g_sched, com_pack->task2_uid, TASK_CRITICAL);
+		
+		/* the resource limits are opt-in - probed as background work */
+		if (ProbeIsEnabled(&(com_pack->config.probe)))
+		{
+			SchedulerSetTaskClass(g_sched,
+								  SchedulerAddTask(g_sched, ProbeTask, com_pack,
+												   SchedulerNow(g_sched) + PROBE_INTERVAL,
+												   PROBE_INTERVAL),
+								  TASK_BACKGROUND);
+		}
+		
+		/*	the stdout & stderr of the app instances spawned by the WD are
+			captured by it. the app holds its pipes for the next WD */
+		if (ROLE_WD == com_pack->role)
+		{
+			LogCapAdopt(g_sched, com_pack->other_proc_pid);
+		}
+		else
+		{
+			LogCapHold();
+		}
+		
+		/*	the WD is the one which supervises - it's asked & commanded
+			through the control socket (opt-in) */
+		if (ROLE_WD == com_pack->role && NULL != control_path &&
+			'\0' != *control_path)
+		{
+			if (SUCCESS != ControlOpen(g_sched, control_path, ControlRequest,
+									   com_pack))
+			{
+				ReportListenFailed("control", control_path);
+			}
+		}
+		
+		/* and scraped through the metrics exporter (opt-in) */
+		if (ROLE_WD == com_pack->role && NULL != metrics_listen &&
+			'\0' != *metrics_listen)
+		{
+			g_metrics_on = (SUCCESS == MetricsOpen(g_sched, metrics_listen,
+												   MetricsCollect, NULL));
+			if (!g_metrics_on)
+			{
+				ReportListenFailed("metrics", metrics_listen);
+			}
+		}
 		ret_status = SUCCESS;
 	}
+	else if (NULL != g_sched)
+	{
+		SchedulerDestroy(g_sched);
+		g_sched = NULL;
+	}
 	
 	return (ret_status);
 }
@@ -81,80 +502,318 @@ void MainLoop(com_pack_t *com_pack)
 {
 	assert(com_pack);
 	
-	/*** main loop - keeps run scheduler and revive as long as the 
-		g_keep_run flag has TRUE ***/
-	while (g_keep_run)
+	/* the tasks got it as they were added */
+	UNUSED(com_pack);
+	
+	/*** main loop - keeps run scheduler as long as the g_keep_run flag has
+		TRUE. the other proc is revived by the tasks of the scheduler ***/
+	while (atomic_load(&g_keep_run))
 	{
 		/* run sched */
 		SchedulerRun(g_sched);
-	
-		/* if scheduler stopped - Revive other proc */
-		Revive(com_pack);
 	}
 }
 
 
 /************************** Revive ********************************************/
-void Revive(com_pack_t *com_pack)
+void Revive(com_pack_t *com_pack, time_t delay)
+{
+	assert(com_pack);
+	
+	/* already being revived */
+	if (REVIVE_READY != g_revive_state)
+	{
+		return;
+	}
+	
+	#ifndef NDEBUG
+	printf("\n ***Revive!!! ***\n\n");
+	#endif
+	
+	FlightLog(FL_REVIVE_START, com_pack->other_proc_pid, delay, NULL);
+	++g_stats.revives;
+	g_revive_start_us = ProcClockUs();
+	
+	g_revive_attempts = 0;
+	
+	/*	a proc which is still there (hung) is terminated first - the new one
+		mustn't run beside it, holding the same ports & memory */
+	if (0 <= g_peer_fd)
+	{
+		g_respawn_delay = delay;
+		g_term_start_us = ProcClockUs();
+		TermStep(com_pack, TERM_NOTIFY);
+		
+		return;
+	}
+	
+	SetReviveState(REVIVE_SPAWNING, SchedulerNow(g_sched) + delay, com_pack);
+}
+
+
+/************************** TerminatePeer *************************************/
+void TerminatePeer(com_pack_t *com_pack)
+{
+	assert(com_pack);
+	
+	if (g_stopped_by_peer)
+	{
+		return;
+	}
+	
+	/*	without a pidfd (or in the middle of a revive) the end of the proc
+		can't be confirmed - only ask it to stop */
+	if (0 > g_peer_fd || REVIVE_READY != g_revive_state)
+	{
+		kill(com_pack->other_proc_pid, SIGUSR2);
+		
+		return;
+	}
+	
+	g_respawn_delay = -1;
+	g_term_start_us = ProcClockUs();
+	TermStep(com_pack, TERM_NOTIFY);
+	
+	/* TermDone stops the scheduler */
+	while (REVIVE_TERMINATING == g_revive_state)
+	{
+		SchedulerRun(g_sched);
+	}
+}
+
+
+/************************** SpawnOtherProc ************************************/
+status_t SpawnOtherProc(com_pack_t *com_pack)
 {
-	pid_t *other_proc_pid = NULL;
+	int socks[2] = {-1, -1};
+	char handshake_var[HANDSHAKE_VAR_SIZE] = {0};
+	char *vars[3] = {NULL};
+	logcap_spawn_t logcap = {0};
+	char **env = NULL;
+	pid_t pid = 0;
+	int fork_errno = 0;
 	
 	assert(com_pack);
 	
-	if (g_keep_run)
+	/*	socks[1] is passed to the child by its number in the environment.
+		prepared before fork - the child only execs */
+	if (0 != socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks))
+	{
+		return (FAILURE);
+	}
+	snprintf(handshake_var, sizeof(handshake_var), "%s=%d", HANDSHAKE_ENV,
+			 socks[1]);
+	vars[0] = handshake_var;
+	
+	/* the pipes of its stdout & stderr, if they are captured */
+	LogCapPrepare(&logcap);
+	vars[1] = ('\0' != logcap.env_var[0]) ? logcap.env_var : NULL;
+	
+	env = BuildChildEnv(vars);
+	if (NULL == env)
 	{
-		/* set local vairables */
-		other_proc_pid = &(com_pack->other_proc_pid);
+		LogCapSpawned(&logcap, -1, NULL);
+		close(socks[0]);
+		close(socks[1]);
 		
-		#ifndef NDEBUG
-		printf("\n ***Revive!!! ***\n\n");
-		#endif
+		return (FAILURE);
+	}
+	
+	pid = fork();
+	if (0 == pid)
+	/* child */
+	{
+		LogCapChild(&logcap);
+		ExecOtherProc(com_pack, socks[1], env);
+	}
 		
-		/* revive the watched process */
-		*other_proc_pid = fork();
-		if (*other_proc_pid == 0)
-		/* child */
-		{
-			/* revive the other process */
-			execv(com_pack->who_to_revive, com_pack->argv);
-		}
-		else if (*other_proc_pid > 0)
-		{
-			/* waits untill revived proc is ready */
-			WaitForSignal(com_pack);			
-		}
-		/* if fork failed - will try again to revive anyway */		
+	fork_errno = (0 > pid) ? errno : 0;
+	free(env);
+	env = NULL;
+	close(socks[1]);
+	LogCapSpawned(&logcap, pid, g_sched);
+	
+	FlightLog(FL_FORK, pid, fork_errno, NULL);
+	if (0 > pid)
+	{
+		close(socks[0]);
+		
+		return (FAILURE);
+	}
+		
+	com_pack->other_proc_pid = pid;
+	g_revive_pid = pid;
+	
+	/*	set by the parent as well - it may signal the group before the child
+		runs. fails harmlessly once the child has exec'd */
+	g_peer_pgid = 0;
+	if (ROLE_WD == com_pack->role)
+	{
+		setpgid(pid, pid);
+		g_peer_pgid = pid;
 	}
+	
+	/* the hello waits in the socket until the child reads it */
+	SetPeerSock(socks[0], com_pack);
+	SendHello(socks[0], com_pack, HELLO_STATE, 0);
+	WatchPeer(com_pack);
+		
+	/* the new proc has REVIVE_READY_TIMEOUT to send its hello */
+	SetReviveState(REVIVE_AWAITING_READY, SchedulerNow(g_sched) + REVIVE_READY_TIMEOUT,
+				   com_pack);
+			
+	return (SUCCESS);
 }
 
 
-/************************** WaitForSignal *************************************/
-void WaitForSignal(com_pack_t *com_pack)
+/************************** AcceptHandshake ***********************************/
+status_t AcceptHandshake(com_pack_t *com_pack)
 {
+	const char *fd_str = getenv(HANDSHAKE_ENV);
+	struct pollfd sock_pollfd = {0};
+	hello_msg_t hello = {0};
+	socklen_t type_size = sizeof(int);
+	ssize_t size = 0;
+	int sock_type = 0;
+	int sock = -1;
+	int state_fd = -1;
+	int is_valid = FALSE;
+	
 	assert(com_pack);
 	
-	/*  waits untill a signal is received & prevents from additional signals
-		to interrupt */
-	pthread_sigmask(SIG_BLOCK, &(com_pack->mask), &(com_pack->oldmask));
+	if (NULL == fd_str)
+	/* not spawned by a peer */
+	{
+		return (FAILURE);
+	}
 	
-	#ifndef NDEBUG
-	printf("\n%d waits for signal\n", getpid());
-	#endif
+	/* the procs created by this one (not by SpawnOtherProc) won't see it */
+	sock = (int)strtol(fd_str, NULL, 10);
+	unsetenv(HANDSHAKE_ENV);
 	
-	sigsuspend(&(com_pack->oldmask));
-	pthread_sigmask(SIG_UNBLOCK, &(com_pack->mask), NULL);
+	/* make sure it's the inherited socket before using it */
+	if (0 != getsockopt(sock, SOL_SOCKET, SO_TYPE, &sock_type, &type_size) ||
+		SOCK_SEQPACKET != sock_type)
+	{
+		return (FAILURE);
+	}
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	
+	/* the hello is sent right after fork - normally it's already waiting */
+	sock_pollfd.fd = sock;
+	sock_pollfd.events = POLLIN;
+	if (0 < poll(&sock_pollfd, 1, REVIVE_READY_TIMEOUT * MSEC_IN_SEC))
+	{
+		size = RecvHello(sock, &hello, &state_fd, 0);
+	}
+	
+	/*	the state region of the app comes with the hello of the peer - the
+		WD keeps it, a revived app attaches it */
+	is_valid = IsValidHello(&hello, size, com_pack);
+	KeepState(&hello, state_fd, is_valid);
+	if (!is_valid)
+	{
+		close(sock);
+		
+		return (FAILURE);
+	}
+	
+	com_pack->other_proc_pid = hello.pid;
+	com_pack->config = hello.config;
+	g_peer_sock = sock;
+	g_peer_pgid = (hello.flags & HELLO_GROUP_LEADER) ? hello.pid : 0;
+	g_is_group_leader = (getpgrp() == getpid());
+	
+	return (SUCCESS);
+}
+
+
+/************************** SendReady *****************************************/
+status_t SendReady(com_pack_t *com_pack)
+{
+	assert(com_pack);
+	
+	if (0 > g_peer_sock || SUCCESS != SendHello(g_peer_sock, com_pack, 0, 0))
+	{
+		return (FAILURE);
+	}
+	
+	/* the socket stays open - PeerSockHandler closes it after the peer */
+	SetPeerSock(g_peer_sock, com_pack);
+	
+	return (SUCCESS);
+}
+
+
+/************************** AwaitPeerReady ************************************/
+status_t AwaitPeerReady(com_pack_t *com_pack, time_t timeout)
+{
+	struct pollfd sock_pollfd = {0};
+	time_t deadline = SchedulerNow(g_sched) + timeout;
+	int sock = g_peer_sock;
+	
+	assert(com_pack);
+	
+	sock_pollfd.fd = sock;
+	sock_pollfd.events = POLLIN;
+	
+	/* the same handler as in MainLoop - makes the state REVIVE_READY */
+	while (REVIVE_AWAITING_READY == g_revive_state && sock == g_peer_sock &&
+		   SchedulerNow(g_sched) < deadline &&
+		   0 < poll(&sock_pollfd, 1, (deadline - SchedulerNow(g_sched)) * MSEC_IN_SEC))
+	{
+		if (DONE == PeerSockHandler(sock, sock_pollfd.revents, com_pack))
+		{
+			SchedulerRemoveFd(g_sched, sock);
+		}
+	}
+	
+	return ((REVIVE_READY == g_revive_state) ? SUCCESS : FAILURE);
 }
 
+
 /************************** SendSignalTask ************************************/
 int SendSignalTask(void *arg)
 {
+	struct timespec now = {0};
+	uint64_t now_us = 0;
+	uint64_t due_us = 0;
+	
 	assert(arg);
 	
+	/*	the retiring proc still watches this one - until it exits */
+	if (0 <= g_retiring_fd)
+	{
+		syscall(SYS_pidfd_send_signal, g_retiring_fd, SIGUSR1, NULL, 0);
+	}
+	
+	/*	a proc which is being revived doesn't handle SIGUSR1 yet - a beat
+		would kill it */
+	if (REVIVE_READY != g_revive_state)
+	{
+		return (REPEAT);
+	}
+	
 	#ifndef NDEBUG
 	printf("%d send signal to %d\n", getpid(), *(pid_t *)arg);
 	#endif
 	
 	kill(*(pid_t *)arg, SIGUSR1);
+	FlightLog(FL_BEAT_SENT, *(pid_t *)arg, 0, NULL);
+	++g_stats.beats_sent;
+	
+	/*	how late the scheduler has run the beat - since its run time. the
+		default clock of the scheduler is the real time in whole seconds, so
+		a run time of T is due at T.000 of CLOCK_REALTIME (another clock has
+		no lag to measure). the first beat runs as it's added */
+	if (g_metrics_on && 1 < g_stats.beats_sent && NULL == g_clock.now_func)
+	{
+		clock_gettime(CLOCK_REALTIME, &now);
+		now_us = (uint64_t)now.tv_sec * USEC_IN_SEC +
+				 (uint64_t)now.tv_nsec / NSEC_IN_USEC;
+		due_us = (uint64_t)SchedulerRunTime(g_sched) * USEC_IN_SEC;
+		MetricsObserve(&g_lag, (now_us > due_us) ? now_us - due_us : 0);
+	}
 	
 	return (REPEAT);
 }
@@ -163,7 +822,23 @@ int SendSignalTask(void *arg)
 /************************* CounterAddOneTask **********************************/
 int CounterAddOneTask(void *arg)
 {
-	UNUSED(arg);
+	assert(arg);
+	
+	HandlePendingSignals((com_pack_t *)arg);
+	
+	/*	a state region created by the app is kept by the WD as well. a proc
+		spawned meanwhile gets it with its hello */
+	if (REVIVE_READY == g_revive_state && 0 <= g_peer_sock &&
+		StateTakePending())
+	{
+		SendHello(g_peer_sock, (com_pack_t *)arg, HELLO_STATE, 0);
+	}
+	
+	/*	the beats are signals, one way - the round trip is of a ping */
+	if (g_metrics_on && REVIVE_READY == g_revive_state && 0 <= g_peer_sock)
+	{
+		SendHello(g_peer_sock, (com_pack_t *)arg, HELLO_PING, 0);
+	}
 	
 	/* mark the current call to this function */
 	++g_time_since_last_sig;
@@ -180,59 +855,1387 @@ int CounterAddOneTask(void *arg)
 /* this func is of type task_func_t */
 int CheckSignalTask(void *arg)
 {
-	scheduler_t *sched = (scheduler_t *)arg;
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	overload_cause_t cause = OVERLOAD_NONE;
+	char phi_text[FLIGHT_TEXT_SIZE] = {0};
 	
 	assert(arg);
 	
-	/* check if too much time has past since the last SIGUSR1 was received */
-	if (g_time_since_last_sig > MAX_SECONDS_WAITING)
+	/*	check if too much time has past since the last SIGUSR1 was received.
+		while reviving - the revive states have their own deadlines. while
+		paused - no verdicts */
+	if (REVIVE_READY == g_revive_state && !g_paused &&
+		IsPeerSilent(com_pack, phi_text, sizeof(phi_text)))
 	{
-		SchedulerStop(sched);
+		/*	a peer which is throttled or stalled isn't hung - give it
+			another window (a bounded number of times) */
+		cause = OverloadExtend();
+		if (OVERLOAD_NONE != cause)
+		{
+			g_deadline_extension += com_pack->config.max_seconds_waiting;
+			++g_stats.deadline_extensions;
+			FlightLog(FL_DEADLINE_EXTENDED, com_pack->other_proc_pid,
+					  g_deadline_extension, OverloadCauseName(cause));
+			
+			return (REPEAT);
+		}
+		
+		FlightLog(FL_DEADLINE_MISS, com_pack->other_proc_pid,
+				  g_time_since_last_sig, phi_text);
+		++g_stats.deadline_misses;
+		
+		/*	the evidence of why it has stopped beating - before it is
+			terminated */
+		if (0 < com_pack->config.snapshot_ms && 0 <= g_peer_fd)
+		{
+			SnapshotTake(com_pack->other_proc_pid,
+						 com_pack->config.snapshot_ms);
+		}
 		
 		/* zero to counter before revive the process */
 		g_time_since_last_sig = 0;
+		g_deadline_extension = 0;
+		
+		Revive(com_pack, 0);
+	}
+	else if (REVIVE_READY != g_revive_state && UIDIsBad(g_revive_task_uid))
+	/* the deadline task couldn't be added - try again */
+	{
+		SetReviveState(g_revive_state, SchedulerNow(g_sched), com_pack);
 	}
 	
 	return (REPEAT);		
 }
 
 
-/************************** SigHandZeroCounter ***************************************/
-void SigHandZeroCounter(int signal)
+/************************** SignalFdHandler ***********************************/
+/* this func is of type fd_func_t */
+int SignalFdHandler(int fd, short revents, void *arg)
 {
-	UNUSED(signal);
+	UNUSED(revents);
 	
-	#ifndef NDEBUG
-	printf("%d received the signal\n", getpid());
-	#endif
+	assert(arg);
 	
-	/* zero the counter */
-	g_time_since_last_sig = 0;
+	ReadSignalFd(fd, (com_pack_t *)arg);
 	
-	return;
+	return (REPEAT);
 }
 
 
-/************************** SigHandStopMainLoop ***************************************/
-void SigHandStopMainLoop(int signal)
+/************************** WatchPeer *****************************************/
+status_t WatchPeer(com_pack_t *com_pack)
 {
-	UNUSED(signal);
+	assert(com_pack);
 	
-	/* stops main loop */
-	StopMainLoop();
-}
-
+	/* stop watching the previous proc */
+	if (0 <= g_peer_fd)
+	{
+		SchedulerRemoveFd(g_sched, g_peer_fd);
+		close(g_peer_fd);
+		g_peer_fd = -1;
+	}
+	
+	/*	the overload of the new proc is read from its own cgroup. without
+		the counters, no missed beat is excused */
+	OverloadWatch(com_pack->other_proc_pid);
+	PhiInit(&g_phi, (uint64_t)com_pack->config.send_interval * USEC_IN_SEC,
+			NowUs());
+	
+	/*	the WD isn't a descendant of the app it snapshots */
+	if (ROLE_APP == com_pack->role && 0 < com_pack->config.snapshot_ms)
+	{
+		SnapshotAllowTracer(com_pack->other_proc_pid);
+	}
+	
+	/*	without a pidfd (old kernel, proc has already ended) the proc is
+		revived only by the missing beats */
+	g_peer_fd = syscall(SYS_pidfd_open, com_pack->other_proc_pid, 0);
+	if (0 > g_peer_fd)
+	{
+		return (FAILURE);
+	}
+	
+	if (SUCCESS != SchedulerAddFd(g_sched, g_peer_fd, POLLIN, PeerExitHandler,
+								  com_pack))
+	{
+		close(g_peer_fd);
+		g_peer_fd = -1;
+		
+		return (FAILURE);
+	}
+	
+	return (SUCCESS);
+}
+
+
+/************************** GetPeerExit ***************************************/
+void GetPeerExit(peer_exit_t *peer_exit)
+{
+	assert(peer_exit);
+	
+	*peer_exit = g_peer_exit;
+}
+
 
 /************************ StopMainLoop ****************************************/
 void StopMainLoop(void)
 {
-	g_keep_run = FALSE;
-	SchedulerStop(g_sched);
+	FlightLog(FL_STOP, 0, 0, NULL);
+	
+	atomic_store(&g_keep_run, FALSE);
+	
+	pthread_mutex_lock(&g_sched_lock);
+	if (NULL != g_sched)
+	{
+		SchedulerStop(g_sched);
+	}
+	pthread_mutex_unlock(&g_sched_lock);
 }
 
 
 /******************* SchedulerDestroyWrapper **********************************/
 void SchedulerDestroyWrapper(void)
 {
-	SchedulerDestroy(g_sched);
+	pthread_mutex_lock(&g_sched_lock);
+	if (NULL != g_sched)
+	{
+		SchedulerDestroy(g_sched);
+		g_sched = NULL;
+	}
+	pthread_mutex_unlock(&g_sched_lock);
+	
+	close(g_sig_fd);
+	g_sig_fd = -1;
+	
+	if (0 <= g_peer_fd)
+	{
+		close(g_peer_fd);
+		g_peer_fd = -1;
+	}
+	
+	if (0 <= g_peer_sock)
+	{
+		close(g_peer_sock);
+		g_peer_sock = -1;
+	}
+	
+	if (0 <= g_retiring_fd)
+	{
+		close(g_retiring_fd);
+		g_retiring_fd = -1;
+		g_retiring_pid = 0;
+	}
+	
+	if (0 <= g_retiring_sock)
+	{
+		close(g_retiring_sock);
+		g_retiring_sock = -1;
+	}
+	
+	OverloadClose();
+	LogCapClose();
+	ControlClose();
+	MetricsClose();
+	g_metrics_on = FALSE;
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/************************** HandleSignal **************************************/
+static void HandleSignal(int signal, pid_t sender, com_pack_t *com_pack)
+{
+	switch (signal)
+	{
+		case SIGUSR1:
+			#ifndef NDEBUG
+			printf("%d received the signal\n", getpid());
+			#endif
+			
+			/* the retiring proc isn't watched anymore */
+			if (0 != sender && g_retiring_pid == sender)
+			{
+				break;
+			}
+			
+			FlightLog(FL_BEAT_RECEIVED, sender, 0, NULL);
+			++g_stats.beats_received;
+			
+			/* zero the counter */
+			g_time_since_last_sig = 0;
+			g_deadline_extension = 0;
+			OverloadMark();
+			PhiBeat(&g_phi, NowUs());
+			
+			/*	the first beat of a revived proc. a late beat of the proc it
+				replaces doesn't count (sender is 0 when unknown) */
+			if (REVIVE_AWAITING_READY == g_revive_state &&
+				(0 == sender || g_revive_pid == sender))
+			{
+				ReviveReady(com_pack);
+			}
+			break;
+		
+		case SIGUSR2:
+			/*	the retiring proc stops only itself (WDLetMeDie while it
+				drains) */
+			if (0 != sender && g_retiring_pid == sender)
+			{
+				break;
+			}
+			
+			/* stops main loop */
+			g_stopped_by_peer = TRUE;
+			StopMainLoop();
+			break;
+		
+		default:
+			break;
+	}
+}
+
+
+/************************ HandlePendingSignals ********************************/
+static void HandlePendingSignals(com_pack_t *com_pack)
+{
+	if (g_pending_beat)
+	{
+		g_pending_beat = FALSE;
+		HandleSignal(SIGUSR1, 0, com_pack);
+	}
+	
+	if (g_pending_stop)
+	{
+		g_pending_stop = FALSE;
+		HandleSignal(SIGUSR2, 0, com_pack);
+	}
+}
+
+
+/************************** ReadSignalFd **************************************/
+static void ReadSignalFd(int fd, com_pack_t *com_pack)
+{
+	struct signalfd_siginfo infos[SIGINFO_BATCH];
+	ssize_t bytes_read = 0;
+	ssize_t i = 0;
+	
+	/* reads whole batches untill the non-blocking fd is empty */
+	do
+	{
+		bytes_read = read(fd, infos, sizeof(infos));
+		for (i = 0; i < bytes_read / (ssize_t)sizeof(infos[0]); ++i)
+		{
+			HandleSignal(infos[i].ssi_signo, infos[i].ssi_pid, com_pack);
+		}
+	}
+	while ((ssize_t)sizeof(infos) == bytes_read);
+}
+
+
+/************************** PeerExitHandler ***********************************/
+/* this func is of type fd_func_t */
+static int PeerExitHandler(int fd, short revents, void *arg)
+{
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	time_t delay = 0;
+	
+	UNUSED(revents);
+	
+	assert(arg);
+	
+	if (!ReapPeer(fd, com_pack->other_proc_pid))
+	{
+		return (REPEAT);
+	}
+	
+	/* the fd is removed from the scheduler by returning DONE */
+	close(fd);
+	g_peer_fd = -1;
+	
+	switch (g_revive_state)
+	{
+		case REVIVE_READY:
+			/*	a proc which has exited is revived right away. a crashed one
+				is revived after a delay, so a proc which crashes on
+				start-up won't be revived in a tight loop */
+			if (CLD_KILLED == g_peer_exit.code ||
+				CLD_DUMPED == g_peer_exit.code)
+			{
+				delay = CRASH_RESTART_DELAY;
+			}
+			Revive(com_pack, delay);
+			break;
+	
+		case REVIVE_AWAITING_READY:
+			/* the new proc has ended during its start-up */
+			ReviveFailed(com_pack, "ended");
+			break;
+		
+		case REVIVE_TERMINATING:
+			TermConfirm(com_pack);
+			break;
+		
+		default:
+			/* a proc killed by ReviveFailed - the next attempt is set */
+			break;
+	}
+	
+	return (DONE);
+}
+
+
+/************************** ReapPeer ******************************************/
+static int ReapPeer(int pidfd, pid_t pid)
+{
+	siginfo_t info = {0};
+	struct rusage usage = {0};
+	const char *how = "unknown";
+	long ret = 0;
+	
+	/*	the glibc waitid has no rusage - the syscall has. fails with ECHILD
+		if the proc isn't a child of ours (the app which created the WD) */
+	ret = syscall(SYS_waitid, P_PIDFD, pidfd, &info, WEXITED | WNOHANG,
+				  &usage);
+	if (0 == ret && 0 == info.si_pid)
+	/* hasn't ended yet */
+	{
+		return (FALSE);
+	}
+	
+	g_peer_exit.pid = pid;
+	g_peer_exit.code = (0 == ret) ? info.si_code : 0;
+	g_peer_exit.status = (0 == ret) ? info.si_status : 0;
+	g_peer_exit.cpu_us = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+						 USEC_IN_SEC +
+						 usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	g_peer_exit.max_rss_kb = usage.ru_maxrss;
+	++g_peer_exit.exits;
+	
+	switch (g_peer_exit.code)
+	{
+		case CLD_EXITED:
+			how = "exited";
+			break;
+		
+		case CLD_KILLED:
+			how = "killed";
+			++g_peer_exit.crashes;
+			break;
+		
+		case CLD_DUMPED:
+			how = "dumped";
+			++g_peer_exit.crashes;
+			break;
+		
+		default:
+			break;
+	}
+	
+	#ifndef NDEBUG
+	printf("%d: %d has %s (%d). cpu: %ldus, max rss: %ldkB\n", getpid(), pid,
+		   how, g_peer_exit.status, g_peer_exit.cpu_us,
+		   g_peer_exit.max_rss_kb);
+	#endif
+	
+	FlightLog(FL_PEER_EXIT, pid, g_peer_exit.status, how);
+	if (0 == ret)
+	{
+		FlightLog(FL_PEER_USAGE, g_peer_exit.cpu_us, g_peer_exit.max_rss_kb,
+				  NULL);
+	}
+	
+	return (TRUE);
+}
+
+
+/************************** PeerSockHandler ***********************************/
+/* this func is of type fd_func_t */
+static int PeerSockHandler(int fd, short revents, void *arg)
+{
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	hello_msg_t hello = {0};
+	ssize_t size = 0;
+	int state_fd = -1;
+	int is_valid = FALSE;
+	
+	UNUSED(revents);
+	
+	assert(arg);
+	
+	while (0 < (size = RecvHello(fd, &hello, &state_fd, MSG_DONTWAIT)))
+	{
+		/* a new state region, from the proc which is watched */
+		is_valid = IsValidHello(&hello, size, com_pack);
+		KeepState(&hello, state_fd,
+				  is_valid && com_pack->other_proc_pid == hello.pid);
+		if (!is_valid)
+		{
+			continue;
+		}
+		
+		/* the other proc is terminating this one - notify */
+		if ((hello.flags & HELLO_STOP) &&
+			com_pack->other_proc_pid == hello.pid)
+		{
+			g_stopped_by_peer = TRUE;
+			StopMainLoop();
+		}
+		/* new intervals, set through the control socket of the WD */
+		else if ((hello.flags & HELLO_CONFIG) &&
+				 com_pack->other_proc_pid == hello.pid)
+		{
+			SetIntervals(com_pack, hello.config.send_interval,
+						 hello.config.check_interval,
+						 hello.config.max_seconds_waiting);
+		}
+		/* answered right away - the round trip is of the schedulers */
+		else if ((hello.flags & HELLO_PING) &&
+				 com_pack->other_proc_pid == hello.pid)
+		{
+			SendHello(fd, com_pack, HELLO_PONG, hello.stamp_us);
+		}
+		else if ((hello.flags & HELLO_PONG) &&
+				 com_pack->other_proc_pid == hello.pid)
+		{
+			MetricsObserve(&g_rtt, ProcClockUs() - hello.stamp_us);
+		}
+		/* the hello of the proc which is being revived */
+		else if (REVIVE_AWAITING_READY == g_revive_state &&
+				 g_revive_pid == hello.pid)
+		{
+			ReviveReady(com_pack);
+		}
+	}
+	
+	if (0 > size && (EAGAIN == errno || EWOULDBLOCK == errno))
+	{
+		return (REPEAT);
+	}
+	
+	/*	the other end is closed - the fd is removed from the scheduler by
+		returning DONE */
+	close(fd);
+	if (fd == g_peer_sock)
+	{
+		g_peer_sock = -1;
+	}
+	
+	return (DONE);
+}
+
+
+/************************** IsValidHello **************************************/
+static int IsValidHello(const hello_msg_t *hello, ssize_t size,
+						const com_pack_t *com_pack)
+{
+	return ((ssize_t)sizeof(*hello) == size &&
+			HELLO_MAGIC == hello->magic &&
+			(uint32_t)com_pack->role != hello->role &&
+			0 < hello->pid &&
+			0 < hello->config.send_interval &&
+			0 < hello->config.check_interval &&
+			0 < hello->config.max_seconds_waiting &&
+			0 <= hello->config.notify_seconds &&
+			0 <= hello->config.term_seconds &&
+			0 < hello->config.kill_seconds &&
+			0 <= hello->config.snapshot_ms &&
+			0 <= hello->config.timer_slack_ms);
+}
+
+
+/************************** SendHello *****************************************/
+static status_t SendHello(int sock, const com_pack_t *com_pack,
+						  uint32_t flags, uint64_t stamp_us)
+{
+	hello_msg_t hello = {0};
+	struct iovec iov = {0};
+	struct msghdr msg = {0};
+	char control[CMSG_SPACE(sizeof(int))] = {0};
+	struct cmsghdr *cmsg = NULL;
+	int state_fd = -1;
+	ssize_t size = 0;
+	
+	if (flags & HELLO_STATE)
+	{
+		state_fd = StateDupFd();
+		flags &= (0 > state_fd) ? ~(uint32_t)HELLO_STATE : ~(uint32_t)0;
+	}
+	
+	hello.magic = HELLO_MAGIC;
+	hello.role = com_pack->role;
+	hello.pid = getpid();
+	hello.flags = flags | (g_is_group_leader ? HELLO_GROUP_LEADER : 0);
+	hello.config = com_pack->config;
+	hello.stamp_us = (0 != stamp_us) ? stamp_us : ProcClockUs();
+	
+	iov.iov_base = &hello;
+	iov.iov_len = sizeof(hello);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	
+	/* the fd is duplicated into the peer as it receives the hello */
+	if (0 <= state_fd)
+	{
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &state_fd, sizeof(int));
+	}
+	
+	size = sendmsg(sock, &msg, MSG_NOSIGNAL);
+	if (0 <= state_fd)
+	{
+		close(state_fd);
+	}
+	
+	return (((ssize_t)sizeof(hello) == size) ? SUCCESS : FAILURE);
+}
+
+
+/************************** RecvHello *****************************************/
+static ssize_t RecvHello(int sock, hello_msg_t *hello, int *state_fd,
+						 int flags)
+{
+	struct iovec iov = {0};
+	struct msghdr msg = {0};
+	char control[CMSG_SPACE(sizeof(int))] = {0};
+	struct cmsghdr *cmsg = NULL;
+	ssize_t size = 0;
+	
+	iov.iov_base = hello;
+	iov.iov_len = sizeof(*hello);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	
+	*state_fd = -1;
+	size = recvmsg(sock, &msg, flags | MSG_CMSG_CLOEXEC);
+	
+	for (cmsg = CMSG_FIRSTHDR(&msg); 0 <= size && NULL != cmsg;
+		 cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type)
+		{
+			memcpy(state_fd, CMSG_DATA(cmsg), sizeof(int));
+		}
+	}
+	
+	return (size);
+}
+
+
+/************************** KeepState *****************************************/
+static void KeepState(const hello_msg_t *hello, int state_fd, int is_valid)
+{
+	if (0 > state_fd)
+	{
+		return;
+	}
+	
+	if (is_valid && (hello->flags & HELLO_STATE))
+	{
+		StateSetFd(state_fd);
+	}
+	else
+	{
+		close(state_fd);
+	}
+}
+
+
+/************************** SetPeerSock ***************************************/
+static void SetPeerSock(int sock, com_pack_t *com_pack)
+{
+	/* stop watching the socket of the previous proc */
+	if (0 <= g_peer_sock)
+	{
+		SchedulerRemoveFd(g_sched, g_peer_sock);
+		if (sock != g_peer_sock)
+		{
+			close(g_peer_sock);
+		}
+	}
+	
+	g_peer_sock = sock;
+	if (SUCCESS != SchedulerAddFd(g_sched, sock, POLLIN, PeerSockHandler,
+								  com_pack))
+	/* the peer is still watched by its pidfd & beats */
+	{
+		close(sock);
+		g_peer_sock = -1;
+	}
+}
+
+
+/************************** BuildChildEnv *************************************/
+static char **BuildChildEnv(char *const vars[])
+{
+	char **env = NULL;
+	size_t count = 0;
+	size_t added = 0;
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	int is_replaced = FALSE;
+	
+	while (NULL != environ[count])
+	{
+		++count;
+	}
+	while (NULL != vars[added])
+	{
+		++added;
+	}
+	
+	env = malloc((count + added + 1) * sizeof(char *));
+	if (NULL == env)
+	{
+		return (NULL);
+	}
+	
+	/* a variable of vars replaces the one of the same name */
+	for (i = 0; i < count; ++i)
+	{
+		is_replaced = FALSE;
+		for (k = 0; k < added && !is_replaced; ++k)
+		{
+			is_replaced = (0 == strncmp(environ[i], vars[k],
+										strcspn(vars[k], "=") + 1));
+		}
+		if (!is_replaced)
+		{
+			env[j] = environ[i];
+			++j;
+		}
+	}
+	for (k = 0; k < added; ++k)
+	{
+		env[j] = vars[k];
+		++j;
+	}
+	env[j] = NULL;
+	
+	return (env);
+}
+
+
+/************************** SetReviveState ************************************/
+static void SetReviveState(revive_state_t state, time_t deadline,
+						   com_pack_t *com_pack)
+{
+	/*	cancel the deadline of the previous state. fails harmlessly when it is
+		the running ReviveTask */
+	if (!UIDIsBad(g_revive_task_uid))
+	{
+		SchedulerRemoveTask(g_sched, g_revive_task_uid);
+		g_revive_task_uid = UIDCreateBad();
+	}
+	
+	g_revive_state = state;
+	if (REVIVE_READY != state)
+	{
+		/* on failure - CheckSignalTask adds it later */
+		g_revive_task_uid = SchedulerAddTask(g_sched, ReviveTask, com_pack,
+											 deadline, 0);
+	}
+}
+
+
+/************************** ReviveTask ****************************************/
+/* this func is of type task_func_t */
+static int ReviveTask(void *arg)
+{
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	
+	assert(arg);
+	
+	/* this task is done after this run */
+	g_revive_task_uid = UIDCreateBad();
+	
+	switch (g_revive_state)
+	{
+		case REVIVE_SPAWNING:
+		case REVIVE_FAILED:
+			/* on success - moves to REVIVE_AWAITING_READY */
+			if (SUCCESS != SpawnOtherProc(com_pack))
+			{
+				ReviveFailed(com_pack, "fork");
+			}
+			break;
+		
+		case REVIVE_AWAITING_READY:
+			/* no beat from the new proc in time */
+			ReviveFailed(com_pack, "timeout");
+			break;
+		
+		case REVIVE_TERMINATING:
+			/*	the proc hasn't ended in time - the next step. SIGKILL is
+				repeated, and so is the check of the group */
+			if (TERM_GROUP == g_term_step)
+			{
+				TermConfirm(com_pack);
+			}
+			else
+			{
+				TermStep(com_pack, (TERM_SIGKILL == g_term_step) ?
+								   TERM_SIGKILL : g_term_step + 1);
+			}
+			break;
+		
+		default:
+			break;
+	}
+	
+	return (DONE);
+}
+
+
+/************************** ReviveFailed **************************************/
+static void ReviveFailed(com_pack_t *com_pack, const char *reason)
+{
+	time_t backoff = 1;
+	unsigned int i = 0;
+	
+	++g_revive_attempts;
+	
+	#ifndef NDEBUG
+	printf("%d: revive attempt %u has failed (%s)\n", getpid(),
+		   g_revive_attempts, reason);
+	#endif
+	
+	FlightLog(FL_REVIVE_FAILED, g_revive_pid, g_revive_attempts, reason);
+	++g_stats.revive_failures;
+	
+	/*	a proc stuck in its start-up is killed, so it won't run alongside
+		the next one. it is reaped by PeerExitHandler */
+	if (REVIVE_AWAITING_READY == g_revive_state)
+	{
+		kill(g_revive_pid, SIGKILL);
+	}
+	
+	/* the proc of a planned restart is still up - no need to retry */
+	if (0 != g_retiring_pid && 0 == g_term_time_us)
+	{
+		AbortPlannedRestart(com_pack);
+		
+		return;
+	}
+	
+	/* 1, 2, 4 ... REVIVE_BACKOFF_MAX seconds */
+	for (i = 1; i < g_revive_attempts && backoff < REVIVE_BACKOFF_MAX; ++i)
+	{
+		backoff *= 2;
+	}
+	
+	SetReviveState(REVIVE_FAILED, SchedulerNow(g_sched) + backoff, com_pack);
+}
+
+
+/************************** ReviveReady ***************************************/
+static void ReviveReady(com_pack_t *com_pack)
+{
+	FlightLog(FL_REVIVE_END, g_revive_pid, g_revive_attempts, NULL);
+	
+	if (0 != g_revive_start_us)
+	{
+		MetricsObserve(&g_revive, ProcClockUs() - g_revive_start_us);
+		g_revive_start_us = 0;
+	}
+	
+	g_revive_attempts = 0;
+	SetReviveState(REVIVE_READY, 0, NULL);
+	
+	if (0 != g_retiring_pid && 0 == g_term_time_us)
+	{
+		RetireOld(com_pack);
+	}
+}
+
+
+/************************** SigHandFallback ***********************************/
+static void SigHandFallback(int signal)
+{
+	if (SIGUSR1 == signal)
+	{
+		g_pending_beat = TRUE;
+	}
+	else if (SIGUSR2 == signal)
+	{
+		g_pending_stop = TRUE;
+	}
+}
+
+
+/************************** ProbeTask *****************************************/
+/* this func is of type task_func_t */
+static int ProbeTask(void *arg)
+{
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	probe_sample_t sample = {{0}};
+	probe_limit_t limit = PROBE_NONE;
+	
+	assert(arg);
+	
+	/* one restart at a time. none while paused */
+	if (REVIVE_READY != g_revive_state || 0 != g_retiring_pid || g_paused)
+	{
+		return (REPEAT);
+	}
+	
+	limit = ProbeCheck(com_pack->other_proc_pid, &(com_pack->config.probe),
+					   &sample);
+	
+	#ifndef NDEBUG
+	printf("%d: %d uses rss %ldkB, %ld fds, cpu %ld%%\n", getpid(),
+		   com_pack->other_proc_pid, sample.values[PROBE_RSS],
+		   sample.values[PROBE_FDS], sample.values[PROBE_CPU]);
+	#endif
+	
+	if (PROBE_NONE != limit)
+	{
+		PlannedRestart(com_pack, limit, sample.values[limit]);
+	}
+	
+	return (REPEAT);
+}
+
+
+/************************** PlannedRestart ************************************/
+static void PlannedRestart(com_pack_t *com_pack, probe_limit_t limit,
+						   long value)
+{
+	/*	without a pidfd the retiring proc can't be told from a proc which
+		has reused its pid */
+	if (0 > g_peer_fd)
+	{
+		return;
+	}
+	
+	FlightLog(FL_RESTART_PLAN, com_pack->other_proc_pid, value,
+			  ProbeLimitName(limit));
+	
+	/* the pidfd of the watched proc moves to the retiring proc */
+	SchedulerRemoveFd(g_sched, g_peer_fd);
+	if (SUCCESS != SchedulerAddFd(g_sched, g_peer_fd, POLLIN,
+								  RetiringExitHandler, com_pack))
+	{
+		SchedulerAddFd(g_sched, g_peer_fd, POLLIN, PeerExitHandler, com_pack);
+		
+		return;
+	}
+	g_retiring_pid = com_pack->other_proc_pid;
+	g_retiring_pgid = g_peer_pgid;
+	g_retiring_fd = g_peer_fd;
+	g_peer_fd = -1;
+	g_term_time_us = 0;
+	++g_stats.planned_restarts;
+	g_revive_start_us = ProcClockUs();
+	
+	/*	its socket is kept apart from the one of the new proc - through it,
+		the retiring proc is told to stop watching this one */
+	if (0 <= g_peer_sock)
+	{
+		SchedulerRemoveFd(g_sched, g_peer_sock);
+		g_retiring_sock = g_peer_sock;
+		g_peer_sock = -1;
+	}
+	g_drain_task_uid = UIDCreateBad();
+	g_drain_seconds = com_pack->config.probe.drain_seconds;
+	
+	/* the same state machine as a revive - ReviveReady retires the old proc */
+	g_revive_attempts = 0;
+	SetReviveState(REVIVE_SPAWNING, SchedulerNow(g_sched), com_pack);
+}
+
+
+/************************** RetireOld *****************************************/
+static void RetireOld(com_pack_t *com_pack)
+{
+	/*	a stop from its peer doesn't terminate the peer - it only ends the
+		supervision of the retiring proc, so WDLetMeDie while it drains
+		can't terminate this one */
+	if (0 <= g_retiring_sock)
+	{
+		SendHello(g_retiring_sock, com_pack, HELLO_STOP, 0);
+		close(g_retiring_sock);
+		g_retiring_sock = -1;
+	}
+	
+	g_term_time_us = ProcClockUs();
+	syscall(SYS_pidfd_send_signal, g_retiring_fd, SIGTERM, NULL, 0);
+	
+	/* on failure - it is asked only once */
+	g_drain_task_uid = SchedulerAddTask(g_sched, DrainTask, NULL,
+										SchedulerNow(g_sched) + g_drain_seconds, 0);
+}
+
+
+/************************** AbortPlannedRestart *******************************/
+static void AbortPlannedRestart(com_pack_t *com_pack)
+{
+	pid_t kept_pid = g_retiring_pid;
+	int kept_fd = g_retiring_fd;
+	
+	FlightLog(FL_RESTART_ABORTED, kept_pid, g_revive_pid, NULL);
+	
+	SchedulerRemoveFd(g_sched, kept_fd);
+	g_retiring_pid = 0;
+	g_retiring_fd = -1;
+	
+	/*	the failed proc (killed by ReviveFailed) is reaped as a retiring
+		one. it has no pidfd if it has ended already */
+	if (0 <= g_peer_fd)
+	{
+		SchedulerRemoveFd(g_sched, g_peer_fd);
+		if (SUCCESS == SchedulerAddFd(g_sched, g_peer_fd, POLLIN,
+									  RetiringExitHandler, com_pack))
+		{
+			g_retiring_pid = g_revive_pid;
+			g_retiring_fd = g_peer_fd;
+			g_term_time_us = ProcClockUs();
+		}
+		else
+		{
+			close(g_peer_fd);
+		}
+		g_peer_fd = -1;
+	}
+	
+	/*	the kept proc is watched again. the limit is checked again after
+		PROBE_STRIKES probes */
+	com_pack->other_proc_pid = kept_pid;
+	g_peer_pgid = g_retiring_pgid;
+	WatchPeer(com_pack);
+	if (0 <= g_retiring_sock)
+	{
+		SetPeerSock(g_retiring_sock, com_pack);
+		g_retiring_sock = -1;
+	}
+	close(kept_fd);
+	ProbeReset();
+	
+	g_revive_attempts = 0;
+	SetReviveState(REVIVE_READY, 0, NULL);
+}
+
+
+/************************** DrainTask *****************************************/
+/* this func is of type task_func_t */
+static int DrainTask(void *arg)
+{
+	UNUSED(arg);
+	
+	/* this task is done after this run */
+	g_drain_task_uid = UIDCreateBad();
+	
+	/* reaped by RetiringExitHandler */
+	if (0 <= g_retiring_fd)
+	{
+		syscall(SYS_pidfd_send_signal, g_retiring_fd, SIGKILL, NULL, 0);
+	}
+	
+	return (DONE);
+}
+
+
+/************************** RetiringExitHandler *******************************/
+/* this func is of type fd_func_t */
+static int RetiringExitHandler(int fd, short revents, void *arg)
+{
+	siginfo_t info = {0};
+	const char *how = "ended";
+	long ret = 0;
+	uint64_t drain_ms = 0;
+	
+	UNUSED(revents);
+	UNUSED(arg);
+	
+	/* fails with ECHILD if it isn't a child of ours */
+	ret = syscall(SYS_waitid, P_PIDFD, fd, &info, WEXITED | WNOHANG, NULL);
+	if (0 == ret && 0 == info.si_pid)
+	/* hasn't ended yet */
+	{
+		return (REPEAT);
+	}
+	
+	if (0 != g_term_time_us)
+	{
+		drain_ms = (ProcClockUs() - g_term_time_us) / MSEC_IN_SEC;
+		how = (0 == ret && CLD_KILLED == info.si_code &&
+			   SIGKILL == info.si_status) ? "killed" : "drained";
+	}
+	FlightLog(FL_RETIRED, g_retiring_pid, drain_ms, how);
+	
+	if (!UIDIsBad(g_drain_task_uid))
+	{
+		SchedulerRemoveTask(g_sched, g_drain_task_uid);
+		g_drain_task_uid = UIDCreateBad();
+	}
+	
+	/* the fd is removed from the scheduler by returning DONE */
+	close(fd);
+	g_retiring_fd = -1;
+	g_retiring_pid = 0;
+	g_term_time_us = 0;
+	if (0 <= g_retiring_sock)
+	{
+		close(g_retiring_sock);
+		g_retiring_sock = -1;
+	}
+	
+	return (DONE);
+}
+
+/************************** TermStep ******************************************/
+static void TermStep(com_pack_t *com_pack, term_step_t step)
+{
+	static const char *step_names[] =
+	{
+		"notify", "SIGTERM", "SIGKILL", "group"
+	};
+	time_t wait = com_pack->config.kill_seconds;
+	
+	/*	a thread left seized by the snapshot would take the signal as a stop */
+	SnapshotRelease();
+	g_term_step = step;
+	FlightLog(FL_TERMINATE, com_pack->other_proc_pid, step, step_names[step]);
+	
+	/*	the pidfd can't reach a proc which has reused the pid. the group is
+		signaled first - a signal to a group whose leader has ended (but
+		isn't reaped yet) still reaches the rest of it */
+	switch (step)
+	{
+		case TERM_NOTIFY:
+			/*	an app has no handler for SIGUSR2 - it would end at once */
+			if (SUCCESS != SendHello(g_peer_sock, com_pack, HELLO_STOP, 0) &&
+				ROLE_APP == com_pack->role)
+			{
+				syscall(SYS_pidfd_send_signal, g_peer_fd, SIGUSR2, NULL, 0);
+			}
+			wait = com_pack->config.notify_seconds;
+			break;
+		
+		case TERM_SIGTERM:
+			if (0 != g_peer_pgid)
+			{
+				kill(-g_peer_pgid, SIGTERM);
+			}
+			syscall(SYS_pidfd_send_signal, g_peer_fd, SIGTERM, NULL, 0);
+			wait = com_pack->config.term_seconds;
+			break;
+		
+		case TERM_SIGKILL:
+			if (0 != g_peer_pgid)
+			{
+				kill(-g_peer_pgid, SIGKILL);
+			}
+			syscall(SYS_pidfd_send_signal, g_peer_fd, SIGKILL, NULL, 0);
+			break;
+		
+		case TERM_GROUP:
+			kill(-g_peer_pgid, SIGKILL);
+			break;
+	}
+	
+	SetReviveState(REVIVE_TERMINATING, SchedulerNow(g_sched) + wait, com_pack);
+}
+
+
+/************************** TermConfirm ***************************************/
+static void TermConfirm(com_pack_t *com_pack)
+{
+	/* the proc has ended - its pidfd has been closed by PeerExitHandler */
+	if (0 != g_peer_pgid && 0 == kill(-g_peer_pgid, 0))
+	{
+		TermStep(com_pack, TERM_GROUP);
+		
+		return;
+	}
+	
+	TermDone(com_pack);
+}
+
+
+/************************** TermDone ******************************************/
+static void TermDone(com_pack_t *com_pack)
+{
+	FlightLog(FL_TERMINATED, com_pack->other_proc_pid,
+			  (ProcClockUs() - g_term_start_us) / MSEC_IN_SEC, NULL);
+	
+	g_peer_pgid = 0;
+	
+	if (0 <= g_respawn_delay)
+	{
+		SetReviveState(REVIVE_SPAWNING, SchedulerNow(g_sched) + g_respawn_delay,
+					   com_pack);
+	}
+	else
+	{
+		SetReviveState(REVIVE_READY, 0, NULL);
+		SchedulerStop(g_sched);
+	}
+}
+
+
+/************************** EnvToInt32 **************************************/
+static void EnvToInt32(const char *name, int32_t *value)
+{
+	*value = (int32_t)EnvToLong(name, *value, INT32_MIN, INT32_MAX);
+}
+
+/************************** IsPeerSilent **************************************/
+static int IsPeerSilent(const com_pack_t *com_pack, char *phi_text,
+						size_t size)
+{
+	uint64_t extension_us = (uint64_t)g_deadline_extension * USEC_IN_SEC;
+	double phi = 0;
+	
+	if (0 >= com_pack->config.phi_threshold)
+	{
+		return (g_time_since_last_sig >
+				com_pack->config.max_seconds_waiting + g_deadline_extension);
+	}
+	
+	/* the level the peer would have without the excused seconds */
+	phi = PhiLevel(&g_phi, NowUs() - extension_us);
+	snprintf(phi_text, size, "phi %.1f", phi);
+	
+	return (phi >= com_pack->config.phi_threshold);
+}
+
+
+/*************************** ControlRequest ***********************************/
+/* this func is of type ctl_request_t */
+static int ControlRequest(ctl_op_t op, const void *body, uint32_t size,
+						  void *reply, uint32_t *reply_size, void *arg)
+{
+	com_pack_t *com_pack = (com_pack_t *)arg;
+	ctl_proc_t procs[2];
+	ctl_stats_t stats = {0};
+	ctl_intervals_t intervals = {0};
+	int32_t send_interval = 0;
+	int32_t max_seconds_waiting = 0;
+	int status = CTL_OK;
+	
+	assert(arg);
+	
+	++g_stats.requests;
+	*reply_size = 0;
+	
+	switch (op)
+	{
+		/*	the queries - answered from the counters, without a syscall on
+			the peer, so they're cheap to poll */
+		case CTL_LIST:
+			*reply_size = ListProcs(com_pack, procs) * sizeof(procs[0]);
+			memcpy(reply, procs, *reply_size);
+			
+			return (CTL_OK);
+		
+		case CTL_STATS:
+			GetStats(&stats);
+			*reply_size = sizeof(stats);
+			memcpy(reply, &stats, sizeof(stats));
+			
+			return (CTL_OK);
+		
+		/*	a hung app is terminated first. without a pidfd it can't be
+			told from a proc which has reused its pid */
+		case CTL_RESTART:
+			status = (REVIVE_READY != g_revive_state || 0 != g_retiring_pid) ?
+					 CTL_BUSY : (0 > g_peer_fd) ? CTL_FAILED : CTL_OK;
+			if (CTL_OK == status)
+			{
+				g_time_since_last_sig = 0;
+				g_deadline_extension = 0;
+				Revive(com_pack, 0);
+			}
+			break;
+		
+		case CTL_PAUSE:
+			g_paused = TRUE;
+			break;
+		
+		/*	the silence while paused doesn't count */
+		case CTL_RESUME:
+			g_paused = FALSE;
+			g_time_since_last_sig = 0;
+			g_deadline_extension = 0;
+			PhiInit(&g_phi, (uint64_t)com_pack->config.send_interval *
+					USEC_IN_SEC, NowUs());
+			break;
+		
+		case CTL_SET_INTERVALS:
+			if (sizeof(intervals) != size)
+			{
+				status = CTL_BAD_REQUEST;
+				break;
+			}
+			memcpy(&intervals, body, sizeof(intervals));
+			
+			/*	a beat must be able to arrive before the deadline */
+			send_interval = (0 < intervals.send_interval) ?
+							intervals.send_interval :
+							com_pack->config.send_interval;
+			max_seconds_waiting = (0 < intervals.max_seconds_waiting) ?
+								  intervals.max_seconds_waiting :
+								  com_pack->config.max_seconds_waiting;
+			if (0 > intervals.send_interval ||
+				0 > intervals.check_interval ||
+				0 > intervals.max_seconds_waiting ||
+				send_interval >= max_seconds_waiting)
+			{
+				status = CTL_BAD_REQUEST;
+				break;
+			}
+			
+			SetIntervals(com_pack, intervals.send_interval,
+						 intervals.check_interval,
+						 intervals.max_seconds_waiting);
+			
+			/*	the app beats & checks by the same intervals. a proc being
+				spawned gets them with its hello */
+			if (0 <= g_peer_sock)
+			{
+				SendHello(g_peer_sock, com_pack, HELLO_CONFIG, 0);
+			}
+			
+			intervals.send_interval = com_pack->config.send_interval;
+			intervals.check_interval = com_pack->config.check_interval;
+			intervals.max_seconds_waiting =
+				com_pack->config.max_seconds_waiting;
+			*reply_size = sizeof(intervals);
+			memcpy(reply, &intervals, sizeof(intervals));
+			break;
+		
+		default:
+			return (CTL_UNKNOWN_OP);
+	}
+	
+	FlightLog(FL_CONTROL, op, status, g_control_names[op]);
+	
+	return (status);
+}
+
+
+/*************************** ListProcs ****************************************/
+static uint32_t ListProcs(const com_pack_t *com_pack, ctl_proc_t procs[2])
+{
+	uint64_t now_us = NowUs();
+	uint32_t count = 1;
+	
+	memset(procs, 0, 2 * sizeof(procs[0]));
+	
+	/*	the age is of the last beat of any instance - a revived one is
+		watched from its spawn */
+	procs[0].pid = com_pack->other_proc_pid;
+	procs[0].state = g_revive_state;
+	procs[0].flags = g_paused ? CTL_PROC_PAUSED : 0;
+	procs[0].beat_age_ms = (now_us > g_phi.last_beat_us) ?
+						   (int64_t)(now_us - g_phi.last_beat_us) /
+						   MSEC_IN_SEC : 0;
+	
+	/*	the beats of the retiring proc aren't watched */
+	if (0 != g_retiring_pid)
+	{
+		procs[1].pid = g_retiring_pid;
+		procs[1].state = REVIVE_READY;
+		procs[1].flags = CTL_PROC_RETIRING;
+		procs[1].beat_age_ms = -1;
+		++count;
+	}
+	
+	return (count);
+}
+
+
+/*************************** GetStats *****************************************/
+static void GetStats(ctl_stats_t *stats)
+{
+	*stats = g_stats;
+	stats->uptime_ms = (ProcClockUs() - g_start_us) / MSEC_IN_SEC;
+	stats->exits = g_peer_exit.exits;
+	stats->crashes = g_peer_exit.crashes;
+	stats->wakeups = (NULL != g_sched) ? SchedulerWakeups(g_sched) : 0;
+}
+
+
+/*************************** MetricsCollect ***********************************/
+static void MetricsCollect(metrics_snapshot_t *snapshot, void *arg)
+{
+	size_t max_backlog = 0;
+	int i = 0;
+	
+	UNUSED(arg);
+	
+	/*	on the thread of the scheduler, like everything it copies - O(1) */
+	GetStats(&(snapshot->stats));
+	snapshot->revive_state = g_revive_state;
+	snapshot->paused = g_paused;
+	snapshot->tasks = SchedulerSize(g_sched);
+	snapshot->backlog = SchedulerBacklog(g_sched, &max_backlog);
+	snapshot->max_backlog = max_backlog;
+	for (i = 0; i < TASK_CLASSES; ++i)
+	{
+		SchedulerGetClassStats(g_sched, (task_class_t)i,
+							   &(snapshot->classes[i]));
+	}
+	snapshot->rtt = g_rtt;
+	snapshot->lag = g_lag;
+	snapshot->revive = g_revive;
+}
+
+
+/*************************** SetIntervals *************************************/
+static void SetIntervals(com_pack_t *com_pack, int32_t send_interval,
+						 int32_t check_interval, int32_t max_seconds_waiting)
+{
+	wd_config_t *config = &(com_pack->config);
+	
+	/*	the tasks are re-armed - due no later than by the new interval */
+	if (0 < send_interval && send_interval != config->send_interval)
+	{
+		config->send_interval = send_interval;
+		SchedulerSetTaskInterval(g_sched, com_pack->task1_uid, send_interval);
+		
+		/* the beats of the peer are expected at the new pace as well */
+		PhiInit(&g_phi, (uint64_t)send_interval * USEC_IN_SEC, NowUs());
+	}
+	
+	if (0 < check_interval && check_interval != config->check_interval)
+	{
+		config->check_interval = check_interval;
+		SchedulerSetTaskInterval(g_sched, com_pack->task2_uid,
+								 check_interval);
+	}
+	
+	if (0 < max_seconds_waiting)
+	{
+		config->max_seconds_waiting = max_seconds_waiting;
+	}
+}
+
+
+/*************************** ReportListenFailed *******************************/
+static void ReportListenFailed(const char *what, const char *where)
+{
+	int error = errno;
+	
+	/* the WD goes on without it */
+	fprintf(stderr, "wd[%d]: %s socket - can't listen on %s: %s\n", getpid(),
+			what, where, strerror(error));
+	FlightLog(FL_LISTEN_FAILED, 0, error, what);
+}
+
+
+/*************************** NowUs ********************************************/
+static uint64_t NowUs(void)
+{
+	return ((NULL != g_clock.now_func) ?
+			(uint64_t)SchedulerNow(g_sched) * USEC_IN_SEC : ProcClockUs());
 }
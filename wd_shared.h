@@ -12,15 +12,51 @@
 										struct sigaction */
 #endif
 
+#include <stdint.h>		/* uint32_t */
 #include <unistd.h>     /* getpid, getppid, fork, execv  */
 #include <signal.h>		/* struct sigaction, sigaction, sigemptyset, sigaddset*/
+#include <poll.h>		/* POLLIN */
 
+#include "./scheduler/scheduler.h"
 #include "./scheduler/task/uid/uid.h"
+#include "wd_rt.h"
+#include "wd_phi.h"
+#include "wd_probe.h"
+#include "wd_snapshot.h"
 #include "./utils/general_types.h"
 
 typedef struct sigaction action_t;
 
+/*** enums ****/
+typedef enum role
+{
+	ROLE_APP = 1,
+	ROLE_WD
+}role_t;
+
 /*** structures ****/
+/*	the timing of the beats. decided by the app, and passed on to every proc
+	spawned through the handshake */
+typedef struct wd_config_s
+{
+	int32_t			send_interval;			/* seconds between beats */
+	int32_t			check_interval;			/* seconds between checks */
+	int32_t			max_seconds_waiting;	/* seconds w/o a beat to revive */
+	int32_t			phi_threshold;			/* phi to revive at. 0 - revive
+											   by max_seconds_waiting */
+	rt_config_t		rt;						/* real-time mode (opt-in) */
+	probe_config_t	probe;					/* limits for a planned restart */
+	int32_t			notify_seconds;			/* terminating the other proc - */
+	int32_t			term_seconds;			/* the wait after each step */
+	int32_t			kill_seconds;
+	int32_t			snapshot_ms;			/* budget of a hang snapshot before
+											   the termination. 0 - none */
+	int32_t			timer_slack_ms;			/* the kernel may delay a wakeup of
+											   the scheduler by up to this, to
+											   batch it with other timers. 0 -
+											   the default slack */
+}wd_config_t;
+
 /*  this struct contains all the needed variables for the communication thread
 	and for the WD. */
 typedef struct com_pack_s
@@ -28,39 +64,174 @@ typedef struct com_pack_s
 	char *const 	*argv;
 	char 			*who_to_revive;
 	pid_t 			other_proc_pid;
-	action_t 		sig_1;
-	action_t 		sig_2;
-	sigset_t 		mask;
-	sigset_t		oldmask;
+	role_t			role;		/* of this proc */
+	wd_config_t		config;
+	sigset_t 		mask;		/* signals received through the signalfd */
 	unique_id_t 	task1_uid;
 	unique_id_t 	task2_uid;
 	unique_id_t 	task3_uid;
 }com_pack_t;
 
+/*	the handshake message, over the socketpair inherited by a spawned proc.
+	the spawning proc sends it right after fork (its pid & the config), and
+	the spawned proc sends it back once it is ready */
+typedef struct hello_msg_s
+{
+	uint32_t		magic;		/* HELLO_MAGIC */
+	uint32_t		role;		/* role_t of the sender */
+	int32_t			pid;		/* of the sender */
+	uint32_t		flags;		/* HELLO_GROUP_LEADER, HELLO_STOP,
+								   HELLO_STATE, HELLO_CONFIG, HELLO_PING,
+								   HELLO_PONG */
+	wd_config_t		config;
+	uint64_t		stamp_us;	/* when it was sent (monotonic). a
+								   HELLO_PONG - the one of the ping */
+}hello_msg_t;
+
+/*	how the watched process has ended last time. collected by the reaper */
+typedef struct peer_exit_s
+{
+	pid_t			pid;
+	int				code;		/* CLD_EXITED/CLD_KILLED/CLD_DUMPED. 0 - the
+								   status is unknown (not a child of ours) */
+	int				status;		/* the exit code, or the signal */
+	long			cpu_us;		/* user + system time */
+	long			max_rss_kb;
+	unsigned long	exits;		/* how many exits were seen */
+	unsigned long	crashes;	/* how many of them were killed/dumped */
+}peer_exit_t;
+
+/*	the states of reviving the other proc */
+typedef enum revive_state
+{
+	REVIVE_READY,			/* the other proc is up - nothing to do */
+	REVIVE_SPAWNING,		/* waits to fork & exec the other proc */
+	REVIVE_AWAITING_READY,	/* waits for the first beat of the new proc */
+	REVIVE_FAILED,			/* waits for a backoff before the next attempt */
+	REVIVE_TERMINATING		/* waits for the previous proc to end */
+}revive_state_t;
+
+/*	the steps of terminating the other proc. each one waits for the proc to
+	end before going on to the next */
+typedef enum term_step
+{
+	TERM_NOTIFY,			/* a HELLO_STOP through the socket (SIGUSR2 to a
+							   WD without one) */
+	TERM_SIGTERM,			/* to its process group, if it leads one */
+	TERM_SIGKILL,			/* repeated until it has ended */
+	TERM_GROUP				/* the proc has ended - SIGKILL to the rest of
+							   its process group until it's empty */
+}term_step_t;
+
 
 /*** MACROS for both watchdog.c and watchdog_main.c ***/
 #define SEND_INTERVAL (1)
 #define CHECK_INTERVAL (2)
 #define MAX_SECONDS_WAITING (3)
+#define CRASH_RESTART_DELAY (2)	/* seconds before reviving a crashed proc */
+#define REVIVE_READY_TIMEOUT (5)	/* seconds for a revived proc to beat */
+#define REVIVE_BACKOFF_MAX (8)	/* max seconds between failed attempts */
+#define HELLO_MAGIC (0x57444831)	/* "WDH1" */
+#define HELLO_GROUP_LEADER (1 << 0)	/* the sender leads its process group */
+#define HELLO_STOP (1 << 1)			/* asks the receiver to stop */
+#define HELLO_STATE (1 << 2)		/* carries the fd of the state region of
+									   the app (SCM_RIGHTS) */
+#define HELLO_CONFIG (1 << 3)		/* the intervals of the config were
+									   changed - the receiver adopts them */
+#define HELLO_PING (1 << 4)			/* asks for a HELLO_PONG - the round
+									   trip through the scheduler of the peer */
+#define HELLO_PONG (1 << 5)
+#define TERM_NOTIFY_SECONDS (1)		/* defaults of the termination steps */
+#define TERM_SIGTERM_SECONDS (2)
+#define TERM_SIGKILL_SECONDS (1)
+#define TERM_NOTIFY_ENV "WD_NOTIFY_SECONDS"
+#define TERM_SIGTERM_ENV "WD_TERM_SECONDS"
+#define TERM_SIGKILL_ENV "WD_KILL_SECONDS"
+#define HANDSHAKE_ENV "WD_HANDSHAKE_FD"	/* the inherited end of the socketpair */
+#define TIMER_SLACK_ENV "WD_TIMER_SLACK_MS"
 
 /* main routine functions */
 void MainLoop(com_pack_t *com_pack);
 status_t InitScheduler(com_pack_t *com_pack);
-void Revive(com_pack_t *com_pack);
-void WaitForSignal(com_pack_t *com_pack);
+
+/*	the clock of the scheduler created by InitScheduler (see scheduler.h).
+	the deadlines of the beats, the verdicts & the revive are all by it - a
+	virtual clock runs the supervision without waiting (tests). the default
+	(zeroed) - the real time. call before InitScheduler */
+void SetSchedulerClock(sched_clock_t clock);
+
+/*	sets the default timing (SEND_INTERVAL, CHECK_INTERVAL...) in config,
+	and the rest from the environment - the phi threshold, the termination
+	deadlines, the hang snapshot (see wd_snapshot.h), the real-time mode
+	(see wd_rt.h) & the resource limits (see wd_probe.h) */
+void InitConfig(wd_config_t *config);
+
+/*	starts reviving the other proc after delay seconds, unless it is already
+	being revived. doesn't block - the revive goes on by the scheduler's
+	tasks: terminate the previous proc if it's still there (hung) -> spawn
+	-> wait for its hello (REVIVE_READY_TIMEOUT) -> ready, or kill the stuck
+	proc & try again after a backoff */
+void Revive(com_pack_t *com_pack, time_t delay);
+
+/*	after the main loop - makes sure the other proc ends: notify, SIGTERM,
+	SIGKILL, each after the deadline in the config. runs the scheduler until
+	the proc (and its process group) has ended. returns at once if the stop
+	was requested by the other proc */
+void TerminatePeer(com_pack_t *com_pack);
+
+/*	forks & execs the other proc into com_pack->other_proc_pid with one end
+	of a new socketpair, sends it a hello and waits (without blocking) for
+	its hello back. returns FAILURE if socketpair/fork failed */
+status_t SpawnOtherProc(com_pack_t *com_pack);
+
+/*	for a proc spawned by its peer - reads the peer's hello from the
+	inherited socket: sets com_pack->other_proc_pid & com_pack->config.
+	returns FAILURE if this proc wasn't spawned by a peer. call first */
+status_t AcceptHandshake(com_pack_t *com_pack);
+
+/*	for a proc spawned by its peer - tells the peer this proc is ready. call
+	after InitScheduler */
+status_t SendReady(com_pack_t *com_pack);
+
+/*	waits up to timeout seconds for the hello of the proc spawned by
+	SpawnOtherProc. returns SUCCESS if it is ready. used only before
+	MainLoop - MainLoop waits for it without blocking */
+status_t AwaitPeerReady(com_pack_t *com_pack, time_t timeout);
+
+/*	blocks com_pack->mask in the calling thread (inherited by threads created
+	later) and opens a signalfd for it. must be called before InitScheduler */
+status_t InitSignals(com_pack_t *com_pack);
+
+/*	runs in the child after fork - restores the signal mask & execs
+	com_pack->who_to_revive with env, keeping handshake_fd open. exits the
+	child if exec has failed */
+void ExecOtherProc(com_pack_t *com_pack, int handshake_fd, char *const env[]);
 
 /* tasks functions for the scheduler */
 int SendSignalTask(void *arg);
 
-/* increase the global counter by 1 */
+/*	increase the global counter by 1, after handling the signals marked by
+	the fallback handler & handing a new state region to the peer.
+	arg - the com_pack_t of the proc */
 int CounterAddOneTask(void *arg);
 
-/* checks if the max time limit for receiving a signal has expired */
+/*	checks if the max time limit for receiving a signal has expired.
+	arg - the com_pack_t of the proc */
 int CheckSignalTask(void *arg);
 
-/* signal handlers for SIGUSR1/SIGUSR2 respectively */
-void SigHandZeroCounter(int signal);
-void SigHandStopMainLoop(int signal);
+/*	watches com_pack->other_proc_pid through a pidfd in the scheduler - when
+	it ends it is reaped, and revived right away if it has exited, or after
+	CRASH_RESTART_DELAY if it was killed by a signal. replaces the previous
+	watched proc. call after InitScheduler, whenever other_proc_pid is set */
+status_t WatchPeer(com_pack_t *com_pack);
+
+/*	copies the exit details of the last watched proc which has ended */
+void GetPeerExit(peer_exit_t *peer_exit);
+
+/*	fd handler for the signalfd - handles a batch of SIGUSR1/SIGUSR2 (zero
+	the counter/stop the main loop respectively) between tasks.
+	arg - the com_pack_t of the proc */
+int SignalFdHandler(int fd, short revents, void *arg);
 
 /* ending functions */
 void StopMainLoop(void);
@@ -0,0 +1,346 @@
+/******************************************************************************
+*	Filename	:	wd_shared_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	supervision test file. this proc plays the WD on a
+*					virtual clock - minutes of revives run in a few seconds.
+*					the peers it revives are real procs (this file again,
+*					by its argument): a silent one never sends its hello,
+*					a hung one sends it and never beats
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200112L   /* unsetenv */
+#define _DEFAULT_SOURCE			  /* CLD_KILLED */
+
+#include <stdio.h> 		/* printf, fflush */
+#include <string.h>		/* strcmp */
+#include <stdlib.h>		/* _exit, unsetenv */
+#include <unistd.h>		/* fork, pause */
+#include <poll.h>		/* poll */
+#include <sys/wait.h>	/* waitpid, CLD_KILLED */
+
+#include "wd_shared.h"
+#include "wd_control.h"
+#include "wd_metrics.h"
+#include "wd_overload.h"
+#include "./scheduler/clock/virtual_clock.h"
+
+/******************************* MACROS ***************************************/
+#define START (1000)			/* the virtual time the WD starts at */
+#define SETTLE_MS (50)			/*	real time for the peers to act before
+									each jump of the virtual clock */
+#define MAX_SPAWNS (16)
+#define SILENT "silent"
+#define HUNG "hung"
+
+/************************** structures ****************************************/
+/*	what the WD has done by the virtual time - seen by the clock before each
+	jump */
+typedef struct timeline
+{
+	virtual_clock_t *vclock;
+	sched_clock_t vclock_sched;		/* the clock of vclock itself */
+	com_pack_t *com_pack;
+	time_t end;						/* the WD is stopped at */
+	time_t spawns[MAX_SPAWNS];		/* the times of the new peers */
+	size_t spawns_count;
+	pid_t last_pid;
+	time_t exit_time;				/* of the first peer which has ended */
+	peer_exit_t exit;
+} timeline_t;
+
+/************************** unit-test functions *******************************/
+void ReviveBackoffTest(void);
+void TerminateHungTest(void);
+
+/*************************** helper functions *********************************/
+/*	the peer spawned by the WD under test. mode - SILENT or HUNG */
+static int RunPeer(const char *mode);
+
+/*	runs the WD, spawning peers of mode, until the virtual time end. runs in
+	a proc of its own - the state of the WD is of the whole proc. returns
+	whether check has passed on the timeline */
+static int RunWD(const char *mode, time_t end,
+				 int (*check)(const timeline_t *timeline));
+
+static int CheckBackoff(const timeline_t *timeline);
+static int CheckTerminate(const timeline_t *timeline);
+
+/*	the clock of the WD - the functions of vclock, after the peers have had
+	SETTLE_MS to act. sched_clock_t functions */
+static time_t TimelineNow(void *timeline);
+static void TimelineSleep(time_t run_time, void *timeline);
+
+/*	the first time a hung peer is found silent by phi - it's ready at
+	START + 1, and beats every send_interval */
+static time_t PhiVerdictTime(const wd_config_t *config);
+
+/************************* global variable ************************************/
+static char *g_peer_argv[3] = {"/proc/self/exe", NULL, NULL};
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+	if (1 < argc)
+	{
+		return (RunPeer(argv[1]));
+	}
+	
+	printf("\n***** UNIT-TEST FOR SHARED'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	/*	the WD under test serves nothing, and terminates by the default
+		deadlines */
+	unsetenv(CTL_PATH_ENV);
+	unsetenv(METRICS_LISTEN_ENV);
+	unsetenv(PHI_THRESHOLD_ENV);
+	unsetenv(TERM_NOTIFY_ENV);
+	unsetenv(TERM_SIGTERM_ENV);
+	unsetenv(TERM_SIGKILL_ENV);
+	unsetenv(SNAPSHOT_ENV);
+	
+	ReviveBackoffTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	TerminateHungTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* ReviveBackoffTest **********************************/
+void ReviveBackoffTest(void)
+{
+	printf("Revive (silent peers - backoff):\t");
+	fflush(stdout);
+	
+	/*	no hello within REVIVE_READY_TIMEOUT - each is killed, and the next
+		one is spawned after 1, 2, 4 ... REVIVE_BACKOFF_MAX seconds */
+	RunWD(SILENT, START + 50, CheckBackoff) ?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/************************* TerminateHungTest **********************************/
+void TerminateHungTest(void)
+{
+	printf("Revive (a hung peer - terminated):\t");
+	fflush(stdout);
+	
+	/*	ready, yet never beats - found silent by phi, notified, SIGTERM
+		(ignored), SIGKILL, and spawned again */
+	RunWD(HUNG, START + 30, CheckTerminate) ?
+	printf("SUCCESS") : printf("FAIL");
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* RunPeer ********************************************/
+static int RunPeer(const char *mode)
+{
+	com_pack_t com_pack = {0};
+	
+	com_pack.role = ROLE_APP;
+	sigemptyset(&(com_pack.mask));
+	sigaddset(&(com_pack.mask), SIGUSR1);
+	sigaddset(&(com_pack.mask), SIGUSR2);
+	
+	/*	killed only by SIGKILL - the last step of the termination */
+	signal(SIGTERM, SIG_IGN);
+	
+	if (0 == strcmp(mode, HUNG) &&
+		(SUCCESS != AcceptHandshake(&com_pack) ||
+		 SUCCESS != InitSignals(&com_pack) ||
+		 SUCCESS != InitScheduler(&com_pack) ||
+		 SUCCESS != SendReady(&com_pack)))
+	{
+		return (1);
+	}
+	
+	/* its scheduler is never run */
+	while (TRUE)
+	{
+		pause();
+	}
+	
+	return (0);
+}
+
+
+/************************* RunWD **********************************************/
+static int RunWD(const char *mode, time_t end,
+				 int (*check)(const timeline_t *timeline))
+{
+	com_pack_t com_pack = {0};
+	timeline_t timeline = {0};
+	sched_clock_t clock = {0};
+	int is_passed = FALSE;
+	int status = 0;
+	pid_t pid = fork();
+	
+	if (0 != pid)
+	{
+		return (0 < pid && pid == waitpid(pid, &status, 0) &&
+				WIFEXITED(status) && 0 == WEXITSTATUS(status));
+	}
+	
+	g_peer_argv[1] = (char *)mode;
+	com_pack.argv = g_peer_argv;
+	com_pack.who_to_revive = g_peer_argv[0];
+	com_pack.role = ROLE_WD;
+	sigemptyset(&(com_pack.mask));
+	sigaddset(&(com_pack.mask), SIGUSR1);
+	sigaddset(&(com_pack.mask), SIGUSR2);
+	InitConfig(&(com_pack.config));
+	
+	timeline.vclock = VClockCreate(START);
+	if (NULL == timeline.vclock)
+	{
+		_exit(1);
+	}
+	timeline.vclock_sched = VClockSchedClock(timeline.vclock);
+	timeline.com_pack = &com_pack;
+	timeline.end = end;
+	clock.now_func = TimelineNow;
+	clock.sleep_func = TimelineSleep;
+	clock.param = &timeline;
+	
+	SetSchedulerClock(clock);
+	if (SUCCESS != InitSignals(&com_pack) ||
+		SUCCESS != InitScheduler(&com_pack))
+	{
+		_exit(1);
+	}
+	
+	/* the first peer is spawned by the revive, right away */
+	Revive(&com_pack, 0);
+	MainLoop(&com_pack);
+	
+	is_passed = check(&timeline);
+	
+	/* the peer of the last spawn leads a process group of its own */
+	if (0 < com_pack.other_proc_pid)
+	{
+		kill(-com_pack.other_proc_pid, SIGKILL);
+	}
+	SchedulerDestroyWrapper();
+	VClockDestroy(timeline.vclock);
+	
+	_exit(is_passed ? 0 : 1);
+}
+
+
+/************************* CheckBackoff ***************************************/
+static int CheckBackoff(const timeline_t *timeline)
+{
+	time_t expected = START;
+	time_t backoff = 1;
+	size_t i = 0;
+	int is_passed = TRUE;
+	
+	for (i = 0; i < timeline->spawns_count && is_passed; ++i)
+	{
+		is_passed = (expected == timeline->spawns[i]);
+		expected += REVIVE_READY_TIMEOUT + backoff;
+		backoff = (REVIVE_BACKOFF_MAX > backoff) ? 2 * backoff : backoff;
+	}
+	
+	/* none is missing - the next one would have come after the end */
+	return (is_passed && expected > timeline->end);
+}
+
+
+/************************* CheckTerminate *************************************/
+static int CheckTerminate(const timeline_t *timeline)
+{
+	const wd_config_t *config = &(timeline->com_pack->config);
+	time_t sigkill_time = PhiVerdictTime(config) + config->notify_seconds +
+						  config->term_seconds;
+	time_t late = timeline->exit_time - sigkill_time;
+	
+	/*	killed at the SIGKILL step - reaped by then, or by the next wakeup,
+		and spawned again right away. a deadline extension (by the pressure
+		on the system, which isn't virtual) delays it by max_seconds_waiting */
+	return (2 <= timeline->spawns_count								&&
+			START == timeline->spawns[0]							&&
+			CLD_KILLED == timeline->exit.code						&&
+			SIGKILL == timeline->exit.status						&&
+			timeline->exit_time == timeline->spawns[1]				&&
+			0 <= late												&&
+			1 + OVERLOAD_MAX_EXTENSIONS *
+				config->max_seconds_waiting >= late);
+}
+
+
+/************************* TimelineNow ****************************************/
+static time_t TimelineNow(void *timeline)
+{
+	timeline_t *this_timeline = (timeline_t *)timeline;
+	
+	return (this_timeline->vclock_sched.now_func(
+			this_timeline->vclock_sched.param));
+}
+
+
+/************************* TimelineSleep **************************************/
+static void TimelineSleep(time_t run_time, void *timeline)
+{
+	timeline_t *this_timeline = (timeline_t *)timeline;
+	time_t now = TimelineNow(timeline);
+	peer_exit_t peer_exit = {0};
+	
+	if (this_timeline->last_pid != this_timeline->com_pack->other_proc_pid &&
+		MAX_SPAWNS > this_timeline->spawns_count)
+	{
+		this_timeline->last_pid = this_timeline->com_pack->other_proc_pid;
+		this_timeline->spawns[this_timeline->spawns_count] = now;
+		++this_timeline->spawns_count;
+	}
+	
+	GetPeerExit(&peer_exit);
+	if (0 == this_timeline->exit_time && 0 < peer_exit.exits)
+	{
+		this_timeline->exit_time = now;
+		this_timeline->exit = peer_exit;
+	}
+	
+	if (now >= this_timeline->end)
+	{
+		StopMainLoop();
+		
+		return;
+	}
+	
+	/*	the exits & the hellos of the peers are handled after the jump */
+	poll(NULL, 0, SETTLE_MS);
+	this_timeline->vclock_sched.sleep_func(run_time,
+										   this_timeline->vclock_sched.param);
+}
+
+
+/************************* PhiVerdictTime *************************************/
+static time_t PhiVerdictTime(const wd_config_t *config)
+{
+	phi_detector_t phi;
+	time_t verdict = START + 2;
+	
+	/*	watched from its spawn. its hello is handled at START + 1, after the
+		check of that second */
+	PhiInit(&phi, (uint64_t)config->send_interval * 1000000,
+			(uint64_t)START * 1000000);
+	while (PhiLevel(&phi, (uint64_t)verdict * 1000000) <
+		   config->phi_threshold)
+	{
+		++verdict;
+	}
+	
+	return (verdict);
+}
@@ -0,0 +1,569 @@
+/*******************************************************************************
+*	Filename	:	wd_snapshot.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	hang snapshot source file. the threads are read from
+					/proc/<pid>/task, their user stacks by ptrace. the user
+					stack is the pc & the return addresses found by scanning
+					the stack - it doesn't need frame pointers, but may hold
+					stale frames.
+*******************************************************************************/
+#define _GNU_SOURCE				/* process_vm_readv, __WALL */
+
+#include <stdio.h> 			/* snprintf, fopen, fgets, sscanf */
+#include <stdlib.h>			/* strtol */
+#include <string.h>		/* strrchr, strchr, strcspn, strcmp, strlen, memset */
+#include <stdint.h>			/* uint64_t */
+#include <time.h>			/* nanosleep */
+#include <dirent.h>			/* opendir, readdir */
+#include <sys/ptrace.h>		/* ptrace, PTRACE_SEIZE, PTRACE_INTERRUPT */
+#include <sys/wait.h>		/* waitid, __WALL, WSTOPPED, WEXITED */
+#include <sys/uio.h>		/* process_vm_readv, struct iovec */
+#include <sys/prctl.h>		/* prctl */
+
+#if defined(__x86_64__)
+#include <sys/user.h>		/* struct user_regs_struct */
+#elif defined(__aarch64__)
+#include <elf.h>			/* NT_PRSTATUS */
+#include <asm/ptrace.h>		/* struct user_pt_regs */
+#endif
+
+#include "wd_snapshot.h"
+#include "wd_flight.h"
+#include "wd_proc.h"
+#include "./utils/general_types.h"
+
+/******************************* MACROS ***************************************/
+#define USEC_IN_MSEC (1000L)
+#define PROC_PATH_SIZE (64)
+#define LINE_SIZE (512)
+#define COUNT_TEXT_SIZE (sizeof("-2147483648/-2147483648 threads"))
+#define MAX_CODE_MAPS (128)
+#define STACK_SCAN_WORDS (512)	/* read from the stack pointer up */
+#define STOP_POLL_NS (1000000L)	/* between checks of a stopping thread */
+
+#ifndef PR_SET_PTRACER
+#define PR_SET_PTRACER (0x59616d61)
+#endif
+
+/*** structures ***/
+/*	an executable mapping of the snapshotted proc - a frame is written as
+	an offset in its file */
+typedef struct code_map_s
+{
+	uint64_t start;
+	uint64_t end;
+	uint64_t offset;
+	char name[FLIGHT_TEXT_SIZE];
+} code_map_t;
+
+typedef struct code_maps_s
+{
+	code_map_t maps[MAX_CODE_MAPS];
+	size_t count;
+} code_maps_t;
+
+/*	a thread which hasn't stopped within the budget - still seized */
+typedef struct seized_s
+{
+	pid_t pid;
+	pid_t tid;
+} seized_t;
+
+/************************** internal functions ********************************/
+static void SnapThread(pid_t pid, pid_t tid, const code_maps_t *maps,
+					   uint64_t deadline_us);
+
+/*	writes FL_SNAP_THREAD, and returns the state of the thread in *state */
+static void LogThreadStat(pid_t pid, pid_t tid, char *state);
+
+static void LogKernelStack(pid_t pid, pid_t tid);
+
+/*	stops the thread by ptrace (PTRACE_INTERRUPT, which isn't a signal) for
+	as long as its registers & stack are read. a thread which doesn't stop
+	in the budget is kept seized, for SnapshotRelease */
+static void LogUserStack(pid_t pid, pid_t tid, const code_maps_t *maps,
+						 uint64_t deadline_us);
+
+/*	waits for the stop of the seized thread until deadline_us. signal gets
+	the signal to deliver as it's detached */
+static status_t AwaitStop(pid_t tid, int *signal, uint64_t deadline_us);
+
+/*	takes a stop of the seized thread, if it has stopped - without waiting,
+	and without taking the exit of a proc (its reaper's). signal gets the
+	signal which has stopped it (0 - the interrupt). returns FALSE if it
+	hasn't stopped, -1 if it isn't a tracee anymore */
+static int TakeStop(pid_t tid, int *signal);
+
+static status_t ReadRegs(pid_t tid, uint64_t *pc, uint64_t *sp);
+
+static void LogFrame(pid_t tid, uint64_t addr, const code_maps_t *maps);
+
+/*	returns the executable mapping holding addr. NULL if none does */
+static const code_map_t *FindCodeMap(const code_maps_t *maps, uint64_t addr);
+
+static void ReadCodeMaps(pid_t pid, code_maps_t *maps);
+
+/*	reads the first line of path into buf, without the new-line. returns
+	FAILURE if it isn't readable */
+static status_t ReadLine(const char *path, char *buf, size_t size);
+
+/************************* global variable ************************************/
+static seized_t g_seized[SNAPSHOT_MAX_THREADS];
+static int g_seized_count = 0;
+
+/******************************************************************************
+*							SnapshotTake
+*******************************************************************************/
+int SnapshotTake(pid_t pid, long budget_ms)
+{
+	static code_maps_t maps;		/* kept off the stack of the scheduler */
+	char path[PROC_PATH_SIZE] = {0};
+	char text[COUNT_TEXT_SIZE] = {0};	/* cut by FlightLog */
+	struct dirent *entry = NULL;
+	uint64_t start_us = ProcClockUs();
+	uint64_t deadline_us = start_us + (uint64_t)budget_ms * USEC_IN_MSEC;
+	int threads = 0;
+	int total = 0;
+	DIR *dir = NULL;
+	
+	snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+	dir = opendir(path);
+	if (NULL == dir)
+	{
+		FlightLog(FL_SNAPSHOT, pid, 0, "unreadable");
+		
+		return (0);
+	}
+	
+	ReadCodeMaps(pid, &maps);
+	
+	while (NULL != (entry = readdir(dir)))
+	{
+		if ('.' == entry->d_name[0])
+		{
+			continue;
+		}
+		
+		/* the rest is only counted */
+		++total;
+		if (SNAPSHOT_MAX_THREADS > threads && ProcClockUs() < deadline_us)
+		{
+			SnapThread(pid, (pid_t)strtol(entry->d_name, NULL, 10), &maps,
+					   deadline_us);
+			++threads;
+		}
+	}
+	closedir(dir);
+	
+	snprintf(text, sizeof(text), "%d/%d threads", threads, total);
+	FlightLog(FL_SNAPSHOT, pid, (ProcClockUs() - start_us) / USEC_IN_MSEC,
+			  text);
+	
+	return (threads);
+}
+
+
+/******************************************************************************
+*							SnapshotRelease
+*******************************************************************************/
+int SnapshotRelease(void)
+{
+	siginfo_t info;
+	int signal = 0;
+	int ret = 0;
+	int i = 0;
+	
+	while (i < g_seized_count)
+	{
+		ret = TakeStop(g_seized[i].tid, &signal);
+		
+		/*	a thread which has ended (not the leader - its exit is of the
+			proc) is reaped by its tracer */
+		if (FALSE == ret && g_seized[i].tid != g_seized[i].pid)
+		{
+			memset(&info, 0, sizeof(info));
+			ret = (0 == waitid(P_PID, g_seized[i].tid, &info,
+							   WEXITED | WNOHANG | __WALL) &&
+				   0 != info.si_pid) ? -1 : FALSE;
+		}
+		
+		if (FALSE == ret)
+		{
+			++i;
+			continue;
+		}
+		
+		if (TRUE == ret)
+		{
+			ptrace(PTRACE_DETACH, g_seized[i].tid, NULL,
+				   (void *)(uintptr_t)signal);
+		}
+		--g_seized_count;
+		g_seized[i] = g_seized[g_seized_count];
+	}
+	
+	return (g_seized_count);
+}
+
+
+/******************************************************************************
+*							SnapshotAllowTracer
+*******************************************************************************/
+void SnapshotAllowTracer(pid_t tracer)
+{
+	/* fails harmlessly without Yama */
+	prctl(PR_SET_PTRACER, (unsigned long)tracer, 0, 0, 0);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** SnapThread ***************************************/
+static void SnapThread(pid_t pid, pid_t tid, const code_maps_t *maps,
+					   uint64_t deadline_us)
+{
+	char state = '?';
+	
+	LogThreadStat(pid, tid, &state);
+	LogKernelStack(pid, tid);
+	
+	/*	a thread in an uninterruptible sleep doesn't stop before it wakes up
+		- it would use up the budget. its kernel stack tells where it is */
+	if ('D' != state)
+	{
+		LogUserStack(pid, tid, maps, deadline_us);
+	}
+}
+
+
+/*************************** LogThreadStat ************************************/
+static void LogThreadStat(pid_t pid, pid_t tid, char *state)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	char line[LINE_SIZE] = {0};
+	char wchan[FLIGHT_TEXT_SIZE] = {0};
+	char text[LINE_SIZE] = {0};			/* cut by FlightLog */
+	proc_stat_t stat = {0};
+	
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", (int)pid, (int)tid);
+	if (SUCCESS != ReadLine(path, line, sizeof(line)) ||
+		SUCCESS != ProcParseStat(line, &stat))
+	{
+		return;
+	}
+	*state = stat.state;
+	
+	/* the kernel function it waits in - "0" when running, or hidden */
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/wchan", (int)pid,
+			 (int)tid);
+	if (SUCCESS != ReadLine(path, wchan, sizeof(wchan)) ||
+		0 == strcmp("0", wchan))
+	{
+		snprintf(wchan, sizeof(wchan), "-");
+	}
+	
+	snprintf(text, sizeof(text), "%c %s %s", *state, wchan, stat.name);
+	FlightLog(FL_SNAP_THREAD, tid, stat.cpu_ticks, text);
+}
+
+
+/*************************** LogKernelStack ***********************************/
+static void LogKernelStack(pid_t pid, pid_t tid)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	char line[LINE_SIZE] = {0};
+	char *func = NULL;
+	int depth = 0;
+	FILE *file = NULL;
+	
+	/* readable only with CAP_SYS_ADMIN */
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/stack", (int)pid,
+			 (int)tid);
+	file = fopen(path, "r");
+	if (NULL == file)
+	{
+		return;
+	}
+	
+	/* "[<0>] do_nanosleep+0x7e/0x180" */
+	while (SNAPSHOT_KSTACK_DEPTH > depth &&
+		   NULL != fgets(line, sizeof(line), file))
+	{
+		func = strchr(line, ']');
+		if (NULL == func || '\0' == func[1])
+		{
+			continue;
+		}
+		func += 2;
+		func[strcspn(func, "+\n")] = '\0';
+		
+		FlightLog(FL_SNAP_KSTACK, tid, depth, func);
+		++depth;
+	}
+	fclose(file);
+}
+
+
+/*************************** LogUserStack *************************************/
+static void LogUserStack(pid_t pid, pid_t tid, const code_maps_t *maps,
+						 uint64_t deadline_us)
+{
+	uint64_t words[STACK_SCAN_WORDS] = {0};
+	struct iovec local = {0};
+	struct iovec remote = {0};
+	uint64_t pc = 0;
+	uint64_t sp = 0;
+	ssize_t size = 0;
+	ssize_t i = 0;
+	int depth = 0;
+	int signal = 0;
+	
+	/*	not permitted for a proc of another user, or (with Yama) which isn't
+		a descendant and hasn't called SnapshotAllowTracer */
+	if (0 != ptrace(PTRACE_SEIZE, tid, NULL, NULL))
+	{
+		return;
+	}
+	
+	/*	a thread which doesn't stop in the budget can't be detached - it
+		would swallow the signals of the termination (as stops). released
+		once it stops, by SnapshotRelease */
+	if (0 != ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) ||
+		SUCCESS != AwaitStop(tid, &signal, deadline_us))
+	{
+		if (0 != ptrace(PTRACE_DETACH, tid, NULL, NULL) &&
+			SNAPSHOT_MAX_THREADS > g_seized_count)
+		{
+			g_seized[g_seized_count].pid = pid;
+			g_seized[g_seized_count].tid = tid;
+			++g_seized_count;
+		}
+		
+		return;
+	}
+	
+	if (SUCCESS == ReadRegs(tid, &pc, &sp))
+	{
+		LogFrame(tid, pc, maps);
+		++depth;
+		
+		/* a read which crosses the end of the stack returns its start */
+		local.iov_base = words;
+		local.iov_len = sizeof(words);
+		remote.iov_base = (void *)(uintptr_t)sp;
+		remote.iov_len = sizeof(words);
+		size = process_vm_readv(tid, &local, 1, &remote, 1, 0);
+		
+		for (i = 0; i < size / (ssize_t)sizeof(words[0]) &&
+			 SNAPSHOT_USTACK_DEPTH > depth; ++i)
+		{
+			if (NULL != FindCodeMap(maps, words[i]))
+			{
+				LogFrame(tid, words[i], maps);
+				++depth;
+			}
+		}
+	}
+	
+	/*	a signal which has stopped it (rather than the interrupt) is
+		delivered on the way out */
+	ptrace(PTRACE_DETACH, tid, NULL, (void *)(uintptr_t)signal);
+}
+
+
+/*************************** AwaitStop ****************************************/
+static status_t AwaitStop(pid_t tid, int *signal, uint64_t deadline_us)
+{
+	struct timespec pause = {0, STOP_POLL_NS};
+	int ret = FALSE;
+	
+	while (FALSE == (ret = TakeStop(tid, signal)) && ProcClockUs() < deadline_us)
+	{
+		nanosleep(&pause, NULL);
+	}
+	
+	return ((TRUE == ret) ? SUCCESS : FAILURE);
+}
+
+
+/*************************** TakeStop *****************************************/
+static int TakeStop(pid_t tid, int *signal)
+{
+	siginfo_t info;
+	
+	/*	waitid reports only the stops - the main thread is the watched proc,
+		whose exit is left to its reaper */
+	memset(&info, 0, sizeof(info));
+	if (0 != waitid(P_PID, tid, &info, WSTOPPED | WNOHANG | __WALL))
+	{
+		return (-1);
+	}
+	if (0 == info.si_pid)
+	{
+		return (FALSE);
+	}
+	
+	/*	the status of a ptrace event stop (the interrupt) has the event
+		above the signal */
+	*signal = (0 == (info.si_status >> 8)) ? info.si_status : 0;
+	
+	return (TRUE);
+}
+
+
+/*************************** ReadRegs *****************************************/
+static status_t ReadRegs(pid_t tid, uint64_t *pc, uint64_t *sp)
+{
+#if defined(__x86_64__)
+	struct user_regs_struct regs = {0};
+	
+	if (0 != ptrace(PTRACE_GETREGS, tid, NULL, &regs))
+	{
+		return (FAILURE);
+	}
+	*pc = regs.rip;
+	*sp = regs.rsp;
+	
+	return (SUCCESS);
+#elif defined(__aarch64__)
+	struct user_pt_regs regs = {0};
+	struct iovec iov = {0};
+	
+	iov.iov_base = &regs;
+	iov.iov_len = sizeof(regs);
+	if (0 != ptrace(PTRACE_GETREGSET, tid, (void *)NT_PRSTATUS, &iov))
+	{
+		return (FAILURE);
+	}
+	*pc = regs.pc;
+	*sp = regs.sp;
+	
+	return (SUCCESS);
+#else
+	/* the user stack isn't sampled on other architectures */
+	(void)tid;
+	(void)pc;
+	(void)sp;
+	
+	return (FAILURE);
+#endif
+}
+
+
+/*************************** LogFrame *****************************************/
+static void LogFrame(pid_t tid, uint64_t addr, const code_maps_t *maps)
+{
+	const code_map_t *map = FindCodeMap(maps, addr);
+	char offset[FLIGHT_TEXT_SIZE] = {0};
+	char text[2 * FLIGHT_TEXT_SIZE] = {0};
+	int name_len = 0;
+	
+	/*	"libc.so.6+0x9a1b2" - the offset is kept whole, for addr2line. the
+		absolute address is in arg2 */
+	if (NULL != map)
+	{
+		snprintf(offset, sizeof(offset), "+0x%llx",
+				 (unsigned long long)(addr - map->start + map->offset));
+		name_len = (int)(FLIGHT_TEXT_SIZE - strlen(offset));
+		snprintf(text, sizeof(text), "%.*s%s", name_len, map->name, offset);
+	}
+	else
+	{
+		snprintf(text, sizeof(text), "?");
+	}
+	
+	FlightLog(FL_SNAP_USTACK, tid, (int64_t)addr, text);
+}
+
+
+/*************************** FindCodeMap **************************************/
+static const code_map_t *FindCodeMap(const code_maps_t *maps, uint64_t addr)
+{
+	size_t i = 0;
+	
+	for (i = 0; i < maps->count; ++i)
+	{
+		if (maps->maps[i].start <= addr && addr < maps->maps[i].end)
+		{
+			return (&(maps->maps[i]));
+		}
+	}
+	
+	return (NULL);
+}
+
+
+/*************************** ReadCodeMaps *************************************/
+static void ReadCodeMaps(pid_t pid, code_maps_t *maps)
+{
+	char path[PROC_PATH_SIZE] = {0};
+	char line[LINE_SIZE] = {0};
+	char perms[8] = {0};
+	unsigned long long start = 0;
+	unsigned long long end = 0;
+	unsigned long long offset = 0;
+	int path_pos = 0;
+	char *name = NULL;
+	code_map_t *map = NULL;
+	FILE *file = NULL;
+	
+	maps->count = 0;
+	
+	snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+	file = fopen(path, "r");
+	if (NULL == file)
+	{
+		return;
+	}
+	
+	/* "start-end perms offset dev inode path" */
+	while (MAX_CODE_MAPS > maps->count &&
+		   NULL != fgets(line, sizeof(line), file))
+	{
+		path_pos = 0;
+		if (4 != sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &start, &end,
+						perms, &offset, &path_pos) ||
+			'x' != perms[2])
+		{
+			continue;
+		}
+		
+		line[strcspn(line, "\n")] = '\0';
+		name = strrchr(line + path_pos, '/');
+		name = (NULL != name) ? name + 1 : line + path_pos;
+		
+		map = &(maps->maps[maps->count]);
+		map->start = start;
+		map->end = end;
+		map->offset = offset;
+		snprintf(map->name, sizeof(map->name), "%s",
+				 ('\0' != *name) ? name : "[anon]");
+		++maps->count;
+	}
+	fclose(file);
+}
+
+
+/*************************** ReadLine *****************************************/
+static status_t ReadLine(const char *path, char *buf, size_t size)
+{
+	FILE *file = fopen(path, "r");
+	char *line = NULL;
+	
+	if (NULL == file)
+	{
+		return (FAILURE);
+	}
+	line = fgets(buf, (int)size, file);
+	fclose(file);
+	
+	if (NULL == line)
+	{
+		return (FAILURE);
+	}
+	buf[strcspn(buf, "\n")] = '\0';
+	
+	return (SUCCESS);
+}
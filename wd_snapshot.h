@@ -0,0 +1,56 @@
+/******************************************************************************
+ * File name  : wd_snapshot.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: hang snapshot - the evidence of why the peer has stopped
+ *				beating (per thread: state, wait channel, kernel stack & a
+ *				sample of the user stack), written to the flight recorder
+ *				before the peer is terminated.
+ ******************************************************************************/
+#ifndef _WD_SNAPSHOT_H_
+#define _WD_SNAPSHOT_H_
+
+#include <sys/types.h>		/* pid_t */
+
+/*** MACROS ***/
+/*	environment variable of the app - the time budget of a snapshot in ms.
+	0 (the default) - no snapshot */
+#define SNAPSHOT_ENV "WD_SNAPSHOT_MS"
+
+#define SNAPSHOT_MAX_THREADS (32)
+#define SNAPSHOT_KSTACK_DEPTH (8)		/* frames of each kernel stack */
+#define SNAPSHOT_USTACK_DEPTH (12)		/* frames of each user stack */
+
+/******************************* SnapshotTake *********************************/
+/*
+ * description  :  writes the threads of pid to the flight recorder, each as
+ *				   FL_SNAP_THREAD & the frames of its stacks (FL_SNAP_KSTACK,
+ *				   FL_SNAP_USTACK), then FL_SNAPSHOT. what isn't readable is
+ *				   skipped. the user stack is sampled by ptrace - each thread
+ *				   is stopped only while its registers & stack are read.
+ *				   stops once budget_ms have passed.
+ *
+ * return value :  the number of threads written.
+ */
+int SnapshotTake(pid_t pid, long budget_ms);
+
+/******************************* SnapshotRelease ******************************/
+/*
+ * description  :  detaches the threads which SnapshotTake has left seized -
+ *				   those which haven't stopped in its budget. a seized thread
+ *				   would be stopped by the signals of the termination rather
+ *				   than get them. one which is still running is kept for the
+ *				   next call.
+ *
+ * return value :  the number of threads still seized.
+ */
+int SnapshotRelease(void);
+
+/**************************** SnapshotAllowTracer *****************************/
+/*
+ * description  :  lets tracer (the peer) sample the stacks of this proc,
+ *				   where ptrace is limited to descendants (Yama).
+ */
+void SnapshotAllowTracer(pid_t tracer);
+
+#endif /* _WD_SNAPSHOT_H_ */
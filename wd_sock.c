@@ -0,0 +1,67 @@
+/*******************************************************************************
+*	Filename	:	wd_sock.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	unix-domain sockets source file
+*******************************************************************************/
+#include <assert.h> 		/* assert */
+#include <errno.h>			/* errno, EADDRINUSE, ECONNREFUSED */
+#include <unistd.h>			/* close, unlink */
+#include <sys/socket.h>		/* socket, connect */
+#include <sys/stat.h>		/* lstat, S_ISSOCK */
+
+#include "wd_sock.h"
+
+/*	whether a proc accepts connections on the socket at addr - a live WD,
+	not one left by a WD which has been killed */
+static int IsListening(const struct sockaddr_un *addr);
+
+
+/******************************************************************************
+*							SockRemoveStale
+*******************************************************************************/
+status_t SockRemoveStale(const struct sockaddr_un *addr)
+{
+	struct stat st = {0};
+	
+	assert(addr);
+	
+	if (0 != lstat(addr->sun_path, &st) || !S_ISSOCK(st.st_mode))
+	{
+		return (SUCCESS);
+	}
+	
+	if (IsListening(addr))
+	{
+		errno = EADDRINUSE;
+		
+		return (FAILURE);
+	}
+	unlink(addr->sun_path);
+	
+	return (SUCCESS);
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** IsListening **************************************/
+static int IsListening(const struct sockaddr_un *addr)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int is_listening = TRUE;
+	
+	if (0 > fd)
+	{
+		return (TRUE);
+	}
+	
+	/*	only a refusal tells a stale socket. a full backlog (EAGAIN) is of a
+		live one, and a socket which can't be checked is kept */
+	is_listening = (0 == connect(fd, (const struct sockaddr *)addr,
+								 sizeof(*addr)) || ECONNREFUSED != errno);
+	close(fd);
+	
+	return (is_listening);
+}
@@ -0,0 +1,28 @@
+/******************************************************************************
+ * File name  : wd_sock.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: the unix-domain sockets of the WD (control & metrics). a
+ *				socket file is left behind by a WD which has been killed,
+ *				and must be removed before its path is bound again - but
+ *				never the one of a WD which is still alive.
+ ******************************************************************************/
+#ifndef _WD_SOCK_H_
+#define _WD_SOCK_H_
+
+#include <sys/un.h>			/* struct sockaddr_un */
+
+#include "./utils/general_types.h"
+
+/******************************* SockRemoveStale ******************************/
+/*
+ * description  :  removes the socket at addr if no proc accepts connections
+ *				   on it. anything else at the path (a live socket, a file
+ *				   which isn't a socket) is kept - the bind fails on it.
+ *
+ * return value :  SUCCESS - the path is free, or isn't a socket.
+ *				   FAILURE - a live socket (errno EADDRINUSE).
+ */
+status_t SockRemoveStale(const struct sockaddr_un *addr);
+
+#endif /* _WD_SOCK_H_ */
@@ -0,0 +1,185 @@
+/******************************************************************************
+*	Filename	:	wd_sock_test.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	unix-domain sockets test file. the sockets at the path
+*					are made by hand - one listening (a live WD) or one
+*					bound & closed (left by a WD which has been killed)
+*******************************************************************************/
+#include <stdio.h> 		/* printf, snprintf */
+#include <string.h>		/* memset, memcpy, strlen */
+#include <errno.h>		/* errno, EADDRINUSE */
+#include <fcntl.h>		/* open */
+#include <unistd.h>		/* close, unlink, access, getpid */
+#include <sys/socket.h>	/* socket, bind, listen, connect */
+#include <sys/un.h>		/* struct sockaddr_un */
+
+#include "wd_sock.h"
+
+/******************************* MACROS ***************************************/
+#define PATH_SIZE (64)
+
+/************************** unit-test functions *******************************/
+void SockLiveTest(void);
+void SockStaleTest(void);
+void SockOtherTest(void);
+
+/*************************** helper functions *********************************/
+/*	a socket bound to g_path - listening if is_listening. -1 on failure */
+static int Listen(int is_listening);
+
+/*	whether a client can connect to g_path */
+static int IsAccepting(void);
+
+/************************* global variable ************************************/
+static struct sockaddr_un g_addr;
+static char g_path[PATH_SIZE] = {0};
+
+/******************************************************************************
+*								main
+*******************************************************************************/
+int main(void)
+{
+	printf("\n***** UNIT-TEST FOR SOCK'S FUNCTIONS *****\n\n");
+	printf("\n========================================================\n\n");
+	
+	snprintf(g_path, sizeof(g_path), "/tmp/wd_sock_test.%d", getpid());
+	memset(&g_addr, 0, sizeof(g_addr));
+	g_addr.sun_family = AF_UNIX;
+	memcpy(g_addr.sun_path, g_path, strlen(g_path));
+	
+	SockLiveTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	SockStaleTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	SockOtherTest();
+	printf("\n\n--------------------------------------------------------\n\n");
+	
+	unlink(g_path);
+	
+	return (0);
+}
+
+
+/******************************************************************************
+*								Unit-Tests
+*******************************************************************************/
+
+/************************* SockLiveTest ***************************************/
+void SockLiveTest(void)
+{
+	status_t status = SUCCESS;
+	int live_fd = -1;
+	int error = 0;
+	
+	printf("SockRemoveStale (live - kept):\t\t");
+	
+	/*	another WD listens on it - it's kept, and still accepts */
+	live_fd = Listen(TRUE);
+	status = SockRemoveStale(&g_addr);
+	error = errno;
+	
+	(0 <= live_fd)						&&
+	(FAILURE == status)					&&
+	(EADDRINUSE == error)				&&
+	(TRUE == IsAccepting())
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(live_fd);
+	unlink(g_path);
+}
+
+
+/************************* SockStaleTest **************************************/
+void SockStaleTest(void)
+{
+	status_t status = FAILURE;
+	int stale_fd = -1;
+	
+	printf("SockRemoveStale (stale - removed):\t");
+	
+	/*	nobody listens on it - left by a WD which has been killed */
+	stale_fd = Listen(FALSE);
+	close(stale_fd);
+	status = SockRemoveStale(&g_addr);
+	
+	(0 <= stale_fd)						&&
+	(SUCCESS == status)					&&
+	(0 != access(g_path, F_OK))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	unlink(g_path);
+}
+
+
+/************************* SockOtherTest **************************************/
+void SockOtherTest(void)
+{
+	status_t none_status = FAILURE;
+	status_t file_status = FAILURE;
+	int fd = -1;
+	
+	printf("SockRemoveStale (no socket - kept):\t");
+	
+	/*	nothing there - free already */
+	unlink(g_path);
+	none_status = SockRemoveStale(&g_addr);
+	
+	/*	a file which isn't a socket isn't ours to remove */
+	fd = open(g_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	file_status = SockRemoveStale(&g_addr);
+	
+	(SUCCESS == none_status)			&&
+	(0 <= fd)							&&
+	(SUCCESS == file_status)			&&
+	(0 == access(g_path, F_OK))
+	?
+	printf("SUCCESS") : printf("FAIL");
+	
+	close(fd);
+	unlink(g_path);
+}
+
+
+/******************************************************************************
+*								helper functions
+*******************************************************************************/
+/************************* Listen *********************************************/
+static int Listen(int is_listening)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	
+	unlink(g_path);
+	if (0 <= fd &&
+		(0 != bind(fd, (struct sockaddr *)&g_addr, sizeof(g_addr)) ||
+		 (is_listening && 0 != listen(fd, 1))))
+	{
+		close(fd);
+		fd = -1;
+	}
+	
+	return (fd);
+}
+
+
+/************************* IsAccepting ****************************************/
+static int IsAccepting(void)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	int is_accepting = FALSE;
+	
+	if (0 > fd)
+	{
+		return (FALSE);
+	}
+	
+	is_accepting = (0 == connect(fd, (struct sockaddr *)&g_addr,
+								 sizeof(g_addr)));
+	close(fd);
+	
+	return (is_accepting);
+}
@@ -0,0 +1,230 @@
+/*******************************************************************************
+*	Filename	:	wd_state.c
+*	Developer	:	Eyal Weizman
+*	Last Update	:	2020-03-08
+*	Description	:	persistent state region source file. the region is a
+					memfd - it lives as long as any proc holds its fd, so
+					the WD keeps it through the revives of the app.
+*******************************************************************************/
+#define _GNU_SOURCE				/* memfd_create */
+
+#include <assert.h> 		/* assert */
+#include <string.h>			/* strncpy, strncmp */
+#include <unistd.h>			/* ftruncate, close, getpid */
+#include <fcntl.h>			/* fcntl, F_DUPFD_CLOEXEC */
+#include <pthread.h>		/* pthread_mutex_t */
+#include <sys/mman.h>		/* memfd_create, mmap */
+#include <sys/stat.h>		/* fstat */
+
+#include "wd_state.h"
+#include "wd_flight.h"
+
+/************************* global variable ************************************/
+/*	the fd is set by the thread running the scheduler (from the peer) and
+	by the app's thread (a new region) */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_fd = -1;
+static atomic_int g_pending = 0;
+
+/*	the region mapped by this proc - only by the app */
+static wd_state_header_t *g_header = NULL;
+
+/************************** internal functions ********************************/
+/*	maps fd if it's a region of name & size. NULL otherwise */
+static wd_state_header_t *MapRegion(int fd, const char *name, size_t size);
+
+/*	creates a new region into *fd. NULL on failure */
+static wd_state_header_t *CreateRegion(const char *name, size_t size,
+									   int *fd);
+
+/******************************************************************************
+*							StateAttach
+*******************************************************************************/
+wd_state_header_t *StateAttach(const char *name, size_t size)
+{
+	wd_state_header_t *header = NULL;
+	int fd = -1;
+	int is_new = 0;
+	
+	assert(name);
+	
+	/* the size of the mapping must fit in off_t */
+	if (size > (size_t)INT32_MAX)
+	{
+		return (NULL);
+	}
+	
+	if (NULL != g_header)
+	{
+		return ((g_header->size == size &&
+				 0 == strncmp(g_header->name, name, STATE_NAME_SIZE - 1)) ?
+				g_header : NULL);
+	}
+	
+	pthread_mutex_lock(&g_lock);
+	if (0 <= g_fd)
+	{
+		header = MapRegion(g_fd, name, size);
+	}
+	pthread_mutex_unlock(&g_lock);
+	
+	/*	a region of another name or size is left to the peer - it's replaced
+		once the new one is handed over */
+	if (NULL == header)
+	{
+		header = CreateRegion(name, size, &fd);
+		if (NULL == header)
+		{
+			return (NULL);
+		}
+		StateSetFd(fd);
+		is_new = 1;
+	}
+	
+	/*	a region still attached was left by a crash (or a proc which is
+		retiring) */
+	header->clean_shutdown = (0 < header->generation &&
+							  0 == atomic_load(&header->attached));
+	++header->generation;
+	header->owner_pid = getpid();
+	atomic_store(&header->attached, 1);
+	
+	g_header = header;
+	if (is_new)
+	{
+		atomic_store(&g_pending, 1);
+	}
+	
+	FlightLog(FL_STATE_ATTACHED, header->generation, header->clean_shutdown,
+			  header->name);
+	
+	return (header);
+}
+
+
+/******************************************************************************
+*							StateDetach
+*******************************************************************************/
+void StateDetach(void)
+{
+	if (NULL != g_header && getpid() == g_header->owner_pid)
+	{
+		atomic_store(&g_header->attached, 0);
+	}
+}
+
+
+/******************************************************************************
+*							StateSetFd
+*******************************************************************************/
+void StateSetFd(int fd)
+{
+	int old_fd = -1;
+	
+	pthread_mutex_lock(&g_lock);
+	old_fd = g_fd;
+	g_fd = fd;
+	pthread_mutex_unlock(&g_lock);
+	
+	if (0 <= old_fd && old_fd != fd)
+	{
+		close(old_fd);
+	}
+}
+
+
+/******************************************************************************
+*							StateDupFd
+*******************************************************************************/
+int StateDupFd(void)
+{
+	int fd = -1;
+	
+	pthread_mutex_lock(&g_lock);
+	if (0 <= g_fd)
+	{
+		fd = fcntl(g_fd, F_DUPFD_CLOEXEC, 0);
+	}
+	pthread_mutex_unlock(&g_lock);
+	
+	return (fd);
+}
+
+
+/******************************************************************************
+*							StateTakePending
+*******************************************************************************/
+int StateTakePending(void)
+{
+	return (atomic_exchange(&g_pending, 0));
+}
+
+
+/******************************************************************************
+*							internal functions
+*******************************************************************************/
+/*************************** MapRegion ****************************************/
+static wd_state_header_t *MapRegion(int fd, const char *name, size_t size)
+{
+	struct stat stat_buf = {0};
+	wd_state_header_t *header = NULL;
+	size_t map_size = sizeof(wd_state_header_t) + size;
+	
+	if (0 != fstat(fd, &stat_buf) || (off_t)map_size != stat_buf.st_size)
+	{
+		return (NULL);
+	}
+	
+	header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == header)
+	{
+		return (NULL);
+	}
+	
+	if (STATE_MAGIC != header->magic || STATE_VERSION != header->version ||
+		size != header->size ||
+		0 != strncmp(header->name, name, STATE_NAME_SIZE - 1))
+	{
+		munmap(header, map_size);
+		
+		return (NULL);
+	}
+	
+	return (header);
+}
+
+
+/*************************** CreateRegion *************************************/
+static wd_state_header_t *CreateRegion(const char *name, size_t size,
+									   int *fd)
+{
+	wd_state_header_t *header = NULL;
+	size_t map_size = sizeof(wd_state_header_t) + size;
+	
+	/*	zero-filled - the data of a new region is all zeros */
+	*fd = memfd_create(name, MFD_CLOEXEC);
+	if (0 > *fd)
+	{
+		return (NULL);
+	}
+	
+	if (0 == ftruncate(*fd, (off_t)map_size))
+	{
+		header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+					  *fd, 0);
+	}
+	if (NULL == header || MAP_FAILED == header)
+	{
+		close(*fd);
+		*fd = -1;
+		
+		return (NULL);
+	}
+	
+	header->magic = STATE_MAGIC;
+	header->version = STATE_VERSION;
+	header->size = size;
+	strncpy(header->name, name, STATE_NAME_SIZE - 1);
+	
+	return (header);
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * File name  : wd_state.h
+ * Developer  : Eyal Weizman
+ * Date		  : 2020-03-08
+ * Description: persistent state region - shared memory (a memfd) which is
+ *				kept by the WD and handed to every revived instance of the
+ *				app, so it can start with warm caches instead of cold ones.
+ ******************************************************************************/
+#ifndef _WD_STATE_H_
+#define _WD_STATE_H_
+
+#include <stddef.h>			/* size_t */
+#include <stdint.h>			/* uint32_t, uint64_t */
+#include <stdatomic.h>		/* _Atomic */
+
+/*** MACROS ***/
+#define STATE_MAGIC (0x57445331)	/* "WDS1" */
+#define STATE_VERSION (1)			/* of the header below */
+#define STATE_NAME_SIZE (32)
+
+/*	the data of the app follows the header */
+#define STATE_DATA(header) ((void *)((char *)(header) + \
+									 sizeof(wd_state_header_t)))
+
+/*** structures ***/
+/*	the head of the region. the app reads it to tell a warm region from a
+	new one, and a clean handover from a crash */
+typedef struct wd_state_header_s
+{
+	uint32_t			magic;			/* STATE_MAGIC */
+	uint32_t			version;		/* STATE_VERSION */
+	uint64_t			size;			/* of the data */
+	uint64_t			generation;		/* instances attached so far - 1 in
+										   a new region */
+	_Atomic uint32_t	attached;		/* an instance uses the region */
+	uint32_t			clean_shutdown;	/* the previous instance has detached
+										   by WDLetMeDie. FALSE after a crash
+										   or a hang - the data may be half
+										   written */
+	int32_t				owner_pid;		/* the instance attached last */
+	uint32_t			reserved1;
+	char				name[STATE_NAME_SIZE];
+	char				reserved2[56];
+} wd_state_header_t;
+
+/* the data starts on a cache line of its own */
+typedef char state_header_size_check[(128 == sizeof(wd_state_header_t)) ?
+									 1 : -1];
+
+/******************************* StateAttach **********************************/
+/*
+ * description  :  maps the region kept for this proc if it was made by the
+ *				   same name & size, and creates a new one otherwise (then it
+ *				   is marked to be handed to the peer - see StateTakePending).
+ *				   counts the attach in the header. a proc has one region -
+ *				   attaching again by the same name & size returns it.
+ *
+ * return value :  the header of the region, followed by size bytes of data.
+ *				   NULL if it couldn't be created, or another region is
+ *				   attached already.
+ */
+wd_state_header_t *StateAttach(const char *name, size_t size);
+
+/******************************* StateDetach **********************************/
+/*
+ * description  :  marks a clean shutdown in the region, unless another
+ *				   instance has attached it since. the region stays mapped.
+ */
+void StateDetach(void);
+
+/******************************* StateSetFd ***********************************/
+/*
+ * description  :  keeps fd as the region of this proc, from the peer. the
+ *				   previous one is closed.
+ */
+void StateSetFd(int fd);
+
+/******************************* StateDupFd ***********************************/
+/*
+ * description  :  returns a duplicate of the fd of the region, to be handed
+ *				   to the peer & closed. -1 if there is no region.
+ */
+int StateDupFd(void);
+
+/**************************** StateTakePending ********************************/
+/*
+ * description  :  returns TRUE once after a new region was created - it
+ *				   should be handed to the peer.
+ */
+int StateTakePending(void);
+
+#endif /* _WD_STATE_H_ */